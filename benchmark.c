@@ -0,0 +1,405 @@
+#include "engine/mental.h"
+#include "engine/component.h"
+#include "engine/wm.h"
+#include "engine/texture.h"
+#include "engine/shader.h"
+#include "engine/glstate.h"
+#include "engine/transform.h"
+#include "engine/renderqueue.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Сцена для замеров: N копий модели (россыпь камней) рисуются двумя способами —
+// отдельным mentalDrawModel3DComponent на каждую копию и одним
+// glDrawElementsInstanced через mentalSetModelInstances.
+// Затем M объектов вращаются каждый кадр, и их матрицы собираются двумя
+// способами — по одному через MentalTransform и пакетом SIMD прямо в
+// отображенный буфер экземпляров (mentalTransformBatchCompose).
+// Наконец, та же россыпь копий идет через очередь отрисовки без
+// предварительного прохода глубины и с ним: PBR шейдер во втором случае
+// выполняется только для видимых пикселей.
+// Окно создается скрытым, рисование идет в его буфер кадра как обычно.
+// Запуск: ./build/benchmark [копий] [кадров] [объектов с анимацией]
+
+#define BENCH_DEFAULT_INSTANCES     20000
+#define BENCH_DEFAULT_FRAMES        300
+#define BENCH_DEFAULT_ANIMATED      100000
+#define BENCH_SPIN_SPEED            50.0f   // Градусов в секунду, как у rectangle в mentalRunWM
+#define BENCH_WARMUP_FRAMES         30
+#define BENCH_READY_TIMEOUT         10.0    // Секунд на компиляцию варианта программы
+#define BENCH_SPACING               2.0f
+
+typedef enum BenchMode {
+    BENCH_MODE_SEPARATE = 0,    // mentalDrawModel3DComponent на каждую копию
+    BENCH_MODE_INSTANCED,       // Все копии одним вызовом
+    BENCH_MODE_QUEUE,           // Копии одним вызовом через очередь отрисовки
+    BENCH_MODE_PREPASS,         // То же с предварительным проходом глубины
+} BenchMode;
+
+typedef struct BenchPlacement {
+    float position[3];
+    float yaw;              // В градусах, как mentalSetRotation
+    float scale;
+} BenchPlacement;
+
+typedef struct BenchResult {
+    double   cpuMs;         // Отправка команд: от первого до последнего вызова отрисовки
+    double   frameMs;       // До завершения работы GPU (glFinish)
+    uint32_t glCalls;       // Вызовов состояния GL за кадр, дошедших до драйвера
+    uint32_t frames;
+} BenchResult;
+
+static uint32_t bench_random(uint32_t* pState)
+{
+    // xorshift32: сцена одинакова от запуска к запуску
+    uint32_t x = *pState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *pState = x;
+    return x;
+}
+
+static float bench_random01(uint32_t* pState)
+{
+    return (float)(bench_random(pState) >> 8) / (float)(1u << 24);
+}
+
+// Копии на квадратной сетке с разбросом по положению, повороту, размеру и оттенку
+static void bench_scatter(BenchPlacement* pPlacements, MentalModelInstance* pInstances, uint32_t count)
+{
+    uint32_t seed = 0x9E3779B9u;
+    uint32_t side = (uint32_t)ceilf(sqrtf((float)count));
+    float half = (float)side * BENCH_SPACING * 0.5f;
+
+    for (uint32_t i = 0; i < count; i++) {
+        BenchPlacement* pPlacement = &pPlacements[i];
+        pPlacement->position[0] = (float)(i % side) * BENCH_SPACING - half + (bench_random01(&seed) - 0.5f) * BENCH_SPACING;
+        pPlacement->position[1] = -1.0f;
+        pPlacement->position[2] = -(float)(i / side) * BENCH_SPACING + (bench_random01(&seed) - 0.5f) * BENCH_SPACING;
+        pPlacement->yaw = bench_random01(&seed) * 360.0f;
+        pPlacement->scale = 0.3f + bench_random01(&seed) * 0.5f;
+
+        MentalModelInstance* pInstance = &pInstances[i];
+        glm_mat4_identity(pInstance->model);
+        glm_translate(pInstance->model, pPlacement->position);
+        glm_rotate(pInstance->model, glm_rad(pPlacement->yaw), (vec3){0.0f, 1.0f, 0.0f});
+        glm_scale_uni(pInstance->model, pPlacement->scale);
+        float shade = 0.7f + bench_random01(&seed) * 0.3f;
+        glm_vec4_copy((vec4){shade, shade * (0.9f + bench_random01(&seed) * 0.1f), shade * 0.85f, 1.0f}, pInstance->tint);
+        pInstance->lod = 0;
+        pInstance->material = 0;
+    }
+}
+
+static void bench_begin_frame(MentalWindowManager* pManager, float time)
+{
+    mentalTextureBeginFrame();
+    mentalGLStateBeginFrame();
+    mentalShaderPoll();
+
+    int width, height;
+    glfwGetFramebufferSize(pManager->pNext, &width, &height);
+    mentalGLViewport(0, 0, width, height);
+    mentalUpdateFrameData(&pManager->frame, &pManager->camera, width, height, time);
+
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+// Вариант программы для режима собран и выбран моделью; для прохода глубины
+// готов и вариант DEPTH_ONLY — очередь записала им глубину копий
+static bool bench_program_ready(MentalWindowManager* pManager, const MentalComponent* pModel, BenchMode eMode)
+{
+    bool instanced = eMode != BENCH_MODE_SEPARATE;
+    bool prepassed = eMode != BENCH_MODE_PREPASS || pManager->queue.stats.prepassCount > 0;
+    return mentalShaderIsReady(pModel->shaderProgram) && pModel->modelData->programInstanced == instanced && prepassed;
+}
+
+static BenchResult bench_run(MentalWindowManager* pManager, MentalComponent* pModel, const BenchPlacement* pPlacements,
+                             uint32_t count, uint32_t frames, BenchMode eMode)
+{
+    BenchResult result = {0};
+    pManager->queue.depthPrepass = eMode == BENCH_MODE_PREPASS;
+    double readyDeadline = glfwGetTime() + BENCH_READY_TIMEOUT;
+    uint32_t warmup = 0;
+
+    while (result.frames < frames && !glfwWindowShouldClose(pManager->pNext)) {
+        double frameStart = glfwGetTime();
+        bench_begin_frame(pManager, (float)frameStart);
+
+        switch (eMode) {
+            case BENCH_MODE_SEPARATE:
+                for (uint32_t i = 0; i < count; i++) {
+                    const BenchPlacement* pPlacement = &pPlacements[i];
+                    mentalSetPosition3D(pModel, pPlacement->position[0], pPlacement->position[1], pPlacement->position[2]);
+                    mentalSetRotation(pModel, 0.0f, pPlacement->yaw, 0.0f);
+                    mentalSetSize(pModel, pPlacement->scale);
+                    mentalDrawModel3DComponent(pModel, pManager);
+                }
+                break;
+            case BENCH_MODE_INSTANCED:
+                mentalDrawModel3DComponent(pModel, pManager);
+                break;
+            case BENCH_MODE_QUEUE:
+            case BENCH_MODE_PREPASS:
+                mentalRenderQueueBegin(&pManager->queue);
+                mentalSubmitComponent(&pManager->queue, pManager, pModel);
+                mentalRenderQueueFlush(&pManager->queue, pManager);
+                break;
+        }
+
+        double submitted = glfwGetTime();
+        glFinish();
+        double finished = glfwGetTime();
+
+        glfwSwapBuffers(pManager->pNext);
+        glfwPollEvents();
+
+        // Замер начинается, когда программа готова и драйвер прогрет
+        bool ready = bench_program_ready(pManager, pModel, eMode) || finished > readyDeadline;
+        if (!ready || warmup < BENCH_WARMUP_FRAMES) {
+            warmup += ready ? 1 : 0;
+            continue;
+        }
+        result.cpuMs += (submitted - frameStart) * 1000.0;
+        result.frameMs += (finished - frameStart) * 1000.0;
+        result.frames++;
+    }
+
+    // Закрываем счетчики последнего кадра
+    mentalGLStateBeginFrame();
+    MentalGLStateStats glStats;
+    mentalGLStateGetStats(&glStats);
+    result.glCalls = glStats.frameIssued;
+
+    if (result.frames > 0) {
+        result.cpuMs /= result.frames;
+        result.frameMs /= result.frames;
+    }
+    pManager->queue.depthPrepass = false;
+    return result;
+}
+
+typedef struct BenchTransformResult {
+    double   perObjectMs;   // MentalTransform на объект, копия матрицы в отображенный буфер
+    double   batchMs;       // SoA -> матрицы и матрицы нормалей пакетом в отображенный буфер
+    uint32_t frames;
+} BenchTransformResult;
+
+// Только сборка матриц и запись в буфер экземпляров; отрисовка не входит в замер.
+// Оба пути пишут в отображенный буфер и закрывают его без границ копий, чтобы
+// разница была только в сборке матриц, а не в пересчете границ
+static BenchTransformResult bench_transforms(MentalWindowManager* pManager, MentalComponent* pModel,
+                                             const BenchPlacement* pPlacements, MentalModelInstance* pInstances,
+                                             uint32_t count, uint32_t frames)
+{
+    BenchTransformResult result = {0};
+    MentalTransform* pTransforms = malloc(sizeof(MentalTransform) * count);
+    float* pAngles = malloc(sizeof(float) * count * 2);
+    float (*pNormals)[12] = malloc(sizeof(float) * 12 * count);
+    MentalTransformSoA soa = {0};
+    if (!pTransforms || !pAngles || !pNormals || mentalTransformSoAReserve(&soa, count) != MENTAL_OK) {
+        printf("Failed to allocate %u animated objects\n", count);
+        free(pTransforms);
+        free(pAngles);
+        free(pNormals);
+        mentalTransformSoAFree(&soa);
+        return result;
+    }
+
+    float* pZero = pAngles + count;
+    for (uint32_t i = 0; i < count; i++) {
+        mentalTransformInit(&pTransforms[i]);
+        mentalTransformSetPosition(&pTransforms[i], pPlacements[i].position[0], pPlacements[i].position[1],
+                                   pPlacements[i].position[2]);
+        mentalTransformSetScale(&pTransforms[i], pPlacements[i].scale);
+        soa.lanes[MENTAL_TRANSFORM_LANE_POSITION_X][i] = pPlacements[i].position[0];
+        soa.lanes[MENTAL_TRANSFORM_LANE_POSITION_Y][i] = pPlacements[i].position[1];
+        soa.lanes[MENTAL_TRANSFORM_LANE_POSITION_Z][i] = pPlacements[i].position[2];
+        soa.lanes[MENTAL_TRANSFORM_LANE_SCALE][i] = pPlacements[i].scale;
+        pZero[i] = 0.0f;
+    }
+
+    double perObjectMs = 0.0;
+    double batchMs = 0.0;
+    uint32_t warmup = 0;
+    while (result.frames < frames && !glfwWindowShouldClose(pManager->pNext)) {
+        double frameStart = glfwGetTime();
+        bench_begin_frame(pManager, (float)frameStart);
+        float spin = (float)frameStart * BENCH_SPIN_SPEED;
+
+        // 1. По объекту: поворот, пересчет кэша и копия матрицы в буфер на GPU
+        double start = glfwGetTime();
+        MentalModelInstance* pMapped = mentalMapModelInstances(pModel, count);
+        if (pMapped) {
+            for (uint32_t i = 0; i < count; i++) {
+                mentalTransformSetEuler(&pTransforms[i], 0.0f, pPlacements[i].yaw + spin, 0.0f);
+                memcpy(pMapped[i].model, mentalTransformWorld(&pTransforms[i]), sizeof(mat4));
+                memcpy(pMapped[i].tint, pInstances[i].tint, sizeof(vec4));
+                pMapped[i].lod = 0;
+                pMapped[i].material = 0;
+            }
+            mentalUnmapModelInstances(pModel, NULL);
+        }
+        double perObjectDone = glfwGetTime();
+
+        // 2. Пакетом: углы -> кватернионы, затем матрицы прямо в буфер на GPU
+        for (uint32_t i = 0; i < count; i++) {
+            pAngles[i] = pPlacements[i].yaw + spin;
+        }
+        mentalTransformSoASetEuler(&soa, 0, count, pZero, pAngles, pZero);
+        pMapped = mentalMapModelInstances(pModel, count);
+        if (pMapped) {
+            mentalTransformBatchCompose(&soa, count, pMapped->model, sizeof(MentalModelInstance), pNormals,
+                                        sizeof(pNormals[0]));
+            for (uint32_t i = 0; i < count; i++) {
+                memcpy(pMapped[i].tint, pInstances[i].tint, sizeof(vec4));
+                pMapped[i].lod = 0;
+                pMapped[i].material = 0;
+            }
+            mentalUnmapModelInstances(pModel, NULL);
+        }
+        double batchDone = glfwGetTime();
+
+        mentalDrawModel3DComponent(pModel, pManager);
+        glfwSwapBuffers(pManager->pNext);
+        glfwPollEvents();
+
+        if (warmup < BENCH_WARMUP_FRAMES) {
+            warmup++;
+            continue;
+        }
+        perObjectMs += (perObjectDone - start) * 1000.0;
+        batchMs += (batchDone - perObjectDone) * 1000.0;
+        result.frames++;
+    }
+
+    if (result.frames > 0) {
+        result.perObjectMs = perObjectMs / result.frames;
+        result.batchMs = batchMs / result.frames;
+    }
+    free(pTransforms);
+    free(pAngles);
+    free(pNormals);
+    mentalTransformSoAFree(&soa);
+    return result;
+}
+
+static void bench_print(const char* pLabel, uint32_t count, BenchResult result)
+{
+    printf("%-10s %6u copies: submit %8.3f ms, frame %8.3f ms, %6u GL state calls/frame (%u frames)\n",
+           pLabel, count, result.cpuMs, result.frameMs, result.glCalls, result.frames);
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_INSTANCES;
+    uint32_t frames = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : BENCH_DEFAULT_FRAMES;
+    uint32_t animated = argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 10) : BENCH_DEFAULT_ANIMATED;
+    if (count == 0 || frames == 0 || animated == 0) {
+        printf("Usage: %s [copies] [frames] [animated objects]\n", argv[0]);
+        return -1;
+    }
+
+    MentalWindowManager wm = {0};
+    MentalWindowManagerInfo wmInfo = {
+        .eType = MENTAL_STRUCTURE_TYPE_WINDOW_MANAGER_INFO,
+        .aSizes = {1280, 720},
+        .pTitle = "Instancing Benchmark",
+        .bHidden = true
+    };
+    wm.pInfo = &wmInfo;
+    if (mentalCreateWM(&wm) != MENTAL_SUCCESS) {
+        printf("Failed to create window manager\n");
+        return -1;
+    }
+    // Без вертикальной синхронизации время кадра — время работы, а не ожидания
+    glfwSwapInterval(0);
+
+    MentalComponent model = {0};
+    if (mentalCreateModel3DComponent(&model) != MENTAL_SUCCESS ||
+        mentalLoadModel3D(&model, "cube.obj") != MENTAL_SUCCESS) {
+        printf("Failed to load benchmark model\n");
+        mentalDestroyWM(&wm);
+        return -1;
+    }
+    mentalSetModelPBRMaterial(&model, (vec3){0.45f, 0.42f, 0.4f}, 0.0f, 0.85f, 1.0f);
+    if (mentalAttachPBRShader(&model) != MENTAL_SUCCESS) {
+        printf("Failed to attach PBR shaders\n");
+        mentalDestroyModel3DComponent(&model);
+        mentalDestroyWM(&wm);
+        return -1;
+    }
+
+    BenchPlacement* pPlacements = malloc(sizeof(BenchPlacement) * count);
+    MentalModelInstance* pInstances = malloc(sizeof(MentalModelInstance) * count);
+    if (!pPlacements || !pInstances) {
+        printf("Failed to allocate %u instances\n", count);
+        free(pPlacements);
+        free(pInstances);
+        mentalDestroyModel3DComponent(&model);
+        mentalDestroyWM(&wm);
+        return -1;
+    }
+    bench_scatter(pPlacements, pInstances, count);
+
+    // Камера над россыпью, взгляд вниз вдоль нее
+    float side = ceilf(sqrtf((float)count)) * BENCH_SPACING;
+    glm_vec3_copy((vec3){0.0f, side * 0.25f + 5.0f, 10.0f}, wm.camera.position);
+    wm.camera.pitch = -30.0f;
+    mental_camera_update_vectors(&wm.camera);
+
+    // 1. Отдельный вызов на каждую копию
+    mentalSetModelInstances(&model, NULL, 0);
+    BenchResult separate = bench_run(&wm, &model, pPlacements, count, frames, BENCH_MODE_SEPARATE);
+
+    // 2. Все копии одним вызовом; преобразование компонента — единичное
+    mentalSetPosition3D(&model, 0.0f, 0.0f, 0.0f);
+    mentalSetRotation(&model, 0.0f, 0.0f, 0.0f);
+    mentalSetSize(&model, 1.0f);
+    mentalSetModelInstances(&model, pInstances, count);
+    BenchResult instanced = bench_run(&wm, &model, pPlacements, count, frames, BENCH_MODE_INSTANCED);
+
+    bench_print("separate", count, separate);
+    bench_print("instanced", count, instanced);
+    if (instanced.cpuMs > 0.0 && instanced.frameMs > 0.0) {
+        printf("speedup: submit x%.1f, frame x%.1f\n", separate.cpuMs / instanced.cpuMs,
+               separate.frameMs / instanced.frameMs);
+    }
+
+    // 3. Очередь отрисовки без предварительного прохода глубины и с ним
+    BenchResult queued = bench_run(&wm, &model, pPlacements, count, frames, BENCH_MODE_QUEUE);
+    BenchResult prepass = bench_run(&wm, &model, pPlacements, count, frames, BENCH_MODE_PREPASS);
+    bench_print("queue", count, queued);
+    bench_print("prepass", count, prepass);
+    if (prepass.frameMs > 0.0) {
+        printf("speedup: depth pre-pass frame x%.2f\n", queued.frameMs / prepass.frameMs);
+    }
+
+    // 4. Анимация: матрицы всех объектов пересобираются каждый кадр
+    BenchPlacement* pAnimated = malloc(sizeof(BenchPlacement) * animated);
+    MentalModelInstance* pAnimatedInstances = malloc(sizeof(MentalModelInstance) * animated);
+    if (pAnimated && pAnimatedInstances) {
+        bench_scatter(pAnimated, pAnimatedInstances, animated);
+        BenchTransformResult transforms = bench_transforms(&wm, &model, pAnimated, pAnimatedInstances, animated, frames);
+        printf("%-10s %6u objects: per object %8.3f ms, batched %8.3f ms (%u frames)\n", "transforms", animated,
+               transforms.perObjectMs, transforms.batchMs, transforms.frames);
+        if (transforms.batchMs > 0.0) {
+            printf("speedup: transforms x%.1f\n", transforms.perObjectMs / transforms.batchMs);
+        }
+    } else {
+        printf("Failed to allocate %u animated objects\n", animated);
+    }
+
+    free(pAnimated);
+    free(pAnimatedInstances);
+    free(pPlacements);
+    free(pInstances);
+    mentalDestroyModel3DComponent(&model);
+    mentalReleasePBRVariants();
+    mentalShaderShutdown();
+    mentalDestroyWM(&wm);
+    return 0;
+}
@@ -4,7 +4,19 @@ out vec4 FragColor;
 in vec3 WorldPos;
 in vec3 LocalPos;
 
-uniform float time;
+// Данные кадра (engine/frame.h), общий UBO для всех программ
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    float time;
+    vec3 lightPos;
+    float aspect;
+    vec3 lightColor;
+    float framePadding;
+    vec2 resolution;
+};
 
 // Улучшенные функции шума для более реалистичных облаков
 float hash(vec3 p) {
@@ -0,0 +1,8 @@
+#version 330 core
+
+// Предварительный проход глубины (вариант DEPTH_ONLY): запись цвета выключена,
+// глубину пишет растеризатор. Дорогой pbr_fragment.glsl потом выполняется
+// с GL_EQUAL только для видимых пикселей
+void main()
+{
+}
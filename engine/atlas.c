@@ -0,0 +1,293 @@
+#include "atlas.h"
+#include "texture.h"
+#include "glstate.h"
+#include "imageproc.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "../stb_image.h"
+
+// Класс размера: ближайшая степень двойки, не меньше стороны изображения
+static uint32_t mental_atlas_size_class(int width, int height)
+{
+    uint32_t side = (uint32_t)(width > height ? width : height);
+    uint32_t sizeClass = MENTAL_ATLAS_MIN_SIZE_CLASS;
+    while (sizeClass < side) {
+        sizeClass <<= 1;
+    }
+    return sizeClass;
+}
+
+static GLenum mental_atlas_format(int channels)
+{
+    switch (channels) {
+        case 1: return GL_RED;
+        case 3: return GL_RGB;
+        case 4: return GL_RGBA;
+        default: return 0;
+    }
+}
+
+static GLenum mental_atlas_internal_format(int channels)
+{
+    switch (channels) {
+        case 1: return GL_R8;
+        case 3: return GL_RGB8;
+        case 4: return GL_RGBA8;
+        default: return 0;
+    }
+}
+
+static MentalAtlasPage* mental_atlas_create_page(MentalTextureAtlas* pAtlas, uint32_t sizeClass, int channels)
+{
+    if (pAtlas->pageCount >= MENTAL_ATLAS_MAX_PAGES) {
+        MENTAL_DEBUG("Texture atlas is full: %u pages", pAtlas->pageCount);
+        return NULL;
+    }
+
+    MentalAtlasPage* pPage = &pAtlas->pages[pAtlas->pageCount];
+    memset(pPage, 0, sizeof(MentalAtlasPage));
+    pPage->sizeClass = sizeClass;
+    pPage->channels = channels;
+    pPage->layerCount = pAtlas->layersPerPage;
+
+    glGenTextures(1, &pPage->texture);
+    mentalGLBindTexture(GL_TEXTURE_2D_ARRAY, pPage->texture);
+
+    // Выделяем все уровни мипмапов сразу, данные заливаются послойно
+    GLenum format = mental_atlas_format(channels);
+    GLenum internalFormat = mental_atlas_internal_format(channels);
+    uint32_t levelSize = sizeClass;
+    for (GLint level = 0; levelSize > 0; level++, levelSize >>= 1) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, levelSize, levelSize,
+                     pPage->layerCount, 0, format, GL_UNSIGNED_BYTE, NULL);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    mentalGLBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    mentalTextureRegister(pPage->texture, GL_TEXTURE_2D_ARRAY, sizeClass, sizeClass, pPage->layerCount, channels,
+                          MENTAL_TEXTURE_FLAG_MIPMAPS | MENTAL_TEXTURE_FLAG_PINNED, NULL);
+
+    pAtlas->pageCount++;
+    MENTAL_DEBUG("Atlas page %u created: %ux%u x %u layers, %d channels",
+                 pAtlas->pageCount - 1, sizeClass, sizeClass, pPage->layerCount, channels);
+    return pPage;
+}
+
+// Копия изображения размером во весь слой: последний столбец и последняя строка
+// повторяются в отступ, поэтому билинейная фильтрация у края и мипмапы
+// видят те же значения, что и GL_CLAMP_TO_EDGE для отдельной текстуры
+static unsigned char* mental_atlas_pad_edges(const unsigned char* data, int width, int height, int channels,
+                                             uint32_t sizeClass)
+{
+    size_t pixelSize = (size_t)channels;
+    size_t srcPitch = (size_t)width * pixelSize;
+    size_t dstPitch = (size_t)sizeClass * pixelSize;
+    unsigned char* padded = (unsigned char*)malloc(dstPitch * sizeClass);
+    if (!padded) {
+        return NULL;
+    }
+
+    for (int y = 0; y < height; y++) {
+        unsigned char* row = padded + (size_t)y * dstPitch;
+        memcpy(row, data + (size_t)y * srcPitch, srcPitch);
+        const unsigned char* last = row + srcPitch - pixelSize;
+        for (size_t offset = srcPitch; offset < dstPitch; offset += pixelSize) {
+            memcpy(row + offset, last, pixelSize);
+        }
+    }
+    const unsigned char* lastRow = padded + (size_t)(height - 1) * dstPitch;
+    for (uint32_t y = (uint32_t)height; y < sizeClass; y++) {
+        memcpy(padded + (size_t)y * dstPitch, lastRow, dstPitch);
+    }
+    return padded;
+}
+
+MentalResult mentalCreateTextureAtlas(MentalTextureAtlas* pAtlas, uint32_t layersPerPage)
+{
+    if (!pAtlas) {
+        MENTAL_DEBUG("Texture atlas pointer is null.");
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    memset(pAtlas, 0, sizeof(MentalTextureAtlas));
+
+    GLint maxLayers = 0, maxSize = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+
+    if (layersPerPage == 0) {
+        layersPerPage = MENTAL_ATLAS_DEFAULT_LAYERS;
+    }
+    if (maxLayers > 0 && layersPerPage > (uint32_t)maxLayers) {
+        layersPerPage = (uint32_t)maxLayers;
+    }
+
+    pAtlas->layersPerPage = layersPerPage;
+    pAtlas->maxSizeClass = maxSize > 0 ? (uint32_t)maxSize : 4096;
+
+    MENTAL_DEBUG("Texture atlas created: %u layers per page, max size class %u",
+                 pAtlas->layersPerPage, pAtlas->maxSizeClass);
+    return MENTAL_OK;
+}
+
+MentalResult mentalAtlasAddImage(MentalTextureAtlas* pAtlas, const unsigned char* data,
+                                 int width, int height, int channels, MentalAtlasSlot* pSlot)
+{
+    if (!pAtlas || !data || !pSlot) {
+        MENTAL_DEBUG("Texture atlas, image data or slot pointer is null.");
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    if (width <= 0 || height <= 0) {
+        return MENTAL_ERROR_INVALID_PARAMETER;
+    }
+
+    if (mental_atlas_format(channels) == 0) {
+        MENTAL_DEBUG("Unsupported atlas image format: %d channels", channels);
+        return MENTAL_ERROR_TEXTURE_UNSUPPORTED_FORMAT;
+    }
+
+    uint32_t sizeClass = mental_atlas_size_class(width, height);
+    if (sizeClass > pAtlas->maxSizeClass) {
+        MENTAL_DEBUG("Image %dx%d exceeds atlas size class limit %u", width, height, pAtlas->maxSizeClass);
+        return MENTAL_ERROR_TEXTURE_UNSUPPORTED_FORMAT;
+    }
+
+    // Ищем страницу того же класса и формата со свободным слоем
+    MentalAtlasPage* pPage = NULL;
+    uint32_t pageIndex = 0;
+    for (uint32_t i = 0; i < pAtlas->pageCount; i++) {
+        MentalAtlasPage* pCandidate = &pAtlas->pages[i];
+        if (pCandidate->sizeClass == sizeClass && pCandidate->channels == channels &&
+            pCandidate->usedLayers < pCandidate->layerCount) {
+            pPage = pCandidate;
+            pageIndex = i;
+            break;
+        }
+    }
+
+    if (!pPage) {
+        pageIndex = pAtlas->pageCount;
+        pPage = mental_atlas_create_page(pAtlas, sizeClass, channels);
+        if (!pPage) {
+            return MENTAL_ERROR_OUT_OF_MEMORY;
+        }
+    }
+
+    // Меньшее изображение заливается вместе с отступом: иначе фильтрация
+    // и glGenerateMipmap читают неинициализированную часть слоя
+    unsigned char* padded = NULL;
+    if ((uint32_t)width != sizeClass || (uint32_t)height != sizeClass) {
+        padded = mental_atlas_pad_edges(data, width, height, channels, sizeClass);
+        if (!padded) {
+            return MENTAL_ERROR_OUT_OF_MEMORY;
+        }
+    }
+
+    uint32_t layer = pPage->usedLayers++;
+
+    mentalGLBindTexture(GL_TEXTURE_2D_ARRAY, pPage->texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, sizeClass, sizeClass, 1,
+                    mental_atlas_format(channels), GL_UNSIGNED_BYTE, padded ? padded : data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    mentalGLBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    free(padded);
+    pPage->dirty = true;
+
+    pSlot->texture = pPage->texture;
+    pSlot->page = pageIndex;
+    pSlot->layer = layer;
+    pSlot->uvScale[0] = (float)width / (float)sizeClass;
+    pSlot->uvScale[1] = (float)height / (float)sizeClass;
+
+    MENTAL_DEBUG("Atlas image %dx%d placed into page %u, layer %u", width, height, pageIndex, layer);
+    return MENTAL_OK;
+}
+
+MentalResult mentalAtlasLoadImage(MentalTextureAtlas* pAtlas, const char* path, MentalAtlasSlot* pSlot)
+{
+    if (!pAtlas || !path || !pSlot) {
+        MENTAL_DEBUG("Texture atlas, path or slot pointer is null.");
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    // Файл уже в атласе — отдаем тот же слой
+    for (uint32_t i = 0; i < pAtlas->entryCount; i++) {
+        if (strcmp(pAtlas->entries[i].path, path) == 0) {
+            *pSlot = pAtlas->entries[i].slot;
+            return MENTAL_OK;
+        }
+    }
+
+    // Цветные изображения в атласе хранятся только как RGBA: драйвер все равно
+    // выравнивает RGB8 до 4 байт, а общий формат не плодит отдельные страницы
+    int width, height, channels;
+    if (!stbi_info(path, &width, &height, &channels)) {
+        MENTAL_DEBUG("Failed to load atlas texture: %s", path);
+        return MENTAL_ERROR_TEXTURE_LOAD_FAILED;
+    }
+    unsigned char* data = mentalImageLoad(path, &width, &height, &channels, channels == 1 ? 1 : 4);
+    if (!data) {
+        MENTAL_DEBUG("Failed to load atlas texture: %s", path);
+        return MENTAL_ERROR_TEXTURE_LOAD_FAILED;
+    }
+
+    MentalResult result = mentalAtlasAddImage(pAtlas, data, width, height, channels, pSlot);
+    stbi_image_free(data);
+    if (result != MENTAL_OK) {
+        return result;
+    }
+
+    if (pAtlas->entryCount < MENTAL_ATLAS_MAX_ENTRIES) {
+        MentalAtlasEntry* pEntry = &pAtlas->entries[pAtlas->entryCount++];
+        strncpy(pEntry->path, path, sizeof(pEntry->path) - 1);
+        pEntry->path[sizeof(pEntry->path) - 1] = '\0';
+        pEntry->slot = *pSlot;
+    }
+
+    return MENTAL_OK;
+}
+
+MentalResult mentalAtlasFlush(MentalTextureAtlas* pAtlas)
+{
+    if (!pAtlas) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    // Перестраиваем мипмапы только у страниц, в которые что-то добавили
+    for (uint32_t i = 0; i < pAtlas->pageCount; i++) {
+        MentalAtlasPage* pPage = &pAtlas->pages[i];
+        if (!pPage->dirty) {
+            continue;
+        }
+        mentalGLBindTexture(GL_TEXTURE_2D_ARRAY, pPage->texture);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        pPage->dirty = false;
+    }
+    mentalGLBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    return MENTAL_OK;
+}
+
+MentalResult mentalDestroyTextureAtlas(MentalTextureAtlas* pAtlas)
+{
+    if (!pAtlas) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    for (uint32_t i = 0; i < pAtlas->pageCount; i++) {
+        if (pAtlas->pages[i].texture != 0) {
+            mentalTextureDelete(&pAtlas->pages[i].texture);
+        }
+    }
+    pAtlas->pageCount = 0;
+    pAtlas->entryCount = 0;
+
+    MENTAL_DEBUG("Texture atlas destroyed.");
+    return MENTAL_OK;
+}
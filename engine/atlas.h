@@ -0,0 +1,60 @@
+#ifndef mental_atlas_h
+#define mental_atlas_h
+
+#include "mental.h"
+
+// Атлас текстур на основе GL_TEXTURE_2D_ARRAY.
+// Текстуры одного класса размера (сторона округляется вверх до степени двойки)
+// и одного формата складываются в слои общей страницы, поэтому модели
+// с разными текстурами используют одну и ту же привязку и могут
+// рисоваться одним instanced/multi-draw вызовом.
+
+#define MENTAL_ATLAS_MAX_PAGES          32
+#define MENTAL_ATLAS_MAX_ENTRIES        256
+#define MENTAL_ATLAS_DEFAULT_LAYERS     16
+#define MENTAL_ATLAS_MIN_SIZE_CLASS     64
+
+// Фиксированный текстурный блок для sampler2DArray в PBR шейдере,
+// чтобы он не пересекался с блоками обычных sampler2D
+#define MENTAL_ATLAS_TEXTURE_UNIT       7
+
+// Положение текстуры в атласе (то, что хранит материал вместо ID текстуры)
+typedef struct MentalAtlasSlot {
+    uint32_t   texture;        // GL_TEXTURE_2D_ARRAY страницы
+    uint32_t   page;           // Индекс страницы в атласе
+    uint32_t   layer;          // Слой внутри страницы
+    float      uvScale[2];     // Доля слоя, занятая изображением
+} MentalAtlasSlot;
+
+typedef struct MentalAtlasPage {
+    uint32_t   texture;
+    uint32_t   sizeClass;      // Сторона слоя (степень двойки)
+    int        channels;       // 1, 3 или 4 канала
+    uint32_t   layerCount;
+    uint32_t   usedLayers;
+    bool       dirty;          // Мипмапы нужно перестроить
+} MentalAtlasPage;
+
+// Запись о уже загруженном файле, чтобы одна текстура попадала в атлас один раз
+typedef struct MentalAtlasEntry {
+    char            path[256];
+    MentalAtlasSlot slot;
+} MentalAtlasEntry;
+
+typedef struct MentalTextureAtlas {
+    MentalAtlasPage  pages[MENTAL_ATLAS_MAX_PAGES];
+    uint32_t         pageCount;
+    uint32_t         layersPerPage;
+    uint32_t         maxSizeClass;
+    MentalAtlasEntry entries[MENTAL_ATLAS_MAX_ENTRIES];
+    uint32_t         entryCount;
+} MentalTextureAtlas;
+
+MentalResult mentalCreateTextureAtlas(MentalTextureAtlas* pAtlas, uint32_t layersPerPage);
+MentalResult mentalAtlasAddImage(MentalTextureAtlas* pAtlas, const unsigned char* data,
+                                 int width, int height, int channels, MentalAtlasSlot* pSlot);
+MentalResult mentalAtlasLoadImage(MentalTextureAtlas* pAtlas, const char* path, MentalAtlasSlot* pSlot);
+MentalResult mentalAtlasFlush(MentalTextureAtlas* pAtlas);
+MentalResult mentalDestroyTextureAtlas(MentalTextureAtlas* pAtlas);
+
+#endif // mental_atlas_h
@@ -2,6 +2,9 @@
 #include "component.h"
 #include "wm.h"
 #include "perlin.h"
+#include "shader.h"
+#include "uniforms.h"
+#include "glstate.h"
 #include <math.h>
 
 // Cloud component functions
@@ -132,7 +135,7 @@ void __mental_create_clouds(MentalComponent *pComponent) {
     glGenBuffers(1, &pComponent->VBO);
     glGenBuffers(1, &pComponent->EBO);
     
-    glBindVertexArray(pComponent->VAO);
+    mentalGLBindVertexArray(pComponent->VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, pComponent->VBO);
     glBufferData(GL_ARRAY_BUFFER, totalVertices * 3 * sizeof(float), vertices, GL_STATIC_DRAW);
@@ -143,7 +146,13 @@ void __mental_create_clouds(MentalComponent *pComponent) {
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
-    glBindVertexArray(0);
+    mentalGLBindVertexArray(0);
+    
+    // Шейдер колышет вершины на 0.05 * (1 + 0.2 * y): запас по самой высокой точке
+    mentalBoundsFromPoints(&pComponent->bounds, vertices, (uint32_t)totalVertices);
+    pComponent->worldBoundsVersion = 0;
+    float topY = fabsf(pComponent->bounds.center[1]) + pComponent->bounds.extents[1];
+    mentalBoundsInflate(&pComponent->bounds, 0.05f * (1.0f + 0.2f * topY));
     
     // Освобождаем память
     free(vertices);
@@ -161,13 +170,8 @@ MentalResult mentalCreateCloudComponent(MentalComponent* pComponent) {
 
     // Инициализируем компонент
     pComponent->eType = MENTAL_COMPONENT_TYPE_CLOUDS;
-    pComponent->position[0] = 0.0f;
-    pComponent->position[1] = 3.0f; // Облака выше земли
-    pComponent->position[2] = 0.0f;
-    pComponent->size = 1.0f;
-    pComponent->rotation[0] = 0.0f;
-    pComponent->rotation[1] = 0.0f;
-    pComponent->rotation[2] = 0.0f;
+    mentalTransformInit(&pComponent->transform);
+    mentalTransformSetPosition(&pComponent->transform, 0.0f, 3.0f, 0.0f); // Облака выше земли
     pComponent->VAO = 0;
     pComponent->VBO = 0;
     pComponent->EBO = 0;
@@ -193,44 +197,22 @@ MentalResult mentalDrawCloudComponent(MentalComponent* pComponent, MentalWindowM
     }
 
     // Включаем смешивание для прозрачности
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    mentalGLEnable(GL_BLEND);
+    mentalGLBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    glUseProgram(pComponent->shaderProgram);
+    uint32_t program = mentalShaderUse(pComponent->shaderProgram);
+    MentalUniformTable* pUniforms = mentalUniformsFor(program);
 
-    // Получаем матрицы
-    mat4 model, view, projection;
-    glm_mat4_identity(model);
-    
-    // Применяем трансформации
-    glm_translate(model, pComponent->position);
-    glm_rotate_x(model, glm_rad(pComponent->rotation[0]), model);
-    glm_rotate_y(model, glm_rad(pComponent->rotation[1]), model);
-    glm_rotate_z(model, glm_rad(pComponent->rotation[2]), model);
-    glm_scale_uni(model, pComponent->size);
-
-    mental_camera_get_view_matrix(&pManager->camera, view);
-    mental_camera_get_projection_matrix(&pManager->camera, projection, 
-                                       (float)pManager->pInfo->aSizes[0] / pManager->pInfo->aSizes[1]);
-
-    // Передаем матрицы в шейдер
-    glUniformMatrix4fv(glGetUniformLocation(pComponent->shaderProgram, "model"), 1, GL_FALSE, (float*)model);
-    glUniformMatrix4fv(glGetUniformLocation(pComponent->shaderProgram, "view"), 1, GL_FALSE, (float*)view);
-    glUniformMatrix4fv(glGetUniformLocation(pComponent->shaderProgram, "projection"), 1, GL_FALSE, (float*)projection);
-
-    // Передаем время в шейдер
-    GLint timeLoc = glGetUniformLocation(pComponent->shaderProgram, "time");
-    if (timeLoc != -1) {
-        glUniform1f(timeLoc, (float)glfwGetTime());
-    }
+    // Матрица модели из кэша преобразования; камера и время — в блоке FrameData
+    mentalUniformMatrix4fv(pUniforms, MENTAL_UNIFORM_MODEL, (float*)mentalTransformWorld(&pComponent->transform));
 
     // Отрисовываем облака
-    glBindVertexArray(pComponent->VAO);
+    mentalGLBindVertexArray(pComponent->VAO);
     glDrawElements(GL_TRIANGLES, pComponent->indexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    mentalGLBindVertexArray(0);
 
     // Отключаем смешивание
-    glDisable(GL_BLEND);
+    mentalGLDisable(GL_BLEND);
 
     return MENTAL_OK;
 }
@@ -1,6 +1,11 @@
 #include "component.h"
 #include "wm.h"
 #include "perlin.h"
+#include "vtex.h"
+#include "shader.h"
+#include "uniforms.h"
+#include "glstate.h"
+#include <string.h>
 
 #include "../stb_image.h"
 
@@ -22,7 +27,7 @@ void __mental_create_rectangle(MentalComponent *pComponent)
     glGenBuffers(1, &pComponent->VBO);
     glGenBuffers(1, &pComponent->EBO);
     
-    glBindVertexArray(pComponent->VAO);
+    mentalGLBindVertexArray(pComponent->VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, pComponent->VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
@@ -33,7 +38,9 @@ void __mental_create_rectangle(MentalComponent *pComponent)
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
-    glBindVertexArray(0);
+    mentalGLBindVertexArray(0);
+    mentalBoundsFromPoints(&pComponent->bounds, vertices, 4);
+    pComponent->worldBoundsVersion = 0;
 }
 
 void __mental_create_triangle(MentalComponent *pComponent)
@@ -48,7 +55,7 @@ void __mental_create_triangle(MentalComponent *pComponent)
     glGenVertexArrays(1, &pComponent->VAO);
     glGenBuffers(1, &pComponent->VBO);
     
-    glBindVertexArray(pComponent->VAO);
+    mentalGLBindVertexArray(pComponent->VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, pComponent->VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
@@ -56,158 +63,76 @@ void __mental_create_triangle(MentalComponent *pComponent)
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
-    glBindVertexArray(0);
+    mentalGLBindVertexArray(0);
+    mentalBoundsFromPoints(&pComponent->bounds, vertices, 3);
+    pComponent->worldBoundsVersion = 0;
 }
 void __mental_draw_rectangle(MentalComponent* pComponent)
 {
-    glBindVertexArray(pComponent->VAO);
+    mentalGLBindVertexArray(pComponent->VAO);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 }
 
 void __mental_draw_triangle(MentalComponent* pComponent)
 {
-    glBindVertexArray(pComponent->VAO);
+    mentalGLBindVertexArray(pComponent->VAO);
     glDrawArrays(GL_TRIANGLES, 0, 3);
 }
 
 void mentalSetPosition(MentalComponent* pComponent, float x, float y)
 {
     if (!pComponent) return;
-    pComponent->position[0] = x;
-    pComponent->position[1] = y;
+    mentalTransformSetPosition(&pComponent->transform, x, y, pComponent->transform.position[2]);
+}
+
+void mentalSetPosition3D(MentalComponent* pComponent, float x, float y, float z)
+{
+    if (!pComponent) return;
+    mentalTransformSetPosition(&pComponent->transform, x, y, z);
 }
 
 void mentalSetSize(MentalComponent* pComponent, float size)
 {
     if (!pComponent) return;
-    pComponent->size = size;
+    mentalTransformSetScale(&pComponent->transform, size);
 }
 
+void mentalSetRotation(MentalComponent* pComponent, float angleX, float angleY, float angleZ)
+{
+    if (!pComponent) return;
+    mentalTransformSetEuler(&pComponent->transform, angleX, angleY, angleZ);
+}
 
-MentalResult mentalAttachShader(MentalComponent* pComponent, const char* vertex_path, const char* fragment_path)
+MentalResult mentalSetParent(MentalComponent* pComponent, MentalComponent* pParent)
 {
-    // 1. Read vertex shader from file
-    FILE* vertex_file = fopen(vertex_path, "r");
-    if (!vertex_file) {
-        MENTAL_DEBUG("Failed to open vertex shader file");
-        return MENTAL_FILE_OPEN_FAILED;
+    if (!pComponent) {
+        return MENTAL_POINTER_IS_NULL;
     }
+    return mentalTransformSetParent(&pComponent->transform, pParent ? &pParent->transform : NULL);
+}
 
-    // Get file size
-    fseek(vertex_file, 0, SEEK_END);
-    long vertex_size = ftell(vertex_file);
-    fseek(vertex_file, 0, SEEK_SET);
-
-    // Allocate buffer and read file
-    char* vertex_source = (char*)malloc(vertex_size + 1);
-    fread(vertex_source, 1, vertex_size, vertex_file);
-    vertex_source[vertex_size] = '\0';
-    fclose(vertex_file);
-
-    // 2. Read fragment shader from file
-    FILE* fragment_file = fopen(fragment_path, "r");
-    if (!fragment_file) {
-        MENTAL_DEBUG("Failed to open fragment shader file");
-        free(vertex_source);
-        return MENTAL_FILE_OPEN_FAILED;
-    }
 
-    // Get file size
-    fseek(fragment_file, 0, SEEK_END);
-    long fragment_size = ftell(fragment_file);
-    fseek(fragment_file, 0, SEEK_SET);
-
-    // Allocate buffer and read file
-    char* fragment_source = (char*)malloc(fragment_size + 1);
-    fread(fragment_source, 1, fragment_size, fragment_file);
-    fragment_source[fragment_size] = '\0';
-    fclose(fragment_file);
-
-    // 3. Create and compile shaders
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    if (vertexShader == 0) {
-        MENTAL_DEBUG("Failed to create vertex shader.");
-        free(vertex_source);
-        free(fragment_source);
-        return MENTAL_SHADER_COMPILE_FAILED;
-    }
-    
-    glShaderSource(vertexShader, 1, (const char**)&vertex_source, NULL);
-    glCompileShader(vertexShader);
-    
-    // Check for shader compile errors
-    GLint success;
-    GLchar infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        MENTAL_DEBUG("Vertex shader compilation failed: %s", infoLog);
-        free(vertex_source);
-        free(fragment_source);
-        glDeleteShader(vertexShader);
-        return MENTAL_SHADER_COMPILE_FAILED;
+MentalResult mentalAttachShader(MentalComponent* pComponent, const char* vertex_path, const char* fragment_path)
+{
+    if (!pComponent || !vertex_path || !fragment_path) {
+        return MENTAL_POINTER_IS_NULL;
     }
 
-    // Fragment shader
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    if (fragmentShader == 0) {
-        MENTAL_DEBUG("Failed to create fragment shader.");
-        free(vertex_source);
-        free(fragment_source);
-        glDeleteShader(vertexShader);
-        return MENTAL_SHADER_COMPILE_FAILED;
+    // Программа берется из общего реестра: одинаковые шейдеры компилируются один раз.
+    // Компиляция не ожидается — до готовности отрисовка идет заглушкой
+    MentalShaderDesc desc = {0};
+    desc.paths[MENTAL_SHADER_STAGE_VERTEX] = vertex_path;
+    desc.paths[MENTAL_SHADER_STAGE_FRAGMENT] = fragment_path;
+
+    uint32_t program = 0;
+    MentalResult result = mentalShaderAcquireAsync(&desc, &program);
+    if (result != MENTAL_OK) {
+        MENTAL_DEBUG("Failed to attach shader %s + %s", vertex_path, fragment_path);
+        return result;
     }
-    
-    glShaderSource(fragmentShader, 1, (const char**)&fragment_source, NULL);
-    glCompileShader(fragmentShader);
-    
-    // Check for shader compile errors
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        MENTAL_DEBUG("Fragment shader compilation failed: %s", infoLog);
-        free(vertex_source);
-        free(fragment_source);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        return MENTAL_SHADER_COMPILE_FAILED;
-    }
-    
-    // 4. Link shaders
-    pComponent->shaderProgram = glCreateProgram();
-    if (pComponent->shaderProgram == 0) {
-        MENTAL_DEBUG("Failed to create shader program.");
-        free(vertex_source);
-        free(fragment_source);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        return MENTAL_SHADER_LINK_FAILED;
-    }
-    
-    glAttachShader(pComponent->shaderProgram, vertexShader);
-    glAttachShader(pComponent->shaderProgram, fragmentShader);
-    glLinkProgram(pComponent->shaderProgram);
-    
-    // Check for linking errors
-    glGetProgramiv(pComponent->shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(pComponent->shaderProgram, 512, NULL, infoLog);
-        MENTAL_DEBUG("Shader program linking failed: %s", infoLog);
-        free(vertex_source);
-        free(fragment_source);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        return MENTAL_SHADER_LINK_FAILED;
-    }
-
-    // 5. Cleanup
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    free(vertex_source);
-    free(fragment_source);
 
+    mentalShaderRelease(pComponent->shaderProgram);
+    pComponent->shaderProgram = program;
     return MENTAL_OK;
 }
 
@@ -250,45 +175,17 @@ MentalResult mentalDrawComponent(MentalComponent* pComponent, MentalWindowManage
         return MENTAL_ERROR;
     }
     
-    // Get window size
-    glfwGetWindowSize(pManager->pNext, &pManager->pInfo->aSizes[0], &pManager->pInfo->aSizes[1]);
-    float aspect_ratio = (float)pManager->pInfo->aSizes[0] / (float)pManager->pInfo->aSizes[1];
-    
-    // Get matrices
-    mat4 view, projection;
-    mental_camera_get_view_matrix(&pManager->camera, view);
-    mental_camera_get_projection_matrix(&pManager->camera, projection, aspect_ratio);
-    
-    glUseProgram(pComponent->shaderProgram);
-    
-    // Pass matrices to shader
-    GLint viewLoc = glGetUniformLocation(pComponent->shaderProgram, "view");
-    GLint projLoc = glGetUniformLocation(pComponent->shaderProgram, "projection");
-    if (viewLoc != -1) glUniformMatrix4fv(viewLoc, 1, GL_FALSE, (float*)view);
-    if (projLoc != -1) glUniformMatrix4fv(projLoc, 1, GL_FALSE, (float*)projection);
-    
-    // Pass other uniforms
-    GLint modelLoc = glGetUniformLocation(pComponent->shaderProgram, "model");
-    GLint resLoc = glGetUniformLocation(pComponent->shaderProgram, "resolution");
-    
-    // Create model matrix (position, rotation, scale)
-    mat4 model = GLM_MAT4_IDENTITY_INIT;
-    glm_translate(model, pComponent->position);
-    glm_rotate(model, glm_rad(pComponent->rotation[0]), (vec3){1.0f, 0.0f, 0.0f});
-    glm_rotate(model, glm_rad(pComponent->rotation[1]), (vec3){0.0f, 1.0f, 0.0f});
-    glm_rotate(model, glm_rad(pComponent->rotation[2]), (vec3){0.0f, 0.0f, 1.0f});
-    glm_scale_uni(model, pComponent->size);
+    // Матрицы вида и проекции, разрешение и время берутся из блока FrameData (engine/frame.h)
+    // Пока программа компилируется, привязана заглушка
+    (void)pManager;
+    uint32_t program = mentalShaderUse(pComponent->shaderProgram);
+    MentalUniformTable* pUniforms = mentalUniformsFor(program);
     
-    if (modelLoc != -1) glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float*)model);
-    if (resLoc != -1) glUniform2f(resLoc, (float)pManager->pInfo->aSizes[0], (float)pManager->pInfo->aSizes[1]);
+    // Матрица модели берется из кэша преобразования и пересчитывается только после изменений
+    mentalUniformMatrix4fv(pUniforms, MENTAL_UNIFORM_MODEL, (float*)mentalTransformWorld(&pComponent->transform));
     
     // Pass size uniform for fragment shader
-    GLint sizeLoc = glGetUniformLocation(pComponent->shaderProgram, "size");
-    if (sizeLoc != -1) glUniform1f(sizeLoc, pComponent->size);
-    
-    // Pass time uniform for cloud animation
-    GLint timeLoc = glGetUniformLocation(pComponent->shaderProgram, "time");
-    if (timeLoc != -1) glUniform1f(timeLoc, (float)glfwGetTime());
+    mentalUniform1f(pUniforms, MENTAL_UNIFORM_SIZE, pComponent->transform.scale);
     
     // Draw the component
     switch(pComponent->eType) {
@@ -309,7 +206,7 @@ MentalResult mentalDestroyComponent(MentalComponent *pComponent) {
     if (!pComponent) { return MENTAL_POINTER_IS_NULL; }
 
     if (pComponent->VAO != 0) {
-        glDeleteVertexArrays(1, &pComponent->VAO);
+        mentalGLDeleteVertexArrays(1, &pComponent->VAO);
         pComponent->VAO = 0;
     }
     if (pComponent->VBO != 0) {
@@ -321,9 +218,15 @@ MentalResult mentalDestroyComponent(MentalComponent *pComponent) {
         pComponent->EBO = 0;
     }
     if (pComponent->shaderProgram != 0) {
-        glDeleteProgram(pComponent->shaderProgram);
+        mentalShaderRelease(pComponent->shaderProgram);
         pComponent->shaderProgram = 0;
     }
+    if (pComponent->pVirtualTexture) {
+        mentalDestroyVirtualTexture(pComponent->pVirtualTexture);
+        free(pComponent->pVirtualTexture);
+        pComponent->pVirtualTexture = NULL;
+    }
+    mentalDestroyOccluder(&pComponent->occluder);
     return MENTAL_OK;
 
 }
@@ -495,7 +398,7 @@ void __mental_create_ground(MentalComponent *pComponent) {
     glGenBuffers(1, &pComponent->VBO);
     glGenBuffers(1, &pComponent->EBO);
     
-    glBindVertexArray(pComponent->VAO);
+    mentalGLBindVertexArray(pComponent->VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, pComponent->VBO);
     glBufferData(GL_ARRAY_BUFFER, vertexCount * 3 * sizeof(float), vertices, GL_STATIC_DRAW);
@@ -506,7 +409,17 @@ void __mental_create_ground(MentalComponent *pComponent) {
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
-    glBindVertexArray(0);
+    mentalGLBindVertexArray(0);
+    
+    // Высоты рельефа уже в вершинах, границы точные
+    mentalBoundsFromPoints(&pComponent->bounds, vertices, (uint32_t)vertexCount);
+    pComponent->worldBoundsVersion = 0;
+
+    // Холмы закрывают большую часть сцены: рельеф — загораживающая сетка для occlusion.h
+    if (mentalCreateOccluder(&pComponent->occluder, vertices, (uint32_t)vertexCount, indices,
+                             (uint32_t)indexCount) != MENTAL_OK) {
+        MENTAL_DEBUG("Ground occluder was not created, occlusion culling will not use the terrain.");
+    }
     
     // Освобождаем память
     free(vertices);
@@ -524,18 +437,15 @@ MentalResult mentalCreateGroundComponent(MentalComponent* pComponent) {
 
     // Инициализируем компонент
     pComponent->eType = MENTAL_COMPONENT_TYPE_GROUND;
-    pComponent->position[0] = 0.0f;
-    pComponent->position[1] = -1.0f; // Земля ниже уровня камеры
-    pComponent->position[2] = 0.0f;
-    pComponent->size = 1.0f;
-    pComponent->rotation[0] = 0.0f;
-    pComponent->rotation[1] = 0.0f;
-    pComponent->rotation[2] = 0.0f;
+    mentalTransformInit(&pComponent->transform);
+    mentalTransformSetPosition(&pComponent->transform, 0.0f, -1.0f, 0.0f); // Земля ниже уровня камеры
     pComponent->VAO = 0;
     pComponent->VBO = 0;
     pComponent->EBO = 0;
     pComponent->shaderProgram = 0;
     pComponent->indexCount = 0;
+    pComponent->pVirtualTexture = NULL;
+    memset(&pComponent->occluder, 0, sizeof(pComponent->occluder));
 
     // Создаем геометрию земли
     __mental_create_ground(pComponent);
@@ -545,15 +455,48 @@ MentalResult mentalCreateGroundComponent(MentalComponent* pComponent) {
 }
 
 MentalResult mentalLoadGroundTexture(MentalComponent* pComponent, const char* texture_path) {
-    (void)texture_path; // Suppress unused parameter warning
-    if (!pComponent) {
-        MENTAL_DEBUG("Ground component pointer is null.");
+    if (!pComponent || !texture_path) {
+        MENTAL_DEBUG("Ground component or texture path pointer is null.");
         return MENTAL_POINTER_IS_NULL;
     }
 
-    // Здесь можно добавить загрузку текстуры, если нужно
-    // Пока используем цвет из шейдера
-    MENTAL_DEBUG("Ground texture loading not implemented yet.");
+    // Текстура местности подключается как виртуальная: в память попадают
+    // только видимые тайлы. Обычное изображение нарезается в кэш page file'ов
+    char page_file[512];
+    const char* ext = strrchr(texture_path, '.');
+    if (ext && strcmp(ext, ".mvt") == 0) {
+        snprintf(page_file, sizeof(page_file), "%s", texture_path);
+    } else {
+        MentalResult result = mentalVirtualTexturePageFile(texture_path, MENTAL_VT_DEFAULT_TILE_SIZE, page_file,
+                                                           sizeof(page_file));
+        if (result != MENTAL_OK) {
+            return result;
+        }
+    }
+
+    MentalVirtualTexture* pVT = malloc(sizeof(MentalVirtualTexture));
+    if (!pVT) {
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+    MentalResult result = mentalCreateVirtualTexture(pVT, page_file, MENTAL_VT_DEFAULT_BUDGET);
+    if (result != MENTAL_OK) {
+        free(pVT);
+        return result;
+    }
+
+    // Земля — сетка 20x20 с центром в нуле, растягиваем текстуру на всю сетку
+    pVT->uvTransform[0] = 1.0f / 20.0f;
+    pVT->uvTransform[1] = 1.0f / 20.0f;
+    pVT->uvTransform[2] = 0.5f;
+    pVT->uvTransform[3] = 0.5f;
+
+    if (pComponent->pVirtualTexture) {
+        mentalDestroyVirtualTexture(pComponent->pVirtualTexture);
+        free(pComponent->pVirtualTexture);
+    }
+    pComponent->pVirtualTexture = pVT;
+
+    MENTAL_DEBUG("Ground virtual texture loaded: %s", page_file);
     return MENTAL_OK;
 }
 
@@ -568,38 +511,22 @@ MentalResult mentalDrawGroundComponent(MentalComponent* pComponent, MentalWindow
         return MENTAL_ERROR;
     }
 
-    glUseProgram(pComponent->shaderProgram);
+    // Пока программа компилируется, привязана заглушка
+    uint32_t program = mentalShaderUse(pComponent->shaderProgram);
+    MentalUniformTable* pUniforms = mentalUniformsFor(program);
 
-    // Получаем матрицы
-    mat4 model, view, projection;
-    glm_mat4_identity(model);
-    
-    // Применяем трансформации
-    glm_translate(model, pComponent->position);
-    glm_rotate_x(model, glm_rad(pComponent->rotation[0]), model);
-    glm_rotate_y(model, glm_rad(pComponent->rotation[1]), model);
-    glm_rotate_z(model, glm_rad(pComponent->rotation[2]), model);
-    glm_scale_uni(model, pComponent->size);
-
-    mental_camera_get_view_matrix(&pManager->camera, view);
-    mental_camera_get_projection_matrix(&pManager->camera, projection, 
-                                       (float)pManager->pInfo->aSizes[0] / pManager->pInfo->aSizes[1]);
-
-    // Передаем матрицы в шейдер
-    glUniformMatrix4fv(glGetUniformLocation(pComponent->shaderProgram, "model"), 1, GL_FALSE, (float*)model);
-    glUniformMatrix4fv(glGetUniformLocation(pComponent->shaderProgram, "view"), 1, GL_FALSE, (float*)view);
-    glUniformMatrix4fv(glGetUniformLocation(pComponent->shaderProgram, "projection"), 1, GL_FALSE, (float*)projection);
-
-    // Передаем время в шейдер
-    GLint timeLoc = glGetUniformLocation(pComponent->shaderProgram, "time");
-    if (timeLoc != -1) {
-        glUniform1f(timeLoc, (float)glfwGetTime());
+    // Матрица модели из кэша преобразования; камера и время — в блоке FrameData
+    mentalUniformMatrix4fv(pUniforms, MENTAL_UNIFORM_MODEL, (float*)mentalTransformWorld(&pComponent->transform));
+
+    if (pComponent->pVirtualTexture) {
+        mentalBindVirtualTexture(pComponent->pVirtualTexture, program, 0);
     }
+    mentalUniform1i(pUniforms, MENTAL_UNIFORM_USE_VIRTUAL_TEXTURE, pComponent->pVirtualTexture != NULL);
 
     // Отрисовываем землю
-    glBindVertexArray(pComponent->VAO);
+    mentalGLBindVertexArray(pComponent->VAO);
     glDrawElements(GL_TRIANGLES, pComponent->indexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    mentalGLBindVertexArray(0);
 
     return MENTAL_OK;
 }
@@ -8,6 +8,11 @@
 #include <cglm/mat4.h>
 
 #include "mental.h"
+#include "atlas.h"
+#include "culling.h"
+#include "transform.h"
+#include "geompool.h"
+#include "occlusion.h"
 
 #include <cglm/cglm.h>
 #include <cglm/vec3.h>
@@ -18,6 +23,52 @@
 // Forward declarations
 typedef struct MentalWindowManager MentalWindowManager;
 typedef struct MentalWindowManagerInfo MentalWindowManagerInfo;
+typedef struct MentalVirtualTexture MentalVirtualTexture;
+
+// Пути к PBR шейдерам (общие для mentalAttachPBRShader и предзаказа в wm.c)
+#define MENTAL_PBR_VERTEX_SHADER    "/Users/twofaced/Documents/Projects/mental.h/pbr_vertex.glsl"
+#define MENTAL_PBR_FRAGMENT_SHADER  "/Users/twofaced/Documents/Projects/mental.h/pbr_fragment.glsl"
+#define MENTAL_DEPTH_FRAGMENT_SHADER "depth_fragment.glsl"
+
+// Тесселяция PBR моделей (OpenGL 4.0): уровни считаются в TCS по размеру ребер на экране
+#define MENTAL_TESS_VERTEX_SHADER       "tess_vertex.glsl"
+#define MENTAL_TESS_CONTROL_SHADER      "tess_control.glsl"
+#define MENTAL_TESS_EVALUATION_SHADER   "tess_evaluation.glsl"
+#define MENTAL_TESS_DEFAULT_EDGE_PIXELS 8.0f
+#define MENTAL_TESS_MAX_LEVEL           64.0f
+
+// Биты варианта PBR программы; каждому соответствует #define в pbr_*.glsl
+typedef enum MentalPBRFeature {
+    MENTAL_PBR_ALBEDO_MAP       = 1u << 0,
+    MENTAL_PBR_NORMAL_MAP       = 1u << 1,
+    MENTAL_PBR_METALLIC_MAP     = 1u << 2,
+    MENTAL_PBR_ROUGHNESS_MAP    = 1u << 3,
+    MENTAL_PBR_AO_MAP           = 1u << 4,
+    MENTAL_PBR_HEIGHT_MAP       = 1u << 5,
+    MENTAL_PBR_ALBEDO_ARRAY     = 1u << 6,
+    MENTAL_PBR_DEBUG_UVS        = 1u << 7,
+    MENTAL_PBR_DEBUG_NORMALS    = 1u << 8,
+    MENTAL_PBR_DEBUG_TANGENTS   = 1u << 9,
+    MENTAL_PBR_DEBUG_WIREFRAME  = 1u << 10,
+    MENTAL_PBR_INSTANCED        = 1u << 11,
+    MENTAL_PBR_DEPTH_ONLY       = 1u << 12,    // Предварительный проход глубины (depth_fragment.glsl)
+} MentalPBRFeature;
+
+#define MENTAL_PBR_FEATURE_COUNT    13
+// Признаки, от которых зависит положение вершин: только они различают варианты DEPTH_ONLY
+#define MENTAL_PBR_DEPTH_FEATURES   (MENTAL_PBR_HEIGHT_MAP | MENTAL_PBR_INSTANCED)
+#define MENTAL_PBR_DEBUG_MASK       (MENTAL_PBR_DEBUG_UVS | MENTAL_PBR_DEBUG_NORMALS | \
+                                     MENTAL_PBR_DEBUG_TANGENTS | MENTAL_PBR_DEBUG_WIREFRAME)
+
+// Экземпляр модели для инстансинга. Раскладка совпадает с атрибутами 4–9
+// в pbr_vertex.glsl: матрица занимает четыре слота, затем оттенок и индексы
+typedef struct MentalModelInstance {
+    mat4     model;        // Поверх преобразования компонента; масштаб равномерный
+    vec4     tint;         // Множитель альбедо
+    uint32_t lod;          // Уровень детализации (у модели пока одна сетка)
+    uint32_t material;     // Смещение слоя альбедо в атласе относительно слоя модели
+    uint32_t padding[2];
+} MentalModelInstance;
 
 // Структура для хранения материала 3D модели
 typedef struct Material {
@@ -32,6 +83,7 @@ typedef struct Material {
     float metallic;        // Металличность (0.0 - диэлектрик, 1.0 - металл)
     float roughness;       // Шероховатость (0.0 - гладкий, 1.0 - шероховатый)
     float ao;              // Ambient Occlusion (затенение в складках)
+    float heightScale;     // Сила смещения по карте высот
     
     bool use_pbr;          // Флаг использования PBR материала
 } Material;
@@ -60,6 +112,27 @@ typedef struct Model3DData {
     bool hasAOMap;         // Флаг наличия карты ambient occlusion
     bool hasHeightMap;     // Флаг наличия карты высот
     
+    // Альбедо из атласа: материал хранит слой вместо собственной текстуры
+    MentalAtlasSlot albedoSlot;
+    bool hasAtlasAlbedo;   // Флаг использования слоя атласа для альбедо
+    
+    // Программа берется из вариантов PBR по флагам текстур (mentalAttachPBRShader)
+    bool usePBRVariants;
+    bool programTessellated;   // Текущая программа — из тесселяционного набора
+    float tessEdgePixels;      // Длина сегмента на экране; 0 — без тесселяции
+    
+    // Инстансинг: копии рисуются одним glDrawElementsInstanced (mentalSetModelInstances)
+    uint32_t instanceVBO;
+    uint32_t instanceCount;
+    uint32_t instanceCapacity; // Емкость буфера на GPU, в экземплярах
+    uint32_t instanceMapped;   // Копий в отображенном буфере; 0 — буфер не отображен
+    bool programInstanced;     // Текущая программа читает атрибуты экземпляров
+    MentalBounds instanceBounds;   // Все экземпляры вместе, в пространстве компонента
+    bool depthPrepassed;       // Глубина уже записана: основной проход не меняет программу
+    
+    // Место в общем пуле геометрии; valid == false — у модели свои VBO и EBO
+    MentalGeometryRange geometry;
+    
     Material material;     // Материал модели
 } Model3DData;
 
@@ -67,19 +140,30 @@ typedef struct MentalComponent {
     uint32_t   VAO, VBO, EBO;
     uint32_t   shaderProgram;
     MentalComponentType eType;
-    float position[3];  // x, y, z координаты
-    float size;         // размер компонента
-    float rotation[3];  // углы поворота по осям X, Y, Z (в градусах)
+    MentalTransform transform;  // Положение, поворот и размер; мировая матрица кэшируется
     int indexCount;     // количество индексов для отрисовки (для земли)
     
     // Данные для 3D модели
     Model3DData* modelData; // Указатель на данные модели (NULL для других типов компонентов)
+    
+    // Виртуальная текстура (сейчас только для земли)
+    MentalVirtualTexture* pVirtualTexture;
+    
+    // Границы сетки в пространстве модели; считаются при создании/загрузке
+    MentalBounds bounds;
+    // Мировые границы для отсечения и версия transform, по которой они посчитаны (0 — устарели)
+    MentalBounds worldBounds;
+    uint32_t worldBoundsVersion;
+
+    // Копия сетки для программного отсечения перекрытых (indexCount = 0 — не загораживает)
+    MentalOccluder occluder;
 } MentalComponent;
 
 typedef struct MentalSkybox {
     uint32_t   VAO, VBO;
     uint32_t   cubemapTexture;
     uint32_t   shaderProgram;
+    uint64_t   sourceHash;     // Хеш содержимого граней (0 — загружены не все грани)
     bool       isInitialized;
 } MentalSkybox;
 
@@ -125,6 +209,9 @@ MentalResult mentalDestroyComponent(MentalComponent *pComponent);
 void mentalSetSize(MentalComponent* pComponent, float size);
 void mentalSetPosition(MentalComponent* pComponent, float x, float y);
 void mentalSetRotation(MentalComponent* pComponent, float angleX, float angleY, float angleZ);
+void mentalSetPosition3D(MentalComponent* pComponent, float x, float y, float z);
+// Компонент двигается вместе с родителем; NULL отвязывает
+MentalResult mentalSetParent(MentalComponent* pComponent, MentalComponent* pParent);
 void mental_process_keyboard(MentalWindowManager* wm, float delta_time);
 void mental_process_mouse(MentalCamera* cam, float xoffset, float yoffset);
 void mental_mouse_callback(GLFWwindow* window, double xpos, double ypos);
@@ -150,6 +237,7 @@ MentalResult mentalAttachSkyboxShader(MentalSkybox* pSkybox, const char* vertex_
 MentalResult mentalDrawSkybox(MentalSkybox* pSkybox, MentalWindowManager *pManager);
 MentalResult mentalDestroySkybox(MentalSkybox *pSkybox);
 uint32_t mentalLoadCubemap(const char* faces[6]);
+uint32_t mentalLoadCubemapHashed(const char* faces[6], uint64_t* pSourceHash);
 
 // Ground functions
 MentalResult mentalCreateGroundComponent(MentalComponent* pComponent);
@@ -173,10 +261,39 @@ MentalResult mentalLoadModelMetallicMap(MentalComponent* pComponent, const char*
 MentalResult mentalLoadModelRoughnessMap(MentalComponent* pComponent, const char* texture_path);
 MentalResult mentalLoadModelAOMap(MentalComponent* pComponent, const char* texture_path);
 MentalResult mentalLoadModelHeightMap(MentalComponent* pComponent, const char* texture_path);
+MentalResult mentalLoadModelTextureFromAtlas(MentalComponent* pComponent, MentalTextureAtlas* pAtlas, const char* texture_path);
 
 // 3D Model material functions
 MentalResult mentalSetModelMaterial(MentalComponent* pComponent, vec3 ambient, vec3 diffuse, vec3 specular, float shininess);
 MentalResult mentalSetModelPBRMaterial(MentalComponent* pComponent, vec3 albedo, float metallic, float roughness, float ao);
+MentalResult mentalSetModelHeightScale(MentalComponent* pComponent, float heightScale);
 MentalResult mentalAttachPBRShader(MentalComponent* pComponent);
 
+// Варианты PBR программы
+uint32_t mentalModelPBRFeatures(const Model3DData* pModelData);
+void mentalSetPBRDebugMode(uint32_t debugFeatures);
+MentalResult mentalSetModelTessellation(MentalComponent* pComponent, float edgePixels);
+MentalResult mentalSetModelInstances(MentalComponent* pComponent, const MentalModelInstance* pInstances, uint32_t count);
+MentalModelInstance* mentalMapModelInstances(MentalComponent* pComponent, uint32_t count);
+MentalResult mentalUnmapModelInstances(MentalComponent* pComponent, const MentalBounds* pInstanceBounds);
+void mentalReleasePBRVariants(void);
+
+// Пакетная отрисовка моделей из пула геометрии (engine/geompool.h)
+bool mentalModelBatchable(const MentalComponent* pComponent);
+bool mentalModelBatchCompatible(const MentalComponent* pFirst, const MentalComponent* pSecond);
+MentalResult mentalDrawModel3DBatch(MentalComponent* const* ppComponents, uint32_t count, MentalWindowManager* pManager);
+
+// Предварительный проход глубины: только позиции (или тесселяция со смещением) тем же
+// путем, что и основная отрисовка, без записи цвета. MENTAL_ERROR — программа модели
+// или ее вариант DEPTH_ONLY еще не готовы; тогда модель рисуется без прохода с GL_LESS
+MentalResult mentalDrawModel3DDepth(MentalComponent* pComponent, MentalWindowManager* pManager);
+// То же для пакета; результат (с отсечением на GPU) сохраняется в ячейке slot пула
+// геометрии. Успех значит, что mentalDrawModel3DBatchPrepassed нарисует его тем же пакетом
+MentalResult mentalDrawModel3DBatchDepth(MentalComponent* const* ppComponents, uint32_t count, MentalWindowManager* pManager,
+                                         uint32_t slot);
+// Основной проход пакета из ячейки slot. MENTAL_ERROR — ячейка не записана в этом
+// кадре; тогда модели рисуются по одной
+MentalResult mentalDrawModel3DBatchPrepassed(MentalComponent* const* ppComponents, uint32_t count,
+                                             MentalWindowManager* pManager, uint32_t slot);
+
 #endif // mental_component_h
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include "culling.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+void mentalBoundsFromPoints(MentalBounds* pBounds, const float* pPoints, uint32_t count)
+{
+    memset(pBounds, 0, sizeof(*pBounds));
+    if (!pPoints || count == 0) {
+        return;
+    }
+
+    float minimum[3] = { pPoints[0], pPoints[1], pPoints[2] };
+    float maximum[3] = { pPoints[0], pPoints[1], pPoints[2] };
+    for (uint32_t i = 1; i < count; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            float value = pPoints[i * 3 + axis];
+            minimum[axis] = value < minimum[axis] ? value : minimum[axis];
+            maximum[axis] = value > maximum[axis] ? value : maximum[axis];
+        }
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        pBounds->center[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+        pBounds->extents[axis] = (maximum[axis] - minimum[axis]) * 0.5f;
+    }
+
+    // Сфера по самой дальней точке теснее сферы вокруг AABB
+    float radiusSq = 0.0f;
+    for (uint32_t i = 0; i < count; i++) {
+        float dx = pPoints[i * 3] - pBounds->center[0];
+        float dy = pPoints[i * 3 + 1] - pBounds->center[1];
+        float dz = pPoints[i * 3 + 2] - pBounds->center[2];
+        float distSq = dx * dx + dy * dy + dz * dz;
+        radiusSq = distSq > radiusSq ? distSq : radiusSq;
+    }
+    pBounds->radius = sqrtf(radiusSq);
+    pBounds->valid = true;
+}
+
+void mentalBoundsInflate(MentalBounds* pBounds, float margin)
+{
+    if (!pBounds->valid) {
+        return;
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        pBounds->extents[axis] += margin;
+    }
+    pBounds->radius += margin;
+}
+
+void mentalBoundsMerge(MentalBounds* pBounds, const MentalBounds* pOther)
+{
+    if (!pOther->valid) {
+        return;
+    }
+    if (!pBounds->valid) {
+        *pBounds = *pOther;
+        return;
+    }
+
+    float center[3];
+    float extents[3];
+    for (int axis = 0; axis < 3; axis++) {
+        float minimum = fminf(pBounds->center[axis] - pBounds->extents[axis], pOther->center[axis] - pOther->extents[axis]);
+        float maximum = fmaxf(pBounds->center[axis] + pBounds->extents[axis], pOther->center[axis] + pOther->extents[axis]);
+        center[axis] = (minimum + maximum) * 0.5f;
+        extents[axis] = (maximum - minimum) * 0.5f;
+    }
+
+    // Обе сферы вокруг нового центра; сфера вокруг AABB — верхняя граница
+    float radius = 0.0f;
+    const MentalBounds* sources[2] = { pBounds, pOther };
+    for (int i = 0; i < 2; i++) {
+        float dx = sources[i]->center[0] - center[0];
+        float dy = sources[i]->center[1] - center[1];
+        float dz = sources[i]->center[2] - center[2];
+        radius = fmaxf(radius, sqrtf(dx * dx + dy * dy + dz * dz) + sources[i]->radius);
+    }
+    radius = fminf(radius, sqrtf(extents[0] * extents[0] + extents[1] * extents[1] + extents[2] * extents[2]));
+
+    memcpy(pBounds->center, center, sizeof(center));
+    memcpy(pBounds->extents, extents, sizeof(extents));
+    pBounds->radius = radius;
+}
+
+void mentalBoundsTransform(const MentalBounds* pLocal, mat4 transform, MentalBounds* pWorld)
+{
+    if (!pLocal->valid) {
+        memset(pWorld, 0, sizeof(*pWorld));
+        return;
+    }
+
+    // Матрица хранится по столбцам: transform[столбец][строка]
+    float maxScaleSq = 0.0f;
+    for (int row = 0; row < 3; row++) {
+        pWorld->center[row] = transform[3][row];
+        pWorld->extents[row] = 0.0f;
+    }
+    for (int column = 0; column < 3; column++) {
+        float scaleSq = 0.0f;
+        for (int row = 0; row < 3; row++) {
+            float m = transform[column][row];
+            pWorld->center[row] += m * pLocal->center[column];
+            pWorld->extents[row] += fabsf(m) * pLocal->extents[column];
+            scaleSq += m * m;
+        }
+        maxScaleSq = scaleSq > maxScaleSq ? scaleSq : maxScaleSq;
+    }
+    pWorld->radius = pLocal->radius * sqrtf(maxScaleSq);
+    pWorld->valid = true;
+}
+
+void mentalFrustumFromMatrix(MentalFrustum* pFrustum, mat4 viewProjection)
+{
+    // Плоскости Gribb-Hartmann: строка 3 плюс/минус строки 0, 1, 2
+    for (int plane = 0; plane < 6; plane++) {
+        int row = plane / 2;
+        float sign = (plane & 1) ? -1.0f : 1.0f;
+        for (int column = 0; column < 4; column++) {
+            pFrustum->planes[plane][column] = viewProjection[column][3] + sign * viewProjection[column][row];
+        }
+        float* p = pFrustum->planes[plane];
+        float length = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        if (length > 0.0f) {
+            for (int i = 0; i < 4; i++) {
+                p[i] /= length;
+            }
+        }
+    }
+}
+
+static bool mental_cull_test(const MentalFrustum* pFrustum, float cx, float cy, float cz, float ex, float ey, float ez,
+                             float radius)
+{
+    for (int plane = 0; plane < 6; plane++) {
+        const float* p = pFrustum->planes[plane];
+        float distance = p[0] * cx + p[1] * cy + p[2] * cz + p[3];
+        float boxRadius = fabsf(p[0]) * ex + fabsf(p[1]) * ey + fabsf(p[2]) * ez;
+        if (distance < -fminf(boxRadius, radius)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool mentalFrustumTestBounds(const MentalFrustum* pFrustum, const MentalBounds* pBounds)
+{
+    if (!pBounds || !pBounds->valid) {
+        return true;
+    }
+    return mental_cull_test(pFrustum, pBounds->center[0], pBounds->center[1], pBounds->center[2], pBounds->extents[0],
+                            pBounds->extents[1], pBounds->extents[2], pBounds->radius);
+}
+
+MentalResult mentalBoundsSoAReserve(MentalBoundsSoA* pSoA, uint32_t capacity)
+{
+    if (capacity <= pSoA->capacity) {
+        return MENTAL_OK;
+    }
+    for (int lane = 0; lane < MENTAL_BOUNDS_LANE_COUNT; lane++) {
+        float* pLane = realloc(pSoA->lanes[lane], sizeof(float) * capacity);
+        if (!pLane) {
+            return MENTAL_ERROR_OUT_OF_MEMORY;
+        }
+        pSoA->lanes[lane] = pLane;
+    }
+    pSoA->capacity = capacity;
+    return MENTAL_OK;
+}
+
+void mentalBoundsSoAFree(MentalBoundsSoA* pSoA)
+{
+    for (int lane = 0; lane < MENTAL_BOUNDS_LANE_COUNT; lane++) {
+        free(pSoA->lanes[lane]);
+    }
+    memset(pSoA, 0, sizeof(*pSoA));
+}
+
+void mentalBoundsSoASet(MentalBoundsSoA* pSoA, uint32_t index, const MentalBounds* pBounds)
+{
+    bool valid = pBounds && pBounds->valid;
+    for (int axis = 0; axis < 3; axis++) {
+        pSoA->lanes[MENTAL_BOUNDS_LANE_CENTER_X + axis][index] = valid ? pBounds->center[axis] : 0.0f;
+        pSoA->lanes[MENTAL_BOUNDS_LANE_EXTENT_X + axis][index] = valid ? pBounds->extents[axis] : MENTAL_BOUNDS_INFINITE;
+    }
+    pSoA->lanes[MENTAL_BOUNDS_LANE_RADIUS][index] = valid ? pBounds->radius : MENTAL_BOUNDS_INFINITE;
+}
+
+#if defined(__SSE2__)
+
+// Четыре объекта за итерацию; возвращает число обработанных
+static uint32_t mental_cull_simd(const MentalFrustum* pFrustum, float* const* lanes, uint32_t count, uint8_t* pVisible)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 cx = _mm_loadu_ps(lanes[MENTAL_BOUNDS_LANE_CENTER_X] + i);
+        __m128 cy = _mm_loadu_ps(lanes[MENTAL_BOUNDS_LANE_CENTER_Y] + i);
+        __m128 cz = _mm_loadu_ps(lanes[MENTAL_BOUNDS_LANE_CENTER_Z] + i);
+        __m128 ex = _mm_loadu_ps(lanes[MENTAL_BOUNDS_LANE_EXTENT_X] + i);
+        __m128 ey = _mm_loadu_ps(lanes[MENTAL_BOUNDS_LANE_EXTENT_Y] + i);
+        __m128 ez = _mm_loadu_ps(lanes[MENTAL_BOUNDS_LANE_EXTENT_Z] + i);
+        __m128 radius = _mm_loadu_ps(lanes[MENTAL_BOUNDS_LANE_RADIUS] + i);
+
+        __m128 outside = _mm_setzero_ps();
+        for (int plane = 0; plane < 6; plane++) {
+            const float* p = pFrustum->planes[plane];
+            __m128 nx = _mm_set1_ps(p[0]);
+            __m128 ny = _mm_set1_ps(p[1]);
+            __m128 nz = _mm_set1_ps(p[2]);
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)),
+                                         _mm_add_ps(_mm_mul_ps(nz, cz), _mm_set1_ps(p[3])));
+            __m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, nx), ex),
+                                                     _mm_mul_ps(_mm_andnot_ps(signMask, ny), ey)),
+                                          _mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+            __m128 limit = _mm_xor_ps(_mm_min_ps(boxRadius, radius), signMask);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, limit));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; lane++) {
+            pVisible[i + lane] = (uint8_t)(((mask >> lane) & 1) ^ 1);
+        }
+    }
+    return i;
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+static uint32_t mental_cull_simd(const MentalFrustum* pFrustum, float* const* lanes, uint32_t count, uint8_t* pVisible)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t cx = vld1q_f32(lanes[MENTAL_BOUNDS_LANE_CENTER_X] + i);
+        float32x4_t cy = vld1q_f32(lanes[MENTAL_BOUNDS_LANE_CENTER_Y] + i);
+        float32x4_t cz = vld1q_f32(lanes[MENTAL_BOUNDS_LANE_CENTER_Z] + i);
+        float32x4_t ex = vld1q_f32(lanes[MENTAL_BOUNDS_LANE_EXTENT_X] + i);
+        float32x4_t ey = vld1q_f32(lanes[MENTAL_BOUNDS_LANE_EXTENT_Y] + i);
+        float32x4_t ez = vld1q_f32(lanes[MENTAL_BOUNDS_LANE_EXTENT_Z] + i);
+        float32x4_t radius = vld1q_f32(lanes[MENTAL_BOUNDS_LANE_RADIUS] + i);
+
+        uint32x4_t outside = vdupq_n_u32(0);
+        for (int plane = 0; plane < 6; plane++) {
+            const float* p = pFrustum->planes[plane];
+            float32x4_t distance = vfmaq_n_f32(vfmaq_n_f32(vfmaq_n_f32(vdupq_n_f32(p[3]), cx, p[0]), cy, p[1]), cz, p[2]);
+            float32x4_t boxRadius = vfmaq_n_f32(vfmaq_n_f32(vmulq_n_f32(ex, fabsf(p[0])), ey, fabsf(p[1])), ez, fabsf(p[2]));
+            float32x4_t limit = vnegq_f32(vminq_f32(boxRadius, radius));
+            outside = vorrq_u32(outside, vcltq_f32(distance, limit));
+        }
+
+        uint32_t flags[4];
+        vst1q_u32(flags, outside);
+        for (int lane = 0; lane < 4; lane++) {
+            pVisible[i + lane] = flags[lane] ? 0 : 1;
+        }
+    }
+    return i;
+}
+
+#else
+
+static uint32_t mental_cull_simd(const MentalFrustum* pFrustum, float* const* lanes, uint32_t count, uint8_t* pVisible)
+{
+    (void)pFrustum;
+    (void)lanes;
+    (void)count;
+    (void)pVisible;
+    return 0;
+}
+
+#endif
+
+uint32_t mentalFrustumCull(const MentalFrustum* pFrustum, const MentalBoundsSoA* pSoA, uint32_t count, uint8_t* pVisible)
+{
+    float* const* lanes = pSoA->lanes;
+    uint32_t i = mental_cull_simd(pFrustum, lanes, count, pVisible);
+    for (; i < count; i++) {
+        pVisible[i] = mental_cull_test(pFrustum, lanes[MENTAL_BOUNDS_LANE_CENTER_X][i], lanes[MENTAL_BOUNDS_LANE_CENTER_Y][i],
+                                       lanes[MENTAL_BOUNDS_LANE_CENTER_Z][i], lanes[MENTAL_BOUNDS_LANE_EXTENT_X][i],
+                                       lanes[MENTAL_BOUNDS_LANE_EXTENT_Y][i], lanes[MENTAL_BOUNDS_LANE_EXTENT_Z][i],
+                                       lanes[MENTAL_BOUNDS_LANE_RADIUS][i]);
+    }
+
+    uint32_t visible = 0;
+    for (i = 0; i < count; i++) {
+        visible += pVisible[i];
+    }
+    return visible;
+}
@@ -0,0 +1,64 @@
+#ifndef mental_culling_h
+#define mental_culling_h
+
+#include "mental.h"
+#include <cglm/cglm.h>
+
+// Отсечение по пирамиде видимости. У каждого компонента при загрузке
+// считаются границы в пространстве модели: AABB (центр и полуразмеры) и
+// сфера вокруг того же центра. Плоскости пирамиды извлекаются из матрицы
+// viewProjection раз в кадр (frame.c), а очередь отрисовки проверяет все
+// элементы кадра пакетом по четыре (SSE / NEON) до сортировки и до загрузки
+// юниформов. Объект отбрасывается, если любая плоскость целиком отделяет
+// от пирамиды его AABB или сферу — берется более тесная из двух оценок.
+
+#define MENTAL_BOUNDS_INFINITE      1.0e30f     // Полуразмер объекта, который не отсекается
+
+typedef struct MentalBounds {
+    float   center[3];
+    float   radius;         // Сфера вокруг center
+    float   extents[3];     // Полуразмеры AABB
+    bool    valid;          // false — границы неизвестны, объект всегда виден
+} MentalBounds;
+
+typedef struct MentalFrustum {
+    float   planes[6][4];   // Нормали внутрь и единичные: dot(n, p) + d >= 0 внутри
+} MentalFrustum;
+
+typedef enum MentalBoundsLane {
+    MENTAL_BOUNDS_LANE_CENTER_X = 0,
+    MENTAL_BOUNDS_LANE_CENTER_Y,
+    MENTAL_BOUNDS_LANE_CENTER_Z,
+    MENTAL_BOUNDS_LANE_EXTENT_X,
+    MENTAL_BOUNDS_LANE_EXTENT_Y,
+    MENTAL_BOUNDS_LANE_EXTENT_Z,
+    MENTAL_BOUNDS_LANE_RADIUS,
+    MENTAL_BOUNDS_LANE_COUNT
+} MentalBoundsLane;
+
+// Границы многих объектов в раскладке SoA: отдельный массив на каждую компоненту
+typedef struct MentalBoundsSoA {
+    float*      lanes[MENTAL_BOUNDS_LANE_COUNT];
+    uint32_t    capacity;
+} MentalBoundsSoA;
+
+// По массиву точек xyz; count = 0 дает невалидные границы
+void mentalBoundsFromPoints(MentalBounds* pBounds, const float* pPoints, uint32_t count);
+void mentalBoundsInflate(MentalBounds* pBounds, float margin);
+// Объединение; невалидные pBounds просто заменяются
+void mentalBoundsMerge(MentalBounds* pBounds, const MentalBounds* pOther);
+// Границы после преобразования (AABB пересчитывается по модулям столбцов матрицы)
+void mentalBoundsTransform(const MentalBounds* pLocal, mat4 transform, MentalBounds* pWorld);
+
+void mentalFrustumFromMatrix(MentalFrustum* pFrustum, mat4 viewProjection);
+bool mentalFrustumTestBounds(const MentalFrustum* pFrustum, const MentalBounds* pBounds);
+
+MentalResult mentalBoundsSoAReserve(MentalBoundsSoA* pSoA, uint32_t capacity);
+void         mentalBoundsSoAFree(MentalBoundsSoA* pSoA);
+// Невалидные или NULL границы записываются бесконечными
+void         mentalBoundsSoASet(MentalBoundsSoA* pSoA, uint32_t index, const MentalBounds* pBounds);
+// pVisible[i] = 1 для видимых; возвращает их число
+uint32_t     mentalFrustumCull(const MentalFrustum* pFrustum, const MentalBoundsSoA* pSoA, uint32_t count,
+                               uint8_t* pVisible);
+
+#endif // mental_culling_h
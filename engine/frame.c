@@ -0,0 +1,76 @@
+#include "frame.h"
+#include <string.h>
+
+MentalResult mentalCreateFrameData(MentalFrameData* pFrame)
+{
+    if (!pFrame) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    memset(pFrame, 0, sizeof(MentalFrameData));
+    glm_mat4_identity(pFrame->block.view);
+    glm_mat4_identity(pFrame->block.projection);
+    glm_mat4_identity(pFrame->block.viewProjection);
+    mentalSetFrameLight(pFrame, (const float[3]){1.2f, 1.0f, 2.0f}, (const float[3]){1.0f, 1.0f, 1.0f});
+
+    glGenBuffers(1, &pFrame->ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, pFrame->ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(MentalFrameBlock), &pFrame->block, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MENTAL_FRAME_BINDING, pFrame->ubo);
+    return MENTAL_OK;
+}
+
+MentalResult mentalUpdateFrameData(MentalFrameData* pFrame, MentalCamera* pCamera, int width, int height, float time)
+{
+    if (!pFrame || !pCamera) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    MentalFrameBlock* pBlock = &pFrame->block;
+    float aspect = height > 0 ? (float)width / (float)height : 1.0f;
+    mental_camera_get_view_matrix(pCamera, pBlock->view);
+    mental_camera_get_projection_matrix(pCamera, pBlock->projection, aspect);
+    glm_mat4_mul(pBlock->projection, pBlock->view, pBlock->viewProjection);
+    mentalFrustumFromMatrix(&pFrame->frustum, pBlock->viewProjection);
+    glm_vec3_copy(pCamera->position, pBlock->viewPos);
+    pBlock->time = time;
+    pBlock->aspect = aspect;
+    pBlock->resolution[0] = (float)width;
+    pBlock->resolution[1] = (float)height;
+
+    // Переопределение хранилища: драйвер не ждет, пока GPU дочитает прошлый кадр
+    glBindBuffer(GL_UNIFORM_BUFFER, pFrame->ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(MentalFrameBlock), NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(MentalFrameBlock), pBlock);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MENTAL_FRAME_BINDING, pFrame->ubo);
+    pFrame->frameIndex++;
+    return MENTAL_OK;
+}
+
+void mentalSetFrameLight(MentalFrameData* pFrame, const float position[3], const float color[3])
+{
+    if (!pFrame) {
+        return;
+    }
+    if (position) {
+        memcpy(pFrame->block.lightPos, position, sizeof(float) * 3);
+    }
+    if (color) {
+        memcpy(pFrame->block.lightColor, color, sizeof(float) * 3);
+    }
+}
+
+MentalResult mentalDestroyFrameData(MentalFrameData* pFrame)
+{
+    if (!pFrame) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    if (pFrame->ubo != 0) {
+        glDeleteBuffers(1, &pFrame->ubo);
+        pFrame->ubo = 0;
+    }
+    return MENTAL_OK;
+}
@@ -0,0 +1,45 @@
+#ifndef mental_frame_h
+#define mental_frame_h
+
+#include "mental.h"
+#include "component.h"
+
+// Данные кадра в общем uniform-буфере. Матрицы камеры, позиция наблюдателя,
+// источник света, время и разрешение считаются один раз за кадр и заливаются
+// в UBO на точке привязки MENTAL_FRAME_BINDING; все шейдеры движка читают
+// их из блока FrameData вместо отдельных юниформов в каждой программе.
+
+#define MENTAL_FRAME_BINDING        0       // Точка привязки uniform-блока FrameData
+#define MENTAL_FRAME_NEAR_PLANE     0.1f
+#define MENTAL_FRAME_FAR_PLANE      100.0f
+
+// Раскладка std140, порядок полей совпадает с блоком FrameData в GLSL:
+// vec3 занимает 12 байт, следующий за ним float ложится в тот же 16-байтный слот
+typedef struct MentalFrameBlock {
+    mat4       view;
+    mat4       projection;
+    mat4       viewProjection;
+    float      viewPos[3];
+    float      time;
+    float      lightPos[3];
+    float      aspect;
+    float      lightColor[3];
+    float      padding0;
+    float      resolution[2];
+    float      padding1[2];
+} MentalFrameBlock;
+
+typedef struct MentalFrameData {
+    uint32_t           ubo;
+    MentalFrameBlock   block;
+    MentalFrustum      frustum;    // Из viewProjection этого кадра, для отсечения на CPU
+    uint64_t           frameIndex;
+} MentalFrameData;
+
+MentalResult mentalCreateFrameData(MentalFrameData* pFrame);
+// Один раз за кадр, до первой отрисовки
+MentalResult mentalUpdateFrameData(MentalFrameData* pFrame, MentalCamera* pCamera, int width, int height, float time);
+void         mentalSetFrameLight(MentalFrameData* pFrame, const float position[3], const float color[3]);
+MentalResult mentalDestroyFrameData(MentalFrameData* pFrame);
+
+#endif // mental_frame_h
@@ -0,0 +1,588 @@
+#include "geompool.h"
+#include "component.h"
+#include "glstate.h"
+#include "gpucull.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Пакет, сохраненный для второго прохода того же кадра: экземпляры и команды
+// после отсечения лежат в своих буферах и рисуются повторно без загрузки
+typedef struct MentalGeometryRetained {
+    GLuint      instanceBuffer;
+    uint32_t    instanceBufferCapacity;
+    GLuint      indirectBuffer;
+    uint32_t    indirectBufferCapacity;
+    GLuint      countBuffer;
+    uint32_t    page;
+    uint32_t    count;
+    bool        compacted;
+    bool        valid;          // Записан в текущем кадре
+} MentalGeometryRetained;
+
+typedef struct MentalGeometrySpan {
+    uint32_t offset;
+    uint32_t size;
+} MentalGeometrySpan;
+
+// Свободные участки, упорядоченные по смещению
+typedef struct MentalGeometryFreeList {
+    MentalGeometrySpan* pSpans;
+    uint32_t            count;
+    uint32_t            capacity;
+} MentalGeometryFreeList;
+
+typedef struct MentalGeometryPage {
+    GLuint                  vao, vbo, ebo;
+    MentalGeometryFreeList  freeVertices;
+    MentalGeometryFreeList  freeIndices;
+    uint32_t                usedVertices;
+    uint32_t                usedIndices;
+} MentalGeometryPage;
+
+static struct {
+    MentalGeometryPage                  pages[MENTAL_GEOMETRY_MAX_PAGES];
+    uint32_t                            pageCount;
+
+    // Общие для всех страниц: матрицы моделей пакета и команды
+    GLuint                              instanceBuffer;
+    uint32_t                            instanceBufferCapacity;
+    GLuint                              indirectBuffer;
+    uint32_t                            indirectBufferCapacity;
+    // Отсечение на GPU: границы и исходные команды (SSBO), счетчик выживших
+    GLuint                              boundsBuffer;
+    uint32_t                            boundsBufferCapacity;
+    GLuint                              commandBuffer;
+    uint32_t                            commandBufferCapacity;
+    GLuint                              countBuffer;
+
+    MentalModelInstance*                pBatchInstances;
+    MentalDrawElementsIndirectCommand*  pBatchCommands;
+    MentalGpuCullBounds*                pBatchBounds;
+    uint32_t                            batchCount;
+    uint32_t                            batchCapacity;
+    uint32_t                            batchPage;
+
+    MentalGeometryRetained*             pRetained;
+    uint32_t                            retainedCount;
+    // Буфер, из которого VAO страниц сейчас читают атрибуты экземпляров
+    GLuint                              pageInstanceSource[MENTAL_GEOMETRY_MAX_PAGES];
+
+    uint32_t                            frameBatches;
+    uint32_t                            frameCommands;
+    MentalGeometryPoolStats             stats;
+} s_geometryPool;
+
+// Первый подходящий участок; остаток остается свободным
+static bool mental_geometry_take(MentalGeometryFreeList* pList, uint32_t size, uint32_t* pOffset)
+{
+    for (uint32_t i = 0; i < pList->count; i++) {
+        MentalGeometrySpan* pSpan = &pList->pSpans[i];
+        if (pSpan->size < size) {
+            continue;
+        }
+        *pOffset = pSpan->offset;
+        pSpan->offset += size;
+        pSpan->size -= size;
+        if (pSpan->size == 0) {
+            memmove(pSpan, pSpan + 1, sizeof(*pSpan) * (pList->count - i - 1));
+            pList->count--;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Возврат участка со слиянием с соседями слева и справа
+static MentalResult mental_geometry_give(MentalGeometryFreeList* pList, uint32_t offset, uint32_t size)
+{
+    uint32_t index = 0;
+    while (index < pList->count && pList->pSpans[index].offset < offset) {
+        index++;
+    }
+
+    bool mergeLeft = index > 0 && pList->pSpans[index - 1].offset + pList->pSpans[index - 1].size == offset;
+    bool mergeRight = index < pList->count && offset + size == pList->pSpans[index].offset;
+    if (mergeLeft && mergeRight) {
+        pList->pSpans[index - 1].size += size + pList->pSpans[index].size;
+        memmove(&pList->pSpans[index], &pList->pSpans[index + 1], sizeof(MentalGeometrySpan) * (pList->count - index - 1));
+        pList->count--;
+        return MENTAL_OK;
+    }
+    if (mergeLeft) {
+        pList->pSpans[index - 1].size += size;
+        return MENTAL_OK;
+    }
+    if (mergeRight) {
+        pList->pSpans[index].offset = offset;
+        pList->pSpans[index].size += size;
+        return MENTAL_OK;
+    }
+
+    if (pList->count == pList->capacity) {
+        uint32_t capacity = pList->capacity ? pList->capacity * 2 : 16;
+        MentalGeometrySpan* pSpans = realloc(pList->pSpans, sizeof(MentalGeometrySpan) * capacity);
+        if (!pSpans) {
+            return MENTAL_ERROR_OUT_OF_MEMORY;
+        }
+        pList->pSpans = pSpans;
+        pList->capacity = capacity;
+    }
+    memmove(&pList->pSpans[index + 1], &pList->pSpans[index], sizeof(MentalGeometrySpan) * (pList->count - index));
+    pList->pSpans[index].offset = offset;
+    pList->pSpans[index].size = size;
+    pList->count++;
+    return MENTAL_OK;
+}
+
+void mentalGeometryInstanceAttributes(uint32_t buffer)
+{
+    const GLsizei stride = sizeof(MentalModelInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (GLuint column = 0; column < 4; column++) {
+        glVertexAttribPointer(4 + column, 4, GL_FLOAT, GL_FALSE, stride,
+                              (void*)(offsetof(MentalModelInstance, model) + column * sizeof(vec4)));
+        glEnableVertexAttribArray(4 + column);
+        glVertexAttribDivisor(4 + column, 1);
+    }
+    glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MentalModelInstance, tint));
+    glEnableVertexAttribArray(8);
+    glVertexAttribDivisor(8, 1);
+    glVertexAttribIPointer(9, 2, GL_UNSIGNED_INT, stride, (void*)offsetof(MentalModelInstance, lod));
+    glEnableVertexAttribArray(9);
+    glVertexAttribDivisor(9, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void mentalGeometryBindRange(const MentalGeometryRange* pRange)
+{
+    const MentalGeometryPage* pPage = &s_geometryPool.pages[pRange->page];
+    const GLsizei stride = sizeof(MentalGeometryVertex);
+    size_t base = (size_t)pRange->firstVertex * sizeof(MentalGeometryVertex);
+
+    glBindBuffer(GL_ARRAY_BUFFER, pPage->vbo);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(MentalGeometryVertex, position)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(MentalGeometryVertex, texCoord)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(MentalGeometryVertex, normal)));
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // EBO запоминается текущим VAO
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pPage->ebo);
+}
+
+const void* mentalGeometryIndexOffset(const MentalGeometryRange* pRange)
+{
+    return (const void*)((size_t)pRange->firstIndex * sizeof(uint32_t));
+}
+
+bool mentalGeometryIndirectSupported(void)
+{
+    return GLEW_VERSION_4_3 != 0;
+}
+
+uint32_t mentalGeometryPageVAO(uint32_t page)
+{
+    return page < s_geometryPool.pageCount ? s_geometryPool.pages[page].vao : 0;
+}
+
+static MentalResult mental_geometry_open_page(void)
+{
+    if (s_geometryPool.pageCount == MENTAL_GEOMETRY_MAX_PAGES) {
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+    if (s_geometryPool.instanceBuffer == 0) {
+        glGenBuffers(1, &s_geometryPool.instanceBuffer);
+        glGenBuffers(1, &s_geometryPool.indirectBuffer);
+    }
+
+    uint32_t index = s_geometryPool.pageCount;
+    MentalGeometryPage* pPage = &s_geometryPool.pages[index];
+    memset(pPage, 0, sizeof(*pPage));
+    if (mental_geometry_give(&pPage->freeVertices, 0, MENTAL_GEOMETRY_PAGE_VERTICES) != MENTAL_OK ||
+        mental_geometry_give(&pPage->freeIndices, 0, MENTAL_GEOMETRY_PAGE_INDICES) != MENTAL_OK) {
+        free(pPage->freeVertices.pSpans);
+        free(pPage->freeIndices.pSpans);
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+
+    glGenVertexArrays(1, &pPage->vao);
+    glGenBuffers(1, &pPage->vbo);
+    glGenBuffers(1, &pPage->ebo);
+    glBindBuffer(GL_ARRAY_BUFFER, pPage->vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)MENTAL_GEOMETRY_PAGE_VERTICES * sizeof(MentalGeometryVertex), NULL,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // VAO страницы для пакетов: вершины от начала страницы, матрицы из общего буфера
+    s_geometryPool.pageCount++;
+    MentalGeometryRange whole = { .page = index, .valid = true };
+    mentalGLBindVertexArray(pPage->vao);
+    mentalGeometryBindRange(&whole);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)MENTAL_GEOMETRY_PAGE_INDICES * sizeof(uint32_t), NULL,
+                 GL_STATIC_DRAW);
+    mentalGeometryInstanceAttributes(s_geometryPool.instanceBuffer);
+    s_geometryPool.pageInstanceSource[index] = s_geometryPool.instanceBuffer;
+    mentalGLBindVertexArray(0);
+
+    MENTAL_DEBUG("Geometry pool page %u opened: %u vertices, %u indices", index, MENTAL_GEOMETRY_PAGE_VERTICES,
+                 MENTAL_GEOMETRY_PAGE_INDICES);
+    return MENTAL_OK;
+}
+
+static bool mental_geometry_place(MentalGeometryPage* pPage, uint32_t vertexCount, uint32_t indexCount,
+                                  uint32_t* pFirstVertex, uint32_t* pFirstIndex)
+{
+    if (!mental_geometry_take(&pPage->freeVertices, vertexCount, pFirstVertex)) {
+        return false;
+    }
+    if (!mental_geometry_take(&pPage->freeIndices, indexCount, pFirstIndex)) {
+        mental_geometry_give(&pPage->freeVertices, *pFirstVertex, vertexCount);
+        return false;
+    }
+    return true;
+}
+
+MentalResult mentalGeometryPoolAllocate(const MentalGeometryVertex* pVertices, uint32_t vertexCount,
+                                        const uint32_t* pIndices, uint32_t indexCount, MentalGeometryRange* pRange)
+{
+    if (!pVertices || !pIndices || !pRange) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    memset(pRange, 0, sizeof(*pRange));
+    if (vertexCount == 0 || indexCount == 0 || vertexCount > MENTAL_GEOMETRY_PAGE_VERTICES ||
+        indexCount > MENTAL_GEOMETRY_PAGE_INDICES) {
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+
+    uint32_t page = 0;
+    uint32_t firstVertex = 0, firstIndex = 0;
+    while (page < s_geometryPool.pageCount &&
+           !mental_geometry_place(&s_geometryPool.pages[page], vertexCount, indexCount, &firstVertex, &firstIndex)) {
+        page++;
+    }
+    if (page == s_geometryPool.pageCount) {
+        MentalResult result = mental_geometry_open_page();
+        if (result != MENTAL_OK ||
+            !mental_geometry_place(&s_geometryPool.pages[page], vertexCount, indexCount, &firstVertex, &firstIndex)) {
+            MENTAL_DEBUG("Geometry pool is full, model keeps its own buffers");
+            return MENTAL_ERROR_OUT_OF_MEMORY;
+        }
+    }
+
+    MentalGeometryPage* pPage = &s_geometryPool.pages[page];
+    glBindBuffer(GL_ARRAY_BUFFER, pPage->vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)firstVertex * sizeof(MentalGeometryVertex),
+                    (GLsizeiptr)vertexCount * sizeof(MentalGeometryVertex), pVertices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // EBO привязан к VAO страницы; загрузка через него не трогает VAO компонентов
+    mentalGLBindVertexArray(pPage->vao);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)firstIndex * sizeof(uint32_t),
+                    (GLsizeiptr)indexCount * sizeof(uint32_t), pIndices);
+    mentalGLBindVertexArray(0);
+
+    pPage->usedVertices += vertexCount;
+    pPage->usedIndices += indexCount;
+    pRange->page = page;
+    pRange->firstVertex = firstVertex;
+    pRange->vertexCount = vertexCount;
+    pRange->firstIndex = firstIndex;
+    pRange->indexCount = indexCount;
+    pRange->valid = true;
+    return MENTAL_OK;
+}
+
+void mentalGeometryPoolRelease(MentalGeometryRange* pRange)
+{
+    if (!pRange || !pRange->valid || pRange->page >= s_geometryPool.pageCount) {
+        return;
+    }
+    MentalGeometryPage* pPage = &s_geometryPool.pages[pRange->page];
+    mental_geometry_give(&pPage->freeVertices, pRange->firstVertex, pRange->vertexCount);
+    mental_geometry_give(&pPage->freeIndices, pRange->firstIndex, pRange->indexCount);
+    pPage->usedVertices -= pRange->vertexCount;
+    pPage->usedIndices -= pRange->indexCount;
+    memset(pRange, 0, sizeof(*pRange));
+}
+
+void mentalGeometryBatchBegin(uint32_t page)
+{
+    s_geometryPool.batchCount = 0;
+    s_geometryPool.batchPage = page;
+}
+
+MentalResult mentalGeometryBatchAdd(const MentalGeometryRange* pRange, mat4 world, const MentalBounds* pBounds)
+{
+    if (!pRange || !pRange->valid || pRange->page != s_geometryPool.batchPage) {
+        return MENTAL_ERROR_INVALID_PARAMETER;
+    }
+    if (s_geometryPool.batchCount == s_geometryPool.batchCapacity) {
+        uint32_t capacity = s_geometryPool.batchCapacity ? s_geometryPool.batchCapacity * 2 : 64;
+        MentalModelInstance* pInstances = realloc(s_geometryPool.pBatchInstances, sizeof(MentalModelInstance) * capacity);
+        if (!pInstances) {
+            return MENTAL_ERROR_OUT_OF_MEMORY;
+        }
+        s_geometryPool.pBatchInstances = pInstances;
+        MentalDrawElementsIndirectCommand* pCommands =
+            realloc(s_geometryPool.pBatchCommands, sizeof(MentalDrawElementsIndirectCommand) * capacity);
+        if (!pCommands) {
+            return MENTAL_ERROR_OUT_OF_MEMORY;
+        }
+        s_geometryPool.pBatchCommands = pCommands;
+        MentalGpuCullBounds* pCullBounds = realloc(s_geometryPool.pBatchBounds, sizeof(MentalGpuCullBounds) * capacity);
+        if (!pCullBounds) {
+            return MENTAL_ERROR_OUT_OF_MEMORY;
+        }
+        s_geometryPool.pBatchBounds = pCullBounds;
+        s_geometryPool.batchCapacity = capacity;
+    }
+
+    uint32_t index = s_geometryPool.batchCount++;
+    MentalModelInstance* pInstance = &s_geometryPool.pBatchInstances[index];
+    glm_mat4_copy(world, pInstance->model);
+    glm_vec4_one(pInstance->tint);
+    pInstance->lod = 0;
+    pInstance->material = 0;
+
+    MentalDrawElementsIndirectCommand* pCommand = &s_geometryPool.pBatchCommands[index];
+    pCommand->count = pRange->indexCount;
+    pCommand->instanceCount = 1;
+    pCommand->firstIndex = pRange->firstIndex;
+    pCommand->baseVertex = (int32_t)pRange->firstVertex;
+    pCommand->baseInstance = index;
+
+    MentalGpuCullBounds* pCullBounds = &s_geometryPool.pBatchBounds[index];
+    memset(pCullBounds, 0, sizeof(*pCullBounds));
+    if (pBounds && pBounds->valid) {
+        memcpy(pCullBounds->sphere, pBounds->center, sizeof(pBounds->center));
+        pCullBounds->sphere[3] = pBounds->radius;
+        memcpy(pCullBounds->extents, pBounds->extents, sizeof(pBounds->extents));
+        pCullBounds->extents[3] = 1.0f;
+    }
+    return MENTAL_OK;
+}
+
+// Буфер целиком переопределяется: предыдущий пакет может еще читаться GPU
+static void mental_geometry_stream(GLenum target, GLuint buffer, uint32_t* pCapacity, const void* pData, size_t size)
+{
+    glBindBuffer(target, buffer);
+    if (size > *pCapacity) {
+        *pCapacity = (uint32_t)size;
+    }
+    glBufferData(target, (GLsizeiptr)*pCapacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(target, 0, (GLsizeiptr)size, pData);
+}
+
+static GLuint mental_geometry_count_buffer(void)
+{
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, buffer);
+    glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+    return buffer;
+}
+
+// Команды пакета проходят через compute шейдер и пишутся в непрямой буфер на GPU
+static bool mental_geometry_cull_on_gpu(uint32_t count, GLuint indirectBuffer, uint32_t* pIndirectCapacity,
+                                        GLuint countBuffer)
+{
+    if (s_geometryPool.boundsBuffer == 0) {
+        glGenBuffers(1, &s_geometryPool.boundsBuffer);
+        glGenBuffers(1, &s_geometryPool.commandBuffer);
+    }
+    mental_geometry_stream(GL_SHADER_STORAGE_BUFFER, s_geometryPool.boundsBuffer, &s_geometryPool.boundsBufferCapacity,
+                           s_geometryPool.pBatchBounds, sizeof(MentalGpuCullBounds) * count);
+    mental_geometry_stream(GL_SHADER_STORAGE_BUFFER, s_geometryPool.commandBuffer,
+                           &s_geometryPool.commandBufferCapacity, s_geometryPool.pBatchCommands,
+                           sizeof(MentalDrawElementsIndirectCommand) * count);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Прежнее содержимое не нужно: шейдер перепишет все, что будет прочитано
+    size_t size = sizeof(MentalDrawElementsIndirectCommand) * count;
+    if (size > *pIndirectCapacity) {
+        *pIndirectCapacity = (uint32_t)size;
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)*pIndirectCapacity, NULL, GL_STREAM_DRAW);
+
+    return mentalGpuCullDispatch(s_geometryPool.boundsBuffer, s_geometryPool.commandBuffer,
+                                 indirectBuffer, countBuffer, count);
+}
+
+// Экземпляры и команды текущего пакета — в заданные буферы; true — команды сжаты
+static bool mental_geometry_upload(GLuint instanceBuffer, uint32_t* pInstanceCapacity, GLuint indirectBuffer,
+                                   uint32_t* pIndirectCapacity, GLuint countBuffer)
+{
+    uint32_t count = s_geometryPool.batchCount;
+    mental_geometry_stream(GL_ARRAY_BUFFER, instanceBuffer, pInstanceCapacity, s_geometryPool.pBatchInstances,
+                           sizeof(MentalModelInstance) * count);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Compute шейдер сменит программу; юниформы программы пакета при этом сохраняются
+    if (mentalGpuCullingActive()) {
+        return mental_geometry_cull_on_gpu(count, indirectBuffer, pIndirectCapacity, countBuffer);
+    }
+    mental_geometry_stream(GL_DRAW_INDIRECT_BUFFER, indirectBuffer, pIndirectCapacity, s_geometryPool.pBatchCommands,
+                           sizeof(MentalDrawElementsIndirectCommand) * count);
+    return false;
+}
+
+static void mental_geometry_draw(uint32_t program, uint32_t page, GLuint instanceBuffer, GLuint indirectBuffer,
+                                 GLuint countBuffer, uint32_t count, bool compacted)
+{
+    mentalGLUseProgram(program);
+    mentalGLBindVertexArray(s_geometryPool.pages[page].vao);
+    // Сохраненные пакеты читают экземпляры из своих буферов
+    if (s_geometryPool.pageInstanceSource[page] != instanceBuffer) {
+        mentalGeometryInstanceAttributes(instanceBuffer);
+        s_geometryPool.pageInstanceSource[page] = instanceBuffer;
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    if (compacted) {
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, countBuffer);
+        glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, 0, (GLsizei)count, 0);
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+    } else {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, (GLsizei)count, 0);
+    }
+    mentalGLBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    s_geometryPool.frameBatches++;
+    s_geometryPool.frameCommands += count;
+    s_geometryPool.stats.totalBatches++;
+    s_geometryPool.stats.totalCommands += count;
+}
+
+uint32_t mentalGeometryBatchSubmit(uint32_t program)
+{
+    uint32_t count = s_geometryPool.batchCount;
+    if (count == 0 || s_geometryPool.batchPage >= s_geometryPool.pageCount) {
+        return 0;
+    }
+
+    if (s_geometryPool.countBuffer == 0 && mentalGpuCullingActive()) {
+        s_geometryPool.countBuffer = mental_geometry_count_buffer();
+    }
+    bool compacted = mental_geometry_upload(s_geometryPool.instanceBuffer, &s_geometryPool.instanceBufferCapacity,
+                                            s_geometryPool.indirectBuffer, &s_geometryPool.indirectBufferCapacity,
+                                            s_geometryPool.countBuffer);
+    mental_geometry_draw(program, s_geometryPool.batchPage, s_geometryPool.instanceBuffer, s_geometryPool.indirectBuffer,
+                         s_geometryPool.countBuffer, count, compacted);
+    s_geometryPool.batchCount = 0;
+    return count;
+}
+
+uint32_t mentalGeometryBatchSubmitRetained(uint32_t program, uint32_t slot)
+{
+    uint32_t count = s_geometryPool.batchCount;
+    if (count == 0 || s_geometryPool.batchPage >= s_geometryPool.pageCount) {
+        return 0;
+    }
+    if (slot >= s_geometryPool.retainedCount) {
+        uint32_t capacity = s_geometryPool.retainedCount ? s_geometryPool.retainedCount : 16;
+        while (capacity <= slot) {
+            capacity *= 2;
+        }
+        MentalGeometryRetained* pRetained = realloc(s_geometryPool.pRetained, sizeof(MentalGeometryRetained) * capacity);
+        if (!pRetained) {
+            return mentalGeometryBatchSubmit(program);
+        }
+        memset(pRetained + s_geometryPool.retainedCount, 0,
+               sizeof(MentalGeometryRetained) * (capacity - s_geometryPool.retainedCount));
+        s_geometryPool.pRetained = pRetained;
+        s_geometryPool.retainedCount = capacity;
+    }
+
+    MentalGeometryRetained* pSlot = &s_geometryPool.pRetained[slot];
+    if (pSlot->instanceBuffer == 0) {
+        glGenBuffers(1, &pSlot->instanceBuffer);
+        glGenBuffers(1, &pSlot->indirectBuffer);
+        pSlot->countBuffer = mental_geometry_count_buffer();
+    }
+    pSlot->compacted = mental_geometry_upload(pSlot->instanceBuffer, &pSlot->instanceBufferCapacity,
+                                              pSlot->indirectBuffer, &pSlot->indirectBufferCapacity, pSlot->countBuffer);
+    pSlot->page = s_geometryPool.batchPage;
+    pSlot->count = count;
+    pSlot->valid = true;
+    mental_geometry_draw(program, pSlot->page, pSlot->instanceBuffer, pSlot->indirectBuffer, pSlot->countBuffer, count,
+                         pSlot->compacted);
+    s_geometryPool.batchCount = 0;
+    return count;
+}
+
+uint32_t mentalGeometryBatchRedraw(uint32_t program, uint32_t slot)
+{
+    if (slot >= s_geometryPool.retainedCount || !s_geometryPool.pRetained[slot].valid) {
+        return 0;
+    }
+    const MentalGeometryRetained* pSlot = &s_geometryPool.pRetained[slot];
+    mental_geometry_draw(program, pSlot->page, pSlot->instanceBuffer, pSlot->indirectBuffer, pSlot->countBuffer,
+                         pSlot->count, pSlot->compacted);
+    return pSlot->count;
+}
+
+void mentalGeometryPoolBeginFrame(void)
+{
+    s_geometryPool.stats.frameBatches = s_geometryPool.frameBatches;
+    s_geometryPool.stats.frameCommands = s_geometryPool.frameCommands;
+    s_geometryPool.frameBatches = 0;
+    s_geometryPool.frameCommands = 0;
+    for (uint32_t slot = 0; slot < s_geometryPool.retainedCount; slot++) {
+        s_geometryPool.pRetained[slot].valid = false;
+    }
+}
+
+void mentalGeometryPoolGetStats(MentalGeometryPoolStats* pStats)
+{
+    *pStats = s_geometryPool.stats;
+    pStats->pageCount = s_geometryPool.pageCount;
+    pStats->usedVertices = 0;
+    pStats->usedIndices = 0;
+    for (uint32_t page = 0; page < s_geometryPool.pageCount; page++) {
+        pStats->usedVertices += s_geometryPool.pages[page].usedVertices;
+        pStats->usedIndices += s_geometryPool.pages[page].usedIndices;
+    }
+}
+
+void mentalGeometryPoolShutdown(void)
+{
+    MentalGeometryPoolStats stats;
+    mentalGeometryPoolGetStats(&stats);
+    MENTAL_DEBUG("Geometry pool: %u pages, %u vertices and %u indices in use, %llu indirect batches for %llu models",
+                 stats.pageCount, stats.usedVertices, stats.usedIndices, (unsigned long long)stats.totalBatches,
+                 (unsigned long long)stats.totalCommands);
+
+    for (uint32_t page = 0; page < s_geometryPool.pageCount; page++) {
+        MentalGeometryPage* pPage = &s_geometryPool.pages[page];
+        mentalGLDeleteVertexArrays(1, &pPage->vao);
+        glDeleteBuffers(1, &pPage->vbo);
+        glDeleteBuffers(1, &pPage->ebo);
+        free(pPage->freeVertices.pSpans);
+        free(pPage->freeIndices.pSpans);
+    }
+    if (s_geometryPool.instanceBuffer) {
+        glDeleteBuffers(1, &s_geometryPool.instanceBuffer);
+        glDeleteBuffers(1, &s_geometryPool.indirectBuffer);
+    }
+    if (s_geometryPool.boundsBuffer) {
+        glDeleteBuffers(1, &s_geometryPool.boundsBuffer);
+        glDeleteBuffers(1, &s_geometryPool.commandBuffer);
+        glDeleteBuffers(1, &s_geometryPool.countBuffer);
+    }
+    for (uint32_t slot = 0; slot < s_geometryPool.retainedCount; slot++) {
+        MentalGeometryRetained* pSlot = &s_geometryPool.pRetained[slot];
+        if (pSlot->instanceBuffer) {
+            glDeleteBuffers(1, &pSlot->instanceBuffer);
+            glDeleteBuffers(1, &pSlot->indirectBuffer);
+            glDeleteBuffers(1, &pSlot->countBuffer);
+        }
+    }
+    free(s_geometryPool.pRetained);
+    free(s_geometryPool.pBatchInstances);
+    free(s_geometryPool.pBatchCommands);
+    free(s_geometryPool.pBatchBounds);
+    memset(&s_geometryPool, 0, sizeof(s_geometryPool));
+}
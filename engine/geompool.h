@@ -0,0 +1,95 @@
+#ifndef mental_geompool_h
+#define mental_geompool_h
+
+#include "mental.h"
+#include "culling.h"
+#include <cglm/cglm.h>
+
+// Общий пул статической геометрии. Вершины всех моделей лежат в одном формате
+// (MentalGeometryVertex) в нескольких больших страницах: у страницы один VBO,
+// один EBO и свой VAO. Диапазоны вершин и индексов выделяются из списков
+// свободных участков, освобожденные участки сливаются с соседями. Страницы не
+// растут и не переносятся, поэтому VAO компонентов, ссылающиеся на них,
+// остаются верными; когда место кончается, открывается следующая страница.
+//
+// При OpenGL 4.3 модели одной страницы с общей программой и материалом
+// рисуются одним glMultiDrawElementsIndirect: матрица каждой модели уходит в
+// общий буфер экземпляров (атрибуты 4–9, как у MentalModelInstance), команда
+// ссылается на нее через baseInstance. Без 4.3 модели из пула рисуются по
+// одной через VAO компонента. Когда работает отсечение на GPU (gpucull.h),
+// команды пакета перед отрисовкой проходят через compute шейдер.
+
+#define MENTAL_GEOMETRY_PAGE_VERTICES   (256u * 1024u)
+#define MENTAL_GEOMETRY_PAGE_INDICES    (1024u * 1024u)
+#define MENTAL_GEOMETRY_MAX_PAGES       8
+
+typedef struct MentalGeometryVertex {
+    float position[3];      // location = 0
+    float texCoord[2];      // location = 1
+    float normal[3];        // location = 2
+} MentalGeometryVertex;
+
+typedef struct MentalGeometryRange {
+    uint32_t page;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    uint32_t firstIndex;    // Индексы диапазона отсчитываются от firstVertex
+    uint32_t indexCount;
+    bool     valid;
+} MentalGeometryRange;
+
+// Команда glMultiDrawElementsIndirect (DrawElementsIndirectCommand)
+typedef struct MentalDrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t  baseVertex;
+    uint32_t baseInstance;
+} MentalDrawElementsIndirectCommand;
+
+typedef struct MentalGeometryPoolStats {
+    uint32_t   pageCount;
+    uint32_t   usedVertices;       // По всем страницам
+    uint32_t   usedIndices;
+    uint32_t   frameBatches;       // Вызовов glMultiDrawElementsIndirect за последний кадр
+    uint32_t   frameCommands;      // Моделей в них
+    uint64_t   totalBatches;
+    uint64_t   totalCommands;
+} MentalGeometryPoolStats;
+
+// Выделяет место и загружает вершины и индексы. MENTAL_ERROR_OUT_OF_MEMORY —
+// модель больше страницы или страницы кончились; тогда у модели свои буферы
+MentalResult mentalGeometryPoolAllocate(const MentalGeometryVertex* pVertices, uint32_t vertexCount,
+                                        const uint32_t* pIndices, uint32_t indexCount, MentalGeometryRange* pRange);
+void         mentalGeometryPoolRelease(MentalGeometryRange* pRange);
+
+// Настраивает атрибуты 0–2 и EBO текущего VAO на страницу диапазона так, что его
+// первая вершина получает индекс 0; индексы рисуются со смещения mentalGeometryIndexOffset
+void         mentalGeometryBindRange(const MentalGeometryRange* pRange);
+const void*  mentalGeometryIndexOffset(const MentalGeometryRange* pRange);
+// Атрибуты экземпляров 4–9 (MentalModelInstance) из buffer в текущем VAO, делитель 1
+void         mentalGeometryInstanceAttributes(uint32_t buffer);
+
+bool         mentalGeometryIndirectSupported(void);
+uint32_t     mentalGeometryPageVAO(uint32_t page);
+
+// Пакет одной страницы: Begin, Add на каждую модель, Submit — один вызов отрисовки.
+// pBounds — мировые границы для отсечения на GPU; NULL — модель всегда видна.
+// program — программа с атрибутами экземпляров, ее юниформы выставляются до Submit
+void         mentalGeometryBatchBegin(uint32_t page);
+MentalResult mentalGeometryBatchAdd(const MentalGeometryRange* pRange, mat4 world, const MentalBounds* pBounds);
+uint32_t     mentalGeometryBatchSubmit(uint32_t program);
+// То же, но экземпляры и команды после отсечения на GPU остаются в ячейке slot
+// до следующего кадра: второй проход (например, основной после прохода глубины)
+// рисует их mentalGeometryBatchRedraw без повторной загрузки и отсечения.
+// Redraw возвращает 0, если ячейка в этом кадре не записана
+uint32_t     mentalGeometryBatchSubmitRetained(uint32_t program, uint32_t slot);
+uint32_t     mentalGeometryBatchRedraw(uint32_t program, uint32_t slot);
+
+// Закрывает счетчики кадра; вызывается в начале каждого кадра
+void         mentalGeometryPoolBeginFrame(void);
+void         mentalGeometryPoolGetStats(MentalGeometryPoolStats* pStats);
+// Сводка в лог и удаление страниц (до уничтожения контекста)
+void         mentalGeometryPoolShutdown(void);
+
+#endif // mental_geompool_h
@@ -0,0 +1,350 @@
+#include "glstate.h"
+#include <string.h>
+
+#define MENTAL_GL_UNKNOWN       0xFFFFFFFFu
+
+typedef enum MentalGLTextureTarget {
+    MENTAL_GL_TARGET_2D = 0,
+    MENTAL_GL_TARGET_2D_ARRAY,
+    MENTAL_GL_TARGET_CUBE_MAP,
+    MENTAL_GL_TARGET_COUNT
+} MentalGLTextureTarget;
+
+// Режимы, которые включает движок; остальные glEnable проходят без кэша
+static const GLenum g_glCaps[] = {
+    GL_DEPTH_TEST,
+    GL_BLEND,
+    GL_CULL_FACE,
+    GL_MULTISAMPLE,
+    GL_POLYGON_SMOOTH,
+    GL_TEXTURE_CUBE_MAP_SEAMLESS,
+};
+#define MENTAL_GL_CAP_COUNT     (sizeof(g_glCaps) / sizeof(g_glCaps[0]))
+
+static struct {
+    GLuint      program;
+    GLuint      vao;
+    GLuint      activeUnit;     // Индекс блока, не GL_TEXTURE0 + i
+    GLuint      textures[MENTAL_GL_MAX_TEXTURE_UNITS][MENTAL_GL_TARGET_COUNT];
+    int8_t      caps[MENTAL_GL_CAP_COUNT];  // -1 — неизвестно
+    GLenum      blendSrc;
+    GLenum      blendDst;
+    GLenum      depthFunc;
+    int8_t      depthMask;
+    GLuint      drawFramebuffer;
+    GLuint      readFramebuffer;
+    GLint       viewport[4];
+    bool        viewportKnown;
+    bool        initialized;
+
+    uint64_t    issued[MENTAL_GL_CALL_COUNT];
+    uint64_t    skipped[MENTAL_GL_CALL_COUNT];
+    uint32_t    currentIssued;
+    uint32_t    currentSkipped;
+    uint32_t    frameIssued;
+    uint32_t    frameSkipped;
+    uint32_t    frameCount;
+} g_gl;
+
+static const char* g_glCallNames[MENTAL_GL_CALL_COUNT] = {
+    [MENTAL_GL_CALL_USE_PROGRAM]        = "UseProgram",
+    [MENTAL_GL_CALL_BIND_VERTEX_ARRAY]  = "BindVertexArray",
+    [MENTAL_GL_CALL_ACTIVE_TEXTURE]     = "ActiveTexture",
+    [MENTAL_GL_CALL_BIND_TEXTURE]       = "BindTexture",
+    [MENTAL_GL_CALL_ENABLE]             = "Enable/Disable",
+    [MENTAL_GL_CALL_BLEND_FUNC]         = "BlendFunc",
+    [MENTAL_GL_CALL_DEPTH_FUNC]         = "DepthFunc",
+    [MENTAL_GL_CALL_DEPTH_MASK]         = "DepthMask",
+    [MENTAL_GL_CALL_BIND_FRAMEBUFFER]   = "BindFramebuffer",
+    [MENTAL_GL_CALL_VIEWPORT]           = "Viewport",
+};
+
+void mentalGLStateInvalidate(void)
+{
+    g_gl.program = MENTAL_GL_UNKNOWN;
+    g_gl.vao = MENTAL_GL_UNKNOWN;
+    g_gl.activeUnit = MENTAL_GL_UNKNOWN;
+    memset(g_gl.textures, 0xFF, sizeof(g_gl.textures));
+    memset(g_gl.caps, -1, sizeof(g_gl.caps));
+    g_gl.blendSrc = MENTAL_GL_UNKNOWN;
+    g_gl.blendDst = MENTAL_GL_UNKNOWN;
+    g_gl.depthFunc = MENTAL_GL_UNKNOWN;
+    g_gl.depthMask = -1;
+    g_gl.drawFramebuffer = MENTAL_GL_UNKNOWN;
+    g_gl.readFramebuffer = MENTAL_GL_UNKNOWN;
+    g_gl.viewportKnown = false;
+    g_gl.initialized = true;
+}
+
+// Считает вызов; возвращает changed — нужно ли обращаться к драйверу
+static bool mental_gl_count(MentalGLCall call, bool changed)
+{
+    if (changed) {
+        g_gl.issued[call]++;
+        g_gl.currentIssued++;
+    } else {
+        g_gl.skipped[call]++;
+        g_gl.currentSkipped++;
+    }
+    return changed;
+}
+
+// Первый вызов после старта сам сбрасывает кэш: нулевая статическая память
+// совпала бы с настоящими значениями GL по умолчанию не во всем (например,
+// glDepthFunc начинается с GL_LESS, а область вывода — с размера окна)
+static void mental_gl_ensure_initialized(void)
+{
+    if (!g_gl.initialized) {
+        mentalGLStateInvalidate();
+    }
+}
+
+static int mental_gl_target_index(GLenum target)
+{
+    switch (target) {
+        case GL_TEXTURE_2D:         return MENTAL_GL_TARGET_2D;
+        case GL_TEXTURE_2D_ARRAY:   return MENTAL_GL_TARGET_2D_ARRAY;
+        case GL_TEXTURE_CUBE_MAP:   return MENTAL_GL_TARGET_CUBE_MAP;
+        default:                    return -1;
+    }
+}
+
+static int mental_gl_cap_index(GLenum cap)
+{
+    for (uint32_t i = 0; i < MENTAL_GL_CAP_COUNT; i++) {
+        if (g_glCaps[i] == cap) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void mentalGLStateBeginFrame(void)
+{
+    g_gl.frameIssued = g_gl.currentIssued;
+    g_gl.frameSkipped = g_gl.currentSkipped;
+    g_gl.currentIssued = 0;
+    g_gl.currentSkipped = 0;
+    g_gl.frameCount++;
+}
+
+void mentalGLStateGetStats(MentalGLStateStats* pStats)
+{
+    if (!pStats) {
+        return;
+    }
+    memcpy(pStats->issued, g_gl.issued, sizeof(pStats->issued));
+    memcpy(pStats->skipped, g_gl.skipped, sizeof(pStats->skipped));
+    pStats->frameIssued = g_gl.frameIssued;
+    pStats->frameSkipped = g_gl.frameSkipped;
+    pStats->frameCount = g_gl.frameCount;
+}
+
+void mentalGLStateShutdown(void)
+{
+    uint64_t issued = 0;
+    uint64_t skipped = 0;
+    for (int call = 0; call < MENTAL_GL_CALL_COUNT; call++) {
+        issued += g_gl.issued[call];
+        skipped += g_gl.skipped[call];
+        if (g_gl.issued[call] + g_gl.skipped[call] > 0) {
+            MENTAL_DEBUG("GL state: gl%s %llu issued, %llu skipped", g_glCallNames[call],
+                         (unsigned long long)g_gl.issued[call], (unsigned long long)g_gl.skipped[call]);
+        }
+    }
+    MENTAL_DEBUG("GL state: %llu calls issued, %llu skipped over %u frames (last frame %u/%u)",
+                 (unsigned long long)issued, (unsigned long long)skipped, g_gl.frameCount,
+                 g_gl.frameIssued, g_gl.frameSkipped);
+    memset(&g_gl, 0, sizeof(g_gl));
+}
+
+void mentalGLUseProgram(GLuint program)
+{
+    mental_gl_ensure_initialized();
+    if (mental_gl_count(MENTAL_GL_CALL_USE_PROGRAM, g_gl.program != program)) {
+        glUseProgram(program);
+        g_gl.program = program;
+    }
+}
+
+void mentalGLBindVertexArray(GLuint vao)
+{
+    mental_gl_ensure_initialized();
+    if (mental_gl_count(MENTAL_GL_CALL_BIND_VERTEX_ARRAY, g_gl.vao != vao)) {
+        glBindVertexArray(vao);
+        g_gl.vao = vao;
+    }
+}
+
+void mentalGLActiveTexture(GLenum unit)
+{
+    mental_gl_ensure_initialized();
+    GLuint index = unit - GL_TEXTURE0;
+    if (mental_gl_count(MENTAL_GL_CALL_ACTIVE_TEXTURE, g_gl.activeUnit != index)) {
+        glActiveTexture(unit);
+        g_gl.activeUnit = index;
+    }
+}
+
+void mentalGLBindTexture(GLenum target, GLuint texture)
+{
+    mental_gl_ensure_initialized();
+    int targetIndex = mental_gl_target_index(target);
+    GLuint unit = g_gl.activeUnit;
+    if (targetIndex < 0 || unit >= MENTAL_GL_MAX_TEXTURE_UNITS) {
+        // Блок или цель вне кэша: выполняем как есть
+        mental_gl_count(MENTAL_GL_CALL_BIND_TEXTURE, true);
+        glBindTexture(target, texture);
+        return;
+    }
+    GLuint* pBound = &g_gl.textures[unit][targetIndex];
+    if (mental_gl_count(MENTAL_GL_CALL_BIND_TEXTURE, *pBound != texture)) {
+        glBindTexture(target, texture);
+        *pBound = texture;
+    }
+}
+
+static void mental_gl_set_cap(GLenum cap, bool enabled)
+{
+    mental_gl_ensure_initialized();
+    int index = mental_gl_cap_index(cap);
+    bool changed = index < 0 || g_gl.caps[index] != (int8_t)enabled;
+    if (!mental_gl_count(MENTAL_GL_CALL_ENABLE, changed)) {
+        return;
+    }
+    if (enabled) {
+        glEnable(cap);
+    } else {
+        glDisable(cap);
+    }
+    if (index >= 0) {
+        g_gl.caps[index] = (int8_t)enabled;
+    }
+}
+
+void mentalGLEnable(GLenum cap)
+{
+    mental_gl_set_cap(cap, true);
+}
+
+void mentalGLDisable(GLenum cap)
+{
+    mental_gl_set_cap(cap, false);
+}
+
+void mentalGLBlendFunc(GLenum sfactor, GLenum dfactor)
+{
+    mental_gl_ensure_initialized();
+    bool changed = g_gl.blendSrc != sfactor || g_gl.blendDst != dfactor;
+    if (mental_gl_count(MENTAL_GL_CALL_BLEND_FUNC, changed)) {
+        glBlendFunc(sfactor, dfactor);
+        g_gl.blendSrc = sfactor;
+        g_gl.blendDst = dfactor;
+    }
+}
+
+void mentalGLDepthFunc(GLenum func)
+{
+    mental_gl_ensure_initialized();
+    if (mental_gl_count(MENTAL_GL_CALL_DEPTH_FUNC, g_gl.depthFunc != func)) {
+        glDepthFunc(func);
+        g_gl.depthFunc = func;
+    }
+}
+
+void mentalGLDepthMask(GLboolean flag)
+{
+    mental_gl_ensure_initialized();
+    int8_t value = flag ? 1 : 0;
+    if (mental_gl_count(MENTAL_GL_CALL_DEPTH_MASK, g_gl.depthMask != value)) {
+        glDepthMask(flag);
+        g_gl.depthMask = value;
+    }
+}
+
+void mentalGLBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    mental_gl_ensure_initialized();
+    bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    bool changed = (draw && g_gl.drawFramebuffer != framebuffer) || (read && g_gl.readFramebuffer != framebuffer);
+    if (!mental_gl_count(MENTAL_GL_CALL_BIND_FRAMEBUFFER, changed)) {
+        return;
+    }
+    glBindFramebuffer(target, framebuffer);
+    if (draw) {
+        g_gl.drawFramebuffer = framebuffer;
+    }
+    if (read) {
+        g_gl.readFramebuffer = framebuffer;
+    }
+}
+
+void mentalGLViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    mental_gl_ensure_initialized();
+    bool changed = !g_gl.viewportKnown || g_gl.viewport[0] != x || g_gl.viewport[1] != y ||
+                   g_gl.viewport[2] != width || g_gl.viewport[3] != height;
+    if (mental_gl_count(MENTAL_GL_CALL_VIEWPORT, changed)) {
+        glViewport(x, y, width, height);
+        g_gl.viewport[0] = x;
+        g_gl.viewport[1] = y;
+        g_gl.viewport[2] = width;
+        g_gl.viewport[3] = height;
+        g_gl.viewportKnown = true;
+    }
+}
+
+void mentalGLDeleteProgram(GLuint program)
+{
+    // Текущая программа удаляется отложенно и остается привязанной, но после
+    // следующего glUseProgram ее ID освободится — проще забыть ее сразу
+    glDeleteProgram(program);
+    if (program != 0 && g_gl.program == program) {
+        g_gl.program = MENTAL_GL_UNKNOWN;
+    }
+}
+
+void mentalGLDeleteVertexArrays(GLsizei n, const GLuint* pArrays)
+{
+    glDeleteVertexArrays(n, pArrays);
+    for (GLsizei i = 0; i < n; i++) {
+        if (pArrays[i] != 0 && g_gl.vao == pArrays[i]) {
+            g_gl.vao = 0;
+        }
+    }
+}
+
+void mentalGLDeleteTextures(GLsizei n, const GLuint* pTextures)
+{
+    glDeleteTextures(n, pTextures);
+    for (GLsizei i = 0; i < n; i++) {
+        if (pTextures[i] == 0) {
+            continue;
+        }
+        // Удаленная текстура отвязывается от всех блоков
+        for (uint32_t unit = 0; unit < MENTAL_GL_MAX_TEXTURE_UNITS; unit++) {
+            for (int target = 0; target < MENTAL_GL_TARGET_COUNT; target++) {
+                if (g_gl.textures[unit][target] == pTextures[i]) {
+                    g_gl.textures[unit][target] = 0;
+                }
+            }
+        }
+    }
+}
+
+void mentalGLDeleteFramebuffers(GLsizei n, const GLuint* pFramebuffers)
+{
+    glDeleteFramebuffers(n, pFramebuffers);
+    for (GLsizei i = 0; i < n; i++) {
+        if (pFramebuffers[i] == 0) {
+            continue;
+        }
+        if (g_gl.drawFramebuffer == pFramebuffers[i]) {
+            g_gl.drawFramebuffer = 0;
+        }
+        if (g_gl.readFramebuffer == pFramebuffers[i]) {
+            g_gl.readFramebuffer = 0;
+        }
+    }
+}
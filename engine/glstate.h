@@ -0,0 +1,67 @@
+#ifndef mental_glstate_h
+#define mental_glstate_h
+
+#include "mental.h"
+
+// Теневая копия состояния GL. Все вызовы движка, меняющие привязки и режимы,
+// идут через обертки ниже: обертка сравнивает запрос с тем, что уже выставлено,
+// и не обращается к драйверу, если состояние не меняется. Счетчики показывают,
+// сколько вызовов ушло в драйвер и сколько отброшено, по видам и за кадр.
+//
+// Кэш верен, только пока состояние меняется через обертки. После кода, который
+// трогает GL напрямую (сторонняя библиотека, новый контекст), нужен
+// mentalGLStateInvalidate. Удаление объектов тоже идет через обертки: GL
+// сбрасывает привязку удаленного объекта в 0, а его ID может быть выдан снова.
+
+#define MENTAL_GL_MAX_TEXTURE_UNITS     16
+
+typedef enum MentalGLCall {
+    MENTAL_GL_CALL_USE_PROGRAM = 0,
+    MENTAL_GL_CALL_BIND_VERTEX_ARRAY,
+    MENTAL_GL_CALL_ACTIVE_TEXTURE,
+    MENTAL_GL_CALL_BIND_TEXTURE,
+    MENTAL_GL_CALL_ENABLE,          // glEnable и glDisable
+    MENTAL_GL_CALL_BLEND_FUNC,
+    MENTAL_GL_CALL_DEPTH_FUNC,
+    MENTAL_GL_CALL_DEPTH_MASK,
+    MENTAL_GL_CALL_BIND_FRAMEBUFFER,
+    MENTAL_GL_CALL_VIEWPORT,
+    MENTAL_GL_CALL_COUNT
+} MentalGLCall;
+
+typedef struct MentalGLStateStats {
+    uint64_t   issued[MENTAL_GL_CALL_COUNT];   // Дошло до драйвера за все время
+    uint64_t   skipped[MENTAL_GL_CALL_COUNT];  // Отброшено: состояние уже такое
+    uint32_t   frameIssued;                    // За последний завершенный кадр
+    uint32_t   frameSkipped;
+    uint32_t   frameCount;
+} MentalGLStateStats;
+
+// Забыть все: следующий вызов каждого вида обязательно дойдет до драйвера
+void mentalGLStateInvalidate(void);
+// Закрывает счетчики кадра; вызывается в начале каждого кадра
+void mentalGLStateBeginFrame(void);
+void mentalGLStateGetStats(MentalGLStateStats* pStats);
+// Сводка в лог (при закрытии окна)
+void mentalGLStateShutdown(void);
+
+// Обертки повторяют сигнатуры GL
+void mentalGLUseProgram(GLuint program);
+void mentalGLBindVertexArray(GLuint vao);
+void mentalGLActiveTexture(GLenum unit);
+// Привязка на текущем блоке (как glBindTexture)
+void mentalGLBindTexture(GLenum target, GLuint texture);
+void mentalGLEnable(GLenum cap);
+void mentalGLDisable(GLenum cap);
+void mentalGLBlendFunc(GLenum sfactor, GLenum dfactor);
+void mentalGLDepthFunc(GLenum func);
+void mentalGLDepthMask(GLboolean flag);
+void mentalGLBindFramebuffer(GLenum target, GLuint framebuffer);
+void mentalGLViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+void mentalGLDeleteProgram(GLuint program);
+void mentalGLDeleteVertexArrays(GLsizei n, const GLuint* pArrays);
+void mentalGLDeleteTextures(GLsizei n, const GLuint* pTextures);
+void mentalGLDeleteFramebuffers(GLsizei n, const GLuint* pFramebuffers);
+
+#endif // mental_glstate_h
@@ -0,0 +1,265 @@
+#include "gpucull.h"
+#include "geompool.h"
+#include "shader.h"
+#include "glstate.h"
+#include <string.h>
+
+// Раскладка std140 блока CullData в gpu_cull_compute.glsl
+typedef struct MentalGpuCullBlock {
+    float      planes[6][4];
+    mat4       pyramidViewProjection;  // Матрица кадра, из которого построена пирамида
+    float      pyramidSize[2];
+    uint32_t   pyramidLevels;
+    uint32_t   useOcclusion;           // 0 — пирамиды еще нет, только пирамида видимости
+} MentalGpuCullBlock;
+
+static struct {
+    bool                disabled;
+    bool                requested;      // Программы заказаны (только при OpenGL 4.3)
+    bool                compacted;
+    uint32_t            cullProgram;
+    uint32_t            copyProgram;    // Уровень 0 пирамиды из копии глубины
+    uint32_t            reduceProgram;  // Следующий уровень из предыдущего
+    GLuint              ubo;
+    MentalGpuCullBlock  block;
+    mat4                frameViewProjection;
+
+    GLuint              depthTexture;
+    GLuint              pyramidTexture;
+    uint32_t            width, height, levels;
+    bool                pyramidValid;
+
+    uint32_t            frameDispatches;
+    uint32_t            frameObjects;
+    MentalGpuCullStats  stats;
+} s_gpuCull;
+
+static void mental_gpucull_request(const char* path, const char* defines, uint32_t* pProgram)
+{
+    MentalShaderDesc desc = {0};
+    desc.paths[MENTAL_SHADER_STAGE_COMPUTE] = path;
+    desc.defines = defines;
+    if (mentalShaderAcquireAsync(&desc, pProgram) != MENTAL_OK) {
+        *pProgram = 0;
+    }
+}
+
+// Программы заказываются асинхронно при первой проверке; до их готовности
+// модели отсекаются на CPU, как раньше
+static void mental_gpucull_request_programs(void)
+{
+    if (s_gpuCull.requested || !GLEW_VERSION_4_3) {
+        return;
+    }
+    s_gpuCull.requested = true;
+    s_gpuCull.compacted = GLEW_ARB_indirect_parameters != 0;
+    mental_gpucull_request(MENTAL_GPU_CULL_SHADER, s_gpuCull.compacted ? "COMPACT" : NULL, &s_gpuCull.cullProgram);
+    mental_gpucull_request(MENTAL_HIZ_SHADER, "FROM_DEPTH", &s_gpuCull.copyProgram);
+    mental_gpucull_request(MENTAL_HIZ_SHADER, NULL, &s_gpuCull.reduceProgram);
+    MENTAL_DEBUG("GPU culling requested, indirect command compaction %s",
+                 s_gpuCull.compacted ? "enabled" : "unavailable");
+}
+
+void mentalSetGpuCulling(bool enabled)
+{
+    s_gpuCull.disabled = !enabled;
+}
+
+static bool mental_gpucull_ready(void)
+{
+    if (s_gpuCull.disabled || !mentalGeometryIndirectSupported()) {
+        return false;
+    }
+    mental_gpucull_request_programs();
+    return s_gpuCull.cullProgram != 0 && mentalShaderIsReady(s_gpuCull.cullProgram);
+}
+
+// Без mentalGpuCullBeginFrame у шейдера нет плоскостей кадра
+bool mentalGpuCullingActive(void)
+{
+    return s_gpuCull.ubo != 0 && mental_gpucull_ready();
+}
+
+void mentalGpuCullBeginFrame(const MentalFrameData* pFrame)
+{
+    s_gpuCull.stats.frameDispatches = s_gpuCull.frameDispatches;
+    s_gpuCull.stats.frameObjects = s_gpuCull.frameObjects;
+    s_gpuCull.frameDispatches = 0;
+    s_gpuCull.frameObjects = 0;
+    if (!pFrame || !mental_gpucull_ready()) {
+        return;
+    }
+
+    MentalGpuCullBlock* pBlock = &s_gpuCull.block;
+    memcpy(pBlock->planes, pFrame->frustum.planes, sizeof(pBlock->planes));
+    pBlock->pyramidSize[0] = (float)s_gpuCull.width;
+    pBlock->pyramidSize[1] = (float)s_gpuCull.height;
+    pBlock->pyramidLevels = s_gpuCull.levels;
+    pBlock->useOcclusion = s_gpuCull.pyramidValid ? 1u : 0u;
+    glm_mat4_copy((vec4*)pFrame->block.viewProjection, s_gpuCull.frameViewProjection);
+
+    if (s_gpuCull.ubo == 0) {
+        glGenBuffers(1, &s_gpuCull.ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, s_gpuCull.ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(MentalGpuCullBlock), NULL, GL_DYNAMIC_DRAW);
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, s_gpuCull.ubo);
+    }
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(MentalGpuCullBlock), pBlock);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MENTAL_GPU_CULL_BINDING, s_gpuCull.ubo);
+}
+
+bool mentalGpuCullDispatch(uint32_t boundsBuffer, uint32_t commandBuffer, uint32_t outputBuffer,
+                           uint32_t countBuffer, uint32_t count)
+{
+    // Длина массивов в шейдере (length()) задается размером привязанных диапазонов
+    mentalShaderUse(s_gpuCull.cullProgram);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, boundsBuffer, 0,
+                      (GLsizeiptr)count * sizeof(MentalGpuCullBounds));
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, commandBuffer, 0,
+                      (GLsizeiptr)count * sizeof(MentalDrawElementsIndirectCommand));
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, outputBuffer, 0,
+                      (GLsizeiptr)count * sizeof(MentalDrawElementsIndirectCommand));
+    if (s_gpuCull.compacted) {
+        const GLuint zero = 0;
+        glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, countBuffer);
+        glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(zero), &zero);
+        glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+        glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 0, countBuffer);
+    }
+    if (s_gpuCull.block.useOcclusion) {
+        mentalGLActiveTexture(GL_TEXTURE0 + MENTAL_GPU_CULL_PYRAMID_UNIT);
+        mentalGLBindTexture(GL_TEXTURE_2D, s_gpuCull.pyramidTexture);
+    }
+
+    glDispatchCompute((count + MENTAL_GPU_CULL_GROUP_SIZE - 1) / MENTAL_GPU_CULL_GROUP_SIZE, 1, 1);
+    // Команды и счетчик читаются отрисовкой как непрямые параметры
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+    s_gpuCull.frameDispatches++;
+    s_gpuCull.frameObjects += count;
+    s_gpuCull.stats.totalDispatches++;
+    s_gpuCull.stats.totalObjects += count;
+    return s_gpuCull.compacted;
+}
+
+static uint32_t mental_gpucull_levels(uint32_t width, uint32_t height)
+{
+    uint32_t levels = 1;
+    uint32_t size = width > height ? width : height;
+    while (size > 1) {
+        size >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+static void mental_gpucull_release_pyramid(void)
+{
+    if (s_gpuCull.depthTexture) {
+        mentalGLDeleteTextures(1, &s_gpuCull.depthTexture);
+        mentalGLDeleteTextures(1, &s_gpuCull.pyramidTexture);
+    }
+    s_gpuCull.depthTexture = 0;
+    s_gpuCull.pyramidTexture = 0;
+    s_gpuCull.width = 0;
+    s_gpuCull.height = 0;
+    s_gpuCull.levels = 0;
+    s_gpuCull.pyramidValid = false;
+}
+
+static void mental_gpucull_resize(uint32_t width, uint32_t height)
+{
+    mental_gpucull_release_pyramid();
+    s_gpuCull.width = width;
+    s_gpuCull.height = height;
+    s_gpuCull.levels = mental_gpucull_levels(width, height);
+
+    mentalGLActiveTexture(GL_TEXTURE0 + MENTAL_GPU_CULL_PYRAMID_UNIT);
+    glGenTextures(1, &s_gpuCull.depthTexture);
+    mentalGLBindTexture(GL_TEXTURE_2D, s_gpuCull.depthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, (GLsizei)width, (GLsizei)height, 0, GL_DEPTH_COMPONENT,
+                 GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &s_gpuCull.pyramidTexture);
+    mentalGLBindTexture(GL_TEXTURE_2D, s_gpuCull.pyramidTexture);
+    glTexStorage2D(GL_TEXTURE_2D, (GLsizei)s_gpuCull.levels, GL_R32F, (GLsizei)width, (GLsizei)height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    MENTAL_DEBUG("Depth pyramid %ux%u, %u levels", width, height, s_gpuCull.levels);
+}
+
+static void mental_gpucull_dispatch_level(uint32_t level)
+{
+    uint32_t width = s_gpuCull.width >> level;
+    uint32_t height = s_gpuCull.height >> level;
+    width = width ? width : 1;
+    height = height ? height : 1;
+    glDispatchCompute((width + MENTAL_HIZ_GROUP_SIZE - 1) / MENTAL_HIZ_GROUP_SIZE,
+                      (height + MENTAL_HIZ_GROUP_SIZE - 1) / MENTAL_HIZ_GROUP_SIZE, 1);
+}
+
+void mentalGpuCullBuildDepthPyramid(int width, int height)
+{
+    if (width <= 0 || height <= 0 || !mentalGpuCullingActive() || !mentalShaderIsReady(s_gpuCull.copyProgram) ||
+        !mentalShaderIsReady(s_gpuCull.reduceProgram)) {
+        return;
+    }
+    if ((uint32_t)width != s_gpuCull.width || (uint32_t)height != s_gpuCull.height) {
+        mental_gpucull_resize((uint32_t)width, (uint32_t)height);
+    }
+
+    // Глубина окна напрямую в compute шейдер не попадает: сначала копия в текстуру
+    mentalGLBindFramebuffer(GL_FRAMEBUFFER, 0);
+    mentalGLActiveTexture(GL_TEXTURE0 + MENTAL_GPU_CULL_PYRAMID_UNIT);
+    mentalGLBindTexture(GL_TEXTURE_2D, s_gpuCull.depthTexture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+    mentalShaderUse(s_gpuCull.copyProgram);
+    glBindImageTexture(1, s_gpuCull.pyramidTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    mental_gpucull_dispatch_level(0);
+
+    mentalShaderUse(s_gpuCull.reduceProgram);
+    for (uint32_t level = 1; level < s_gpuCull.levels; level++) {
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        glBindImageTexture(0, s_gpuCull.pyramidTexture, (GLint)level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, s_gpuCull.pyramidTexture, (GLint)level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        mental_gpucull_dispatch_level(level);
+    }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    glm_mat4_copy(s_gpuCull.frameViewProjection, s_gpuCull.block.pyramidViewProjection);
+    s_gpuCull.pyramidValid = true;
+}
+
+void mentalGpuCullGetStats(MentalGpuCullStats* pStats)
+{
+    *pStats = s_gpuCull.stats;
+    pStats->pyramidWidth = s_gpuCull.pyramidValid ? s_gpuCull.width : 0;
+    pStats->pyramidHeight = s_gpuCull.pyramidValid ? s_gpuCull.height : 0;
+    pStats->pyramidLevels = s_gpuCull.pyramidValid ? s_gpuCull.levels : 0;
+    pStats->compacted = s_gpuCull.compacted;
+}
+
+void mentalGpuCullShutdown(void)
+{
+    MentalGpuCullStats stats;
+    mentalGpuCullGetStats(&stats);
+    MENTAL_DEBUG("GPU culling: %llu dispatches for %llu objects, depth pyramid %ux%u (%u levels), compaction %s",
+                 (unsigned long long)stats.totalDispatches, (unsigned long long)stats.totalObjects,
+                 stats.pyramidWidth, stats.pyramidHeight, stats.pyramidLevels, stats.compacted ? "on" : "off");
+
+    mental_gpucull_release_pyramid();
+    if (s_gpuCull.ubo) {
+        glDeleteBuffers(1, &s_gpuCull.ubo);
+    }
+    mentalShaderRelease(s_gpuCull.cullProgram);
+    mentalShaderRelease(s_gpuCull.copyProgram);
+    mentalShaderRelease(s_gpuCull.reduceProgram);
+    memset(&s_gpuCull, 0, sizeof(s_gpuCull));
+}
@@ -0,0 +1,66 @@
+#ifndef mental_gpucull_h
+#define mental_gpucull_h
+
+#include "mental.h"
+#include "frame.h"
+
+// Отсечение моделей из пула геометрии на GPU (OpenGL 4.3, compute шейдеры).
+// Пакет пула (geompool.h) кладет в SSBO мировые границы и исходные команды
+// всех своих моделей; шейдер gpu_cull_compute.glsl проверяет каждую по
+// пирамиде видимости кадра и по пирамиде глубины прошлого кадра (Hi-Z) и
+// пишет выжившие команды в буфер непрямой отрисовки. С
+// GL_ARB_indirect_parameters выжившие сжимаются атомарным счетчиком и число
+// команд берется из него же (glMultiDrawElementsIndirectCountARB); без
+// расширения отброшенные команды остаются на месте с instanceCount = 0.
+// CPU не проверяет такие модели вовсе: очередь отрисовки отдает их без границ.
+//
+// Пирамида глубины строится в конце кадра из буфера глубины окна: уровень 0
+// копируется, каждый следующий хранит максимум (самую дальнюю глубину) 2x2
+// текселей предыдущего. Объект невидим, если ближайшая точка его AABB в
+// прошлом кадре дальше всей глубины на занятом им участке экрана.
+
+#define MENTAL_GPU_CULL_BINDING         2       // Точка привязки uniform-блока CullData
+#define MENTAL_GPU_CULL_PYRAMID_UNIT    11      // Текстурный блок пирамиды и копии глубины
+#define MENTAL_GPU_CULL_GROUP_SIZE      64      // local_size_x в gpu_cull_compute.glsl
+#define MENTAL_HIZ_GROUP_SIZE           8       // local_size_x/y в hiz_compute.glsl
+
+#define MENTAL_GPU_CULL_SHADER          "gpu_cull_compute.glsl"
+#define MENTAL_HIZ_SHADER               "hiz_compute.glsl"
+
+// Границы объекта в SSBO (std430): центр и радиус сферы, полуразмеры AABB и
+// w = 0, если границ нет и объект всегда виден
+typedef struct MentalGpuCullBounds {
+    float   sphere[4];
+    float   extents[4];
+} MentalGpuCullBounds;
+
+typedef struct MentalGpuCullStats {
+    uint32_t   frameDispatches;    // Запусков отсечения за последний кадр
+    uint32_t   frameObjects;       // Объектов в них
+    uint64_t   totalDispatches;
+    uint64_t   totalObjects;
+    uint32_t   pyramidWidth;       // 0 — пирамиды еще нет
+    uint32_t   pyramidHeight;
+    uint32_t   pyramidLevels;
+    bool       compacted;          // Команды сжимаются (GL_ARB_indirect_parameters)
+} MentalGpuCullStats;
+
+// По умолчанию включено; действует, когда есть OpenGL 4.3, шейдеры собраны и
+// кадр начат mentalGpuCullBeginFrame
+void         mentalSetGpuCulling(bool enabled);
+bool         mentalGpuCullingActive(void);
+
+// После mentalUpdateFrameData: плоскости кадра и матрица пирамиды уходят в CullData
+void         mentalGpuCullBeginFrame(const MentalFrameData* pFrame);
+// count исходных команд (commandBuffer) и их границ (boundsBuffer) — в outputBuffer.
+// Если результат сжат, возвращает true, а число команд лежит в countBuffer (GLuint)
+bool         mentalGpuCullDispatch(uint32_t boundsBuffer, uint32_t commandBuffer, uint32_t outputBuffer,
+                                   uint32_t countBuffer, uint32_t count);
+// После непрозрачных объектов кадра; пирамида пригодится следующему кадру
+void         mentalGpuCullBuildDepthPyramid(int width, int height);
+
+void         mentalGpuCullGetStats(MentalGpuCullStats* pStats);
+// Сводка в лог, удаление текстур и буферов (до уничтожения контекста)
+void         mentalGpuCullShutdown(void);
+
+#endif // mental_gpucull_h
@@ -0,0 +1,30 @@
+#ifndef mental_hash_h
+#define mental_hash_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+// FNV-1a (64 бита) — ключи для кэшей на диске и в памяти
+#define MENTAL_HASH_SEED    1469598103934665603ull
+#define MENTAL_HASH_PRIME   1099511628211ull
+
+static inline uint64_t mentalHashBytes(const void* data, size_t size, uint64_t hash)
+{
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= MENTAL_HASH_PRIME;
+    }
+    return hash;
+}
+
+static inline uint64_t mentalHashString(const char* string, uint64_t hash)
+{
+    for (; string && *string; string++) {
+        hash ^= (unsigned char)*string;
+        hash *= MENTAL_HASH_PRIME;
+    }
+    return hash;
+}
+
+#endif // mental_hash_h
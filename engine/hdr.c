@@ -0,0 +1,356 @@
+#include "hdr.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "../stb_image.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Ограничения форматов (EXT_packed_float, EXT_texture_shared_exponent)
+#define MENTAL_HDR_R11_MAX          65024.0f        // (2 - 2^-6) * 2^15
+#define MENTAL_HDR_B10_MAX          64512.0f        // (2 - 2^-5) * 2^15
+#define MENTAL_HDR_RGB9E5_MAX       65408.0f        // (511 / 512) * 2^16
+#define MENTAL_HDR_RGB9E5_MIN       (1.0f / 65536.0f)
+#define MENTAL_HDR_DENORM_LIMIT     (113u << 23)    // 2^-14 — наименьшее нормальное число
+#define MENTAL_HDR_REBIAS           ((uint32_t)(15 - 127) << 23)
+
+static MentalHDRFormat g_cubemapFormat = MENTAL_HDR_FORMAT_R11G11B10F;
+
+void mentalHDRSetCubemapFormat(MentalHDRFormat format)
+{
+    g_cubemapFormat = format;
+}
+
+MentalHDRFormat mentalHDRGetCubemapFormat(void)
+{
+    return g_cubemapFormat;
+}
+
+uint32_t mentalHDRInternalFormat(MentalHDRFormat format)
+{
+    return format == MENTAL_HDR_FORMAT_RGB9E5 ? GL_RGB9_E5 : GL_R11F_G11F_B10F;
+}
+
+uint32_t mentalHDRPixelType(MentalHDRFormat format)
+{
+    return format == MENTAL_HDR_FORMAT_RGB9E5 ? GL_UNSIGNED_INT_5_9_9_9_REV : GL_UNSIGNED_INT_10F_11F_11F_REV;
+}
+
+static inline uint32_t mental_hdr_float_bits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static inline float mental_hdr_bits_float(uint32_t bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Беззнаковый float с 5-битной экспонентой и mantissaBits мантиссы, округление к четному
+static inline uint32_t mental_hdr_pack_float(float value, uint32_t mantissaBits, float maxValue)
+{
+    if (!(value > 0.0f)) {
+        return 0;   // Отрицательные и NaN
+    }
+    if (value > maxValue) {
+        value = maxValue;
+    }
+
+    uint32_t shift = 23 - mantissaBits;
+    uint32_t bits = mental_hdr_float_bits(value);
+    if (bits < MENTAL_HDR_DENORM_LIMIT) {
+        // Денормализованный результат: сложение с "магическим" числом выравнивает мантиссу
+        uint32_t magic = ((127 - 15) + shift + 1) << 23;
+        return mental_hdr_float_bits(value + mental_hdr_bits_float(magic)) - magic;
+    }
+
+    uint32_t odd = (bits >> shift) & 1;
+    bits += MENTAL_HDR_REBIAS + ((1u << (shift - 1)) - 1) + odd;
+    return bits >> shift;
+}
+
+static inline uint32_t mental_hdr_pack_rgb9e5(float r, float g, float b)
+{
+    r = r > 0.0f ? (r < MENTAL_HDR_RGB9E5_MAX ? r : MENTAL_HDR_RGB9E5_MAX) : 0.0f;
+    g = g > 0.0f ? (g < MENTAL_HDR_RGB9E5_MAX ? g : MENTAL_HDR_RGB9E5_MAX) : 0.0f;
+    b = b > 0.0f ? (b < MENTAL_HDR_RGB9E5_MAX ? b : MENTAL_HDR_RGB9E5_MAX) : 0.0f;
+
+    float maxc = r > g ? r : g;
+    maxc = maxc > b ? maxc : b;
+    maxc = maxc > MENTAL_HDR_RGB9E5_MIN ? maxc : MENTAL_HDR_RGB9E5_MIN;
+
+    // floor(log2(maxc)) прямо из битов экспоненты, масштаб 2^(8 - e) тоже собираем из битов
+    int exponent = (int)(mental_hdr_float_bits(maxc) >> 23) - 127;
+    float scale = mental_hdr_bits_float((uint32_t)(127 + 8 - exponent) << 23);
+    if ((uint32_t)(maxc * scale + 0.5f) == 512) {
+        scale *= 0.5f;
+        exponent++;
+    }
+
+    uint32_t rm = (uint32_t)(r * scale + 0.5f);
+    uint32_t gm = (uint32_t)(g * scale + 0.5f);
+    uint32_t bm = (uint32_t)(b * scale + 0.5f);
+    return rm | (gm << 9) | (bm << 18) | ((uint32_t)(exponent + 16) << 27);
+}
+
+#if defined(__SSE2__)
+
+// Четыре RGB пикселя (12 float) -> три регистра по каналам
+static inline void mental_hdr_load4(const float* rgb, __m128* pR, __m128* pG, __m128* pB)
+{
+    __m128 a = _mm_loadu_ps(rgb);        // r0 g0 b0 r1
+    __m128 b = _mm_loadu_ps(rgb + 4);    // g1 b1 r2 g2
+    __m128 c = _mm_loadu_ps(rgb + 8);    // b2 r3 g3 b3
+
+    __m128 t = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+    *pR = _mm_shuffle_ps(a, t, _MM_SHUFFLE(2, 0, 3, 0));
+
+    __m128 x = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+    __m128 y = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+    *pG = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+
+    x = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+    y = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0));
+    *pB = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+static inline __m128i mental_hdr_pack_float4(__m128 value, uint32_t mantissaBits, float maxValue)
+{
+    // max с нулем вторым аргументом превращает NaN в 0
+    value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(maxValue));
+
+    uint32_t shift = 23 - mantissaBits;
+    __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    __m128i bits = _mm_castps_si128(value);
+
+    __m128i magic = _mm_set1_epi32((int)(((127 - 15) + shift + 1) << 23));
+    __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(value, _mm_castsi128_ps(magic))), magic);
+
+    __m128i odd = _mm_and_si128(_mm_srl_epi32(bits, shiftCount), _mm_set1_epi32(1));
+    __m128i normal = _mm_add_epi32(bits, _mm_set1_epi32((int)(MENTAL_HDR_REBIAS + ((1u << (shift - 1)) - 1))));
+    normal = _mm_srl_epi32(_mm_add_epi32(normal, odd), shiftCount);
+
+    __m128i isDenormal = _mm_cmplt_epi32(bits, _mm_set1_epi32((int)MENTAL_HDR_DENORM_LIMIT));
+    return _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+}
+
+static size_t mental_hdr_encode_r11g11b10f_simd(const float* rgb, uint32_t* packed, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 r, g, b;
+        mental_hdr_load4(rgb + i * 3, &r, &g, &b);
+        __m128i result = mental_hdr_pack_float4(r, 6, MENTAL_HDR_R11_MAX);
+        result = _mm_or_si128(result, _mm_slli_epi32(mental_hdr_pack_float4(g, 6, MENTAL_HDR_R11_MAX), 11));
+        result = _mm_or_si128(result, _mm_slli_epi32(mental_hdr_pack_float4(b, 5, MENTAL_HDR_B10_MAX), 22));
+        _mm_storeu_si128((__m128i*)(packed + i), result);
+    }
+    return i;
+}
+
+static size_t mental_hdr_encode_rgb9e5_simd(const float* rgb, uint32_t* packed, size_t count)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 maxValue = _mm_set1_ps(MENTAL_HDR_RGB9E5_MAX);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 r, g, b;
+        mental_hdr_load4(rgb + i * 3, &r, &g, &b);
+        r = _mm_min_ps(_mm_max_ps(r, zero), maxValue);
+        g = _mm_min_ps(_mm_max_ps(g, zero), maxValue);
+        b = _mm_min_ps(_mm_max_ps(b, zero), maxValue);
+
+        __m128 maxc = _mm_max_ps(_mm_max_ps(r, g), _mm_max_ps(b, _mm_set1_ps(MENTAL_HDR_RGB9E5_MIN)));
+        __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(maxc), 23), _mm_set1_epi32(127));
+        __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(_mm_set1_epi32(127 + 8), exponent), 23));
+
+        // Округление максимума до 512 — экспонента на единицу больше, масштаб вдвое меньше
+        __m128i maxm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(maxc, scale), half));
+        __m128i overflow = _mm_cmpeq_epi32(maxm, _mm_set1_epi32(512));
+        scale = _mm_mul_ps(scale, _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(overflow), half),
+                                           _mm_andnot_ps(_mm_castsi128_ps(overflow), _mm_set1_ps(1.0f))));
+        exponent = _mm_sub_epi32(exponent, overflow);
+
+        __m128i rm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(r, scale), half));
+        __m128i gm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(g, scale), half));
+        __m128i bm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(b, scale), half));
+        __m128i result = _mm_or_si128(rm, _mm_slli_epi32(gm, 9));
+        result = _mm_or_si128(result, _mm_slli_epi32(bm, 18));
+        result = _mm_or_si128(result, _mm_slli_epi32(_mm_add_epi32(exponent, _mm_set1_epi32(16)), 27));
+        _mm_storeu_si128((__m128i*)(packed + i), result);
+    }
+    return i;
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+static inline uint32x4_t mental_hdr_pack_float4(float32x4_t value, uint32_t mantissaBits, float maxValue)
+{
+    // vmaxnm игнорирует NaN и возвращает 0
+    value = vminq_f32(vmaxnmq_f32(value, vdupq_n_f32(0.0f)), vdupq_n_f32(maxValue));
+
+    uint32_t shift = 23 - mantissaBits;
+    int32x4_t shiftRight = vdupq_n_s32(-(int32_t)shift);
+    uint32x4_t bits = vreinterpretq_u32_f32(value);
+
+    uint32x4_t magic = vdupq_n_u32(((127 - 15) + shift + 1) << 23);
+    uint32x4_t denormal = vsubq_u32(vreinterpretq_u32_f32(vaddq_f32(value, vreinterpretq_f32_u32(magic))), magic);
+
+    uint32x4_t odd = vandq_u32(vshlq_u32(bits, shiftRight), vdupq_n_u32(1));
+    uint32x4_t normal = vaddq_u32(bits, vdupq_n_u32(MENTAL_HDR_REBIAS + ((1u << (shift - 1)) - 1)));
+    normal = vshlq_u32(vaddq_u32(normal, odd), shiftRight);
+
+    return vbslq_u32(vcltq_u32(bits, vdupq_n_u32(MENTAL_HDR_DENORM_LIMIT)), denormal, normal);
+}
+
+static size_t mental_hdr_encode_r11g11b10f_simd(const float* rgb, uint32_t* packed, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4x3_t pixels = vld3q_f32(rgb + i * 3);
+        uint32x4_t result = mental_hdr_pack_float4(pixels.val[0], 6, MENTAL_HDR_R11_MAX);
+        result = vorrq_u32(result, vshlq_n_u32(mental_hdr_pack_float4(pixels.val[1], 6, MENTAL_HDR_R11_MAX), 11));
+        result = vorrq_u32(result, vshlq_n_u32(mental_hdr_pack_float4(pixels.val[2], 5, MENTAL_HDR_B10_MAX), 22));
+        vst1q_u32(packed + i, result);
+    }
+    return i;
+}
+
+static size_t mental_hdr_encode_rgb9e5_simd(const float* rgb, uint32_t* packed, size_t count)
+{
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t maxValue = vdupq_n_f32(MENTAL_HDR_RGB9E5_MAX);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4x3_t pixels = vld3q_f32(rgb + i * 3);
+        float32x4_t r = vminq_f32(vmaxnmq_f32(pixels.val[0], zero), maxValue);
+        float32x4_t g = vminq_f32(vmaxnmq_f32(pixels.val[1], zero), maxValue);
+        float32x4_t b = vminq_f32(vmaxnmq_f32(pixels.val[2], zero), maxValue);
+
+        float32x4_t maxc = vmaxq_f32(vmaxq_f32(r, g), vmaxq_f32(b, vdupq_n_f32(MENTAL_HDR_RGB9E5_MIN)));
+        int32x4_t exponent = vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_f32(maxc), 23)),
+                                       vdupq_n_s32(127));
+        float32x4_t scale = vreinterpretq_f32_s32(vshlq_n_s32(vsubq_s32(vdupq_n_s32(127 + 8), exponent), 23));
+
+        uint32x4_t maxm = vcvtq_u32_f32(vaddq_f32(vmulq_f32(maxc, scale), half));
+        uint32x4_t overflow = vceqq_u32(maxm, vdupq_n_u32(512));
+        scale = vmulq_f32(scale, vbslq_f32(overflow, half, vdupq_n_f32(1.0f)));
+        exponent = vsubq_s32(exponent, vreinterpretq_s32_u32(overflow));
+
+        uint32x4_t rm = vcvtq_u32_f32(vaddq_f32(vmulq_f32(r, scale), half));
+        uint32x4_t gm = vcvtq_u32_f32(vaddq_f32(vmulq_f32(g, scale), half));
+        uint32x4_t bm = vcvtq_u32_f32(vaddq_f32(vmulq_f32(b, scale), half));
+        uint32x4_t result = vorrq_u32(rm, vshlq_n_u32(gm, 9));
+        result = vorrq_u32(result, vshlq_n_u32(bm, 18));
+        result = vorrq_u32(result, vshlq_n_u32(vreinterpretq_u32_s32(vaddq_s32(exponent, vdupq_n_s32(16))), 27));
+        vst1q_u32(packed + i, result);
+    }
+    return i;
+}
+
+#else
+
+static size_t mental_hdr_encode_r11g11b10f_simd(const float* rgb, uint32_t* packed, size_t count)
+{
+    (void)rgb; (void)packed; (void)count;
+    return 0;
+}
+
+static size_t mental_hdr_encode_rgb9e5_simd(const float* rgb, uint32_t* packed, size_t count)
+{
+    (void)rgb; (void)packed; (void)count;
+    return 0;
+}
+
+#endif
+
+void mentalEncodeR11G11B10F(const float* rgb, uint32_t* packed, size_t count)
+{
+    // SIMD ядро обрабатывает по 4 пикселя, хвост — скалярно
+    for (size_t i = mental_hdr_encode_r11g11b10f_simd(rgb, packed, count); i < count; i++) {
+        const float* pixel = rgb + i * 3;
+        packed[i] = mental_hdr_pack_float(pixel[0], 6, MENTAL_HDR_R11_MAX) |
+                    (mental_hdr_pack_float(pixel[1], 6, MENTAL_HDR_R11_MAX) << 11) |
+                    (mental_hdr_pack_float(pixel[2], 5, MENTAL_HDR_B10_MAX) << 22);
+    }
+}
+
+void mentalEncodeRGB9E5(const float* rgb, uint32_t* packed, size_t count)
+{
+    for (size_t i = mental_hdr_encode_rgb9e5_simd(rgb, packed, count); i < count; i++) {
+        const float* pixel = rgb + i * 3;
+        packed[i] = mental_hdr_pack_rgb9e5(pixel[0], pixel[1], pixel[2]);
+    }
+}
+
+void mentalEncodeHDR(MentalHDRFormat format, const float* rgb, uint32_t* packed, size_t count)
+{
+    if (format == MENTAL_HDR_FORMAT_RGB9E5) {
+        mentalEncodeRGB9E5(rgb, packed, count);
+    } else {
+        mentalEncodeR11G11B10F(rgb, packed, count);
+    }
+}
+
+MentalResult mentalBakeHDRImage(const char* sourcePath, const char* destinationPath, MentalHDRFormat format)
+{
+    if (!sourcePath || !destinationPath) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    int width = 0, height = 0, channels = 0;
+    float* rgb = stbi_loadf(sourcePath, &width, &height, &channels, 3);
+    if (!rgb) {
+        MENTAL_DEBUG("Failed to load HDR image %s: %s", sourcePath, stbi_failure_reason());
+        return MENTAL_ERROR_TEXTURE_LOAD_FAILED;
+    }
+
+    size_t count = (size_t)width * height;
+    uint32_t* packed = malloc(count * sizeof(uint32_t));
+    if (!packed) {
+        stbi_image_free(rgb);
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+    mentalEncodeHDR(format, rgb, packed, count);
+    stbi_image_free(rgb);
+
+    FILE* file = fopen(destinationPath, "wb");
+    if (!file) {
+        MENTAL_DEBUG("Failed to create HDR file: %s", destinationPath);
+        free(packed);
+        return MENTAL_FILE_OPEN_FAILED;
+    }
+
+    MentalHDRFileHeader header;
+    memcpy(header.magic, MENTAL_HDR_FILE_MAGIC, 4);
+    header.version = MENTAL_HDR_FILE_VERSION;
+    header.width = (uint32_t)width;
+    header.height = (uint32_t)height;
+    header.format = (uint32_t)format;
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(packed, sizeof(uint32_t), count, file) == count;
+    fclose(file);
+    free(packed);
+    if (!written) {
+        MENTAL_DEBUG("Failed to write HDR file: %s", destinationPath);
+        remove(destinationPath);
+        return MENTAL_ERROR;
+    }
+
+    MENTAL_DEBUG("Baked %s -> %s (%dx%d, %s)", sourcePath, destinationPath, width, height,
+                 format == MENTAL_HDR_FORMAT_RGB9E5 ? "RGB9E5" : "R11G11B10F");
+    return MENTAL_OK;
+}
@@ -0,0 +1,47 @@
+#ifndef mental_hdr_h
+#define mental_hdr_h
+
+#include "mental.h"
+
+// Компактные HDR форматы по 4 байта на тексель для неба и данных освещения.
+// RGB9E5 — три 9-битные мантиссы с общей экспонентой (точнее по цвету),
+// R11G11B10F — беззнаковые float 11/11/10 бит (поддерживает рендер в текстуру
+// и генерацию мипмапов на любом драйвере). Кодирование идет SIMD ядрами
+// (SSE2 / NEON) при загрузке, либо заранее в файл .mhdr, который затем
+// отображается в память и заливается на GPU без преобразований.
+
+#define MENTAL_HDR_FILE_MAGIC       "MHDR"
+#define MENTAL_HDR_FILE_VERSION     1
+
+typedef enum MentalHDRFormat {
+    MENTAL_HDR_FORMAT_R11G11B10F = 0,
+    MENTAL_HDR_FORMAT_RGB9E5     = 1,
+} MentalHDRFormat;
+
+// Заголовок файла .mhdr, за ним width * height упакованных uint32
+typedef struct MentalHDRFileHeader {
+    char       magic[4];
+    uint32_t   version;
+    uint32_t   width;
+    uint32_t   height;
+    uint32_t   format;         // MentalHDRFormat
+} MentalHDRFileHeader;
+
+// Формат, в который кодируются HDR грани скайбокса (R11G11B10F по умолчанию)
+void            mentalHDRSetCubemapFormat(MentalHDRFormat format);
+MentalHDRFormat mentalHDRGetCubemapFormat(void);
+
+// Параметры glTexImage2D для упакованных данных
+uint32_t        mentalHDRInternalFormat(MentalHDRFormat format);
+uint32_t        mentalHDRPixelType(MentalHDRFormat format);
+
+// Кодирование count RGB float пикселей в упакованные uint32.
+// Отрицательные значения и NaN дают 0, слишком большие — максимум формата.
+void            mentalEncodeR11G11B10F(const float* rgb, uint32_t* packed, size_t count);
+void            mentalEncodeRGB9E5(const float* rgb, uint32_t* packed, size_t count);
+void            mentalEncodeHDR(MentalHDRFormat format, const float* rgb, uint32_t* packed, size_t count);
+
+// Офлайн запекание .hdr/float изображения в файл .mhdr
+MentalResult    mentalBakeHDRImage(const char* sourcePath, const char* destinationPath, MentalHDRFormat format);
+
+#endif // mental_hdr_h
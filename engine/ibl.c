@@ -0,0 +1,412 @@
+#include "ibl.h"
+#include "component.h"
+#include "texture.h"
+#include "shader.h"
+#include "uniforms.h"
+#include "glstate.h"
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+typedef struct MentalIBLCacheHeader {
+    char       magic[4];
+    uint32_t   version;
+    uint32_t   irradianceSize;
+    uint32_t   prefilterSize;
+    uint32_t   prefilterMips;
+    uint32_t   brdfSize;
+    uint64_t   sourceHash;
+} MentalIBLCacheHeader;
+
+// Данные хранятся как half float: RGB для кубических карт и RG для таблицы BRDF
+static inline size_t mental_ibl_face_bytes(uint32_t size)
+{
+    return (size_t)size * size * 3 * sizeof(uint16_t);
+}
+
+static inline size_t mental_ibl_lut_bytes(void)
+{
+    return (size_t)MENTAL_IBL_BRDF_LUT_SIZE * MENTAL_IBL_BRDF_LUT_SIZE * 2 * sizeof(uint16_t);
+}
+
+static size_t mental_ibl_cache_size(void)
+{
+    size_t bytes = sizeof(MentalIBLCacheHeader) + 6 * mental_ibl_face_bytes(MENTAL_IBL_IRRADIANCE_SIZE);
+    for (uint32_t mip = 0; mip < MENTAL_IBL_PREFILTER_MIPS; mip++) {
+        bytes += 6 * mental_ibl_face_bytes(MENTAL_IBL_PREFILTER_SIZE >> mip);
+    }
+    return bytes + mental_ibl_lut_bytes();
+}
+
+static void mental_ibl_cache_path(uint64_t sourceHash, char* path, size_t size)
+{
+    snprintf(path, size, "%s/ibl_%016llx.bin", MENTAL_IBL_CACHE_DIR, (unsigned long long)sourceHash);
+}
+
+static uint32_t mental_ibl_create_cubemap(uint32_t size, bool mipmaps)
+{
+    uint32_t texture;
+    glGenTextures(1, &texture);
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    for (uint32_t i = 0; i < 6; i++) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, size, size, 0, GL_RGB, GL_HALF_FLOAT, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (mipmaps) {
+        // Выделяем цепочку уровней под шероховатость
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, MENTAL_IBL_PREFILTER_MIPS - 1);
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    }
+    return texture;
+}
+
+static uint32_t mental_ibl_create_lut(void)
+{
+    uint32_t texture;
+    glGenTextures(1, &texture);
+    mentalGLBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, MENTAL_IBL_BRDF_LUT_SIZE, MENTAL_IBL_BRDF_LUT_SIZE, 0, GL_RG, GL_HALF_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+static void mental_ibl_create_textures(MentalIBL* pIBL)
+{
+    pIBL->irradianceMap = mental_ibl_create_cubemap(MENTAL_IBL_IRRADIANCE_SIZE, false);
+    pIBL->prefilterMap = mental_ibl_create_cubemap(MENTAL_IBL_PREFILTER_SIZE, true);
+    pIBL->brdfLUT = mental_ibl_create_lut();
+
+    // Половинная точность: 2 байта на канал
+    mentalTextureRegister(pIBL->irradianceMap, GL_TEXTURE_CUBE_MAP, MENTAL_IBL_IRRADIANCE_SIZE, MENTAL_IBL_IRRADIANCE_SIZE,
+                          6, 6, MENTAL_TEXTURE_FLAG_PINNED, NULL);
+    mentalTextureRegister(pIBL->prefilterMap, GL_TEXTURE_CUBE_MAP, MENTAL_IBL_PREFILTER_SIZE, MENTAL_IBL_PREFILTER_SIZE,
+                          6, 6, MENTAL_TEXTURE_FLAG_MIPMAPS | MENTAL_TEXTURE_FLAG_PINNED, NULL);
+    mentalTextureRegister(pIBL->brdfLUT, GL_TEXTURE_2D, MENTAL_IBL_BRDF_LUT_SIZE, MENTAL_IBL_BRDF_LUT_SIZE,
+                          1, 4, MENTAL_TEXTURE_FLAG_PINNED, NULL);
+}
+
+// ============================
+// Кэш на диске
+// ============================
+
+static bool mental_ibl_load_cache(MentalIBL* pIBL)
+{
+    char path[256];
+    mental_ibl_cache_path(pIBL->sourceHash, path, sizeof(path));
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    size_t size = mental_ibl_cache_size();
+    unsigned char* data = malloc(size);
+    bool ok = data && fread(data, 1, size, file) == size;
+    fclose(file);
+
+    const MentalIBLCacheHeader* pHeader = (const MentalIBLCacheHeader*)data;
+    ok = ok && memcmp(pHeader->magic, MENTAL_IBL_CACHE_MAGIC, 4) == 0 &&
+         pHeader->version == MENTAL_IBL_CACHE_VERSION &&
+         pHeader->irradianceSize == MENTAL_IBL_IRRADIANCE_SIZE &&
+         pHeader->prefilterSize == MENTAL_IBL_PREFILTER_SIZE &&
+         pHeader->prefilterMips == MENTAL_IBL_PREFILTER_MIPS &&
+         pHeader->brdfSize == MENTAL_IBL_BRDF_LUT_SIZE &&
+         pHeader->sourceHash == pIBL->sourceHash;
+    if (!ok) {
+        MENTAL_DEBUG("IBL cache %s is stale or corrupt, recomputing.", path);
+        free(data);
+        return false;
+    }
+
+    mental_ibl_create_textures(pIBL);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    const unsigned char* cursor = data + sizeof(MentalIBLCacheHeader);
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, pIBL->irradianceMap);
+    for (uint32_t i = 0; i < 6; i++) {
+        glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0, 0, MENTAL_IBL_IRRADIANCE_SIZE, MENTAL_IBL_IRRADIANCE_SIZE,
+                        GL_RGB, GL_HALF_FLOAT, cursor);
+        cursor += mental_ibl_face_bytes(MENTAL_IBL_IRRADIANCE_SIZE);
+    }
+
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, pIBL->prefilterMap);
+    for (uint32_t mip = 0; mip < MENTAL_IBL_PREFILTER_MIPS; mip++) {
+        uint32_t mipSize = MENTAL_IBL_PREFILTER_SIZE >> mip;
+        for (uint32_t i = 0; i < 6; i++) {
+            glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, mip, 0, 0, mipSize, mipSize, GL_RGB, GL_HALF_FLOAT, cursor);
+            cursor += mental_ibl_face_bytes(mipSize);
+        }
+    }
+
+    mentalGLBindTexture(GL_TEXTURE_2D, pIBL->brdfLUT);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, MENTAL_IBL_BRDF_LUT_SIZE, MENTAL_IBL_BRDF_LUT_SIZE, GL_RG, GL_HALF_FLOAT, cursor);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    mentalGLBindTexture(GL_TEXTURE_2D, 0);
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    free(data);
+    return true;
+}
+
+static void mental_ibl_save_cache(const MentalIBL* pIBL)
+{
+    mkdir(MENTAL_IBL_CACHE_DIR, 0755);
+
+    size_t size = mental_ibl_cache_size();
+    unsigned char* data = malloc(size);
+    if (!data) {
+        return;
+    }
+
+    MentalIBLCacheHeader* pHeader = (MentalIBLCacheHeader*)data;
+    memset(pHeader, 0, sizeof(MentalIBLCacheHeader));
+    memcpy(pHeader->magic, MENTAL_IBL_CACHE_MAGIC, 4);
+    pHeader->version = MENTAL_IBL_CACHE_VERSION;
+    pHeader->irradianceSize = MENTAL_IBL_IRRADIANCE_SIZE;
+    pHeader->prefilterSize = MENTAL_IBL_PREFILTER_SIZE;
+    pHeader->prefilterMips = MENTAL_IBL_PREFILTER_MIPS;
+    pHeader->brdfSize = MENTAL_IBL_BRDF_LUT_SIZE;
+    pHeader->sourceHash = pIBL->sourceHash;
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    unsigned char* cursor = data + sizeof(MentalIBLCacheHeader);
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, pIBL->irradianceMap);
+    for (uint32_t i = 0; i < 6; i++) {
+        glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, GL_HALF_FLOAT, cursor);
+        cursor += mental_ibl_face_bytes(MENTAL_IBL_IRRADIANCE_SIZE);
+    }
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, pIBL->prefilterMap);
+    for (uint32_t mip = 0; mip < MENTAL_IBL_PREFILTER_MIPS; mip++) {
+        for (uint32_t i = 0; i < 6; i++) {
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, mip, GL_RGB, GL_HALF_FLOAT, cursor);
+            cursor += mental_ibl_face_bytes(MENTAL_IBL_PREFILTER_SIZE >> mip);
+        }
+    }
+    mentalGLBindTexture(GL_TEXTURE_2D, pIBL->brdfLUT);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_HALF_FLOAT, cursor);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    mentalGLBindTexture(GL_TEXTURE_2D, 0);
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    char path[256];
+    mental_ibl_cache_path(pIBL->sourceHash, path, sizeof(path));
+    FILE* file = fopen(path, "wb");
+    if (file) {
+        fwrite(data, 1, size, file);
+        fclose(file);
+        MENTAL_DEBUG("IBL cache written: %s (%zu KB)", path, size / 1024);
+    } else {
+        MENTAL_DEBUG("Failed to write IBL cache: %s", path);
+    }
+    free(data);
+}
+
+// ============================
+// Расчет на GPU
+// ============================
+
+// Свертка выполняется сразу после компиляции, поэтому ожидание здесь синхронное
+static uint32_t mental_ibl_compile(const char* vertex_path, const char* fragment_path)
+{
+    MentalShaderDesc desc = {0};
+    desc.paths[MENTAL_SHADER_STAGE_VERTEX] = vertex_path;
+    desc.paths[MENTAL_SHADER_STAGE_FRAGMENT] = fragment_path;
+
+    uint32_t program = 0;
+    if (mentalShaderAcquire(&desc, &program) != MENTAL_OK) {
+        MENTAL_DEBUG("Failed to compile IBL shader: %s", fragment_path);
+        return 0;
+    }
+    return program;
+}
+
+static void mental_ibl_render_cube(uint32_t program, uint32_t skyboxVAO, uint32_t target, uint32_t size, uint32_t mip)
+{
+    static const vec3 targets[6] = {
+        { 1.0f,  0.0f,  0.0f}, {-1.0f,  0.0f,  0.0f},
+        { 0.0f,  1.0f,  0.0f}, { 0.0f, -1.0f,  0.0f},
+        { 0.0f,  0.0f,  1.0f}, { 0.0f,  0.0f, -1.0f},
+    };
+    static const vec3 ups[6] = {
+        {0.0f, -1.0f,  0.0f}, {0.0f, -1.0f,  0.0f},
+        {0.0f,  0.0f,  1.0f}, {0.0f,  0.0f, -1.0f},
+        {0.0f, -1.0f,  0.0f}, {0.0f, -1.0f,  0.0f},
+    };
+
+    MentalUniformTable* pUniforms = mentalUniformsFor(program);
+    mat4 projection;
+    glm_perspective(glm_rad(90.0f), 1.0f, 0.1f, 10.0f, projection);
+    mentalUniformMatrix4fv(pUniforms, MENTAL_UNIFORM_PROJECTION, (float*)projection);
+
+    mentalGLViewport(0, 0, size, size);
+    mentalGLBindVertexArray(skyboxVAO);
+    for (uint32_t i = 0; i < 6; i++) {
+        mat4 view;
+        vec3 eye = {0.0f, 0.0f, 0.0f};
+        glm_lookat(eye, (float*)targets[i], (float*)ups[i], view);
+        mentalUniformMatrix4fv(pUniforms, MENTAL_UNIFORM_VIEW, (float*)view);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, target, mip);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
+    mentalGLBindVertexArray(0);
+}
+
+static MentalResult mental_ibl_compute(MentalIBL* pIBL, MentalSkybox* pSkybox)
+{
+    uint32_t irradianceProgram = mental_ibl_compile("ibl_cubemap_vertex.glsl", "ibl_irradiance_fragment.glsl");
+    uint32_t prefilterProgram = mental_ibl_compile("ibl_cubemap_vertex.glsl", "ibl_prefilter_fragment.glsl");
+    uint32_t brdfProgram = mental_ibl_compile("ibl_brdf_vertex.glsl", "ibl_brdf_fragment.glsl");
+    if (!irradianceProgram || !prefilterProgram || !brdfProgram) {
+        mentalShaderRelease(irradianceProgram);
+        mentalShaderRelease(prefilterProgram);
+        mentalShaderRelease(brdfProgram);
+        return MENTAL_SHADER_COMPILE_FAILED;
+    }
+
+    mental_ibl_create_textures(pIBL);
+
+    // Сохраняем состояние, которое меняют проходы
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    mentalGLDisable(GL_DEPTH_TEST);
+
+    GLint sourceSize = 0;
+    mentalGLActiveTexture(GL_TEXTURE0);
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, pSkybox->cubemapTexture);
+    glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_WIDTH, &sourceSize);
+
+    uint32_t fbo;
+    glGenFramebuffers(1, &fbo);
+    mentalGLBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    // 1. Диффузная освещенность по уменьшенной копии окружения
+    mentalGLUseProgram(irradianceProgram);
+    MentalUniformTable* pIrradianceUniforms = mentalUniformsFor(irradianceProgram);
+    mentalUniform1i(pIrradianceUniforms, MENTAL_UNIFORM_ENVIRONMENT_MAP, 0);
+    float sourceLod = sourceSize > 64 ? log2f((float)sourceSize / 64.0f) : 0.0f;
+    mentalUniform1f(pIrradianceUniforms, MENTAL_UNIFORM_SOURCE_LOD, sourceLod);
+    mental_ibl_render_cube(irradianceProgram, pSkybox->VAO, pIBL->irradianceMap, MENTAL_IBL_IRRADIANCE_SIZE, 0);
+
+    // 2. Зеркальная составляющая: каждый мип-уровень — своя шероховатость
+    mentalGLUseProgram(prefilterProgram);
+    MentalUniformTable* pPrefilterUniforms = mentalUniformsFor(prefilterProgram);
+    mentalUniform1i(pPrefilterUniforms, MENTAL_UNIFORM_ENVIRONMENT_MAP, 0);
+    mentalUniform1f(pPrefilterUniforms, MENTAL_UNIFORM_SOURCE_RESOLUTION, (float)sourceSize);
+    for (uint32_t mip = 0; mip < MENTAL_IBL_PREFILTER_MIPS; mip++) {
+        float roughness = (float)mip / (float)(MENTAL_IBL_PREFILTER_MIPS - 1);
+        mentalUniform1f(pPrefilterUniforms, MENTAL_UNIFORM_PREFILTER_ROUGHNESS, roughness);
+        mental_ibl_render_cube(prefilterProgram, pSkybox->VAO, pIBL->prefilterMap, MENTAL_IBL_PREFILTER_SIZE >> mip, mip);
+    }
+
+    // 3. Таблица BRDF не зависит от окружения
+    uint32_t emptyVAO;
+    glGenVertexArrays(1, &emptyVAO);
+    mentalGLUseProgram(brdfProgram);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pIBL->brdfLUT, 0);
+    mentalGLViewport(0, 0, MENTAL_IBL_BRDF_LUT_SIZE, MENTAL_IBL_BRDF_LUT_SIZE);
+    glClear(GL_COLOR_BUFFER_BIT);
+    mentalGLBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    mentalGLBindVertexArray(0);
+    mentalGLDeleteVertexArrays(1, &emptyVAO);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    mentalGLBindFramebuffer(GL_FRAMEBUFFER, 0);
+    mentalGLDeleteFramebuffers(1, &fbo);
+    mentalShaderRelease(irradianceProgram);
+    mentalShaderRelease(prefilterProgram);
+    mentalShaderRelease(brdfProgram);
+
+    mentalGLViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (depthTest) {
+        mentalGLEnable(GL_DEPTH_TEST);
+    }
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        MENTAL_DEBUG("IBL framebuffer is incomplete: 0x%X", status);
+        return MENTAL_ERROR;
+    }
+    return MENTAL_OK;
+}
+
+MentalResult mentalCreateIBL(MentalIBL* pIBL, MentalSkybox* pSkybox)
+{
+    if (!pIBL || !pSkybox) {
+        MENTAL_DEBUG("IBL or skybox pointer is null.");
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    memset(pIBL, 0, sizeof(MentalIBL));
+    if (pSkybox->cubemapTexture == 0 || pSkybox->sourceHash == 0) {
+        MENTAL_DEBUG("Skybox cubemap is incomplete, image based lighting disabled.");
+        return MENTAL_ERROR_TEXTURE_LOAD_FAILED;
+    }
+    pIBL->sourceHash = pSkybox->sourceHash;
+
+    double startTime = glfwGetTime();
+    if (mental_ibl_load_cache(pIBL)) {
+        pIBL->fromCache = true;
+    } else {
+        MentalResult result = mental_ibl_compute(pIBL, pSkybox);
+        if (result != MENTAL_OK) {
+            mentalDestroyIBL(pIBL);
+            return result;
+        }
+        mental_ibl_save_cache(pIBL);
+    }
+
+    pIBL->isReady = true;
+    MENTAL_DEBUG("IBL ready (%s) in %.1f ms", pIBL->fromCache ? "cache" : "computed",
+                 (glfwGetTime() - startTime) * 1000.0);
+    return MENTAL_OK;
+}
+
+MentalResult mentalBindIBL(MentalIBL* pIBL, uint32_t program)
+{
+    if (!pIBL) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    // Сэмплеры выставляются всегда: samplerCube не должен делить блок 0 с sampler2D
+    MentalUniformTable* pUniforms = mentalUniformsFor(program);
+    mentalUniform1i(pUniforms, MENTAL_UNIFORM_IRRADIANCE_MAP, MENTAL_IBL_IRRADIANCE_UNIT);
+    mentalUniform1i(pUniforms, MENTAL_UNIFORM_PREFILTER_MAP, MENTAL_IBL_PREFILTER_UNIT);
+    mentalUniform1i(pUniforms, MENTAL_UNIFORM_BRDF_LUT, MENTAL_IBL_BRDF_UNIT);
+    mentalUniform1i(pUniforms, MENTAL_UNIFORM_USE_IBL, pIBL->isReady);
+    if (!pIBL->isReady) {
+        return MENTAL_OK;
+    }
+
+    mentalUniform1f(pUniforms, MENTAL_UNIFORM_PREFILTER_MAX_LOD, (float)(MENTAL_IBL_PREFILTER_MIPS - 1));
+    mentalGLActiveTexture(GL_TEXTURE0 + MENTAL_IBL_IRRADIANCE_UNIT);
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, pIBL->irradianceMap);
+    mentalGLActiveTexture(GL_TEXTURE0 + MENTAL_IBL_PREFILTER_UNIT);
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, pIBL->prefilterMap);
+    mentalGLActiveTexture(GL_TEXTURE0 + MENTAL_IBL_BRDF_UNIT);
+    mentalGLBindTexture(GL_TEXTURE_2D, pIBL->brdfLUT);
+    mentalGLActiveTexture(GL_TEXTURE0);
+    return MENTAL_OK;
+}
+
+MentalResult mentalDestroyIBL(MentalIBL* pIBL)
+{
+    if (!pIBL) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    mentalTextureDelete(&pIBL->irradianceMap);
+    mentalTextureDelete(&pIBL->prefilterMap);
+    mentalTextureDelete(&pIBL->brdfLUT);
+    pIBL->isReady = false;
+    return MENTAL_OK;
+}
@@ -0,0 +1,40 @@
+#ifndef mental_ibl_h
+#define mental_ibl_h
+
+#include "mental.h"
+
+// Освещение по изображению (IBL) из кубической карты скайбокса.
+// Один раз считаются карта диффузной освещенности, отфильтрованная по GGX
+// зеркальная карта (шероховатость по мип-уровням) и таблица BRDF для
+// приближения split-sum. Результат кэшируется на диске по хешу граней
+// скайбокса, поэтому при повторных запусках расчеты не повторяются.
+
+#define MENTAL_IBL_IRRADIANCE_SIZE      32
+#define MENTAL_IBL_PREFILTER_SIZE       128
+#define MENTAL_IBL_PREFILTER_MIPS       5
+#define MENTAL_IBL_BRDF_LUT_SIZE        256
+#define MENTAL_IBL_CACHE_DIR            ".mental_cache"
+#define MENTAL_IBL_CACHE_MAGIC          "MIBL"
+#define MENTAL_IBL_CACHE_VERSION        1
+
+// Текстурные блоки IBL в PBR шейдере (после блока атласа)
+#define MENTAL_IBL_IRRADIANCE_UNIT      8
+#define MENTAL_IBL_PREFILTER_UNIT       9
+#define MENTAL_IBL_BRDF_UNIT            10
+
+typedef struct MentalSkybox MentalSkybox;
+
+typedef struct MentalIBL {
+    uint32_t   irradianceMap;      // GL_TEXTURE_CUBE_MAP, RGB16F
+    uint32_t   prefilterMap;       // GL_TEXTURE_CUBE_MAP, RGB16F с мипмапами
+    uint32_t   brdfLUT;            // GL_TEXTURE_2D, RG16F
+    uint64_t   sourceHash;
+    bool       fromCache;
+    bool       isReady;
+} MentalIBL;
+
+MentalResult mentalCreateIBL(MentalIBL* pIBL, MentalSkybox* pSkybox);
+MentalResult mentalBindIBL(MentalIBL* pIBL, uint32_t program);
+MentalResult mentalDestroyIBL(MentalIBL* pIBL);
+
+#endif // mental_ibl_h
@@ -0,0 +1,402 @@
+#include "imageproc.h"
+#include <string.h>
+
+#include "../stb_image.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+static MentalTextureQuality g_textureQuality = MENTAL_TEXTURE_QUALITY_FULL;
+
+void mentalSetTextureQuality(MentalTextureQuality quality)
+{
+    g_textureQuality = quality;
+    MENTAL_DEBUG("Texture quality set to 1/%d resolution", 1 << (int)quality);
+}
+
+MentalTextureQuality mentalGetTextureQuality(void)
+{
+    return g_textureQuality;
+}
+
+// c * a / 255 с округлением к ближайшему без деления
+static inline unsigned char mental_image_mul255(unsigned int c, unsigned int a)
+{
+    unsigned int t = c * a + 128;
+    return (unsigned char)((t + (t >> 8)) >> 8);
+}
+
+#if defined(__SSE2__)
+
+// Пары соседних пикселей двух строк -> dstWidth пикселей, возвращает сколько сделано
+static int mental_image_downscale_row_simd(const unsigned char* row0, const unsigned char* row1,
+                                           unsigned char* dst, int dstWidth, int channels)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    int x = 0;
+
+    if (channels == 4) {
+        for (; x + 4 <= dstWidth; x += 4) {
+            const unsigned char* p0 = row0 + x * 8;
+            const unsigned char* p1 = row1 + x * 8;
+            __m128i a0 = _mm_loadu_si128((const __m128i*)p0);
+            __m128i a1 = _mm_loadu_si128((const __m128i*)(p0 + 16));
+            __m128i b0 = _mm_loadu_si128((const __m128i*)p1);
+            __m128i b1 = _mm_loadu_si128((const __m128i*)(p1 + 16));
+
+            // Сумма по вертикали в 16 бит, затем соседние пиксели (4 канала = 8 байт)
+            __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+            __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+            __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+            __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+            s0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+            s1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+            s2 = _mm_add_epi16(s2, _mm_srli_si128(s2, 8));
+            s3 = _mm_add_epi16(s3, _mm_srli_si128(s3, 8));
+
+            __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s0, s1), two), 2);
+            __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s2, s3), two), 2);
+            _mm_storeu_si128((__m128i*)(dst + x * 4), _mm_packus_epi16(lo, hi));
+        }
+    } else if (channels == 1) {
+        const __m128i even = _mm_set1_epi16(0x00FF);
+        for (; x + 16 <= dstWidth; x += 16) {
+            const unsigned char* p0 = row0 + x * 2;
+            const unsigned char* p1 = row1 + x * 2;
+            __m128i a0 = _mm_loadu_si128((const __m128i*)p0);
+            __m128i a1 = _mm_loadu_si128((const __m128i*)(p0 + 16));
+            __m128i b0 = _mm_loadu_si128((const __m128i*)p1);
+            __m128i b1 = _mm_loadu_si128((const __m128i*)(p1 + 16));
+
+            // Четные и нечетные байты как 16-битные слова
+            __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0, even), _mm_srli_epi16(a0, 8)),
+                                       _mm_add_epi16(_mm_and_si128(b0, even), _mm_srli_epi16(b0, 8)));
+            __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a1, even), _mm_srli_epi16(a1, 8)),
+                                       _mm_add_epi16(_mm_and_si128(b1, even), _mm_srli_epi16(b1, 8)));
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+            _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(lo, hi));
+        }
+    }
+    return x;
+}
+
+static size_t mental_image_premultiply_simd(unsigned char* rgba, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i colorLanes = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+    const __m128i alphaOne = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+    const __m128i bias = _mm_set1_epi16(128);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+        __m128i halves[2] = { _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero) };
+        for (int h = 0; h < 2; h++) {
+            // Альфа каждого пикселя во все его каналы, сам канал альфы умножаем на 255
+            __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(halves[h], 0xFF), 0xFF);
+            alpha = _mm_or_si128(_mm_and_si128(alpha, colorLanes), alphaOne);
+            __m128i t = _mm_add_epi16(_mm_mullo_epi16(halves[h], alpha), bias);
+            halves[h] = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+        }
+        _mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_packus_epi16(halves[0], halves[1]));
+    }
+    return i;
+}
+
+static size_t mental_image_extract_simd(const unsigned char* src, int channels, int channel,
+                                        unsigned char* dst, size_t count)
+{
+    if (channels != 4) {
+        return 0;
+    }
+
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    const __m128i shift = _mm_cvtsi32_si128(channel * 8);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const unsigned char* p = src + i * 4;
+        __m128i v0 = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i*)p), shift), mask);
+        __m128i v1 = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i*)(p + 16)), shift), mask);
+        __m128i v2 = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i*)(p + 32)), shift), mask);
+        __m128i v3 = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i*)(p + 48)), shift), mask);
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3));
+        _mm_storeu_si128((__m128i*)(dst + i), packed);
+    }
+    return i;
+}
+
+// Первые 12 байт v — четыре пикселя RGB -> четыре пикселя RGBA с непрозрачной альфой
+static inline __m128i mental_image_expand4_sse2(__m128i v, __m128i alpha)
+{
+    __m128i lo = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+    __m128i hi = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+    return _mm_or_si128(_mm_unpacklo_epi64(lo, hi), alpha);
+}
+
+static size_t mental_image_expand_simd(const unsigned char* rgb, unsigned char* rgba, size_t count)
+{
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000u);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        // 48 байт = 16 пикселей, переложенных по четыре пикселя на регистр
+        const unsigned char* p = rgb + i * 3;
+        __m128i a = _mm_loadu_si128((const __m128i*)p);
+        __m128i b = _mm_loadu_si128((const __m128i*)(p + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(p + 32));
+        __m128i v1 = _mm_or_si128(_mm_srli_si128(a, 12), _mm_slli_si128(b, 4));
+        __m128i v2 = _mm_or_si128(_mm_srli_si128(b, 8), _mm_slli_si128(c, 8));
+        __m128i v3 = _mm_srli_si128(c, 4);
+        unsigned char* q = rgba + i * 4;
+        _mm_storeu_si128((__m128i*)q, mental_image_expand4_sse2(a, alpha));
+        _mm_storeu_si128((__m128i*)(q + 16), mental_image_expand4_sse2(v1, alpha));
+        _mm_storeu_si128((__m128i*)(q + 32), mental_image_expand4_sse2(v2, alpha));
+        _mm_storeu_si128((__m128i*)(q + 48), mental_image_expand4_sse2(v3, alpha));
+    }
+    return i;
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+static int mental_image_downscale_row_simd(const unsigned char* row0, const unsigned char* row1,
+                                           unsigned char* dst, int dstWidth, int channels)
+{
+    int x = 0;
+    if (channels == 4) {
+        for (; x + 4 <= dstWidth; x += 4) {
+            // vld2 по 32 бита раскладывает четные и нечетные пиксели
+            uint32x4x2_t a = vld2q_u32((const uint32_t*)(row0 + x * 8));
+            uint32x4x2_t b = vld2q_u32((const uint32_t*)(row1 + x * 8));
+            uint8x16_t a0 = vreinterpretq_u8_u32(a.val[0]), a1 = vreinterpretq_u8_u32(a.val[1]);
+            uint8x16_t b0 = vreinterpretq_u8_u32(b.val[0]), b1 = vreinterpretq_u8_u32(b.val[1]);
+            uint16x8_t lo = vaddq_u16(vaddl_u8(vget_low_u8(a0), vget_low_u8(a1)),
+                                      vaddl_u8(vget_low_u8(b0), vget_low_u8(b1)));
+            uint16x8_t hi = vaddq_u16(vaddl_u8(vget_high_u8(a0), vget_high_u8(a1)),
+                                      vaddl_u8(vget_high_u8(b0), vget_high_u8(b1)));
+            vst1q_u8(dst + x * 4, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+        }
+    } else if (channels == 1) {
+        for (; x + 16 <= dstWidth; x += 16) {
+            uint8x16x2_t a = vld2q_u8(row0 + x * 2);
+            uint8x16x2_t b = vld2q_u8(row1 + x * 2);
+            uint16x8_t lo = vaddq_u16(vaddl_u8(vget_low_u8(a.val[0]), vget_low_u8(a.val[1])),
+                                      vaddl_u8(vget_low_u8(b.val[0]), vget_low_u8(b.val[1])));
+            uint16x8_t hi = vaddq_u16(vaddl_u8(vget_high_u8(a.val[0]), vget_high_u8(a.val[1])),
+                                      vaddl_u8(vget_high_u8(b.val[0]), vget_high_u8(b.val[1])));
+            vst1q_u8(dst + x, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+        }
+    }
+    return x;
+}
+
+static inline uint8x16_t mental_image_mul255_neon(uint8x16_t c, uint8x16_t a)
+{
+    uint16x8_t lo = vmull_u8(vget_low_u8(c), vget_low_u8(a));
+    uint16x8_t hi = vmull_u8(vget_high_u8(c), vget_high_u8(a));
+    lo = vrsraq_n_u16(lo, lo, 8);
+    hi = vrsraq_n_u16(hi, hi, 8);
+    return vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8));
+}
+
+static size_t mental_image_premultiply_simd(unsigned char* rgba, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t v = vld4q_u8(rgba + i * 4);
+        v.val[0] = mental_image_mul255_neon(v.val[0], v.val[3]);
+        v.val[1] = mental_image_mul255_neon(v.val[1], v.val[3]);
+        v.val[2] = mental_image_mul255_neon(v.val[2], v.val[3]);
+        vst4q_u8(rgba + i * 4, v);
+    }
+    return i;
+}
+
+static size_t mental_image_extract_simd(const unsigned char* src, int channels, int channel,
+                                        unsigned char* dst, size_t count)
+{
+    size_t i = 0;
+    if (channels == 4) {
+        for (; i + 16 <= count; i += 16) {
+            vst1q_u8(dst + i, vld4q_u8(src + i * 4).val[channel]);
+        }
+    } else if (channels == 3) {
+        for (; i + 16 <= count; i += 16) {
+            vst1q_u8(dst + i, vld3q_u8(src + i * 3).val[channel]);
+        }
+    } else if (channels == 2) {
+        for (; i + 16 <= count; i += 16) {
+            vst1q_u8(dst + i, vld2q_u8(src + i * 2).val[channel]);
+        }
+    }
+    return i;
+}
+
+static size_t mental_image_expand_simd(const unsigned char* rgb, unsigned char* rgba, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x3_t v = vld3q_u8(rgb + i * 3);
+        uint8x16x4_t out = { { v.val[0], v.val[1], v.val[2], vdupq_n_u8(255) } };
+        vst4q_u8(rgba + i * 4, out);
+    }
+    return i;
+}
+
+#else
+
+static int mental_image_downscale_row_simd(const unsigned char* row0, const unsigned char* row1,
+                                           unsigned char* dst, int dstWidth, int channels)
+{
+    (void)row0; (void)row1; (void)dst; (void)dstWidth; (void)channels;
+    return 0;
+}
+
+static size_t mental_image_premultiply_simd(unsigned char* rgba, size_t count)
+{
+    (void)rgba; (void)count;
+    return 0;
+}
+
+static size_t mental_image_extract_simd(const unsigned char* src, int channels, int channel,
+                                        unsigned char* dst, size_t count)
+{
+    (void)src; (void)channels; (void)channel; (void)dst; (void)count;
+    return 0;
+}
+
+static size_t mental_image_expand_simd(const unsigned char* rgb, unsigned char* rgba, size_t count)
+{
+    (void)rgb; (void)rgba; (void)count;
+    return 0;
+}
+
+#endif
+
+void mentalImageDownscale2x(const unsigned char* src, int width, int height, int channels, unsigned char* dst)
+{
+    int dstWidth = width > 1 ? width / 2 : 1;
+    int dstHeight = height > 1 ? height / 2 : 1;
+    size_t srcStride = (size_t)width * channels;
+
+    for (int y = 0; y < dstHeight; y++) {
+        const unsigned char* row0 = src + (size_t)(y * 2) * srcStride;
+        const unsigned char* row1 = height > 1 ? row0 + srcStride : row0;
+        unsigned char* out = dst + (size_t)y * dstWidth * channels;
+
+        int x = width > 1 ? mental_image_downscale_row_simd(row0, row1, out, dstWidth, channels) : 0;
+        for (; x < dstWidth; x++) {
+            int x0 = x * 2;
+            int x1 = x0 + 1 < width ? x0 + 1 : x0;
+            for (int c = 0; c < channels; c++) {
+                unsigned int sum = row0[x0 * channels + c] + row0[x1 * channels + c] +
+                                   row1[x0 * channels + c] + row1[x1 * channels + c];
+                out[x * channels + c] = (unsigned char)((sum + 2) >> 2);
+            }
+        }
+    }
+}
+
+void mentalImageExpandRGBToRGBA(const unsigned char* rgb, unsigned char* rgba, size_t count)
+{
+    size_t i = mental_image_expand_simd(rgb, rgba, count);
+    // Без SIMD: 32-битные чтения, последний пиксель отдельно, чтобы не выйти за буфер
+    for (; i + 1 < count; i++) {
+        uint32_t pixel;
+        memcpy(&pixel, rgb + i * 3, sizeof(pixel));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        pixel |= 0x000000FFu;
+#else
+        pixel |= 0xFF000000u;
+#endif
+        memcpy(rgba + i * 4, &pixel, sizeof(pixel));
+    }
+    for (; i < count; i++) {
+        rgba[i * 4 + 0] = rgb[i * 3 + 0];
+        rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        rgba[i * 4 + 3] = 255;
+    }
+}
+
+void mentalImagePremultiplyAlpha(unsigned char* rgba, size_t count)
+{
+    for (size_t i = mental_image_premultiply_simd(rgba, count); i < count; i++) {
+        unsigned char* pixel = rgba + i * 4;
+        pixel[0] = mental_image_mul255(pixel[0], pixel[3]);
+        pixel[1] = mental_image_mul255(pixel[1], pixel[3]);
+        pixel[2] = mental_image_mul255(pixel[2], pixel[3]);
+    }
+}
+
+void mentalImageExtractChannel(const unsigned char* src, int channels, int channel, unsigned char* dst, size_t count)
+{
+    if (channel < 0 || channel >= channels) {
+        return;
+    }
+    for (size_t i = mental_image_extract_simd(src, channels, channel, dst, count); i < count; i++) {
+        dst[i] = src[i * channels + channel];
+    }
+}
+
+void mentalImageApplyQuality(unsigned char* data, int* pWidth, int* pHeight, int channels)
+{
+    int originalWidth = *pWidth, originalHeight = *pHeight;
+    for (int level = 0; level < (int)g_textureQuality; level++) {
+        if (*pWidth < MENTAL_IMAGE_MIN_QUALITY_SIZE * 2 || *pHeight < MENTAL_IMAGE_MIN_QUALITY_SIZE * 2) {
+            break;
+        }
+        mentalImageDownscale2x(data, *pWidth, *pHeight, channels, data);
+        *pWidth /= 2;
+        *pHeight /= 2;
+    }
+    if (*pWidth != originalWidth) {
+        MENTAL_DEBUG("Image downscaled %dx%d -> %dx%d by texture quality", originalWidth, originalHeight,
+                     *pWidth, *pHeight);
+    }
+}
+
+unsigned char* mentalImageLoad(const char* path, int* pWidth, int* pHeight, int* pChannels, int desiredChannels)
+{
+    int width, height, channels;
+    unsigned char* data = stbi_load(path, &width, &height, &channels, 0);
+    if (!data) {
+        return NULL;
+    }
+
+    size_t count = (size_t)width * height;
+    if (desiredChannels != 0 && desiredChannels != channels) {
+        if (desiredChannels == 1) {
+            mentalImageExtractChannel(data, channels, 0, data, count);
+        } else if (desiredChannels == 4 && channels == 3) {
+            unsigned char* rgba = malloc(count * 4);
+            if (!rgba) {
+                stbi_image_free(data);
+                return NULL;
+            }
+            mentalImageExpandRGBToRGBA(data, rgba, count);
+            stbi_image_free(data);
+            data = rgba;
+        } else {
+            // Редкие сочетания (серое -> RGB и т.п.) отдаем конвертации stb
+            stbi_image_free(data);
+            data = stbi_load(path, &width, &height, &channels, desiredChannels);
+            if (!data) {
+                return NULL;
+            }
+        }
+        channels = desiredChannels;
+    }
+
+    mentalImageApplyQuality(data, &width, &height, channels);
+
+    *pWidth = width;
+    *pHeight = height;
+    if (pChannels) {
+        *pChannels = channels;
+    }
+    return data;
+}
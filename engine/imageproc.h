@@ -0,0 +1,44 @@
+#ifndef mental_imageproc_h
+#define mental_imageproc_h
+
+#include "mental.h"
+
+// Подготовка 8-битных изображений перед glTexImage2D: уменьшение 2x2,
+// расширение RGB -> RGBA, премультипликация альфы и выделение одного канала.
+// Ядра написаны на SSE2 / NEON со скалярным хвостом. Поверх них — глобальный
+// уровень качества текстур, который уменьшает изображения при загрузке,
+// чтобы на машинах с малым объемом памяти не перерабатывать ассеты.
+
+// Ниже этого размера уровень качества изображение не уменьшает
+#define MENTAL_IMAGE_MIN_QUALITY_SIZE   64
+
+typedef enum MentalTextureQuality {
+    MENTAL_TEXTURE_QUALITY_FULL     = 0,
+    MENTAL_TEXTURE_QUALITY_HALF     = 1,
+    MENTAL_TEXTURE_QUALITY_QUARTER  = 2,
+} MentalTextureQuality;
+
+void                 mentalSetTextureQuality(MentalTextureQuality quality);
+MentalTextureQuality mentalGetTextureQuality(void);
+
+// Уменьшение вдвое усреднением 2x2 (размер результата max(1, w/2) x max(1, h/2)).
+// dst может совпадать с src — запись всегда идет не дальше уже прочитанных данных.
+void mentalImageDownscale2x(const unsigned char* src, int width, int height, int channels, unsigned char* dst);
+
+// Непересекающиеся буферы: count пикселей RGB -> RGBA с альфой 255
+void mentalImageExpandRGBToRGBA(const unsigned char* rgb, unsigned char* rgba, size_t count);
+
+// Умножение цвета на альфу на месте, c * a / 255 с округлением
+void mentalImagePremultiplyAlpha(unsigned char* rgba, size_t count);
+
+// Один канал из многоканального изображения, dst может совпадать с src
+void mentalImageExtractChannel(const unsigned char* src, int channels, int channel, unsigned char* dst, size_t count);
+
+// Уменьшение на месте согласно уровню качества, размеры обновляются
+void mentalImageApplyQuality(unsigned char* data, int* pWidth, int* pHeight, int channels);
+
+// stbi_load + приведение к desiredChannels (0 — как в файле, 1 — красный канал,
+// 4 из RGB — расширение) + уровень качества. Освобождать через stbi_image_free.
+unsigned char* mentalImageLoad(const char* path, int* pWidth, int* pHeight, int* pChannels, int desiredChannels);
+
+#endif // mental_imageproc_h
@@ -0,0 +1,233 @@
+#include "jobs.h"
+#include <pthread.h>
+#include <unistd.h>
+#include <string.h>
+
+// Группа параллельного цикла живет на стеке вызывающего потока
+typedef struct MentalParallelGroup {
+    MentalParallelForFunc   func;
+    void                    *pArg;
+    uint32_t                count;
+    uint32_t                next;       // Следующий свободный индекс (атомарно)
+    uint32_t                running;    // Сколько помощников сейчас выполняется (под mutex)
+} MentalParallelGroup;
+
+typedef struct MentalJob {
+    MentalJobFunc           func;
+    void                    *pArg;
+    MentalParallelGroup     *pGroup;
+} MentalJob;
+
+typedef struct MentalJobSystem {
+    pthread_t               workers[MENTAL_JOBS_MAX_WORKERS];
+    uint32_t                workerCount;
+    MentalJob               queue[MENTAL_JOBS_QUEUE_SIZE];
+    uint32_t                head;
+    uint32_t                count;
+    pthread_mutex_t         mutex;
+    pthread_cond_t          hasWork;
+    pthread_cond_t          groupDone;
+    bool                    initialized;
+    bool                    shutdown;
+} MentalJobSystem;
+
+static MentalJobSystem g_jobs = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .hasWork = PTHREAD_COND_INITIALIZER,
+    .groupDone = PTHREAD_COND_INITIALIZER,
+};
+
+static void mental_jobs_run_group(MentalParallelGroup* pGroup)
+{
+    for (;;) {
+        uint32_t index = __atomic_fetch_add(&pGroup->next, 1, __ATOMIC_RELAXED);
+        if (index >= pGroup->count) {
+            break;
+        }
+        pGroup->func(pGroup->pArg, index);
+    }
+}
+
+static void* mental_jobs_worker(void* pUnused)
+{
+    (void)pUnused;
+    for (;;) {
+        pthread_mutex_lock(&g_jobs.mutex);
+        while (g_jobs.count == 0 && !g_jobs.shutdown) {
+            pthread_cond_wait(&g_jobs.hasWork, &g_jobs.mutex);
+        }
+        if (g_jobs.count == 0 && g_jobs.shutdown) {
+            pthread_mutex_unlock(&g_jobs.mutex);
+            break;
+        }
+
+        MentalJob job = g_jobs.queue[g_jobs.head];
+        g_jobs.head = (g_jobs.head + 1) % MENTAL_JOBS_QUEUE_SIZE;
+        g_jobs.count--;
+        if (job.pGroup) {
+            job.pGroup->running++;
+        }
+        pthread_mutex_unlock(&g_jobs.mutex);
+
+        if (job.pGroup) {
+            mental_jobs_run_group(job.pGroup);
+            pthread_mutex_lock(&g_jobs.mutex);
+            job.pGroup->running--;
+            pthread_cond_broadcast(&g_jobs.groupDone);
+            pthread_mutex_unlock(&g_jobs.mutex);
+        } else {
+            job.func(job.pArg);
+        }
+    }
+    return NULL;
+}
+
+MentalResult mentalJobsInit(uint32_t workerCount)
+{
+    pthread_mutex_lock(&g_jobs.mutex);
+    if (g_jobs.initialized) {
+        pthread_mutex_unlock(&g_jobs.mutex);
+        return MENTAL_OK;
+    }
+    // Остановленный пул заново не запускается: задачи после mentalJobsShutdown
+    // (например, при закрытии окна) выполняются на вызывающем потоке
+    if (g_jobs.shutdown) {
+        pthread_mutex_unlock(&g_jobs.mutex);
+        return MENTAL_ERROR;
+    }
+
+    if (workerCount == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workerCount = cores > 1 ? (uint32_t)(cores - 1) : 1;
+    }
+    if (workerCount > MENTAL_JOBS_MAX_WORKERS) {
+        workerCount = MENTAL_JOBS_MAX_WORKERS;
+    }
+
+    g_jobs.head = 0;
+    g_jobs.count = 0;
+    g_jobs.workerCount = 0;
+    for (uint32_t i = 0; i < workerCount; i++) {
+        if (pthread_create(&g_jobs.workers[i], NULL, mental_jobs_worker, NULL) != 0) {
+            MENTAL_DEBUG("Failed to create job worker thread %u", i);
+            break;
+        }
+        g_jobs.workerCount++;
+    }
+    g_jobs.initialized = true;
+    uint32_t started = g_jobs.workerCount;
+    pthread_mutex_unlock(&g_jobs.mutex);
+
+    MENTAL_DEBUG("Job system started with %u workers", started);
+    return started > 0 ? MENTAL_OK : MENTAL_ERROR;
+}
+
+void mentalJobsShutdown(void)
+{
+    pthread_mutex_lock(&g_jobs.mutex);
+    // Пул уже останавливает другой поток или он так и не был запущен —
+    // отмечаем остановку, чтобы ленивый запуск больше не срабатывал
+    bool running = g_jobs.initialized && !g_jobs.shutdown;
+    g_jobs.shutdown = true;
+    if (!running) {
+        pthread_mutex_unlock(&g_jobs.mutex);
+        return;
+    }
+    pthread_cond_broadcast(&g_jobs.hasWork);
+    pthread_mutex_unlock(&g_jobs.mutex);
+
+    // Рабочие потоки доделывают очередь и выходят
+    for (uint32_t i = 0; i < g_jobs.workerCount; i++) {
+        pthread_join(g_jobs.workers[i], NULL);
+    }
+
+    pthread_mutex_lock(&g_jobs.mutex);
+    g_jobs.workerCount = 0;
+    g_jobs.initialized = false;
+    pthread_mutex_unlock(&g_jobs.mutex);
+    MENTAL_DEBUG("Job system stopped.");
+}
+
+// Состояние пула читается только под mutex: mentalJobsShutdown может идти в другом потоке.
+// mentalJobsInit сам проверяет, запущен ли пул, и не перезапускает остановленный
+uint32_t mentalJobsWorkerCount(void)
+{
+    mentalJobsInit(0);
+    pthread_mutex_lock(&g_jobs.mutex);
+    uint32_t workerCount = g_jobs.shutdown ? 0 : g_jobs.workerCount;
+    pthread_mutex_unlock(&g_jobs.mutex);
+    return workerCount;
+}
+
+MentalResult mentalJobsSubmit(MentalJobFunc func, void* pArg)
+{
+    if (!func) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    mentalJobsInit(0);
+
+    pthread_mutex_lock(&g_jobs.mutex);
+    if (!g_jobs.initialized || g_jobs.shutdown || g_jobs.workerCount == 0 || g_jobs.count == MENTAL_JOBS_QUEUE_SIZE) {
+        pthread_mutex_unlock(&g_jobs.mutex);
+        // Очередь переполнена или пул остановлен — выполняем задачу на месте
+        func(pArg);
+        return MENTAL_OK;
+    }
+
+    uint32_t tail = (g_jobs.head + g_jobs.count) % MENTAL_JOBS_QUEUE_SIZE;
+    g_jobs.queue[tail] = (MentalJob){ .func = func, .pArg = pArg, .pGroup = NULL };
+    g_jobs.count++;
+    pthread_cond_signal(&g_jobs.hasWork);
+    pthread_mutex_unlock(&g_jobs.mutex);
+    return MENTAL_OK;
+}
+
+void mentalJobsParallelFor(uint32_t count, MentalParallelForFunc func, void* pArg)
+{
+    if (!func || count == 0) {
+        return;
+    }
+
+    MentalParallelGroup group = {
+        .func = func,
+        .pArg = pArg,
+        .count = count,
+        .next = 0,
+        .running = 0,
+    };
+
+    uint32_t helpers = count > 1 ? mentalJobsWorkerCount() : 0;
+    if (helpers > count - 1) {
+        helpers = count - 1;
+    }
+
+    pthread_mutex_lock(&g_jobs.mutex);
+    for (uint32_t i = 0; i < helpers && g_jobs.count < MENTAL_JOBS_QUEUE_SIZE; i++) {
+        uint32_t tail = (g_jobs.head + g_jobs.count) % MENTAL_JOBS_QUEUE_SIZE;
+        g_jobs.queue[tail] = (MentalJob){ .func = NULL, .pArg = NULL, .pGroup = &group };
+        g_jobs.count++;
+    }
+    pthread_cond_broadcast(&g_jobs.hasWork);
+    pthread_mutex_unlock(&g_jobs.mutex);
+
+    // Вызывающий поток тоже разбирает индексы
+    mental_jobs_run_group(&group);
+
+    // Убираем из очереди помощников, которые так и не стартовали,
+    // и ждем тех, кто еще дорабатывает свой последний индекс
+    pthread_mutex_lock(&g_jobs.mutex);
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < g_jobs.count; i++) {
+        MentalJob job = g_jobs.queue[(g_jobs.head + i) % MENTAL_JOBS_QUEUE_SIZE];
+        if (job.pGroup == &group) {
+            continue;
+        }
+        g_jobs.queue[(g_jobs.head + kept) % MENTAL_JOBS_QUEUE_SIZE] = job;
+        kept++;
+    }
+    g_jobs.count = kept;
+    while (group.running > 0) {
+        pthread_cond_wait(&g_jobs.groupDone, &g_jobs.mutex);
+    }
+    pthread_mutex_unlock(&g_jobs.mutex);
+}
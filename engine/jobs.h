@@ -0,0 +1,29 @@
+#ifndef mental_jobs_h
+#define mental_jobs_h
+
+#include "mental.h"
+
+// Простая система задач на пуле потоков pthread.
+// Используется для фоновой подгрузки данных и для параллельной обработки
+// на CPU (mentalJobsParallelFor). Пул создается лениво при первом обращении.
+// mentalJobsShutdown окончательна: после нее пул не перезапускается, а задачи
+// и параллельные циклы выполняются на вызывающем потоке.
+
+#define MENTAL_JOBS_MAX_WORKERS     16
+#define MENTAL_JOBS_QUEUE_SIZE      1024
+
+typedef void (*MentalJobFunc)(void* pArg);
+typedef void (*MentalParallelForFunc)(void* pArg, uint32_t index);
+
+MentalResult mentalJobsInit(uint32_t workerCount);
+void         mentalJobsShutdown(void);
+uint32_t     mentalJobsWorkerCount(void);
+
+// Асинхронная задача: выполняется на одном из рабочих потоков
+MentalResult mentalJobsSubmit(MentalJobFunc func, void* pArg);
+
+// Блокирующий параллельный цикл: индексы [0, count) распределяются между
+// рабочими потоками, вызывающий поток тоже участвует в работе
+void         mentalJobsParallelFor(uint32_t count, MentalParallelForFunc func, void* pArg);
+
+#endif // mental_jobs_h
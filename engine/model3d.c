@@ -1,8 +1,14 @@
 #include "mental.h"
 #include "component.h"
 #include "wm.h"
+#include "texture.h"
+#include "shader.h"
+#include "uniforms.h"
+#include "glstate.h"
+#include "geompool.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <math.h>
 #include <GL/glew.h>
@@ -298,7 +304,7 @@ static MentalResult loadOBJFile(const char* filename, Model3DData* modelData) {
 // Функция для загрузки текстуры модели
 static MentalResult loadModelTexture(const char* filename, uint32_t* textureID) {
     int width, height, nrChannels;
-    unsigned char *data = stbi_load(filename, &width, &height, &nrChannels, 0);
+    unsigned char *data = mentalImageLoad(filename, &width, &height, &nrChannels, 0);
     
     if (!data) {
         MENTAL_DEBUG("Failed to load texture: %s", filename);
@@ -307,7 +313,7 @@ static MentalResult loadModelTexture(const char* filename, uint32_t* textureID)
     
     // Создаем текстуру OpenGL
     glGenTextures(1, textureID);
-    glBindTexture(GL_TEXTURE_2D, *textureID);
+    mentalGLBindTexture(GL_TEXTURE_2D, *textureID);
     
     // Устанавливаем параметры текстуры
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -332,6 +338,7 @@ static MentalResult loadModelTexture(const char* filename, uint32_t* textureID)
     // Загружаем данные изображения в текстуру
     glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
     glGenerateMipmap(GL_TEXTURE_2D);
+    mentalTextureRegister(*textureID, GL_TEXTURE_2D, width, height, 1, nrChannels, MENTAL_TEXTURE_FLAG_MIPMAPS, filename);
     
     // Освобождаем память
     stbi_image_free(data);
@@ -340,6 +347,271 @@ static MentalResult loadModelTexture(const char* filename, uint32_t* textureID)
     return MENTAL_OK;
 }
 
+// Варианты PBR программы: вместо юниформов-флагов в шейдер подставляются #define,
+// и каждая комбинация текстур получает свою специализированную программу
+static const char* g_pbrStagePaths[MENTAL_SHADER_STAGE_COUNT] = {
+    [MENTAL_SHADER_STAGE_VERTEX]   = MENTAL_PBR_VERTEX_SHADER,
+    [MENTAL_SHADER_STAGE_FRAGMENT] = MENTAL_PBR_FRAGMENT_SHADER,
+};
+
+// Имена в порядке битов MentalPBRFeature
+static const char* g_pbrFeatureNames[MENTAL_PBR_FEATURE_COUNT] = {
+    "HAS_ALBEDO_MAP",
+    "HAS_NORMAL_MAP",
+    "HAS_METALLIC_MAP",
+    "HAS_ROUGHNESS_MAP",
+    "HAS_AO_MAP",
+    "HAS_HEIGHT_MAP",
+    "USE_ALBEDO_ARRAY",
+    "DEBUG_UVS",
+    "DEBUG_NORMALS",
+    "DEBUG_TANGENTS",
+    "DEBUG_WIREFRAME",
+    "INSTANCED",
+    "DEPTH_ONLY",
+};
+
+static MentalShaderVariants g_pbrVariants = {
+    .paths = g_pbrStagePaths,
+    .featureNames = g_pbrFeatureNames,
+    .featureCount = MENTAL_PBR_FEATURE_COUNT,
+};
+
+// Тесселяционный набор: те же #define и фрагментный шейдер, смещение по карте высот в TES
+static const char* g_pbrTessStagePaths[MENTAL_SHADER_STAGE_COUNT] = {
+    [MENTAL_SHADER_STAGE_VERTEX]          = MENTAL_TESS_VERTEX_SHADER,
+    [MENTAL_SHADER_STAGE_TESS_CONTROL]    = MENTAL_TESS_CONTROL_SHADER,
+    [MENTAL_SHADER_STAGE_TESS_EVALUATION] = MENTAL_TESS_EVALUATION_SHADER,
+    [MENTAL_SHADER_STAGE_FRAGMENT]        = MENTAL_PBR_FRAGMENT_SHADER,
+};
+
+static MentalShaderVariants g_pbrTessVariants = {
+    .paths = g_pbrTessStagePaths,
+    .featureNames = g_pbrFeatureNames,
+    .featureCount = MENTAL_PBR_FEATURE_COUNT,
+};
+
+// Предварительный проход глубины: те же вершинные стадии с DEPTH_ONLY и пустой
+// фрагментный шейдер. Варианты различаются только MENTAL_PBR_DEPTH_FEATURES
+static const char* g_pbrDepthStagePaths[MENTAL_SHADER_STAGE_COUNT] = {
+    [MENTAL_SHADER_STAGE_VERTEX]   = MENTAL_PBR_VERTEX_SHADER,
+    [MENTAL_SHADER_STAGE_FRAGMENT] = MENTAL_DEPTH_FRAGMENT_SHADER,
+};
+
+static MentalShaderVariants g_pbrDepthVariants = {
+    .paths = g_pbrDepthStagePaths,
+    .featureNames = g_pbrFeatureNames,
+    .featureCount = MENTAL_PBR_FEATURE_COUNT,
+};
+
+static const char* g_pbrTessDepthStagePaths[MENTAL_SHADER_STAGE_COUNT] = {
+    [MENTAL_SHADER_STAGE_VERTEX]          = MENTAL_TESS_VERTEX_SHADER,
+    [MENTAL_SHADER_STAGE_TESS_CONTROL]    = MENTAL_TESS_CONTROL_SHADER,
+    [MENTAL_SHADER_STAGE_TESS_EVALUATION] = MENTAL_TESS_EVALUATION_SHADER,
+    [MENTAL_SHADER_STAGE_FRAGMENT]        = MENTAL_DEPTH_FRAGMENT_SHADER,
+};
+
+static MentalShaderVariants g_pbrTessDepthVariants = {
+    .paths = g_pbrTessDepthStagePaths,
+    .featureNames = g_pbrFeatureNames,
+    .featureCount = MENTAL_PBR_FEATURE_COUNT,
+};
+
+static float g_tessMaxLevel = 0.0f;     // 0 — лимит драйвера еще не запрошен
+
+static uint32_t g_pbrDebugFeatures = 0;
+
+uint32_t mentalModelPBRFeatures(const Model3DData* pModelData) {
+    if (!pModelData) {
+        return 0;
+    }
+    
+    uint32_t features = g_pbrDebugFeatures;
+    if (pModelData->hasAtlasAlbedo) {
+        features |= MENTAL_PBR_ALBEDO_ARRAY;
+    } else if (pModelData->hasTexture) {
+        features |= MENTAL_PBR_ALBEDO_MAP;
+    }
+    if (pModelData->hasNormalMap) features |= MENTAL_PBR_NORMAL_MAP;
+    if (pModelData->hasMetallicMap) features |= MENTAL_PBR_METALLIC_MAP;
+    if (pModelData->hasRoughnessMap) features |= MENTAL_PBR_ROUGHNESS_MAP;
+    if (pModelData->hasAOMap) features |= MENTAL_PBR_AO_MAP;
+    if (pModelData->hasHeightMap) features |= MENTAL_PBR_HEIGHT_MAP;
+    if (pModelData->instanceCount > 0) features |= MENTAL_PBR_INSTANCED;
+    return features;
+}
+
+// Отладочные режимы тоже становятся вариантами; 0 выключает их
+void mentalSetPBRDebugMode(uint32_t debugFeatures) {
+    g_pbrDebugFeatures = debugFeatures & MENTAL_PBR_DEBUG_MASK;
+}
+
+// Вызывается до mentalShaderShutdown: набор держит по ссылке на каждый вариант
+void mentalReleasePBRVariants(void) {
+    mentalShaderReleaseVariants(&g_pbrVariants);
+    mentalShaderReleaseVariants(&g_pbrTessVariants);
+    mentalShaderReleaseVariants(&g_pbrDepthVariants);
+    mentalShaderReleaseVariants(&g_pbrTessDepthVariants);
+    g_tessMaxLevel = 0.0f;
+}
+
+// Включает адаптивную тесселяцию: ребро делится так, чтобы сегмент занимал
+// около edgePixels пикселей. 0 выключает. Нужен OpenGL 4.0
+MentalResult mentalSetModelTessellation(MentalComponent* pComponent, float edgePixels) {
+    if (!pComponent) {
+        MENTAL_DEBUG("Component pointer is null");
+        return MENTAL_POINTER_IS_NULL;
+    }
+    
+    if (pComponent->eType != MENTAL_COMPONENT_TYPE_MODEL3D || !pComponent->modelData) {
+        MENTAL_DEBUG("Component is not a 3D model or modelData is NULL");
+        return MENTAL_UNKNOWN_COMPONENT_TYPE;
+    }
+    
+    if (edgePixels > 0.0f && !GLEW_VERSION_4_0) {
+        MENTAL_DEBUG("Tessellation requires OpenGL 4.0, model is drawn without it");
+        return MENTAL_ERROR;
+    }
+    
+    pComponent->modelData->tessEdgePixels = edgePixels > 0.0f ? edgePixels : 0.0f;
+    return MENTAL_OK;
+}
+
+// Атрибуты экземпляров в VAO модели: матрица (4–7), оттенок (8), индексы (9)
+static void mental_model_setup_instance_attributes(MentalComponent* pComponent) {
+    mentalGLBindVertexArray(pComponent->VAO);
+    mentalGeometryInstanceAttributes(pComponent->modelData->instanceVBO);
+    mentalGLBindVertexArray(0);
+}
+
+// Буфер экземпляров остается привязанным к GL_ARRAY_BUFFER и вмещает count копий.
+// Старое хранилище отдается драйверу: кадр, который еще читает прежние
+// экземпляры, не заставит ждать запись новых
+static void mental_model_orphan_instances(MentalComponent* pComponent, uint32_t count) {
+    Model3DData* pData = pComponent->modelData;
+    if (pData->instanceVBO == 0) {
+        glGenBuffers(1, &pData->instanceVBO);
+        mental_model_setup_instance_attributes(pComponent);
+    }
+    
+    glBindBuffer(GL_ARRAY_BUFFER, pData->instanceVBO);
+    if (count > pData->instanceCapacity) {
+        pData->instanceCapacity = count;
+    }
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)pData->instanceCapacity * sizeof(MentalModelInstance), NULL, GL_DYNAMIC_DRAW);
+}
+
+// Копии модели рисуются одним вызовом: матрица экземпляра применяется поверх
+// преобразования компонента. Нормали не пересчитываются обратной матрицей,
+// поэтому масштаб в матрице экземпляра должен быть равномерным.
+// Массив копируется, 0 выключает инстансинг. Нужна PBR программа
+MentalResult mentalSetModelInstances(MentalComponent* pComponent, const MentalModelInstance* pInstances, uint32_t count) {
+    if (!pComponent || (count > 0 && !pInstances)) {
+        MENTAL_DEBUG("Component or instance pointer is null");
+        return MENTAL_POINTER_IS_NULL;
+    }
+    
+    if (pComponent->eType != MENTAL_COMPONENT_TYPE_MODEL3D || !pComponent->modelData) {
+        MENTAL_DEBUG("Component is not a 3D model or modelData is NULL");
+        return MENTAL_UNKNOWN_COMPONENT_TYPE;
+    }
+    
+    Model3DData* pData = pComponent->modelData;
+    if (count == 0) {
+        pData->instanceCount = 0;
+        return MENTAL_OK;
+    }
+    
+    mental_model_orphan_instances(pComponent, count);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)count * sizeof(MentalModelInstance), pInstances);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    // Для отсечения копии видны как одно целое
+    memset(&pData->instanceBounds, 0, sizeof(pData->instanceBounds));
+    for (uint32_t i = 0; i < count; i++) {
+        MentalBounds instanceBounds;
+        mentalBoundsTransform(&pComponent->bounds, (vec4*)pInstances[i].model, &instanceBounds);
+        mentalBoundsMerge(&pData->instanceBounds, &instanceBounds);
+    }
+    
+    pData->instanceCount = count;
+    pComponent->worldBoundsVersion = 0;
+    return MENTAL_OK;
+}
+
+// Запись экземпляров прямо в буфер на GPU, без промежуточного массива (например,
+// пакетом mentalTransformBatchCompose с шагом sizeof(MentalModelInstance)).
+// Все поля всех count копий нужно заполнить заново. До mentalUnmapModelInstances
+// модель не рисуется
+MentalModelInstance* mentalMapModelInstances(MentalComponent* pComponent, uint32_t count) {
+    if (!pComponent || pComponent->eType != MENTAL_COMPONENT_TYPE_MODEL3D || !pComponent->modelData || count == 0) {
+        MENTAL_DEBUG("Instances can only be mapped for a 3D model with at least one copy");
+        return NULL;
+    }
+    
+    Model3DData* pData = pComponent->modelData;
+    mental_model_orphan_instances(pComponent, count);
+    MentalModelInstance* pInstances = glMapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr)count * sizeof(MentalModelInstance),
+                                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (!pInstances) {
+        MENTAL_DEBUG("Failed to map instance buffer for %u copies", count);
+        return NULL;
+    }
+    pData->instanceMapped = count;
+    return pInstances;
+}
+
+// pInstanceBounds — границы всех копий в пространстве компонента; NULL — не отсекать
+MentalResult mentalUnmapModelInstances(MentalComponent* pComponent, const MentalBounds* pInstanceBounds) {
+    if (!pComponent || !pComponent->modelData) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    
+    Model3DData* pData = pComponent->modelData;
+    if (pData->instanceMapped == 0) {
+        MENTAL_DEBUG("Instance buffer is not mapped");
+        return MENTAL_ERROR;
+    }
+    
+    glBindBuffer(GL_ARRAY_BUFFER, pData->instanceVBO);
+    GLboolean intact = glUnmapBuffer(GL_ARRAY_BUFFER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    // Содержимое могло потеряться (смена видеорежима): копии не рисуются до следующей записи
+    pData->instanceCount = intact ? pData->instanceMapped : 0;
+    pData->instanceMapped = 0;
+    if (pInstanceBounds) {
+        pData->instanceBounds = *pInstanceBounds;
+    } else {
+        memset(&pData->instanceBounds, 0, sizeof(pData->instanceBounds));
+    }
+    pComponent->worldBoundsVersion = 0;
+    return intact ? MENTAL_OK : MENTAL_ERROR;
+}
+
+// Тесселяционный набор не читает атрибуты экземпляров: копии рисуются без нее
+static bool mental_model_tessellated(const Model3DData* pModelData) {
+    return pModelData->tessEdgePixels > 0.0f && pModelData->instanceCount == 0;
+}
+
+// Переключает модель на вариант под ее текущие текстуры. Пока новый вариант
+// компилируется, модель рисуется прежней программой, а не заглушкой
+static void mental_model_select_variant(MentalComponent* pComponent) {
+    bool tessellated = mental_model_tessellated(pComponent->modelData);
+    MentalShaderVariants* pVariants = tessellated ? &g_pbrTessVariants : &g_pbrVariants;
+    uint32_t features = mentalModelPBRFeatures(pComponent->modelData);
+    uint32_t variant = mentalShaderVariant(pVariants, features);
+    if (variant == 0 || variant == pComponent->shaderProgram) {
+        return;
+    }
+    if (mentalShaderIsReady(variant) || !mentalShaderIsReady(pComponent->shaderProgram)) {
+        pComponent->shaderProgram = variant;
+        pComponent->modelData->programTessellated = tessellated;
+        pComponent->modelData->programInstanced = (features & MENTAL_PBR_INSTANCED) != 0;
+    }
+}
+
 // Функция для загрузки PBR шейдеров
 MentalResult mentalAttachPBRShader(MentalComponent* pComponent) {
     if (!pComponent) {
@@ -347,12 +619,27 @@ MentalResult mentalAttachPBRShader(MentalComponent* pComponent) {
         return MENTAL_POINTER_IS_NULL;
     }
     
-    // Путь к PBR шейдерам
-    const char* vertex_path = "/Users/twofaced/Documents/Projects/mental.h/pbr_vertex.glsl";
-    const char* fragment_path = "/Users/twofaced/Documents/Projects/mental.h/pbr_fragment.glsl";
+    if (pComponent->eType != MENTAL_COMPONENT_TYPE_MODEL3D || !pComponent->modelData) {
+        MENTAL_DEBUG("Component is not a 3D model or modelData is NULL");
+        return MENTAL_UNKNOWN_COMPONENT_TYPE;
+    }
     
-    // Используем существующую функцию для прикрепления шейдеров
-    return mentalAttachShader(pComponent, vertex_path, fragment_path);
+    // Вариантами владеет общий набор, ссылку компонента на прежнюю программу отпускаем
+    bool tessellated = mental_model_tessellated(pComponent->modelData);
+    MentalShaderVariants* pVariants = tessellated ? &g_pbrTessVariants : &g_pbrVariants;
+    uint32_t features = mentalModelPBRFeatures(pComponent->modelData);
+    uint32_t program = mentalShaderVariant(pVariants, features);
+    if (program == 0) {
+        return MENTAL_SHADER_COMPILE_FAILED;
+    }
+    if (!pComponent->modelData->usePBRVariants) {
+        mentalShaderRelease(pComponent->shaderProgram);
+    }
+    pComponent->shaderProgram = program;
+    pComponent->modelData->usePBRVariants = true;
+    pComponent->modelData->programTessellated = tessellated;
+    pComponent->modelData->programInstanced = (features & MENTAL_PBR_INSTANCED) != 0;
+    return MENTAL_OK;
 }
 
 // Функция для установки PBR материала
@@ -380,6 +667,23 @@ MentalResult mentalSetModelPBRMaterial(MentalComponent* pComponent, vec3 albedo,
     return MENTAL_OK;
 }
 
+// Сила смещения по карте высот; загружается при отрисовке вместе с материалом
+MentalResult mentalSetModelHeightScale(MentalComponent* pComponent, float heightScale) {
+    if (!pComponent) {
+        MENTAL_DEBUG("Component pointer is null");
+        return MENTAL_POINTER_IS_NULL;
+    }
+    
+    if (pComponent->eType != MENTAL_COMPONENT_TYPE_MODEL3D || !pComponent->modelData) {
+        MENTAL_DEBUG("Component is not a 3D model or modelData is NULL");
+        return MENTAL_UNKNOWN_COMPONENT_TYPE;
+    }
+    
+    pComponent->modelData->material.heightScale = heightScale;
+    pComponent->worldBoundsVersion = 0;
+    return MENTAL_OK;
+}
+
 // Создание компонента 3D модели
 MentalResult mentalCreateModel3DComponent(MentalComponent* pComponent) {
     if (!pComponent) {
@@ -389,13 +693,7 @@ MentalResult mentalCreateModel3DComponent(MentalComponent* pComponent) {
     pComponent->eType = MENTAL_COMPONENT_TYPE_MODEL3D;
     
     // Инициализируем позицию, размер и поворот
-    pComponent->position[0] = 0.0f;
-    pComponent->position[1] = 0.0f;
-    pComponent->position[2] = 0.0f;
-    pComponent->size = 1.0f;
-    pComponent->rotation[0] = 0.0f;
-    pComponent->rotation[1] = 0.0f;
-    pComponent->rotation[2] = 0.0f;
+    mentalTransformInit(&pComponent->transform);
     
     // Выделяем память для данных модели
     pComponent->modelData = (Model3DData*)malloc(sizeof(Model3DData));
@@ -418,6 +716,7 @@ MentalResult mentalCreateModel3DComponent(MentalComponent* pComponent) {
     pComponent->modelData->material.metallic = 0.0f;
     pComponent->modelData->material.roughness = 0.5f;
     pComponent->modelData->material.ao = 1.0f;
+    pComponent->modelData->material.heightScale = 0.1f;
     pComponent->modelData->material.use_pbr = false; // По умолчанию используем традиционный материал
     
     // Создаем VAO, VBO и EBO
@@ -429,6 +728,38 @@ MentalResult mentalCreateModel3DComponent(MentalComponent* pComponent) {
     return MENTAL_OK;
 }
 
+// Вершины перекладываются в общий формат пула (позиция, UV, нормаль подряд).
+// VAO компонента смотрит в страницу пула, собственные VBO и EBO не нужны
+static MentalResult mental_model_upload_pooled(MentalComponent* pComponent) {
+    Model3DData* pData = pComponent->modelData;
+    mentalGeometryPoolRelease(&pData->geometry);
+    
+    MentalGeometryVertex* pVertices = malloc(sizeof(MentalGeometryVertex) * pData->vertexCount);
+    if (!pVertices) {
+        return MENTAL_FAILED_TO_ALLOCATE_MEMORY;
+    }
+    for (unsigned int i = 0; i < pData->vertexCount; i++) {
+        memcpy(pVertices[i].position, &pData->vertices[i * 3], sizeof(pVertices[i].position));
+        memcpy(pVertices[i].texCoord, &pData->texCoords[i * 2], sizeof(pVertices[i].texCoord));
+        memcpy(pVertices[i].normal, &pData->normals[i * 3], sizeof(pVertices[i].normal));
+    }
+    MentalResult result = mentalGeometryPoolAllocate(pVertices, pData->vertexCount, pData->indices,
+                                                     pData->indexCount, &pData->geometry);
+    free(pVertices);
+    if (result != MENTAL_OK) {
+        return result;
+    }
+    
+    glDeleteBuffers(1, &pComponent->VBO);
+    glDeleteBuffers(1, &pComponent->EBO);
+    pComponent->VBO = 0;
+    pComponent->EBO = 0;
+    mentalGLBindVertexArray(pComponent->VAO);
+    mentalGeometryBindRange(&pData->geometry);
+    mentalGLBindVertexArray(0);
+    return MENTAL_OK;
+}
+
 // Загрузка 3D модели из файла
 MentalResult mentalLoadModel3D(MentalComponent* pComponent, const char* model_path) {
     if (!pComponent || !model_path) {
@@ -446,6 +777,8 @@ MentalResult mentalLoadModel3D(MentalComponent* pComponent, const char* model_pa
         MENTAL_DEBUG("Failed to load OBJ file: %s", model_path);
         return result;
     }
+    mentalBoundsFromPoints(&pComponent->bounds, pComponent->modelData->vertices, pComponent->modelData->vertexCount);
+    pComponent->worldBoundsVersion = 0;
     
     // Инициализируем флаги наличия текстур
     pComponent->modelData->hasTexture = false;
@@ -514,7 +847,7 @@ MentalResult mentalLoadModel3D(MentalComponent* pComponent, const char* model_pa
     if (!pComponent->modelData->hasTexture) {
         // Создаем пустую текстуру 1x1 пиксель белого цвета
         glGenTextures(1, &pComponent->modelData->texture);
-        glBindTexture(GL_TEXTURE_2D, pComponent->modelData->texture);
+        mentalGLBindTexture(GL_TEXTURE_2D, pComponent->modelData->texture);
         
         // Создаем белый пиксель
         unsigned char whitePixel[] = {255, 255, 255, 255};
@@ -523,6 +856,7 @@ MentalResult mentalLoadModel3D(MentalComponent* pComponent, const char* model_pa
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        mentalTextureRegister(pComponent->modelData->texture, GL_TEXTURE_2D, 1, 1, 1, 4, MENTAL_TEXTURE_FLAG_PINNED, NULL);
         
         // Устанавливаем флаг, что текстура есть (пустая, но есть)
         pComponent->modelData->hasTexture = true;
@@ -621,8 +955,22 @@ MentalResult mentalLoadModel3D(MentalComponent* pComponent, const char* model_pa
         }
     }
     
-    // Загружаем данные в буферы OpenGL
-    glBindVertexArray(pComponent->VAO);
+    // Сохраняем количество индексов для отрисовки
+    pComponent->indexCount = pComponent->modelData->indexCount;
+    
+    // Сначала пробуем общий пул геометрии; не поместилась — свои буферы
+    if (mental_model_upload_pooled(pComponent) == MENTAL_OK) {
+        MENTAL_DEBUG("Model3D loaded successfully: %s (geometry pool page %u)", model_path,
+                     pComponent->modelData->geometry.page);
+        return MENTAL_OK;
+    }
+    
+    // Загружаем данные в буферы OpenGL (после модели из пула своих буферов может не быть)
+    if (pComponent->VBO == 0) {
+        glGenBuffers(1, &pComponent->VBO);
+        glGenBuffers(1, &pComponent->EBO);
+    }
+    mentalGLBindVertexArray(pComponent->VAO);
     
     // Позиции вершин
     glBindBuffer(GL_ARRAY_BUFFER, pComponent->VBO);
@@ -672,157 +1020,375 @@ MentalResult mentalLoadModel3D(MentalComponent* pComponent, const char* model_pa
                  pComponent->modelData->indexCount * sizeof(unsigned int),
                  pComponent->modelData->indices, GL_STATIC_DRAW);
     
-    // Сохраняем количество индексов для отрисовки
-    pComponent->indexCount = pComponent->modelData->indexCount;
-    
     // Отвязываем VAO
-    glBindVertexArray(0);
+    mentalGLBindVertexArray(0);
     
     MENTAL_DEBUG("Model3D loaded successfully: %s", model_path);
     return MENTAL_OK;
 }
 
-// Отрисовка 3D модели
-MentalResult mentalDrawModel3DComponent(MentalComponent* pComponent, MentalWindowManager *pManager) {
-    if (!pComponent || !pManager) {
-        return MENTAL_POINTER_IS_NULL;
-    }
-    
-    if (pComponent->eType != MENTAL_COMPONENT_TYPE_MODEL3D || !pComponent->modelData) {
-        MENTAL_DEBUG("Component is not a 3D model or modelData is NULL");
-        return MENTAL_UNKNOWN_COMPONENT_TYPE;
+// Уровни тесселяции считаются одинаково в основном проходе и в проходе глубины
+static void mental_model_tess_uniforms(MentalComponent* pComponent, MentalUniformTable* pUniforms) {
+    if (g_tessMaxLevel == 0.0f) {
+        GLint maxLevel = 0;
+        glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &maxLevel);
+        g_tessMaxLevel = fminf((float)maxLevel, MENTAL_TESS_MAX_LEVEL);
     }
-    
-    // Используем шейдерную программу
-    glUseProgram(pComponent->shaderProgram);
-    
-    // Получаем матрицы вида и проекции из менеджера окон
-    mat4 view, projection;
-    mental_camera_get_view_matrix(&pManager->camera, view);
-    // Вычисляем соотношение сторон из размеров окна
-    float aspect_ratio = (float)pManager->pInfo->aSizes[0] / (float)pManager->pInfo->aSizes[1];
-    mental_camera_get_projection_matrix(&pManager->camera, projection, aspect_ratio);
-    
-    // Создаем матрицу модели
-    mat4 model = GLM_MAT4_IDENTITY_INIT;
-    
-    // Применяем трансформации: перемещение, масштабирование и поворот
-    glm_translate(model, (vec3){pComponent->position[0], pComponent->position[1], pComponent->position[2]});
-    
-    // Поворот по X, Y, Z
-    glm_rotate(model, glm_rad(pComponent->rotation[0]), (vec3){1.0f, 0.0f, 0.0f});
-    glm_rotate(model, glm_rad(pComponent->rotation[1]), (vec3){0.0f, 1.0f, 0.0f});
-    glm_rotate(model, glm_rad(pComponent->rotation[2]), (vec3){0.0f, 0.0f, 1.0f});
-    
-    // Масштабирование
-    glm_scale_uni(model, pComponent->size);
-    
-    // Передаем матрицы в шейдер
-    glUniformMatrix4fv(glGetUniformLocation(pComponent->shaderProgram, "model"), 1, GL_FALSE, (float*)model);
-    glUniformMatrix4fv(glGetUniformLocation(pComponent->shaderProgram, "view"), 1, GL_FALSE, (float*)view);
-    glUniformMatrix4fv(glGetUniformLocation(pComponent->shaderProgram, "projection"), 1, GL_FALSE, (float*)projection);
-    
-    // Устанавливаем параметры освещения
-    glUniform3f(glGetUniformLocation(pComponent->shaderProgram, "lightPos"), 1.2f, 1.0f, 2.0f);
-    glUniform3f(glGetUniformLocation(pComponent->shaderProgram, "viewPos"), 
-                pManager->camera.position[0], 
-                pManager->camera.position[1], 
-                pManager->camera.position[2]);
-    glUniform3f(glGetUniformLocation(pComponent->shaderProgram, "lightColor"), 1.0f, 1.0f, 1.0f);
-    
-    // Передаем флаг использования PBR материала
-    glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "usePBR"), pComponent->modelData->material.use_pbr);
-    
+    mentalUniform1f(pUniforms, MENTAL_UNIFORM_TESS_EDGE_PIXELS, pComponent->modelData->tessEdgePixels);
+    mentalUniform1f(pUniforms, MENTAL_UNIFORM_TESS_MAX_LEVEL, g_tessMaxLevel);
+}
+
+// Материал и текстуры модели; общие для одиночной отрисовки и пакета из пула
+static void mental_model_bind_material(MentalComponent* pComponent, MentalWindowManager* pManager, uint32_t program,
+                                       MentalUniformTable* pUniforms, bool patches) {
     if (pComponent->modelData->material.use_pbr) {
         // Устанавливаем параметры PBR материала
-        glUniform3fv(glGetUniformLocation(pComponent->shaderProgram, "material.albedo"), 1, pComponent->modelData->material.albedo);
-        glUniform1f(glGetUniformLocation(pComponent->shaderProgram, "material.metallic"), pComponent->modelData->material.metallic);
-        glUniform1f(glGetUniformLocation(pComponent->shaderProgram, "material.roughness"), pComponent->modelData->material.roughness);
-        glUniform1f(glGetUniformLocation(pComponent->shaderProgram, "material.ao"), pComponent->modelData->material.ao);
+        mentalUniform3fv(pUniforms, MENTAL_UNIFORM_MATERIAL_ALBEDO, pComponent->modelData->material.albedo);
+        mentalUniform1f(pUniforms, MENTAL_UNIFORM_MATERIAL_METALLIC, pComponent->modelData->material.metallic);
+        mentalUniform1f(pUniforms, MENTAL_UNIFORM_MATERIAL_ROUGHNESS, pComponent->modelData->material.roughness);
+        mentalUniform1f(pUniforms, MENTAL_UNIFORM_MATERIAL_AO, pComponent->modelData->material.ao);
+        
+        // Наличие текстур задано вариантом программы (#define), флаги не загружаются
+        mentalUniform1f(pUniforms, MENTAL_UNIFORM_HEIGHT_SCALE, pComponent->modelData->material.heightScale);
         
-        // Передаем флаги наличия PBR текстур
-        glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "hasAlbedoMap"), pComponent->modelData->hasTexture);
-        glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "hasNormalMap"), pComponent->modelData->hasNormalMap);
-        glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "hasMetallicMap"), pComponent->modelData->hasMetallicMap);
-        glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "hasRoughnessMap"), pComponent->modelData->hasRoughnessMap);
-        glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "hasAOMap"), pComponent->modelData->hasAOMap);
-        glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "hasHeightMap"), pComponent->modelData->hasHeightMap);
+        // Параметры адаптивной тесселяции (есть только в тесселяционных вариантах)
+        if (patches) {
+            mental_model_tess_uniforms(pComponent, pUniforms);
+        }
         
         // Активируем текстуры для PBR
         int textureUnit = 0;
+        mentalBindIBL(&pManager->ibl, program);
+        
+        // Альбедо из атласа: слой общей GL_TEXTURE_2D_ARRAY на фиксированном блоке
+        if (pComponent->modelData->hasAtlasAlbedo) {
+            mentalUniform1i(pUniforms, MENTAL_UNIFORM_ALBEDO_ARRAY, MENTAL_ATLAS_TEXTURE_UNIT);
+            mentalGLActiveTexture(GL_TEXTURE0 + MENTAL_ATLAS_TEXTURE_UNIT);
+            mentalGLBindTexture(GL_TEXTURE_2D_ARRAY, pComponent->modelData->albedoSlot.texture);
+            mentalTextureTouch(pComponent->modelData->albedoSlot.texture);
+            mentalUniform1f(pUniforms, MENTAL_UNIFORM_ALBEDO_LAYER, (float)pComponent->modelData->albedoSlot.layer);
+            mentalUniform2fv(pUniforms, MENTAL_UNIFORM_ALBEDO_UV_SCALE, pComponent->modelData->albedoSlot.uvScale);
+        }
         
         // Альбедо карта (базовая текстура)
-        if (pComponent->modelData->hasTexture) {
-            glActiveTexture(GL_TEXTURE0 + textureUnit);
-            glBindTexture(GL_TEXTURE_2D, pComponent->modelData->texture);
-            glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "albedoMap"), textureUnit);
+        if (pComponent->modelData->hasTexture && !pComponent->modelData->hasAtlasAlbedo) {
+            mentalGLActiveTexture(GL_TEXTURE0 + textureUnit);
+            mentalGLBindTexture(GL_TEXTURE_2D, pComponent->modelData->texture);
+            mentalTextureTouch(pComponent->modelData->texture);
+            mentalUniform1i(pUniforms, MENTAL_UNIFORM_ALBEDO_MAP, textureUnit);
             textureUnit++;
         }
         
         // Карта нормалей
         if (pComponent->modelData->hasNormalMap) {
-            glActiveTexture(GL_TEXTURE0 + textureUnit);
-            glBindTexture(GL_TEXTURE_2D, pComponent->modelData->normal_map);
-            glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "normalMap"), textureUnit);
+            mentalGLActiveTexture(GL_TEXTURE0 + textureUnit);
+            mentalGLBindTexture(GL_TEXTURE_2D, pComponent->modelData->normal_map);
+            mentalTextureTouch(pComponent->modelData->normal_map);
+            mentalUniform1i(pUniforms, MENTAL_UNIFORM_NORMAL_MAP, textureUnit);
             textureUnit++;
         }
         
         // Карта металличности
         if (pComponent->modelData->hasMetallicMap) {
-            glActiveTexture(GL_TEXTURE0 + textureUnit);
-            glBindTexture(GL_TEXTURE_2D, pComponent->modelData->metallic_map);
-            glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "metallicMap"), textureUnit);
+            mentalGLActiveTexture(GL_TEXTURE0 + textureUnit);
+            mentalGLBindTexture(GL_TEXTURE_2D, pComponent->modelData->metallic_map);
+            mentalTextureTouch(pComponent->modelData->metallic_map);
+            mentalUniform1i(pUniforms, MENTAL_UNIFORM_METALLIC_MAP, textureUnit);
             textureUnit++;
         }
         
         // Карта шероховатости
         if (pComponent->modelData->hasRoughnessMap) {
-            glActiveTexture(GL_TEXTURE0 + textureUnit);
-            glBindTexture(GL_TEXTURE_2D, pComponent->modelData->roughness_map);
-            glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "roughnessMap"), textureUnit);
+            mentalGLActiveTexture(GL_TEXTURE0 + textureUnit);
+            mentalGLBindTexture(GL_TEXTURE_2D, pComponent->modelData->roughness_map);
+            mentalTextureTouch(pComponent->modelData->roughness_map);
+            mentalUniform1i(pUniforms, MENTAL_UNIFORM_ROUGHNESS_MAP, textureUnit);
             textureUnit++;
         }
         
         // Карта ambient occlusion
         if (pComponent->modelData->hasAOMap) {
-            glActiveTexture(GL_TEXTURE0 + textureUnit);
-            glBindTexture(GL_TEXTURE_2D, pComponent->modelData->ao_map);
-            glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "aoMap"), textureUnit);
+            mentalGLActiveTexture(GL_TEXTURE0 + textureUnit);
+            mentalGLBindTexture(GL_TEXTURE_2D, pComponent->modelData->ao_map);
+            mentalTextureTouch(pComponent->modelData->ao_map);
+            mentalUniform1i(pUniforms, MENTAL_UNIFORM_AO_MAP, textureUnit);
             textureUnit++;
         }
         
         // Карта высот
         if (pComponent->modelData->hasHeightMap) {
-            glActiveTexture(GL_TEXTURE0 + textureUnit);
-            glBindTexture(GL_TEXTURE_2D, pComponent->modelData->height_map);
-            glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "heightMap"), textureUnit);
+            mentalGLActiveTexture(GL_TEXTURE0 + textureUnit);
+            mentalGLBindTexture(GL_TEXTURE_2D, pComponent->modelData->height_map);
+            mentalTextureTouch(pComponent->modelData->height_map);
+            mentalUniform1i(pUniforms, MENTAL_UNIFORM_HEIGHT_MAP, textureUnit);
         }
     } else {
         // Устанавливаем параметры традиционного материала
-        glUniform3fv(glGetUniformLocation(pComponent->shaderProgram, "material.ambient"), 1, pComponent->modelData->material.ambient);
-        glUniform3fv(glGetUniformLocation(pComponent->shaderProgram, "material.diffuse"), 1, pComponent->modelData->material.diffuse);
-        glUniform3fv(glGetUniformLocation(pComponent->shaderProgram, "material.specular"), 1, pComponent->modelData->material.specular);
-        glUniform1f(glGetUniformLocation(pComponent->shaderProgram, "material.shininess"), pComponent->modelData->material.shininess);
+        mentalUniform3fv(pUniforms, MENTAL_UNIFORM_MATERIAL_AMBIENT, pComponent->modelData->material.ambient);
+        mentalUniform3fv(pUniforms, MENTAL_UNIFORM_MATERIAL_DIFFUSE, pComponent->modelData->material.diffuse);
+        mentalUniform3fv(pUniforms, MENTAL_UNIFORM_MATERIAL_SPECULAR, pComponent->modelData->material.specular);
+        mentalUniform1f(pUniforms, MENTAL_UNIFORM_MATERIAL_SHININESS, pComponent->modelData->material.shininess);
         
-        glUniform3f(glGetUniformLocation(pComponent->shaderProgram, "objectColor"), 0.5f, 0.5f, 1.0f);
-        glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "hasTexture"), pComponent->modelData->hasTexture);
+        mentalUniform3f(pUniforms, MENTAL_UNIFORM_OBJECT_COLOR, 0.5f, 0.5f, 1.0f);
+        mentalUniform1i(pUniforms, MENTAL_UNIFORM_HAS_TEXTURE, pComponent->modelData->hasTexture);
         
         // Если есть текстура, активируем её
         if (pComponent->modelData->hasTexture) {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, pComponent->modelData->texture);
-            glUniform1i(glGetUniformLocation(pComponent->shaderProgram, "texture1"), 0);
+            mentalGLActiveTexture(GL_TEXTURE0);
+            mentalGLBindTexture(GL_TEXTURE_2D, pComponent->modelData->texture);
+            mentalTextureTouch(pComponent->modelData->texture);
+            mentalUniform1i(pUniforms, MENTAL_UNIFORM_TEXTURE1, 0);
+        }
+    }
+}
+
+// Вызов отрисовки; у модели из пула индексы начинаются не с нуля
+static void mental_model_draw_elements(MentalComponent* pComponent, bool patches, uint32_t instances) {
+    const MentalGeometryRange* pGeometry = &pComponent->modelData->geometry;
+    const void* indexOffset = pGeometry->valid ? mentalGeometryIndexOffset(pGeometry) : NULL;
+    mentalGLBindVertexArray(pComponent->VAO);
+    if (patches) {
+        glPatchParameteri(GL_PATCH_VERTICES, 3);
+        glDrawElements(GL_PATCHES, pComponent->indexCount, GL_UNSIGNED_INT, indexOffset);
+    } else if (instances > 0) {
+        glDrawElementsInstanced(GL_TRIANGLES, pComponent->indexCount, GL_UNSIGNED_INT, indexOffset, (GLsizei)instances);
+    } else {
+        glDrawElements(GL_TRIANGLES, pComponent->indexCount, GL_UNSIGNED_INT, indexOffset);
+    }
+    mentalGLBindVertexArray(0);
+}
+
+// Отрисовка 3D модели
+MentalResult mentalDrawModel3DComponent(MentalComponent* pComponent, MentalWindowManager *pManager) {
+    if (!pComponent || !pManager) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    
+    if (pComponent->eType != MENTAL_COMPONENT_TYPE_MODEL3D || !pComponent->modelData) {
+        MENTAL_DEBUG("Component is not a 3D model or modelData is NULL");
+        return MENTAL_UNKNOWN_COMPONENT_TYPE;
+    }
+    
+    // Буфер экземпляров отображен: рисование из него дало бы GL_INVALID_OPERATION
+    if (pComponent->modelData->instanceMapped != 0) {
+        pComponent->modelData->depthPrepassed = false;
+        return MENTAL_OK;
+    }
+    
+    // Вариант PBR программы под текущий набор текстур. После прохода глубины
+    // программа остается прежней: другой вариант мог бы дать другую глубину
+    if (pComponent->modelData->usePBRVariants && !pComponent->modelData->depthPrepassed) {
+        mental_model_select_variant(pComponent);
+    }
+    pComponent->modelData->depthPrepassed = false;
+    
+    // Используем шейдерную программу (или заглушку, пока она компилируется)
+    uint32_t program = mentalShaderUse(pComponent->shaderProgram);
+    MentalUniformTable* pUniforms = mentalUniformsFor(program);
+    // Заглушка и обычные варианты рисуют треугольники, тесселяционные — патчи
+    bool patches = pComponent->modelData->programTessellated && program == pComponent->shaderProgram;
+    // Копии рисует только вариант с атрибутами экземпляров; до его готовности — одна модель
+    uint32_t instances = pComponent->modelData->programInstanced && program == pComponent->shaderProgram
+                       ? pComponent->modelData->instanceCount : 0;
+    
+    // Матрицы камеры и параметры света берутся из блока FrameData (engine/frame.h)
+    
+    // Матрица модели берется из кэша преобразования и пересчитывается только после изменений
+    mentalUniformMatrix4fv(pUniforms, MENTAL_UNIFORM_MODEL, (float*)mentalTransformWorld(&pComponent->transform));
+    
+    mental_model_bind_material(pComponent, pManager, program, pUniforms, patches);
+    mental_model_draw_elements(pComponent, patches, instances);
+    
+    return MENTAL_OK;
+}
+
+// Признаки, с которыми собрана программа набора; false — программа не из него
+static bool mental_model_variant_features(const MentalShaderVariants* pVariants, uint32_t program, uint32_t* pFeatures) {
+    for (uint32_t i = 0; i < pVariants->count; i++) {
+        if (pVariants->programs[i] == program) {
+            *pFeatures = pVariants->masks[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+// Проходу глубины из материала нужно только то, что сдвигает вершины
+static void mental_model_bind_displacement(MentalComponent* pComponent, MentalUniformTable* pUniforms,
+                                           uint32_t features, bool patches) {
+    if (patches) {
+        mental_model_tess_uniforms(pComponent, pUniforms);
+    }
+    if (features & MENTAL_PBR_HEIGHT_MAP) {
+        mentalUniform1f(pUniforms, MENTAL_UNIFORM_HEIGHT_SCALE, pComponent->modelData->material.heightScale);
+        mentalGLActiveTexture(GL_TEXTURE0);
+        mentalGLBindTexture(GL_TEXTURE_2D, pComponent->modelData->height_map);
+        mentalTextureTouch(pComponent->modelData->height_map);
+        mentalUniform1i(pUniforms, MENTAL_UNIFORM_HEIGHT_MAP, 0);
+    }
+}
+
+// Глубина модели тем же путем, что и mentalDrawModel3DComponent: патчи, копии или
+// одна модель, с теми же признаками, что у ее текущей программы
+MentalResult mentalDrawModel3DDepth(MentalComponent* pComponent, MentalWindowManager* pManager) {
+    if (!pComponent || !pManager) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    
+    if (pComponent->eType != MENTAL_COMPONENT_TYPE_MODEL3D || !pComponent->modelData) {
+        return MENTAL_UNKNOWN_COMPONENT_TYPE;
+    }
+    
+    Model3DData* pData = pComponent->modelData;
+    if (!pData->usePBRVariants || !pData->material.use_pbr || pData->instanceMapped != 0) {
+        return MENTAL_ERROR;
+    }
+    
+    // Программа выбирается здесь; заглушку проход глубины не заменяет
+    mental_model_select_variant(pComponent);
+    uint32_t features = 0;
+    MentalShaderVariants* pVariants = pData->programTessellated ? &g_pbrTessVariants : &g_pbrVariants;
+    if (!mentalShaderIsReady(pComponent->shaderProgram) ||
+        !mental_model_variant_features(pVariants, pComponent->shaderProgram, &features)) {
+        return MENTAL_ERROR;
+    }
+    MentalShaderVariants* pDepthVariants = pData->programTessellated ? &g_pbrTessDepthVariants : &g_pbrDepthVariants;
+    uint32_t variant = mentalShaderVariant(pDepthVariants, (features & MENTAL_PBR_DEPTH_FEATURES) | MENTAL_PBR_DEPTH_ONLY);
+    if (variant == 0 || !mentalShaderIsReady(variant)) {
+        return MENTAL_ERROR;
+    }
+    
+    uint32_t program = mentalShaderUse(variant);
+    MentalUniformTable* pUniforms = mentalUniformsFor(program);
+    bool patches = pData->programTessellated;
+    uint32_t instances = pData->programInstanced ? pData->instanceCount : 0;
+    mentalUniformMatrix4fv(pUniforms, MENTAL_UNIFORM_MODEL, (float*)mentalTransformWorld(&pComponent->transform));
+    mental_model_bind_displacement(pComponent, pUniforms, features, patches);
+    mental_model_draw_elements(pComponent, patches, instances);
+    
+    pData->depthPrepassed = true;
+    return MENTAL_OK;
+}
+
+// В пакет идут PBR модели из пула без своих копий и тесселяции; нужен OpenGL 4.3
+bool mentalModelBatchable(const MentalComponent* pComponent) {
+    if (!pComponent || pComponent->eType != MENTAL_COMPONENT_TYPE_MODEL3D || !pComponent->modelData) {
+        return false;
+    }
+    const Model3DData* pData = pComponent->modelData;
+    return pData->geometry.valid && pData->usePBRVariants && pData->material.use_pbr && pData->instanceCount == 0 &&
+           pData->instanceMapped == 0 && pData->tessEdgePixels == 0.0f && mentalGeometryIndirectSupported();
+}
+
+// Модели одного пакета делят страницу, программу, текстуры и параметры материала
+bool mentalModelBatchCompatible(const MentalComponent* pFirst, const MentalComponent* pSecond) {
+    if (!mentalModelBatchable(pFirst) || !mentalModelBatchable(pSecond)) {
+        return false;
+    }
+    const Model3DData* a = pFirst->modelData;
+    const Model3DData* b = pSecond->modelData;
+    if (a->geometry.page != b->geometry.page || mentalModelPBRFeatures(a) != mentalModelPBRFeatures(b)) {
+        return false;
+    }
+    if (a->texture != b->texture || a->normal_map != b->normal_map || a->metallic_map != b->metallic_map ||
+        a->roughness_map != b->roughness_map || a->ao_map != b->ao_map || a->height_map != b->height_map) {
+        return false;
+    }
+    if (a->hasAtlasAlbedo && (a->albedoSlot.texture != b->albedoSlot.texture || a->albedoSlot.layer != b->albedoSlot.layer ||
+                              memcmp(a->albedoSlot.uvScale, b->albedoSlot.uvScale, sizeof(a->albedoSlot.uvScale)) != 0)) {
+        return false;
+    }
+    return memcmp(a->material.albedo, b->material.albedo, sizeof(vec3)) == 0 && a->material.metallic == b->material.metallic &&
+           a->material.roughness == b->material.roughness && a->material.ao == b->material.ao &&
+           a->material.heightScale == b->material.heightScale;
+}
+
+// Пакет из пула: основной проход или проход глубины. Вариант глубины берется, только
+// если готов и основной: иначе основной проход нарисовал бы модели по одной.
+// pSlot — ячейка сохраненного пакета: проход глубины записывает ее, основной
+// рисует из нее без повторной загрузки и отсечения на GPU
+static MentalResult mental_model_draw_batch(MentalComponent* const* ppComponents, uint32_t count,
+                                            MentalWindowManager* pManager, bool depthOnly, const uint32_t* pSlot) {
+    if (!ppComponents || !pManager) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    if (count == 0) {
+        return MENTAL_OK;
+    }
+    
+    MentalComponent* pFirst = ppComponents[0];
+    if (!mentalModelBatchable(pFirst)) {
+        return MENTAL_ERROR_INVALID_COMPONENT;
+    }
+    uint32_t features = mentalModelPBRFeatures(pFirst->modelData) | MENTAL_PBR_INSTANCED;
+    uint32_t variant = mentalShaderVariant(&g_pbrVariants, features);
+    if (variant == 0 || !mentalShaderIsReady(variant)) {
+        return MENTAL_ERROR;
+    }
+    if (depthOnly) {
+        variant = mentalShaderVariant(&g_pbrDepthVariants, (features & MENTAL_PBR_DEPTH_FEATURES) | MENTAL_PBR_DEPTH_ONLY);
+        if (variant == 0 || !mentalShaderIsReady(variant)) {
+            return MENTAL_ERROR;
+        }
+    }
+    
+    // Мировые границы берутся из кэша компонента; они нужны только отсечению на GPU
+    bool redraw = pSlot && !depthOnly;
+    if (!redraw) {
+        mentalGeometryBatchBegin(pFirst->modelData->geometry.page);
+        for (uint32_t i = 0; i < count; i++) {
+            MentalBounds worldBounds;
+            mentalComponentWorldBounds(ppComponents[i], &worldBounds);
+            MentalResult result = mentalGeometryBatchAdd(&ppComponents[i]->modelData->geometry,
+                                                         mentalTransformWorld(&ppComponents[i]->transform), &worldBounds);
+            if (result != MENTAL_OK) {
+                return result;
+            }
         }
     }
     
-    // Отрисовываем модель
-    glBindVertexArray(pComponent->VAO);
-    glDrawElements(GL_TRIANGLES, pComponent->indexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    // Матрица экземпляра применяется поверх матрицы модели, поэтому та единичная
+    uint32_t program = mentalShaderUse(variant);
+    MentalUniformTable* pUniforms = mentalUniformsFor(program);
+    mat4 identity = GLM_MAT4_IDENTITY_INIT;
+    mentalUniformMatrix4fv(pUniforms, MENTAL_UNIFORM_MODEL, (float*)identity);
+    if (depthOnly) {
+        mental_model_bind_displacement(pFirst, pUniforms, features, false);
+    } else {
+        mental_model_bind_material(pFirst, pManager, program, pUniforms, false);
+    }
     
+    if (redraw) {
+        return mentalGeometryBatchRedraw(program, *pSlot) != 0 ? MENTAL_OK : MENTAL_ERROR;
+    }
+    if (pSlot) {
+        mentalGeometryBatchSubmitRetained(program, *pSlot);
+    } else {
+        mentalGeometryBatchSubmit(program);
+    }
     return MENTAL_OK;
 }
 
+// Совместимые модели (mentalModelBatchCompatible) одним glMultiDrawElementsIndirect:
+// мировые матрицы уходят в буфер экземпляров пула, программа — вариант с
+// атрибутами экземпляров. При отсечении на GPU невидимые модели отбрасывает
+// compute шейдер. MENTAL_ERROR — вариант еще не готов, модели рисуются по одной
+MentalResult mentalDrawModel3DBatch(MentalComponent* const* ppComponents, uint32_t count, MentalWindowManager* pManager) {
+    return mental_model_draw_batch(ppComponents, count, pManager, false, NULL);
+}
+
+MentalResult mentalDrawModel3DBatchDepth(MentalComponent* const* ppComponents, uint32_t count, MentalWindowManager* pManager,
+                                         uint32_t slot) {
+    return mental_model_draw_batch(ppComponents, count, pManager, true, &slot);
+}
+
+// Команды после отсечения на GPU берутся из прохода глубины, поэтому оба прохода
+// рисуют один и тот же набор моделей, а compute шейдер запускается один раз
+MentalResult mentalDrawModel3DBatchPrepassed(MentalComponent* const* ppComponents, uint32_t count,
+                                             MentalWindowManager* pManager, uint32_t slot) {
+    return mental_model_draw_batch(ppComponents, count, pManager, false, &slot);
+}
+
 // Загрузка текстуры для 3D модели
 MentalResult mentalLoadModelTexture(MentalComponent* pComponent, const char* texture_path) {
     if (!pComponent || !texture_path) {
@@ -836,7 +1402,7 @@ MentalResult mentalLoadModelTexture(MentalComponent* pComponent, const char* tex
     
     // Если уже есть текстура, удаляем её
     if (pComponent->modelData->hasTexture) {
-        glDeleteTextures(1, &pComponent->modelData->texture);
+        mentalTextureDelete(&pComponent->modelData->texture);
     }
     
     // Загружаем новую текстуру
@@ -865,7 +1431,7 @@ MentalResult mentalLoadModelNormalMap(MentalComponent* pComponent, const char* t
     
     // Если уже есть карта нормалей, удаляем её
     if (pComponent->modelData->hasNormalMap) {
-        glDeleteTextures(1, &pComponent->modelData->normal_map);
+        mentalTextureDelete(&pComponent->modelData->normal_map);
     }
     
     // Загружаем новую карту нормалей
@@ -895,7 +1461,7 @@ MentalResult mentalLoadModelMetallicMap(MentalComponent* pComponent, const char*
     
     // Если уже есть карта металличности, удаляем её
     if (pComponent->modelData->hasMetallicMap) {
-        glDeleteTextures(1, &pComponent->modelData->metallic_map);
+        mentalTextureDelete(&pComponent->modelData->metallic_map);
     }
     
     // Загружаем новую карту металличности
@@ -925,7 +1491,7 @@ MentalResult mentalLoadModelRoughnessMap(MentalComponent* pComponent, const char
     
     // Если уже есть карта шероховатости, удаляем её
     if (pComponent->modelData->hasRoughnessMap) {
-        glDeleteTextures(1, &pComponent->modelData->roughness_map);
+        mentalTextureDelete(&pComponent->modelData->roughness_map);
     }
     
     // Загружаем новую карту шероховатости
@@ -955,7 +1521,7 @@ MentalResult mentalLoadModelAOMap(MentalComponent* pComponent, const char* textu
     
     // Если уже есть карта ambient occlusion, удаляем её
     if (pComponent->modelData->hasAOMap) {
-        glDeleteTextures(1, &pComponent->modelData->ao_map);
+        mentalTextureDelete(&pComponent->modelData->ao_map);
     }
     
     // Загружаем новую карту ambient occlusion
@@ -972,6 +1538,37 @@ MentalResult mentalLoadModelAOMap(MentalComponent* pComponent, const char* textu
     return result;
 }
 
+// Загрузка альбедо модели в общий атлас текстур
+MentalResult mentalLoadModelTextureFromAtlas(MentalComponent* pComponent, MentalTextureAtlas* pAtlas, const char* texture_path) {
+    if (!pComponent || !pAtlas || !texture_path) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    
+    if (pComponent->eType != MENTAL_COMPONENT_TYPE_MODEL3D || !pComponent->modelData) {
+        MENTAL_DEBUG("Component is not a 3D model or modelData is NULL");
+        return MENTAL_UNKNOWN_COMPONENT_TYPE;
+    }
+    
+    MentalResult result = mentalAtlasLoadImage(pAtlas, texture_path, &pComponent->modelData->albedoSlot);
+    if (result != MENTAL_OK) {
+        pComponent->modelData->hasAtlasAlbedo = false;
+        MENTAL_DEBUG("Failed to load model atlas texture: %s", texture_path);
+        return result;
+    }
+    
+    // Слоем атласа владеет атлас, собственную текстуру модель больше не держит
+    if (pComponent->modelData->hasTexture) {
+        mentalTextureDelete(&pComponent->modelData->texture);
+        pComponent->modelData->texture = 0;
+        pComponent->modelData->hasTexture = false;
+    }
+    
+    pComponent->modelData->hasAtlasAlbedo = true;
+    pComponent->modelData->material.use_pbr = true;
+    MENTAL_DEBUG("Model atlas texture loaded: %s (page %u, layer %u)", texture_path,
+                 pComponent->modelData->albedoSlot.page, pComponent->modelData->albedoSlot.layer);
+    return MENTAL_OK;
+}
 
 MentalResult mentalLoadModelHeightMap(MentalComponent* pComponent, const char* texture_path) {
     // Проверка входных параметров
@@ -991,15 +1588,15 @@ MentalResult mentalLoadModelHeightMap(MentalComponent* pComponent, const char* t
     
     // Загружаем как одноканальное изображение (высота - только красный канал)
     stbi_set_flip_vertically_on_load(true); // Важно для корректного отображения
-    unsigned char* data = stbi_load(texture_path, &width, &height, &nrComponents, 1);
+    unsigned char* data = mentalImageLoad(texture_path, &width, &height, &nrComponents, 1);
     if (!data) {
         MENTAL_DEBUG("Failed to load height map texture: %s", texture_path);
-        glDeleteTextures(1, &textureID);
+        mentalTextureDelete(&textureID);
         return MENTAL_ERROR_TEXTURE_LOAD_FAILED;
     }
     
     // Для карты высот используем только один канал (GL_RED)
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    mentalGLBindTexture(GL_TEXTURE_2D, textureID);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, data);
     glGenerateMipmap(GL_TEXTURE_2D);
     
@@ -1013,7 +1610,13 @@ MentalResult mentalLoadModelHeightMap(MentalComponent* pComponent, const char* t
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
     
     stbi_image_free(data);
+    mentalTextureRegister(textureID, GL_TEXTURE_2D, width, height, 1, 1,
+                          MENTAL_TEXTURE_FLAG_MIPMAPS | MENTAL_TEXTURE_FLAG_FLIP_Y, texture_path);
     
+    // Старую карту высот освобождаем, иначе при повторной загрузке она утекает
+    if (pComponent->modelData->hasHeightMap) {
+        mentalTextureDelete(&pComponent->modelData->height_map);
+    }
     pComponent->modelData->height_map = textureID;
     pComponent->modelData->hasHeightMap = true;
     
@@ -1058,6 +1661,9 @@ MentalResult mentalDestroyModel3DComponent(MentalComponent* pComponent) {
         return MENTAL_UNKNOWN_COMPONENT_TYPE;
     }
     
+    // Варианты PBR принадлежат общему набору, их ссылки здесь не отпускаются
+    bool ownsProgram = !pComponent->modelData->usePBRVariants;
+    
     // Освобождаем память для данных модели
     free(pComponent->modelData->vertices);
     free(pComponent->modelData->texCoords);
@@ -1066,34 +1672,51 @@ MentalResult mentalDestroyModel3DComponent(MentalComponent* pComponent) {
     
     // Удаляем текстуры, если они есть
     if (pComponent->modelData->hasTexture) {
-        glDeleteTextures(1, &pComponent->modelData->texture);
+        mentalTextureDelete(&pComponent->modelData->texture);
     }
     
     if (pComponent->modelData->hasNormalMap) {
-        glDeleteTextures(1, &pComponent->modelData->normal_map);
+        mentalTextureDelete(&pComponent->modelData->normal_map);
     }
     
     if (pComponent->modelData->hasMetallicMap) {
-        glDeleteTextures(1, &pComponent->modelData->metallic_map);
+        mentalTextureDelete(&pComponent->modelData->metallic_map);
     }
     
     if (pComponent->modelData->hasRoughnessMap) {
-        glDeleteTextures(1, &pComponent->modelData->roughness_map);
+        mentalTextureDelete(&pComponent->modelData->roughness_map);
     }
     
     if (pComponent->modelData->hasAOMap) {
-        glDeleteTextures(1, &pComponent->modelData->ao_map);
+        mentalTextureDelete(&pComponent->modelData->ao_map);
+    }
+    
+    if (pComponent->modelData->hasHeightMap) {
+        mentalTextureDelete(&pComponent->modelData->height_map);
+    }
+    
+    if (pComponent->modelData->instanceVBO) {
+        glDeleteBuffers(1, &pComponent->modelData->instanceVBO);
     }
     
+    // Место в пуле геометрии переиспользуется следующими моделями
+    mentalGeometryPoolRelease(&pComponent->modelData->geometry);
+    
     // Освобождаем память для структуры данных модели
     free(pComponent->modelData);
     pComponent->modelData = NULL;
     
     // Удаляем буферы OpenGL
-    glDeleteVertexArrays(1, &pComponent->VAO);
+    mentalGLDeleteVertexArrays(1, &pComponent->VAO);
     glDeleteBuffers(1, &pComponent->VBO);
     glDeleteBuffers(1, &pComponent->EBO);
     
+    // Программа общая — отпускаем ссылку в реестре
+    if (ownsProgram) {
+        mentalShaderRelease(pComponent->shaderProgram);
+    }
+    pComponent->shaderProgram = 0;
+    
     MENTAL_DEBUG("Model3D component destroyed successfully");
     return MENTAL_OK;
 }
\ No newline at end of file
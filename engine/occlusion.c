@@ -0,0 +1,485 @@
+#include "occlusion.h"
+#include "frame.h"
+#include "jobs.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define MENTAL_OCCLUSION_TILE_COUNT     (MENTAL_OCCLUSION_TILES_X * MENTAL_OCCLUSION_TILES_Y)
+
+// Треугольник в пикселях буфера, подготовленный к растеризации: три функции
+// ребер A*x + B*y + C (>= 0 внутри) и плоскость глубины a*x + b*y + c
+typedef struct MentalOcclusionTriangle {
+    float   edges[3][3];
+    float   depth[3];
+    int     minX, minY, maxX, maxY;     // Центры пикселей внутри прямоугольника, включительно
+} MentalOcclusionTriangle;
+
+static struct {
+    bool                        disabled;
+    bool                        ready;          // Буфер растеризован для текущего кадра
+    mat4                        viewProjection;
+
+    MentalOcclusionTriangle*    pTriangles;
+    uint32_t                    triangleCount;
+    uint32_t                    triangleCapacity;
+    float*                      pClip;          // Вершины текущей сетки в пространстве отсечения (xyzw)
+    uint32_t                    clipCapacity;
+    uint32_t*                   pBins;          // Индексы треугольников, подряд по тайлам
+    uint32_t                    binCapacity;
+    uint32_t                    binStart[MENTAL_OCCLUSION_TILE_COUNT + 1];
+
+    float                       depth[MENTAL_OCCLUSION_WIDTH * MENTAL_OCCLUSION_HEIGHT];
+    float                       tileMaxDepth[MENTAL_OCCLUSION_TILE_COUNT];
+
+    MentalOcclusionStats        stats;
+} s_occlusion;
+
+MentalResult mentalCreateOccluder(MentalOccluder* pOccluder, const float* pVertices, uint32_t vertexCount,
+                                  const uint32_t* pIndices, uint32_t indexCount)
+{
+    if (!pOccluder || !pVertices || !pIndices) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    memset(pOccluder, 0, sizeof(*pOccluder));
+    pOccluder->pVertices = malloc(sizeof(float) * 3 * vertexCount);
+    pOccluder->pIndices = malloc(sizeof(uint32_t) * indexCount);
+    if (!pOccluder->pVertices || !pOccluder->pIndices) {
+        mentalDestroyOccluder(pOccluder);
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+    memcpy(pOccluder->pVertices, pVertices, sizeof(float) * 3 * vertexCount);
+    memcpy(pOccluder->pIndices, pIndices, sizeof(uint32_t) * indexCount);
+    pOccluder->vertexCount = vertexCount;
+    pOccluder->indexCount = indexCount - indexCount % 3;
+    return MENTAL_OK;
+}
+
+void mentalDestroyOccluder(MentalOccluder* pOccluder)
+{
+    if (!pOccluder) {
+        return;
+    }
+    free(pOccluder->pVertices);
+    free(pOccluder->pIndices);
+    memset(pOccluder, 0, sizeof(*pOccluder));
+}
+
+void mentalSetOcclusionCulling(bool enabled)
+{
+    s_occlusion.disabled = !enabled;
+}
+
+bool mentalOcclusionCullingActive(void)
+{
+    return !s_occlusion.disabled && s_occlusion.ready;
+}
+
+void mentalOcclusionBeginFrame(mat4 viewProjection)
+{
+    glm_mat4_copy(viewProjection, s_occlusion.viewProjection);
+    s_occlusion.triangleCount = 0;
+    s_occlusion.ready = false;
+    s_occlusion.stats.frameTriangles = 0;
+    s_occlusion.stats.frameBinned = 0;
+    s_occlusion.stats.frameTested = 0;
+    s_occlusion.stats.frameOccluded = 0;
+}
+
+static bool mental_occlusion_reserve(void** ppData, uint32_t* pCapacity, uint32_t count, size_t itemSize)
+{
+    if (count <= *pCapacity) {
+        return true;
+    }
+    uint32_t capacity = *pCapacity ? *pCapacity : 1024;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    void* pData = realloc(*ppData, itemSize * capacity);
+    if (!pData) {
+        return false;
+    }
+    *ppData = pData;
+    *pCapacity = capacity;
+    return true;
+}
+
+static inline int mental_occlusion_clamp(float value, int maximum)
+{
+    value = fminf(fmaxf(value, -1.0f), (float)maximum + 1.0f);
+    return (int)value;
+}
+
+// Треугольник в пикселях; false — он не покрывает ни одного центра пикселя
+static bool mental_occlusion_setup(MentalOcclusionTriangle* pTriangle, const float* a, const float* b, const float* c)
+{
+    const float* v[3] = { a, b, c };
+    float x[3], y[3], z[3];
+    for (int i = 0; i < 3; i++) {
+        float invW = 1.0f / v[i][3];
+        x[i] = (v[i][0] * invW * 0.5f + 0.5f) * (float)MENTAL_OCCLUSION_WIDTH;
+        y[i] = (v[i][1] * invW * 0.5f + 0.5f) * (float)MENTAL_OCCLUSION_HEIGHT;
+        z[i] = v[i][2] * invW * 0.5f + 0.5f;
+    }
+    if (z[0] > 1.0f && z[1] > 1.0f && z[2] > 1.0f) {
+        return false;
+    }
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (fabsf(area) < 1.0e-6f) {
+        return false;
+    }
+    // Обход против часовой стрелки, чтобы внутри все ребра были неотрицательны
+    if (area < 0.0f) {
+        float t;
+        t = x[1]; x[1] = x[2]; x[2] = t;
+        t = y[1]; y[1] = y[2]; y[2] = t;
+        t = z[1]; z[1] = z[2]; z[2] = t;
+        area = -area;
+    }
+
+    float minX = fminf(x[0], fminf(x[1], x[2])), maxX = fmaxf(x[0], fmaxf(x[1], x[2]));
+    float minY = fminf(y[0], fminf(y[1], y[2])), maxY = fmaxf(y[0], fmaxf(y[1], y[2]));
+    pTriangle->minX = mental_occlusion_clamp(ceilf(minX - 0.5f), MENTAL_OCCLUSION_WIDTH);
+    pTriangle->maxX = mental_occlusion_clamp(floorf(maxX - 0.5f), MENTAL_OCCLUSION_WIDTH);
+    pTriangle->minY = mental_occlusion_clamp(ceilf(minY - 0.5f), MENTAL_OCCLUSION_HEIGHT);
+    pTriangle->maxY = mental_occlusion_clamp(floorf(maxY - 0.5f), MENTAL_OCCLUSION_HEIGHT);
+    pTriangle->minX = pTriangle->minX < 0 ? 0 : pTriangle->minX;
+    pTriangle->minY = pTriangle->minY < 0 ? 0 : pTriangle->minY;
+    pTriangle->maxX = pTriangle->maxX >= MENTAL_OCCLUSION_WIDTH ? MENTAL_OCCLUSION_WIDTH - 1 : pTriangle->maxX;
+    pTriangle->maxY = pTriangle->maxY >= MENTAL_OCCLUSION_HEIGHT ? MENTAL_OCCLUSION_HEIGHT - 1 : pTriangle->maxY;
+    if (pTriangle->minX > pTriangle->maxX || pTriangle->minY > pTriangle->maxY) {
+        return false;
+    }
+
+    // Консервативная растеризация: ребра сдвинуты внутрь на полпикселя по их
+    // нормали, поэтому центр проходит проверку, только если весь пиксель
+    // внутри треугольника. Частично покрытые пиксели на силуэте не пишутся
+    for (int i = 0; i < 3; i++) {
+        int j = (i + 1) % 3;
+        pTriangle->edges[i][0] = y[i] - y[j];
+        pTriangle->edges[i][1] = x[j] - x[i];
+        pTriangle->edges[i][2] = -(pTriangle->edges[i][0] * x[i] + pTriangle->edges[i][1] * y[i]) -
+                                 0.5f * (fabsf(pTriangle->edges[i][0]) + fabsf(pTriangle->edges[i][1]));
+    }
+    float invArea = 1.0f / area;
+    float dz1 = z[1] - z[0], dz2 = z[2] - z[0];
+    pTriangle->depth[0] = (dz1 * (y[2] - y[0]) + dz2 * (y[0] - y[1])) * invArea;
+    pTriangle->depth[1] = (dz1 * (x[0] - x[2]) + dz2 * (x[1] - x[0])) * invArea;
+    // В центре пикселя — самая дальняя глубина плоскости в его пределах, а не глубина центра
+    pTriangle->depth[2] = z[0] - pTriangle->depth[0] * x[0] - pTriangle->depth[1] * y[0] +
+                          0.5f * (fabsf(pTriangle->depth[0]) + fabsf(pTriangle->depth[1]));
+    return true;
+}
+
+void mentalOcclusionAddOccluder(const MentalOccluder* pOccluder, mat4 world)
+{
+    if (s_occlusion.disabled || !pOccluder || pOccluder->indexCount == 0) {
+        return;
+    }
+    if (!mental_occlusion_reserve((void**)&s_occlusion.pClip, &s_occlusion.clipCapacity, pOccluder->vertexCount,
+                                  sizeof(float) * 4)) {
+        MENTAL_DEBUG("Out of memory transforming an occluder of %u vertices.", pOccluder->vertexCount);
+        return;
+    }
+
+    mat4 mvp;
+    glm_mat4_mul(s_occlusion.viewProjection, world, mvp);
+    for (uint32_t i = 0; i < pOccluder->vertexCount; i++) {
+        const float* p = pOccluder->pVertices + i * 3;
+        float* clip = s_occlusion.pClip + i * 4;
+        for (int row = 0; row < 4; row++) {
+            clip[row] = mvp[0][row] * p[0] + mvp[1][row] * p[1] + mvp[2][row] * p[2] + mvp[3][row];
+        }
+    }
+
+    for (uint32_t i = 0; i + 2 < pOccluder->indexCount; i += 3) {
+        uint32_t i0 = pOccluder->pIndices[i], i1 = pOccluder->pIndices[i + 1], i2 = pOccluder->pIndices[i + 2];
+        if (i0 >= pOccluder->vertexCount || i1 >= pOccluder->vertexCount || i2 >= pOccluder->vertexCount) {
+            continue;
+        }
+        const float* a = s_occlusion.pClip + i0 * 4;
+        const float* b = s_occlusion.pClip + i1 * 4;
+        const float* c = s_occlusion.pClip + i2 * 4;
+        if (a[3] < MENTAL_FRAME_NEAR_PLANE || b[3] < MENTAL_FRAME_NEAR_PLANE || c[3] < MENTAL_FRAME_NEAR_PLANE) {
+            continue;
+        }
+        if (s_occlusion.triangleCount >= MENTAL_OCCLUSION_MAX_TRIANGLES) {
+            break;
+        }
+        if (!mental_occlusion_reserve((void**)&s_occlusion.pTriangles, &s_occlusion.triangleCapacity,
+                                      s_occlusion.triangleCount + 1, sizeof(MentalOcclusionTriangle))) {
+            break;
+        }
+        if (mental_occlusion_setup(&s_occlusion.pTriangles[s_occlusion.triangleCount], a, b, c)) {
+            s_occlusion.triangleCount++;
+        }
+    }
+}
+
+#if defined(__SSE2__)
+
+// Строка треугольника от x (кратно четырем) до maxX включительно, по четыре пикселя
+static void mental_occlusion_span(const MentalOcclusionTriangle* pTriangle, float* pRow, int x, int maxX, float py)
+{
+    const __m128 zero = _mm_setzero_ps();
+    __m128 px = _mm_add_ps(_mm_set1_ps((float)x + 0.5f), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+    __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pTriangle->edges[0][0]), px),
+                           _mm_set1_ps(pTriangle->edges[0][1] * py + pTriangle->edges[0][2]));
+    __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pTriangle->edges[1][0]), px),
+                           _mm_set1_ps(pTriangle->edges[1][1] * py + pTriangle->edges[1][2]));
+    __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pTriangle->edges[2][0]), px),
+                           _mm_set1_ps(pTriangle->edges[2][1] * py + pTriangle->edges[2][2]));
+    __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pTriangle->depth[0]), px),
+                          _mm_set1_ps(pTriangle->depth[1] * py + pTriangle->depth[2]));
+    const __m128 step0 = _mm_set1_ps(pTriangle->edges[0][0] * 4.0f);
+    const __m128 step1 = _mm_set1_ps(pTriangle->edges[1][0] * 4.0f);
+    const __m128 step2 = _mm_set1_ps(pTriangle->edges[2][0] * 4.0f);
+    const __m128 stepZ = _mm_set1_ps(pTriangle->depth[0] * 4.0f);
+
+    for (; x <= maxX; x += 4) {
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+        if (_mm_movemask_ps(inside)) {
+            __m128 depth = _mm_loadu_ps(pRow + x);
+            __m128 nearest = _mm_min_ps(depth, z);
+            _mm_storeu_ps(pRow + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, depth)));
+        }
+        e0 = _mm_add_ps(e0, step0);
+        e1 = _mm_add_ps(e1, step1);
+        e2 = _mm_add_ps(e2, step2);
+        z = _mm_add_ps(z, stepZ);
+    }
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+static void mental_occlusion_span(const MentalOcclusionTriangle* pTriangle, float* pRow, int x, int maxX, float py)
+{
+    static const float lanes[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    float32x4_t px = vaddq_f32(vdupq_n_f32((float)x + 0.5f), vld1q_f32(lanes));
+    float32x4_t e0 = vfmaq_n_f32(vdupq_n_f32(pTriangle->edges[0][1] * py + pTriangle->edges[0][2]), px, pTriangle->edges[0][0]);
+    float32x4_t e1 = vfmaq_n_f32(vdupq_n_f32(pTriangle->edges[1][1] * py + pTriangle->edges[1][2]), px, pTriangle->edges[1][0]);
+    float32x4_t e2 = vfmaq_n_f32(vdupq_n_f32(pTriangle->edges[2][1] * py + pTriangle->edges[2][2]), px, pTriangle->edges[2][0]);
+    float32x4_t z = vfmaq_n_f32(vdupq_n_f32(pTriangle->depth[1] * py + pTriangle->depth[2]), px, pTriangle->depth[0]);
+    const float32x4_t step0 = vdupq_n_f32(pTriangle->edges[0][0] * 4.0f);
+    const float32x4_t step1 = vdupq_n_f32(pTriangle->edges[1][0] * 4.0f);
+    const float32x4_t step2 = vdupq_n_f32(pTriangle->edges[2][0] * 4.0f);
+    const float32x4_t stepZ = vdupq_n_f32(pTriangle->depth[0] * 4.0f);
+
+    for (; x <= maxX; x += 4) {
+        uint32x4_t inside = vandq_u32(vandq_u32(vcgezq_f32(e0), vcgezq_f32(e1)), vcgezq_f32(e2));
+        if (vmaxvq_u32(inside)) {
+            float32x4_t depth = vld1q_f32(pRow + x);
+            vst1q_f32(pRow + x, vbslq_f32(inside, vminq_f32(depth, z), depth));
+        }
+        e0 = vaddq_f32(e0, step0);
+        e1 = vaddq_f32(e1, step1);
+        e2 = vaddq_f32(e2, step2);
+        z = vaddq_f32(z, stepZ);
+    }
+}
+
+#else
+
+static void mental_occlusion_span(const MentalOcclusionTriangle* pTriangle, float* pRow, int x, int maxX, float py)
+{
+    for (; x <= maxX; x++) {
+        float px = (float)x + 0.5f;
+        bool inside = true;
+        for (int edge = 0; edge < 3; edge++) {
+            inside = inside && pTriangle->edges[edge][0] * px + pTriangle->edges[edge][1] * py + pTriangle->edges[edge][2] >= 0.0f;
+        }
+        float z = pTriangle->depth[0] * px + pTriangle->depth[1] * py + pTriangle->depth[2];
+        if (inside && z < pRow[x]) {
+            pRow[x] = z;
+        }
+    }
+}
+
+#endif
+
+// Один тайл: очистка, все попавшие в него треугольники и самая дальняя глубина.
+// Пиксели выравниваются на четыре внутри тайла, соседние тайлы не затрагиваются
+static void mental_occlusion_raster_tile(void* pArg, uint32_t tile)
+{
+    (void)pArg;
+    int tileX = (int)(tile % MENTAL_OCCLUSION_TILES_X) * MENTAL_OCCLUSION_TILE_WIDTH;
+    int tileY = (int)(tile / MENTAL_OCCLUSION_TILES_X) * MENTAL_OCCLUSION_TILE_HEIGHT;
+    int lastX = tileX + MENTAL_OCCLUSION_TILE_WIDTH - 1;
+    int lastY = tileY + MENTAL_OCCLUSION_TILE_HEIGHT - 1;
+
+    for (int y = tileY; y <= lastY; y++) {
+        float* pRow = s_occlusion.depth + y * MENTAL_OCCLUSION_WIDTH;
+        for (int x = tileX; x <= lastX; x++) {
+            pRow[x] = 1.0f;
+        }
+    }
+
+    for (uint32_t i = s_occlusion.binStart[tile]; i < s_occlusion.binStart[tile + 1]; i++) {
+        const MentalOcclusionTriangle* pTriangle = &s_occlusion.pTriangles[s_occlusion.pBins[i]];
+        int minX = (pTriangle->minX > tileX ? pTriangle->minX : tileX) & ~3;
+        int maxX = pTriangle->maxX < lastX ? pTriangle->maxX : lastX;
+        int minY = pTriangle->minY > tileY ? pTriangle->minY : tileY;
+        int maxY = pTriangle->maxY < lastY ? pTriangle->maxY : lastY;
+        for (int y = minY; y <= maxY; y++) {
+            mental_occlusion_span(pTriangle, s_occlusion.depth + y * MENTAL_OCCLUSION_WIDTH, minX, maxX, (float)y + 0.5f);
+        }
+    }
+
+    float farthest = 0.0f;
+    for (int y = tileY; y <= lastY; y++) {
+        const float* pRow = s_occlusion.depth + y * MENTAL_OCCLUSION_WIDTH;
+        for (int x = tileX; x <= lastX; x++) {
+            farthest = pRow[x] > farthest ? pRow[x] : farthest;
+        }
+    }
+    s_occlusion.tileMaxDepth[tile] = farthest;
+}
+
+void mentalOcclusionRasterize(void)
+{
+    s_occlusion.ready = false;
+    if (s_occlusion.disabled || s_occlusion.triangleCount == 0) {
+        return;
+    }
+
+    // Раскладка по тайлам в два прохода: подсчет, затем заполнение по смещениям
+    uint32_t counts[MENTAL_OCCLUSION_TILE_COUNT];
+    memset(counts, 0, sizeof(counts));
+    for (uint32_t i = 0; i < s_occlusion.triangleCount; i++) {
+        const MentalOcclusionTriangle* pTriangle = &s_occlusion.pTriangles[i];
+        for (int ty = pTriangle->minY / MENTAL_OCCLUSION_TILE_HEIGHT; ty <= pTriangle->maxY / MENTAL_OCCLUSION_TILE_HEIGHT; ty++) {
+            for (int tx = pTriangle->minX / MENTAL_OCCLUSION_TILE_WIDTH; tx <= pTriangle->maxX / MENTAL_OCCLUSION_TILE_WIDTH; tx++) {
+                counts[ty * MENTAL_OCCLUSION_TILES_X + tx]++;
+            }
+        }
+    }
+    uint32_t total = 0;
+    for (uint32_t tile = 0; tile < MENTAL_OCCLUSION_TILE_COUNT; tile++) {
+        s_occlusion.binStart[tile] = total;
+        total += counts[tile];
+    }
+    s_occlusion.binStart[MENTAL_OCCLUSION_TILE_COUNT] = total;
+    if (!mental_occlusion_reserve((void**)&s_occlusion.pBins, &s_occlusion.binCapacity, total, sizeof(uint32_t))) {
+        MENTAL_DEBUG("Out of memory binning %u occluder triangles.", s_occlusion.triangleCount);
+        return;
+    }
+
+    memcpy(counts, s_occlusion.binStart, sizeof(counts));
+    for (uint32_t i = 0; i < s_occlusion.triangleCount; i++) {
+        const MentalOcclusionTriangle* pTriangle = &s_occlusion.pTriangles[i];
+        for (int ty = pTriangle->minY / MENTAL_OCCLUSION_TILE_HEIGHT; ty <= pTriangle->maxY / MENTAL_OCCLUSION_TILE_HEIGHT; ty++) {
+            for (int tx = pTriangle->minX / MENTAL_OCCLUSION_TILE_WIDTH; tx <= pTriangle->maxX / MENTAL_OCCLUSION_TILE_WIDTH; tx++) {
+                s_occlusion.pBins[counts[ty * MENTAL_OCCLUSION_TILES_X + tx]++] = i;
+            }
+        }
+    }
+
+    mentalJobsParallelFor(MENTAL_OCCLUSION_TILE_COUNT, mental_occlusion_raster_tile, NULL);
+    s_occlusion.stats.frameTriangles = s_occlusion.triangleCount;
+    s_occlusion.stats.frameBinned = total;
+    s_occlusion.ready = true;
+}
+
+bool mentalOcclusionTestBounds(const MentalBounds* pBounds)
+{
+    if (!mentalOcclusionCullingActive() || !pBounds || !pBounds->valid) {
+        return true;
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        if (pBounds->extents[axis] >= MENTAL_BOUNDS_INFINITE) {
+            return true;
+        }
+    }
+    s_occlusion.stats.frameTested++;
+    s_occlusion.stats.totalTested++;
+
+    // Экранный прямоугольник и ближайшая глубина по восьми углам AABB
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX;
+    for (int corner = 0; corner < 8; corner++) {
+        float p[3];
+        for (int axis = 0; axis < 3; axis++) {
+            p[axis] = pBounds->center[axis] + ((corner >> axis) & 1 ? pBounds->extents[axis] : -pBounds->extents[axis]);
+        }
+        float clip[4];
+        for (int row = 0; row < 4; row++) {
+            clip[row] = s_occlusion.viewProjection[0][row] * p[0] + s_occlusion.viewProjection[1][row] * p[1] +
+                        s_occlusion.viewProjection[2][row] * p[2] + s_occlusion.viewProjection[3][row];
+        }
+        // Объект задевает ближнюю плоскость — камера внутри или рядом
+        if (clip[3] < MENTAL_FRAME_NEAR_PLANE) {
+            return true;
+        }
+        float invW = 1.0f / clip[3];
+        float x = (clip[0] * invW * 0.5f + 0.5f) * (float)MENTAL_OCCLUSION_WIDTH;
+        float y = (clip[1] * invW * 0.5f + 0.5f) * (float)MENTAL_OCCLUSION_HEIGHT;
+        minX = fminf(minX, x);
+        maxX = fmaxf(maxX, x);
+        minY = fminf(minY, y);
+        maxY = fmaxf(maxY, y);
+        minZ = fminf(minZ, clip[2] * invW * 0.5f + 0.5f);
+    }
+
+    // Все пиксели, которые задевает прямоугольник, а не только их центры
+    int x0 = mental_occlusion_clamp(floorf(minX), MENTAL_OCCLUSION_WIDTH);
+    int x1 = mental_occlusion_clamp(floorf(maxX), MENTAL_OCCLUSION_WIDTH);
+    int y0 = mental_occlusion_clamp(floorf(minY), MENTAL_OCCLUSION_HEIGHT);
+    int y1 = mental_occlusion_clamp(floorf(maxY), MENTAL_OCCLUSION_HEIGHT);
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 >= MENTAL_OCCLUSION_WIDTH ? MENTAL_OCCLUSION_WIDTH - 1 : x1;
+    y1 = y1 >= MENTAL_OCCLUSION_HEIGHT ? MENTAL_OCCLUSION_HEIGHT - 1 : y1;
+    if (x0 > x1 || y0 > y1) {
+        return true;
+    }
+
+    for (int ty = y0 / MENTAL_OCCLUSION_TILE_HEIGHT; ty <= y1 / MENTAL_OCCLUSION_TILE_HEIGHT; ty++) {
+        for (int tx = x0 / MENTAL_OCCLUSION_TILE_WIDTH; tx <= x1 / MENTAL_OCCLUSION_TILE_WIDTH; tx++) {
+            // Весь тайл ближе объекта — пиксели можно не смотреть
+            if (s_occlusion.tileMaxDepth[ty * MENTAL_OCCLUSION_TILES_X + tx] < minZ) {
+                continue;
+            }
+            int startX = x0 > tx * MENTAL_OCCLUSION_TILE_WIDTH ? x0 : tx * MENTAL_OCCLUSION_TILE_WIDTH;
+            int endX = x1 < (tx + 1) * MENTAL_OCCLUSION_TILE_WIDTH - 1 ? x1 : (tx + 1) * MENTAL_OCCLUSION_TILE_WIDTH - 1;
+            int startY = y0 > ty * MENTAL_OCCLUSION_TILE_HEIGHT ? y0 : ty * MENTAL_OCCLUSION_TILE_HEIGHT;
+            int endY = y1 < (ty + 1) * MENTAL_OCCLUSION_TILE_HEIGHT - 1 ? y1 : (ty + 1) * MENTAL_OCCLUSION_TILE_HEIGHT - 1;
+            for (int y = startY; y <= endY; y++) {
+                const float* pRow = s_occlusion.depth + y * MENTAL_OCCLUSION_WIDTH;
+                for (int x = startX; x <= endX; x++) {
+                    if (pRow[x] >= minZ) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    s_occlusion.stats.frameOccluded++;
+    s_occlusion.stats.totalOccluded++;
+    return false;
+}
+
+void mentalOcclusionGetStats(MentalOcclusionStats* pStats)
+{
+    if (pStats) {
+        *pStats = s_occlusion.stats;
+    }
+}
+
+void mentalOcclusionShutdown(void)
+{
+    MENTAL_DEBUG("Occlusion culling: %llu of %llu tested objects occluded, %u occluder triangles in the last frame",
+                 (unsigned long long)s_occlusion.stats.totalOccluded, (unsigned long long)s_occlusion.stats.totalTested,
+                 s_occlusion.stats.frameTriangles);
+    free(s_occlusion.pTriangles);
+    free(s_occlusion.pClip);
+    free(s_occlusion.pBins);
+    memset(&s_occlusion, 0, sizeof(s_occlusion));
+}
@@ -0,0 +1,72 @@
+#ifndef mental_occlusion_h
+#define mental_occlusion_h
+
+#include "mental.h"
+#include "culling.h"
+#include <cglm/cglm.h>
+
+// Программное отсечение перекрытых объектов на CPU. Несколько крупных
+// загораживающих сеток (рельеф земли, большие модели) каждый кадр
+// растеризуются в буфер глубины низкого разрешения; очередь отрисовки
+// после отсечения по пирамиде видимости проверяет экранный прямоугольник
+// каждого элемента и выбрасывает те, что целиком лежат за уже нарисованной
+// глубиной.
+//
+// Буфер разбит на тайлы: треугольники раскладываются по тайлам, которые
+// задевает их прямоугольник, и тайлы растеризуются параллельно на пуле
+// задач (jobs.h) по четыре пикселя за раз (SSE / NEON). Для каждого тайла
+// хранится самая дальняя его глубина — верхний уровень иерархии: тайл, целиком
+// ближе объекта, закрывает его без просмотра пикселей.
+//
+// Растеризация консервативная: пишутся только пиксели, целиком покрытые
+// треугольником, с самой дальней глубиной плоскости в их пределах. Треугольники,
+// задевающие ближнюю плоскость, отбрасываются целиком: это только уменьшает
+// перекрытие и не прячет видимое.
+
+#define MENTAL_OCCLUSION_WIDTH          256
+#define MENTAL_OCCLUSION_HEIGHT         128
+#define MENTAL_OCCLUSION_TILE_WIDTH     32      // Кратно четырем
+#define MENTAL_OCCLUSION_TILE_HEIGHT    16
+#define MENTAL_OCCLUSION_TILES_X        (MENTAL_OCCLUSION_WIDTH / MENTAL_OCCLUSION_TILE_WIDTH)
+#define MENTAL_OCCLUSION_TILES_Y        (MENTAL_OCCLUSION_HEIGHT / MENTAL_OCCLUSION_TILE_HEIGHT)
+#define MENTAL_OCCLUSION_MAX_TRIANGLES  (64u * 1024u)   // Загораживающих треугольников за кадр
+
+// Копия сетки на CPU для растеризации: позиции xyz в пространстве модели
+typedef struct MentalOccluder {
+    float*      pVertices;
+    uint32_t    vertexCount;
+    uint32_t*   pIndices;
+    uint32_t    indexCount;
+} MentalOccluder;
+
+typedef struct MentalOcclusionStats {
+    uint32_t   frameTriangles;     // Загораживающих треугольников за последний кадр
+    uint32_t   frameBinned;        // Их попаданий в тайлы
+    uint32_t   frameTested;        // Проверенных объектов
+    uint32_t   frameOccluded;      // Из них перекрытых
+    uint64_t   totalTested;
+    uint64_t   totalOccluded;
+} MentalOcclusionStats;
+
+// Копирует вершины и индексы; MENTAL_ERROR_OUT_OF_MEMORY — не хватило памяти
+MentalResult mentalCreateOccluder(MentalOccluder* pOccluder, const float* pVertices, uint32_t vertexCount,
+                                  const uint32_t* pIndices, uint32_t indexCount);
+void         mentalDestroyOccluder(MentalOccluder* pOccluder);
+
+// По умолчанию включено; действует в кадре, для которого вызван mentalOcclusionRasterize
+void         mentalSetOcclusionCulling(bool enabled);
+bool         mentalOcclusionCullingActive(void);
+
+// Кадр: BeginFrame, AddOccluder на каждую загораживающую сетку, Rasterize, затем проверки
+void         mentalOcclusionBeginFrame(mat4 viewProjection);
+void         mentalOcclusionAddOccluder(const MentalOccluder* pOccluder, mat4 world);
+void         mentalOcclusionRasterize(void);
+// false — мировые границы целиком за загораживающими сетками. Невалидные и
+// бесконечные границы, а также все объекты до Rasterize считаются видимыми
+bool         mentalOcclusionTestBounds(const MentalBounds* pBounds);
+
+void         mentalOcclusionGetStats(MentalOcclusionStats* pStats);
+// Сводка в лог и освобождение буферов
+void         mentalOcclusionShutdown(void);
+
+#endif // mental_occlusion_h
@@ -0,0 +1,528 @@
+#include "renderqueue.h"
+#include "wm.h"
+#include "vtex.h"
+#include "glstate.h"
+#include "gpucull.h"
+#include "occlusion.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+MentalResult mentalCreateRenderQueue(MentalRenderQueue* pQueue)
+{
+    if (!pQueue) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    memset(pQueue, 0, sizeof(*pQueue));
+    pQueue->pItems = malloc(sizeof(MentalDrawItem) * MENTAL_RENDER_QUEUE_INITIAL_CAPACITY);
+    pQueue->pScratch = malloc(sizeof(MentalDrawItem) * MENTAL_RENDER_QUEUE_INITIAL_CAPACITY);
+    pQueue->pVisible = malloc(MENTAL_RENDER_QUEUE_INITIAL_CAPACITY);
+    pQueue->ppBatch = malloc(sizeof(MentalComponent*) * MENTAL_RENDER_QUEUE_INITIAL_CAPACITY);
+    pQueue->pPrepassed = malloc(MENTAL_RENDER_QUEUE_INITIAL_CAPACITY);
+    if (!pQueue->pItems || !pQueue->pScratch || !pQueue->pVisible || !pQueue->ppBatch || !pQueue->pPrepassed ||
+        mentalBoundsSoAReserve(&pQueue->bounds, MENTAL_RENDER_QUEUE_INITIAL_CAPACITY) != MENTAL_OK) {
+        mentalDestroyRenderQueue(pQueue);
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+    pQueue->capacity = MENTAL_RENDER_QUEUE_INITIAL_CAPACITY;
+    pQueue->cullingEnabled = true;
+    return MENTAL_OK;
+}
+
+void mentalDestroyRenderQueue(MentalRenderQueue* pQueue)
+{
+    if (!pQueue) {
+        return;
+    }
+    free(pQueue->pItems);
+    free(pQueue->pScratch);
+    free(pQueue->pVisible);
+    free(pQueue->ppBatch);
+    free(pQueue->pPrepassed);
+    mentalBoundsSoAFree(&pQueue->bounds);
+    memset(pQueue, 0, sizeof(*pQueue));
+}
+
+void mentalRenderQueueBegin(MentalRenderQueue* pQueue)
+{
+    if (pQueue) {
+        pQueue->count = 0;
+    }
+}
+
+uint64_t mentalRenderKey(MentalRenderPass ePass, uint32_t program, uint32_t material, uint32_t vao, float depth)
+{
+    const uint64_t idMask = (1ull << MENTAL_RENDER_KEY_ID_BITS) - 1;
+    const uint64_t depthMax = (1ull << MENTAL_RENDER_KEY_DEPTH_BITS) - 1;
+
+    // Глубина нормируется на дальнюю плоскость; ID GL обычно малы, старшие биты
+    // отбрасываются — совпадение ключей влияет только на группировку, не на результат
+    float normalized = depth / MENTAL_FRAME_FAR_PLANE;
+    normalized = normalized < 0.0f ? 0.0f : (normalized > 1.0f ? 1.0f : normalized);
+    uint64_t quantized = (uint64_t)(normalized * (float)depthMax);
+
+    uint64_t state = ((uint64_t)program & idMask) << (MENTAL_RENDER_KEY_ID_BITS * 2)
+                   | ((uint64_t)material & idMask) << MENTAL_RENDER_KEY_ID_BITS
+                   | ((uint64_t)vao & idMask);
+    uint64_t key = (uint64_t)ePass << 62;
+    if (ePass == MENTAL_RENDER_PASS_TRANSPARENT) {
+        key |= (depthMax - quantized) << 38;
+        key |= state << 2;
+    } else {
+        key |= state << 26;
+        key |= quantized << 2;
+    }
+    return key;
+}
+
+static MentalResult mental_rq_reserve(MentalRenderQueue* pQueue, uint32_t capacity)
+{
+    if (capacity <= pQueue->capacity) {
+        return MENTAL_OK;
+    }
+    uint32_t newCapacity = pQueue->capacity ? pQueue->capacity * 2 : MENTAL_RENDER_QUEUE_INITIAL_CAPACITY;
+    while (newCapacity < capacity) {
+        newCapacity *= 2;
+    }
+    MentalDrawItem* pItems = realloc(pQueue->pItems, sizeof(MentalDrawItem) * newCapacity);
+    if (!pItems) {
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+    pQueue->pItems = pItems;
+    MentalDrawItem* pScratch = realloc(pQueue->pScratch, sizeof(MentalDrawItem) * newCapacity);
+    if (!pScratch) {
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+    pQueue->pScratch = pScratch;
+    uint8_t* pVisible = realloc(pQueue->pVisible, newCapacity);
+    if (!pVisible) {
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+    pQueue->pVisible = pVisible;
+    MentalComponent** ppBatch = realloc(pQueue->ppBatch, sizeof(MentalComponent*) * newCapacity);
+    if (!ppBatch) {
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+    pQueue->ppBatch = ppBatch;
+    uint8_t* pPrepassed = realloc(pQueue->pPrepassed, newCapacity);
+    if (!pPrepassed) {
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+    pQueue->pPrepassed = pPrepassed;
+    if (mentalBoundsSoAReserve(&pQueue->bounds, newCapacity) != MENTAL_OK) {
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+    pQueue->capacity = newCapacity;
+    return MENTAL_OK;
+}
+
+MentalResult mentalRenderQueueSubmit(MentalRenderQueue* pQueue, uint64_t key, MentalDrawFunc pfnDraw, void* pObject,
+                                     const MentalBounds* pBounds)
+{
+    if (!pQueue || !pfnDraw) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    MentalResult result = mental_rq_reserve(pQueue, pQueue->count + 1);
+    if (result != MENTAL_OK) {
+        return result;
+    }
+    mentalBoundsSoASet(&pQueue->bounds, pQueue->count, pBounds);
+    MentalDrawItem* pItem = &pQueue->pItems[pQueue->count++];
+    pItem->key = key;
+    pItem->pfnDraw = pfnDraw;
+    pItem->pObject = pObject;
+    return MENTAL_OK;
+}
+
+// Обертки приводят функции отрисовки к общей сигнатуре
+static MentalResult mental_rq_draw_component(void* pObject, MentalWindowManager* pManager)
+{
+    return mentalDrawComponent(pObject, pManager);
+}
+
+static MentalResult mental_rq_draw_ground(void* pObject, MentalWindowManager* pManager)
+{
+    return mentalDrawGroundComponent(pObject, pManager);
+}
+
+static MentalResult mental_rq_draw_clouds(void* pObject, MentalWindowManager* pManager)
+{
+    return mentalDrawCloudComponent(pObject, pManager);
+}
+
+static MentalResult mental_rq_draw_model(void* pObject, MentalWindowManager* pManager)
+{
+    return mentalDrawModel3DComponent(pObject, pManager);
+}
+
+static MentalResult mental_rq_draw_skybox(void* pObject, MentalWindowManager* pManager)
+{
+    return mentalDrawSkybox(pObject, pManager);
+}
+
+void mentalComponentWorldBounds(MentalComponent* pComponent, MentalBounds* pWorld)
+{
+    // Мировая матрица и границы кэшируются: неподвижный компонент только сравнивает версии
+    vec4* world = mentalTransformWorld(&pComponent->transform);
+    if (pComponent->worldBoundsVersion == pComponent->transform.version) {
+        *pWorld = pComponent->worldBounds;
+        return;
+    }
+
+    const MentalBounds* pLocal = &pComponent->bounds;
+    const Model3DData* pModelData = pComponent->modelData;
+    if (pComponent->eType == MENTAL_COMPONENT_TYPE_MODEL3D && pModelData && pModelData->instanceCount > 0) {
+        pLocal = &pModelData->instanceBounds;
+    }
+    mentalBoundsTransform(pLocal, world, &pComponent->worldBounds);
+
+    // Смещение по карте высот (в вершинном шейдере или при тесселяции) выходит за сетку
+    if (pComponent->eType == MENTAL_COMPONENT_TYPE_MODEL3D && pModelData && pModelData->hasHeightMap) {
+        float scale = mentalTransformWorldScale(&pComponent->transform);
+        mentalBoundsInflate(&pComponent->worldBounds, fabsf(pModelData->material.heightScale) * fmaxf(scale, 1.0f));
+    }
+    pComponent->worldBoundsVersion = pComponent->transform.version;
+    *pWorld = pComponent->worldBounds;
+}
+
+MentalResult mentalSubmitComponent(MentalRenderQueue* pQueue, MentalWindowManager* pManager, MentalComponent* pComponent)
+{
+    if (!pQueue || !pManager || !pComponent) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    // Глубина — расстояние вдоль направления взгляда
+    vec3 position, toComponent;
+    mentalTransformWorldPosition(&pComponent->transform, position);
+    glm_vec3_sub(position, pManager->camera.position, toComponent);
+    float depth = glm_vec3_dot(toComponent, pManager->camera.front);
+
+    MentalRenderPass ePass = MENTAL_RENDER_PASS_OPAQUE;
+    MentalDrawFunc pfnDraw = mental_rq_draw_component;
+    uint32_t material = 0;
+    switch (pComponent->eType) {
+        case MENTAL_COMPONENT_TYPE_GROUND:
+            pfnDraw = mental_rq_draw_ground;
+            material = pComponent->pVirtualTexture ? pComponent->pVirtualTexture->physicalTexture : 0;
+            break;
+        case MENTAL_COMPONENT_TYPE_CLOUDS:
+            ePass = MENTAL_RENDER_PASS_TRANSPARENT;
+            pfnDraw = mental_rq_draw_clouds;
+            break;
+        case MENTAL_COMPONENT_TYPE_MODEL3D:
+            pfnDraw = mental_rq_draw_model;
+            if (pComponent->modelData) {
+                material = pComponent->modelData->hasAtlasAlbedo ? pComponent->modelData->albedoSlot.texture
+                                                                 : pComponent->modelData->texture;
+            }
+            break;
+        default:
+            break;
+    }
+
+    // Модели одной страницы пула группируются по ее VAO и могут уйти одним пакетом
+    uint32_t vao = pComponent->VAO;
+    if (pComponent->eType == MENTAL_COMPONENT_TYPE_MODEL3D && pComponent->modelData &&
+        pComponent->modelData->geometry.valid) {
+        vao = mentalGeometryPageVAO(pComponent->modelData->geometry.page);
+    }
+
+    // Модели, которые отсечет compute шейдер, CPU не проверяет
+    uint64_t key = mentalRenderKey(ePass, pComponent->shaderProgram, material, vao, depth);
+    if (mentalModelBatchable(pComponent) && mentalGpuCullingActive()) {
+        return mentalRenderQueueSubmit(pQueue, key, pfnDraw, pComponent, NULL);
+    }
+
+    MentalBounds worldBounds;
+    mentalComponentWorldBounds(pComponent, &worldBounds);
+    return mentalRenderQueueSubmit(pQueue, key, pfnDraw, pComponent, &worldBounds);
+}
+
+MentalResult mentalSubmitSkybox(MentalRenderQueue* pQueue, MentalSkybox* pSkybox)
+{
+    if (!pQueue || !pSkybox) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    uint64_t key = mentalRenderKey(MENTAL_RENDER_PASS_SKY, pSkybox->shaderProgram, pSkybox->cubemapTexture,
+                                   pSkybox->VAO, MENTAL_FRAME_FAR_PLANE);
+    return mentalRenderQueueSubmit(pQueue, key, mental_rq_draw_skybox, pSkybox, NULL);
+}
+
+// Пакетная проверка границ; видимые элементы сдвигаются к началу очереди
+static void mental_rq_cull(MentalRenderQueue* pQueue, const MentalFrustum* pFrustum)
+{
+    uint32_t count = pQueue->count;
+    if (!pQueue->cullingEnabled || count == 0) {
+        pQueue->stats.visibleCount = count;
+        pQueue->stats.culledCount = 0;
+        pQueue->stats.occludedCount = 0;
+        return;
+    }
+
+    uint32_t visible = mentalFrustumCull(pFrustum, &pQueue->bounds, count, pQueue->pVisible);
+
+    // Перекрытие проверяется только у попавших в пирамиду; границы берутся из SoA
+    uint32_t occluded = 0;
+    if (mentalOcclusionCullingActive()) {
+        float* const* lanes = pQueue->bounds.lanes;
+        for (uint32_t i = 0; i < count; i++) {
+            if (!pQueue->pVisible[i]) {
+                continue;
+            }
+            MentalBounds bounds = {
+                .center = { lanes[MENTAL_BOUNDS_LANE_CENTER_X][i], lanes[MENTAL_BOUNDS_LANE_CENTER_Y][i],
+                            lanes[MENTAL_BOUNDS_LANE_CENTER_Z][i] },
+                .radius = lanes[MENTAL_BOUNDS_LANE_RADIUS][i],
+                .extents = { lanes[MENTAL_BOUNDS_LANE_EXTENT_X][i], lanes[MENTAL_BOUNDS_LANE_EXTENT_Y][i],
+                             lanes[MENTAL_BOUNDS_LANE_EXTENT_Z][i] },
+                .valid = true,
+            };
+            if (!mentalOcclusionTestBounds(&bounds)) {
+                pQueue->pVisible[i] = 0;
+                occluded++;
+            }
+        }
+        visible -= occluded;
+    }
+
+    if (visible < count) {
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (pQueue->pVisible[i]) {
+                pQueue->pItems[kept++] = pQueue->pItems[i];
+            }
+        }
+        pQueue->count = kept;
+    }
+    pQueue->stats.visibleCount = visible;
+    pQueue->stats.culledCount = count - visible;
+    pQueue->stats.totalCulled += count - visible;
+    pQueue->stats.occludedCount = occluded;
+    pQueue->stats.totalOccluded += occluded;
+}
+
+// Поразрядная сортировка LSD по байтам ключа. Гистограммы всех восьми разрядов
+// строятся за один проход; разряд, одинаковый у всех элементов, пропускается
+static void mental_rq_sort(MentalRenderQueue* pQueue)
+{
+    uint32_t count = pQueue->count;
+    pQueue->stats.sortPasses = 0;
+    if (count < 2) {
+        return;
+    }
+
+    uint32_t histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t key = pQueue->pItems[i].key;
+        for (int digit = 0; digit < 8; digit++) {
+            histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+        }
+    }
+
+    MentalDrawItem* pSource = pQueue->pItems;
+    MentalDrawItem* pTarget = pQueue->pScratch;
+    for (int digit = 0; digit < 8; digit++) {
+        uint32_t* histogram = histograms[digit];
+        uint32_t first = (uint32_t)((pSource[0].key >> (digit * 8)) & 0xFF);
+        if (histogram[first] == count) {
+            continue;
+        }
+
+        uint32_t offsets[256];
+        uint32_t sum = 0;
+        for (int bucket = 0; bucket < 256; bucket++) {
+            offsets[bucket] = sum;
+            sum += histogram[bucket];
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t bucket = (uint32_t)((pSource[i].key >> (digit * 8)) & 0xFF);
+            pTarget[offsets[bucket]++] = pSource[i];
+        }
+
+        MentalDrawItem* pSwap = pSource;
+        pSource = pTarget;
+        pTarget = pSwap;
+        pQueue->stats.sortPasses++;
+    }
+
+    // Результат должен оказаться в pItems
+    if (pSource != pQueue->pItems) {
+        pQueue->pScratch = pQueue->pItems;
+        pQueue->pItems = pSource;
+    }
+}
+
+// Серия подряд идущих совместимых моделей из пула, начиная с first; 0 — первый
+// элемент в пакет не годится
+static uint32_t mental_rq_gather_batch(MentalRenderQueue* pQueue, uint32_t first)
+{
+    MentalDrawItem* pFirst = &pQueue->pItems[first];
+    if (pFirst->pfnDraw != mental_rq_draw_model || !mentalModelBatchable(pFirst->pObject)) {
+        return 0;
+    }
+    uint32_t count = 1;
+    pQueue->ppBatch[0] = pFirst->pObject;
+    while (first + count < pQueue->count) {
+        MentalDrawItem* pNext = &pQueue->pItems[first + count];
+        if (pNext->pfnDraw != mental_rq_draw_model || !mentalModelBatchCompatible(pFirst->pObject, pNext->pObject)) {
+            break;
+        }
+        pQueue->ppBatch[count++] = pNext->pObject;
+    }
+    return count;
+}
+
+// Состояние, общее для всего прохода, выставляется один раз на его границе
+static void mental_rq_begin_pass(MentalRenderPass ePass)
+{
+    // После предварительного прохода непрозрачные могли оставить GL_EQUAL
+    mentalGLDepthFunc(GL_LESS);
+    switch (ePass) {
+        case MENTAL_RENDER_PASS_TRANSPARENT:
+            // Прозрачные не пишут глубину: отсортированы сзади вперед и не должны закрывать друг друга
+            mentalGLDepthMask(GL_FALSE);
+            break;
+        default:
+            mentalGLDepthMask(GL_TRUE);
+            break;
+    }
+}
+
+// Должен ли пакет рисоваться через mentalDrawModel3DBatch; одинаково в обоих проходах
+static bool mental_rq_batch_worthwhile(uint32_t batch, bool gpuCulling)
+{
+    // Пакет из одной модели не дешевле обычной отрисовки, если его не отсекает GPU
+    return batch > 1 || (batch == 1 && gpuCulling);
+}
+
+// Только глубина непрозрачных элементов, без записи цвета. Серии моделей идут
+// теми же пакетами, что и в основном проходе: если пакет глубины не готов,
+// ни одна модель серии не отмечается и основной проход рисует их как обычно
+#define MENTAL_RQ_PREPASSED         1
+#define MENTAL_RQ_PREPASSED_BATCH   2
+
+static void mental_rq_depth_prepass(MentalRenderQueue* pQueue, MentalWindowManager* pManager, bool gpuCulling)
+{
+    memset(pQueue->pPrepassed, 0, pQueue->count);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    mentalGLDepthFunc(GL_LESS);
+    mentalGLDepthMask(GL_TRUE);
+
+    // Непрозрачные после сортировки идут первыми. Пакеты сохраняются в ячейках пула
+    // по порядку, и основной проход, встречая их в том же порядке, рисует их оттуда
+    uint32_t slot = 0;
+    for (uint32_t i = 0; i < pQueue->count; i++) {
+        if ((MentalRenderPass)(pQueue->pItems[i].key >> 62) != MENTAL_RENDER_PASS_OPAQUE) {
+            break;
+        }
+        uint32_t batch = mental_rq_gather_batch(pQueue, i);
+        if (mental_rq_batch_worthwhile(batch, gpuCulling)) {
+            if (mentalDrawModel3DBatchDepth(pQueue->ppBatch, batch, pManager, slot) == MENTAL_OK) {
+                memset(pQueue->pPrepassed + i, MENTAL_RQ_PREPASSED_BATCH, batch);
+                pQueue->stats.prepassCount += batch;
+                slot++;
+            }
+            i += batch - 1;
+            continue;
+        }
+
+        batch = batch ? batch : 1;
+        for (uint32_t j = i; j < i + batch; j++) {
+            MentalDrawItem* pItem = &pQueue->pItems[j];
+            if (pItem->pfnDraw == mental_rq_draw_model && mentalDrawModel3DDepth(pItem->pObject, pManager) == MENTAL_OK) {
+                pQueue->pPrepassed[j] = MENTAL_RQ_PREPASSED;
+                pQueue->stats.prepassCount++;
+            }
+        }
+        i += batch - 1;
+    }
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+// Элемент с записанной глубиной проходит тест только там, где он ближайший
+static void mental_rq_prepass_state(const MentalRenderQueue* pQueue, uint32_t index)
+{
+    bool prepassed = pQueue->pPrepassed[index] != 0;
+    mentalGLDepthFunc(prepassed ? GL_EQUAL : GL_LESS);
+    mentalGLDepthMask(prepassed ? GL_FALSE : GL_TRUE);
+}
+
+MentalResult mentalRenderQueueFlush(MentalRenderQueue* pQueue, MentalWindowManager* pManager)
+{
+    if (!pQueue || !pManager) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    mental_rq_cull(pQueue, &pManager->frame.frustum);
+    mental_rq_sort(pQueue);
+
+    const uint64_t programMask = ((1ull << MENTAL_RENDER_KEY_ID_BITS) - 1);
+    MentalRenderPass eCurrentPass = MENTAL_RENDER_PASS_COUNT;
+    uint64_t lastProgram = UINT64_MAX;
+    pQueue->stats.itemCount = pQueue->count;
+    pQueue->stats.programChanges = 0;
+    pQueue->stats.failedDraws = 0;
+    pQueue->stats.indirectBatches = 0;
+    pQueue->stats.batchedCount = 0;
+    pQueue->stats.prepassCount = 0;
+    bool gpuCulling = mentalGpuCullingActive();
+    bool prepass = pQueue->depthPrepass;
+    uint32_t slot = 0;
+    if (prepass) {
+        mental_rq_depth_prepass(pQueue, pManager, gpuCulling);
+    }
+
+    for (uint32_t i = 0; i < pQueue->count; i++) {
+        MentalDrawItem* pItem = &pQueue->pItems[i];
+        MentalRenderPass ePass = (MentalRenderPass)(pItem->key >> 62);
+        if (ePass != eCurrentPass) {
+            mental_rq_begin_pass(ePass);
+            eCurrentPass = ePass;
+        }
+
+        uint64_t program = ePass == MENTAL_RENDER_PASS_TRANSPARENT ? (pItem->key >> 26) & programMask
+                                                                   : (pItem->key >> 50) & programMask;
+        if (program != lastProgram) {
+            pQueue->stats.programChanges++;
+            lastProgram = program;
+        }
+
+        // Серия в пакет не годится или вариант не готов — серия по одной
+        bool opaquePrepass = prepass && ePass == MENTAL_RENDER_PASS_OPAQUE;
+        uint32_t batch = ePass == MENTAL_RENDER_PASS_OPAQUE ? mental_rq_gather_batch(pQueue, i) : 0;
+        if (opaquePrepass) {
+            mental_rq_prepass_state(pQueue, i);
+        }
+        // Пакет из прохода глубины рисуется из своей ячейки: второго отсечения на GPU нет
+        bool retained = opaquePrepass && pQueue->pPrepassed[i] == MENTAL_RQ_PREPASSED_BATCH;
+        MentalResult batchResult = MENTAL_ERROR;
+        if (mental_rq_batch_worthwhile(batch, gpuCulling)) {
+            batchResult = retained ? mentalDrawModel3DBatchPrepassed(pQueue->ppBatch, batch, pManager, slot++)
+                                   : mentalDrawModel3DBatch(pQueue->ppBatch, batch, pManager);
+        }
+        if (batchResult == MENTAL_OK) {
+            pQueue->stats.indirectBatches++;
+            pQueue->stats.batchedCount += batch;
+            i += batch - 1;
+            continue;
+        }
+
+        batch = batch ? batch : 1;
+        for (uint32_t j = i; j < i + batch; j++) {
+            if (opaquePrepass) {
+                mental_rq_prepass_state(pQueue, j);
+            }
+            if (pQueue->pItems[j].pfnDraw(pQueue->pItems[j].pObject, pManager) != MENTAL_OK) {
+                pQueue->stats.failedDraws++;
+            }
+        }
+        i += batch - 1;
+    }
+
+    if (eCurrentPass == MENTAL_RENDER_PASS_TRANSPARENT || prepass) {
+        mentalGLDepthFunc(GL_LESS);
+        mentalGLDepthMask(GL_TRUE);
+    }
+    return pQueue->stats.failedDraws ? MENTAL_ERROR : MENTAL_OK;
+}
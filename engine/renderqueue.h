@@ -0,0 +1,107 @@
+#ifndef mental_renderqueue_h
+#define mental_renderqueue_h
+
+#include "mental.h"
+#include "component.h"
+
+// Очередь отрисовки кадра. Компоненты не рисуются сразу, а кладут в очередь
+// элемент с 64-битным ключом сортировки; в конце кадра очередь сортируется
+// поразрядно и выполняется подряд, так что элементы с одной программой,
+// текстурой и VAO идут друг за другом.
+//
+// Раскладка ключа (старшие биты сортируются первыми):
+//   непрозрачные и небо: | проход 2 | программа 12 | материал 12 | VAO 12 | глубина 24 | 2 |
+//   прозрачные:          | проход 2 | обратная глубина 24 | программа 12 | материал 12 | VAO 12 | 2 |
+// Непрозрачные рисуются спереди назад внутри одинакового состояния, небо —
+// после них (отсекается тестом глубины на дальней плоскости), прозрачные —
+// строго сзади вперед.
+//
+// Вместе с элементом очередь хранит его мировые границы (SoA). Перед
+// сортировкой все элементы кадра проверяются пакетом против пирамиды
+// видимости (culling.h); невидимые выбрасываются до загрузки юниформов.
+// Прошедшие пирамиду затем проверяются по буферу глубины загораживающих
+// сеток (occlusion.h), если он растеризован в этом кадре.
+//
+// Модели из пула геометрии (geompool.h) получают в ключ VAO страницы, поэтому
+// совместимые модели оказываются рядом; такая серия рисуется одним
+// glMultiDrawElementsIndirect через mentalDrawModel3DBatch. Если работает
+// отсечение на GPU (gpucull.h), такие модели кладутся без границ и CPU их не
+// проверяет, а пакетом рисуется даже одиночная модель.
+//
+// С depthPrepass непрозрачные PBR модели сначала рисуются только в буфер
+// глубины (вариант DEPTH_ONLY, теми же пакетами), а затем основным проходом с
+// GL_EQUAL и без записи глубины: дорогой фрагментный шейдер выполняется один
+// раз на видимый пиксель. Пакеты основного прохода берут экземпляры и команды,
+// уже отсеченные на GPU в проходе глубины. Модели, чей вариант глубины еще не готов, и прочие
+// компоненты рисуются как обычно, с GL_LESS.
+
+#define MENTAL_RENDER_QUEUE_INITIAL_CAPACITY    64
+#define MENTAL_RENDER_KEY_ID_BITS               12
+#define MENTAL_RENDER_KEY_DEPTH_BITS            24
+
+typedef enum MentalRenderPass {
+    MENTAL_RENDER_PASS_OPAQUE = 0,
+    MENTAL_RENDER_PASS_SKY,
+    MENTAL_RENDER_PASS_TRANSPARENT,
+    MENTAL_RENDER_PASS_COUNT
+} MentalRenderPass;
+
+typedef MentalResult (*MentalDrawFunc)(void* pObject, MentalWindowManager* pManager);
+
+typedef struct MentalDrawItem {
+    uint64_t        key;
+    MentalDrawFunc  pfnDraw;
+    void*           pObject;        // Компонент или скайбокс
+} MentalDrawItem;
+
+typedef struct MentalRenderQueueStats {
+    uint32_t   itemCount;          // Элементов в последнем кадре
+    uint32_t   programChanges;     // Смен программы между соседними элементами
+    uint32_t   sortPasses;         // Выполненных проходов поразрядной сортировки (из 8)
+    uint32_t   failedDraws;
+    uint32_t   visibleCount;       // Прошли отсечение в последнем кадре
+    uint32_t   culledCount;        // Отброшены как невидимые
+    uint64_t   totalCulled;
+    uint32_t   occludedCount;      // Прошли пирамиду, но закрыты загораживающими сетками
+    uint64_t   totalOccluded;
+    uint32_t   indirectBatches;    // Пакетов моделей из пула в последнем кадре
+    uint32_t   batchedCount;       // Элементов, нарисованных в этих пакетах
+    uint32_t   prepassCount;       // Элементов, чья глубина записана предварительным проходом
+} MentalRenderQueueStats;
+
+typedef struct MentalRenderQueue {
+    MentalDrawItem*         pItems;
+    MentalDrawItem*         pScratch;   // Второй буфер поразрядной сортировки
+    MentalBoundsSoA         bounds;     // Мировые границы элементов, по индексу в pItems
+    uint8_t*                pVisible;
+    MentalComponent**       ppBatch;    // Серия моделей текущего пакета
+    uint8_t*                pPrepassed; // Не 0 — глубина элемента уже записана, рисуется с GL_EQUAL
+    uint32_t                count;
+    uint32_t                capacity;
+    bool                    cullingEnabled;
+    bool                    depthPrepass;   // Предварительный проход глубины (по умолчанию выключен)
+    MentalRenderQueueStats  stats;
+} MentalRenderQueue;
+
+MentalResult mentalCreateRenderQueue(MentalRenderQueue* pQueue);
+void         mentalDestroyRenderQueue(MentalRenderQueue* pQueue);
+
+// Начало кадра: очередь пустеет, память сохраняется
+void         mentalRenderQueueBegin(MentalRenderQueue* pQueue);
+uint64_t     mentalRenderKey(MentalRenderPass ePass, uint32_t program, uint32_t material, uint32_t vao, float depth);
+// pBounds — мировые границы; NULL — элемент не отсекается
+MentalResult mentalRenderQueueSubmit(MentalRenderQueue* pQueue, uint64_t key, MentalDrawFunc pfnDraw, void* pObject,
+                                     const MentalBounds* pBounds);
+
+// Ключ и функция отрисовки выбираются по типу компонента; глубина — от камеры менеджера
+MentalResult mentalSubmitComponent(MentalRenderQueue* pQueue, MentalWindowManager* pManager, MentalComponent* pComponent);
+MentalResult mentalSubmitSkybox(MentalRenderQueue* pQueue, MentalSkybox* pSkybox);
+
+// Мировые границы компонента с учетом иерархии преобразований и экземпляров;
+// пересчитываются, только если изменилось преобразование или локальные границы
+void         mentalComponentWorldBounds(MentalComponent* pComponent, MentalBounds* pWorld);
+
+// Отсекает по пирамиде кадра (pManager->frame.frustum) и по перекрытию, сортирует и выполняет очередь
+MentalResult mentalRenderQueueFlush(MentalRenderQueue* pQueue, MentalWindowManager* pManager);
+
+#endif // mental_renderqueue_h
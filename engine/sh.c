@@ -0,0 +1,219 @@
+#include "sh.h"
+#include "component.h"
+#include "jobs.h"
+#include "hash.h"
+#include "glstate.h"
+#include <string.h>
+#include <math.h>
+
+#define MENTAL_SH_PI    3.14159265358979f
+
+// Данные одной грани для параллельной проекции
+typedef struct MentalSHFaceJob {
+    MentalSHLighting   *pSH;
+    float              *pixels[6];     // RGB float, MENTAL_SH_SAMPLE_SIZE^2 или меньше
+    int                size;
+    bool               isHDR;
+    bool               dirty[6];
+} MentalSHFaceJob;
+
+static void mental_sh_basis(const float dir[3], float basis[MENTAL_SH_COEFFICIENTS])
+{
+    float x = dir[0], y = dir[1], z = dir[2];
+    basis[0] = 0.282095f;
+    basis[1] = 0.488603f * y;
+    basis[2] = 0.488603f * z;
+    basis[3] = 0.488603f * x;
+    basis[4] = 1.092548f * x * y;
+    basis[5] = 1.092548f * y * z;
+    basis[6] = 0.315392f * (3.0f * z * z - 1.0f);
+    basis[7] = 1.092548f * x * z;
+    basis[8] = 0.546274f * (x * x - y * y);
+}
+
+// Направление для текселя грани в соглашении кубических карт OpenGL
+static void mental_sh_face_direction(uint32_t face, float u, float v, float dir[3])
+{
+    switch (face) {
+        case 0: dir[0] =  1.0f; dir[1] = -v;    dir[2] = -u;    break;
+        case 1: dir[0] = -1.0f; dir[1] = -v;    dir[2] =  u;    break;
+        case 2: dir[0] =  u;    dir[1] =  1.0f; dir[2] =  v;    break;
+        case 3: dir[0] =  u;    dir[1] = -1.0f; dir[2] = -v;    break;
+        case 4: dir[0] =  u;    dir[1] = -v;    dir[2] =  1.0f; break;
+        default: dir[0] = -u;   dir[1] = -v;    dir[2] = -1.0f; break;
+    }
+    float length = sqrtf(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+    dir[0] /= length;
+    dir[1] /= length;
+    dir[2] /= length;
+}
+
+static void mental_sh_project_face(void* pArg, uint32_t face)
+{
+    MentalSHFaceJob* pJob = pArg;
+    if (!pJob->dirty[face]) {
+        return;
+    }
+
+    float (*projection)[3] = pJob->pSH->faceProjection[face];
+    memset(projection, 0, sizeof(float) * MENTAL_SH_COEFFICIENTS * 3);
+
+    const float* pixels = pJob->pixels[face];
+    int size = pJob->size;
+    for (int y = 0; y < size; y++) {
+        float v = 2.0f * ((float)y + 0.5f) / (float)size - 1.0f;
+        for (int x = 0; x < size; x++) {
+            float u = 2.0f * ((float)x + 0.5f) / (float)size - 1.0f;
+
+            // Телесный угол текселя на грани куба
+            float t = 1.0f + u * u + v * v;
+            float solidAngle = 4.0f / ((float)size * (float)size * t * sqrtf(t));
+
+            float dir[3], basis[MENTAL_SH_COEFFICIENTS];
+            mental_sh_face_direction(face, u, v, dir);
+            mental_sh_basis(dir, basis);
+
+            const float* texel = &pixels[((size_t)y * size + x) * 3];
+            float color[3];
+            for (int c = 0; c < 3; c++) {
+                // 8-битные грани хранятся в sRGB, переводим в линейное пространство
+                color[c] = pJob->isHDR ? texel[c] : powf(texel[c], 2.2f);
+            }
+            for (int i = 0; i < MENTAL_SH_COEFFICIENTS; i++) {
+                float weight = basis[i] * solidAngle;
+                projection[i][0] += color[0] * weight;
+                projection[i][1] += color[1] * weight;
+                projection[i][2] += color[2] * weight;
+            }
+        }
+    }
+}
+
+MentalResult mentalCreateSHLighting(MentalSHLighting* pSH)
+{
+    if (!pSH) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    memset(pSH, 0, sizeof(MentalSHLighting));
+    glGenBuffers(1, &pSH->ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, pSH->ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(MentalSHBlock), &pSH->block, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MENTAL_SH_BINDING, pSH->ubo);
+    return MENTAL_OK;
+}
+
+MentalResult mentalUpdateSHLighting(MentalSHLighting* pSH, MentalSkybox* pSkybox)
+{
+    if (!pSH || !pSkybox) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    if (pSkybox->cubemapTexture == 0) {
+        return MENTAL_ERROR_TEXTURE_LOAD_FAILED;
+    }
+
+    // Небо с известным хешем не менялось — ничего не делаем
+    if (pSH->isReady && pSkybox->sourceHash != 0 && pSkybox->sourceHash == pSH->sourceHash) {
+        return MENTAL_OK;
+    }
+
+    double startTime = glfwGetTime();
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, pSkybox->cubemapTexture);
+
+    // Берем мип-уровень не больше MENTAL_SH_SAMPLE_SIZE: мипмапы уже усреднили грани
+    GLint baseSize = 0, internalFormat = 0, maxLevel = 0;
+    glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_WIDTH, &baseSize);
+    glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+    GLint minFilter = 0;
+    glGetTexParameteriv(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, &minFilter);
+    if (minFilter != GL_LINEAR && minFilter != GL_NEAREST) {
+        while ((baseSize >> maxLevel) > MENTAL_SH_SAMPLE_SIZE) {
+            maxLevel++;
+        }
+    }
+    int size = baseSize >> maxLevel;
+    if (size <= 0) {
+        mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        return MENTAL_ERROR_TEXTURE_LOAD_FAILED;
+    }
+
+    MentalSHFaceJob job;
+    memset(&job, 0, sizeof(job));
+    job.pSH = pSH;
+    job.size = size;
+    job.isHDR = internalFormat == GL_RGB16F || internalFormat == GL_RGB32F ||
+                internalFormat == GL_RGBA16F || internalFormat == GL_RGBA32F ||
+                internalFormat == GL_R11F_G11F_B10F || internalFormat == GL_RGB9_E5;
+
+    float* pixels = malloc((size_t)size * size * 3 * sizeof(float) * 6);
+    if (!pixels) {
+        mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+
+    uint32_t dirtyCount = 0;
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    for (uint32_t face = 0; face < 6; face++) {
+        job.pixels[face] = pixels + (size_t)face * size * size * 3;
+        glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, maxLevel, GL_RGB, GL_FLOAT, job.pixels[face]);
+
+        // Проекцию грани пересчитываем только если ее содержимое изменилось
+        uint64_t hash = mentalHashBytes(job.pixels[face], (size_t)size * size * 3 * sizeof(float), MENTAL_HASH_SEED);
+        job.dirty[face] = !pSH->isReady || hash != pSH->faceHashes[face];
+        pSH->faceHashes[face] = hash;
+        dirtyCount += job.dirty[face];
+    }
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    mentalJobsParallelFor(6, mental_sh_project_face, &job);
+    free(pixels);
+
+    // Свертка с косинусом (A0 = pi, A1 = 2pi/3, A2 = pi/4) и деление на pi,
+    // чтобы шейдер сразу получал диффузное излучение для альбедо 1
+    static const float band[MENTAL_SH_COEFFICIENTS] = {
+        1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f
+    };
+    for (int i = 0; i < MENTAL_SH_COEFFICIENTS; i++) {
+        for (int c = 0; c < 3; c++) {
+            float sum = 0.0f;
+            for (int face = 0; face < 6; face++) {
+                sum += pSH->faceProjection[face][i][c];
+            }
+            pSH->block.coefficients[i][c] = sum * band[i];
+        }
+        pSH->block.coefficients[i][3] = 0.0f;
+    }
+
+    // Средняя яркость неба — чтобы земля получала оттенок, а не общее затемнение
+    float average = 0.282095f * (0.2126f * pSH->block.coefficients[0][0] +
+                                 0.7152f * pSH->block.coefficients[0][1] +
+                                 0.0722f * pSH->block.coefficients[0][2]);
+    pSH->block.params[0] = 1.0f;
+    pSH->block.params[1] = average > 1e-4f ? 1.0f / average : 1.0f;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, pSH->ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(MentalSHBlock), &pSH->block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MENTAL_SH_BINDING, pSH->ubo);
+
+    pSH->sourceHash = pSkybox->sourceHash;
+    pSH->isReady = true;
+    MENTAL_DEBUG("SH lighting updated: %u/6 faces reprojected from %dx%d in %.2f ms", dirtyCount, size, size,
+                 (glfwGetTime() - startTime) * 1000.0);
+    return MENTAL_OK;
+}
+
+MentalResult mentalDestroySHLighting(MentalSHLighting* pSH)
+{
+    if (!pSH) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    if (pSH->ubo != 0) {
+        glDeleteBuffers(1, &pSH->ubo);
+        pSH->ubo = 0;
+    }
+    pSH->isReady = false;
+    return MENTAL_OK;
+}
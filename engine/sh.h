@@ -0,0 +1,37 @@
+#ifndef mental_sh_h
+#define mental_sh_h
+
+#include "mental.h"
+
+// Фоновое освещение по сферическим гармоникам (SH, 3 полосы, 9 коэффициентов).
+// Дешевая альтернатива полному IBL: младший мип-уровень кубической карты
+// скайбокса проецируется на базис SH на CPU (грани параллельно), коэффициенты
+// заливаются в небольшой uniform-блок SHLighting. Проекция каждой грани
+// кэшируется по хешу ее пикселей, поэтому пересчет идет только при смене неба.
+
+#define MENTAL_SH_COEFFICIENTS      9
+#define MENTAL_SH_SAMPLE_SIZE       32      // Сторона грани, с которой идет проекция
+#define MENTAL_SH_BINDING           1       // Точка привязки блока SHLighting (выставляет shader.c)
+
+typedef struct MentalSkybox MentalSkybox;
+
+// Раскладка std140: vec4 на коэффициент, w не используется
+typedef struct MentalSHBlock {
+    float      coefficients[MENTAL_SH_COEFFICIENTS][4];
+    float      params[4];                  // x — включено, y — нормировка яркости для земли
+} MentalSHBlock;
+
+typedef struct MentalSHLighting {
+    uint32_t       ubo;
+    uint64_t       sourceHash;             // Хеш скайбокса, для которого посчитаны коэффициенты
+    uint64_t       faceHashes[6];
+    float          faceProjection[6][MENTAL_SH_COEFFICIENTS][3];
+    MentalSHBlock  block;
+    bool           isReady;
+} MentalSHLighting;
+
+MentalResult mentalCreateSHLighting(MentalSHLighting* pSH);
+MentalResult mentalUpdateSHLighting(MentalSHLighting* pSH, MentalSkybox* pSkybox);
+MentalResult mentalDestroySHLighting(MentalSHLighting* pSH);
+
+#endif // mental_sh_h
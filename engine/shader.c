@@ -0,0 +1,820 @@
+#include "shader.h"
+#include "hash.h"
+#include "uniforms.h"
+#include "frame.h"
+#include "sh.h"
+#include "gpucull.h"
+#include "glstate.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Заголовок файла кэша, за ним length байт образа программы
+typedef struct MentalShaderCacheHeader {
+    char       magic[4];
+    uint32_t   version;
+    uint32_t   format;         // binaryFormat из glGetProgramBinary
+    uint32_t   length;
+    uint64_t   rendererHash;
+    uint64_t   key;
+} MentalShaderCacheHeader;
+
+static struct {
+    MentalShaderEntry   entries[MENTAL_SHADER_MAX_PROGRAMS];
+    uint32_t            entryCount;
+    uint32_t            compileCount;
+    uint32_t            hitCount;
+    uint32_t            binaryHitCount;
+    uint32_t            binaryRejectCount;
+    uint32_t            asyncCount;
+    uint64_t            placeholderUseCount;
+    uint64_t            rendererHash;       // 0 — еще не проверяли драйвер
+    bool                binaryCacheEnabled;
+    bool                parallelChecked;
+    bool                parallelCompile;
+    uint32_t            placeholder;        // Заглушка на время компиляции, вне реестра
+    MentalShaderEntry*  pLastUsed;          // Последняя запись, найденная mentalShaderUse
+} g_shaders;
+
+static const GLenum g_stageTypes[MENTAL_SHADER_STAGE_COUNT] = {
+    GL_VERTEX_SHADER,
+    GL_TESS_CONTROL_SHADER,
+    GL_TESS_EVALUATION_SHADER,
+    GL_GEOMETRY_SHADER,
+    GL_FRAGMENT_SHADER,
+    GL_COMPUTE_SHADER,
+};
+
+static const char* g_stageNames[MENTAL_SHADER_STAGE_COUNT] = {
+    "vertex", "tess control", "tess evaluation", "geometry", "fragment", "compute"
+};
+
+static char* mental_shader_read_file(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        MENTAL_DEBUG("Failed to open shader file: %s", path);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    char* source = malloc((size_t)size + 1);
+    if (source) {
+        size_t read = fread(source, 1, (size_t)size, file);
+        source[read] = '\0';
+    }
+    fclose(file);
+    return source;
+}
+
+// "A;B=1" -> "#define A\n#define B 1\n"
+static char* mental_shader_build_defines(const char* defines)
+{
+    if (!defines || !*defines) {
+        return NULL;
+    }
+
+    size_t length = strlen(defines);
+    // На каждое определение не больше "#define " + "\n", '=' превращается в пробел
+    size_t capacity = length * 10 + 1;
+    char* block = malloc(capacity);
+    if (!block) {
+        return NULL;
+    }
+
+    size_t offset = 0;
+    const char* cursor = defines;
+    while (*cursor) {
+        const char* end = strchr(cursor, ';');
+        size_t nameLength = end ? (size_t)(end - cursor) : strlen(cursor);
+        if (nameLength > 0) {
+            offset += (size_t)snprintf(block + offset, capacity - offset, "#define %.*s\n", (int)nameLength, cursor);
+        }
+        cursor += nameLength + (end ? 1 : 0);
+    }
+    for (char* p = block; *p; p++) {
+        if (*p == '=') {
+            *p = ' ';
+        }
+    }
+    return block;
+}
+
+// ============================
+// Кэш двоичных образов программ
+// ============================
+
+static void mental_shader_init_binary_cache(void)
+{
+    if (g_shaders.rendererHash != 0) {
+        return;
+    }
+
+    // Образы годятся только для того же драйвера: версия и имя GPU входят в ключ
+    const char* strings[4] = {
+        (const char*)glGetString(GL_VENDOR), (const char*)glGetString(GL_RENDERER),
+        (const char*)glGetString(GL_VERSION), (const char*)glGetString(GL_SHADING_LANGUAGE_VERSION)
+    };
+    uint64_t hash = MENTAL_HASH_SEED;
+    for (int i = 0; i < 4; i++) {
+        hash = mentalHashString(strings[i], hash);
+        hash = mentalHashString("|", hash);
+    }
+    g_shaders.rendererHash = hash;
+
+    GLint formatCount = 0;
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    }
+    g_shaders.binaryCacheEnabled = formatCount > 0;
+    MENTAL_DEBUG("Program binary cache %s (%d formats)", g_shaders.binaryCacheEnabled ? "enabled" : "unavailable",
+                 formatCount);
+}
+
+static void mental_shader_cache_path(uint64_t key, char* path, size_t size)
+{
+    snprintf(path, size, "%s/program_%016llx_%016llx.bin", MENTAL_SHADER_CACHE_DIR,
+             (unsigned long long)g_shaders.rendererHash, (unsigned long long)key);
+}
+
+static bool mental_shader_load_binary(uint64_t key, uint32_t* pProgram)
+{
+    if (!g_shaders.binaryCacheEnabled) {
+        return false;
+    }
+
+    char path[256];
+    mental_shader_cache_path(key, path, sizeof(path));
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    MentalShaderCacheHeader header;
+    void* binary = NULL;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, MENTAL_SHADER_CACHE_MAGIC, 4) == 0 &&
+              header.version == MENTAL_SHADER_CACHE_VERSION &&
+              header.rendererHash == g_shaders.rendererHash && header.key == key && header.length > 0;
+    if (ok) {
+        binary = malloc(header.length);
+        ok = binary && fread(binary, 1, header.length, file) == header.length;
+    }
+    fclose(file);
+
+    GLuint program = 0;
+    if (ok) {
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, binary, (GLsizei)header.length);
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        ok = success != 0;
+    }
+    free(binary);
+
+    if (!ok) {
+        // Драйвер обновился или файл поврежден — удаляем и компилируем заново
+        MENTAL_DEBUG("Program binary %s rejected, recompiling.", path);
+        if (program) {
+            mentalGLDeleteProgram(program);
+        }
+        remove(path);
+        g_shaders.binaryRejectCount++;
+        return false;
+    }
+
+    *pProgram = program;
+    return true;
+}
+
+static void mental_shader_save_binary(uint64_t key, uint32_t program)
+{
+    if (!g_shaders.binaryCacheEnabled) {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    void* binary = malloc((size_t)length);
+    if (!binary) {
+        return;
+    }
+
+    MentalShaderCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary);
+    memcpy(header.magic, MENTAL_SHADER_CACHE_MAGIC, 4);
+    header.version = MENTAL_SHADER_CACHE_VERSION;
+    header.format = format;
+    header.length = (uint32_t)written;
+    header.rendererHash = g_shaders.rendererHash;
+    header.key = key;
+
+    mkdir(MENTAL_SHADER_CACHE_DIR, 0755);
+    char path[256];
+    mental_shader_cache_path(key, path, sizeof(path));
+    FILE* file = written > 0 ? fopen(path, "wb") : NULL;
+    if (file) {
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(binary, 1, (size_t)written, file) == (size_t)written;
+        fclose(file);
+        if (!ok) {
+            remove(path);
+        }
+    }
+    free(binary);
+}
+
+// Точки привязки uniform-блоков не хранятся в GLSL 3.3 и сбрасываются после
+// glProgramBinary, поэтому выставляются при каждом создании программы
+static void mental_shader_bind_blocks(uint32_t program)
+{
+    static const struct {
+        const char* name;
+        GLuint      binding;
+    } blocks[] = {
+        { "FrameData",  MENTAL_FRAME_BINDING },
+        { "SHLighting", MENTAL_SH_BINDING },
+        { "CullData",   MENTAL_GPU_CULL_BINDING },
+    };
+
+    for (size_t i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++) {
+        GLuint blockIndex = glGetUniformBlockIndex(program, blocks[i].name);
+        if (blockIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(program, blockIndex, blocks[i].binding);
+        }
+    }
+}
+
+// Только отправляет исходник драйверу: статус компиляции проверяется при завершении
+static GLuint mental_shader_submit_stage(GLenum type, const char* source, const char* defineBlock, const char* path)
+{
+    // Определения вставляются сразу после строки #version
+    const char* parts[3];
+    GLint lengths[3];
+    GLsizei count = 0;
+    const char* body = source;
+    if (defineBlock) {
+        const char* version = strstr(source, "#version");
+        const char* lineEnd = version ? strchr(version, '\n') : NULL;
+        if (lineEnd) {
+            parts[count] = source;
+            lengths[count++] = (GLint)(lineEnd + 1 - source);
+            body = lineEnd + 1;
+        }
+        parts[count] = defineBlock;
+        lengths[count++] = -1;
+    }
+    parts[count] = body;
+    lengths[count++] = -1;
+
+    GLuint shader = glCreateShader(type);
+    if (shader == 0) {
+        MENTAL_DEBUG("Failed to create shader for %s", path);
+        return 0;
+    }
+    glShaderSource(shader, count, parts, lengths);
+    glCompileShader(shader);
+    return shader;
+}
+
+// Компиляция и линковка без ожидания результата. С KHR_parallel_shader_compile
+// драйвер выполняет их в своих потоках, без расширения — как обычно
+static MentalResult mental_shader_submit(char* sources[MENTAL_SHADER_STAGE_COUNT], const MentalShaderDesc* pDesc,
+                                         uint32_t* pProgram, uint32_t stageShaders[MENTAL_SHADER_STAGE_COUNT])
+{
+    char* defineBlock = mental_shader_build_defines(pDesc->defines);
+    MentalResult result = MENTAL_OK;
+    for (int stage = 0; stage < MENTAL_SHADER_STAGE_COUNT; stage++) {
+        stageShaders[stage] = 0;
+        if (sources[stage] && result == MENTAL_OK) {
+            stageShaders[stage] = mental_shader_submit_stage(g_stageTypes[stage], sources[stage], defineBlock,
+                                                             pDesc->paths[stage]);
+            if (stageShaders[stage] == 0) {
+                result = MENTAL_SHADER_COMPILE_FAILED;
+            }
+        }
+    }
+    free(defineBlock);
+
+    if (result != MENTAL_OK) {
+        for (int stage = 0; stage < MENTAL_SHADER_STAGE_COUNT; stage++) {
+            if (stageShaders[stage]) {
+                glDeleteShader(stageShaders[stage]);
+                stageShaders[stage] = 0;
+            }
+        }
+        *pProgram = 0;
+        return result;
+    }
+
+    GLuint program = glCreateProgram();
+    if (g_shaders.binaryCacheEnabled) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    for (int stage = 0; stage < MENTAL_SHADER_STAGE_COUNT; stage++) {
+        if (stageShaders[stage]) {
+            glAttachShader(program, stageShaders[stage]);
+        }
+    }
+    glLinkProgram(program);
+    *pProgram = program;
+    return MENTAL_OK;
+}
+
+// Проверяет результат (блокирует, если драйвер еще не закончил) и освобождает стадии.
+// Программа при ошибке не удаляется — ее ID уже может быть у компонентов
+static MentalResult mental_shader_finish(uint32_t program, uint32_t stageShaders[MENTAL_SHADER_STAGE_COUNT],
+                                         const char* label)
+{
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    MentalResult result = success ? MENTAL_OK : MENTAL_SHADER_LINK_FAILED;
+
+    for (int stage = 0; stage < MENTAL_SHADER_STAGE_COUNT; stage++) {
+        if (!stageShaders[stage]) {
+            continue;
+        }
+        if (!success) {
+            GLint compiled = 0;
+            glGetShaderiv(stageShaders[stage], GL_COMPILE_STATUS, &compiled);
+            if (!compiled) {
+                GLchar infoLog[1024];
+                glGetShaderInfoLog(stageShaders[stage], sizeof(infoLog), NULL, infoLog);
+                MENTAL_DEBUG("Shader compilation failed (%s stage of %s): %s", g_stageNames[stage], label, infoLog);
+                result = MENTAL_SHADER_COMPILE_FAILED;
+            }
+        }
+        glDetachShader(program, stageShaders[stage]);
+        glDeleteShader(stageShaders[stage]);
+        stageShaders[stage] = 0;
+    }
+
+    if (result == MENTAL_SHADER_LINK_FAILED) {
+        GLchar infoLog[1024];
+        glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+        MENTAL_DEBUG("Shader program linking failed (%s): %s", label, infoLog);
+    }
+    return result;
+}
+
+// Завершение ожидающей программы из реестра
+static void mental_shader_complete_entry(MentalShaderEntry* pEntry)
+{
+    MentalResult result = mental_shader_finish(pEntry->program, pEntry->stageShaders, pEntry->label);
+    if (result != MENTAL_OK) {
+        pEntry->status = MENTAL_SHADER_STATUS_FAILED;
+        return;
+    }
+    g_shaders.compileCount++;
+    mental_shader_save_binary(pEntry->key, pEntry->program);
+    mental_shader_bind_blocks(pEntry->program);
+    pEntry->status = MENTAL_SHADER_STATUS_READY;
+    MENTAL_DEBUG("Shader program %u compiled: %s", pEntry->program, pEntry->label);
+}
+
+// Готова ли программа, не блокируя поток (только с параллельной компиляцией)
+static bool mental_shader_is_complete(uint32_t program)
+{
+    if (!g_shaders.parallelCompile) {
+        return false;
+    }
+    GLint complete = 0;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete != 0;
+}
+
+static void mental_shader_init_parallel(void)
+{
+    if (g_shaders.parallelChecked) {
+        return;
+    }
+    g_shaders.parallelChecked = true;
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);     // Столько потоков, сколько сочтет нужным драйвер
+        g_shaders.parallelCompile = true;
+    } else if (GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+        g_shaders.parallelCompile = true;
+    }
+    MENTAL_DEBUG("Parallel shader compilation %s", g_shaders.parallelCompile ? "enabled" : "unavailable");
+}
+
+static MentalShaderEntry* mental_shader_find(uint32_t program)
+{
+    if (program == 0) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < g_shaders.entryCount; i++) {
+        if (g_shaders.entries[i].program == program) {
+            return &g_shaders.entries[i];
+        }
+    }
+    return NULL;
+}
+
+static MentalResult mental_shader_acquire(const MentalShaderDesc* pDesc, uint32_t* pProgram, bool async)
+{
+    if (!pDesc || !pProgram) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    const char* computePath = pDesc->paths[MENTAL_SHADER_STAGE_COMPUTE];
+    bool graphics = pDesc->paths[MENTAL_SHADER_STAGE_VERTEX] && pDesc->paths[MENTAL_SHADER_STAGE_FRAGMENT];
+    if (graphics == (computePath != NULL)) {
+        MENTAL_DEBUG("Shader program needs vertex and fragment stages or a single compute stage.");
+        return MENTAL_ERROR_INVALID_PARAMETER;
+    }
+
+    // Чтение файлов дешево по сравнению с компиляцией, а содержимое в ключе
+    // гарантирует, что измененный на диске шейдер не возьмется из реестра
+    char* sources[MENTAL_SHADER_STAGE_COUNT] = {0};
+    uint64_t key = MENTAL_HASH_SEED;
+    for (int stage = 0; stage < MENTAL_SHADER_STAGE_COUNT; stage++) {
+        if (!pDesc->paths[stage]) {
+            continue;
+        }
+        sources[stage] = mental_shader_read_file(pDesc->paths[stage]);
+        if (!sources[stage]) {
+            for (int i = 0; i < stage; i++) {
+                free(sources[i]);
+            }
+            return MENTAL_FILE_OPEN_FAILED;
+        }
+        key = mentalHashBytes(&stage, sizeof(stage), key);
+        key = mentalHashString(pDesc->paths[stage], key);
+        key = mentalHashString(sources[stage], key);
+    }
+    key = mentalHashString("|", key);
+    key = mentalHashString(pDesc->defines, key);
+
+    for (uint32_t i = 0; i < g_shaders.entryCount; i++) {
+        MentalShaderEntry* pEntry = &g_shaders.entries[i];
+        if (pEntry->key != key) {
+            continue;
+        }
+        for (int stage = 0; stage < MENTAL_SHADER_STAGE_COUNT; stage++) {
+            free(sources[stage]);
+        }
+        // Синхронному вызывающему нужна готовая программа
+        if (!async && pEntry->status == MENTAL_SHADER_STATUS_PENDING) {
+            mental_shader_complete_entry(pEntry);
+        }
+        if (!async && pEntry->status == MENTAL_SHADER_STATUS_FAILED) {
+            return MENTAL_SHADER_LINK_FAILED;
+        }
+        pEntry->refCount++;
+        g_shaders.hitCount++;
+        *pProgram = pEntry->program;
+        return MENTAL_OK;
+    }
+
+    // Теплый старт: образ из кэша, компилятор GLSL не вызывается
+    mental_shader_init_binary_cache();
+    mental_shader_init_parallel();
+    uint32_t program = 0;
+    uint32_t stageShaders[MENTAL_SHADER_STAGE_COUNT] = {0};
+    MentalResult result = MENTAL_OK;
+    bool fromBinary = mental_shader_load_binary(key, &program);
+    if (fromBinary) {
+        g_shaders.binaryHitCount++;
+        mental_shader_bind_blocks(program);
+    } else {
+        result = mental_shader_submit(sources, pDesc, &program, stageShaders);
+    }
+    for (int stage = 0; stage < MENTAL_SHADER_STAGE_COUNT; stage++) {
+        free(sources[stage]);
+    }
+    if (result != MENTAL_OK) {
+        return result;
+    }
+
+    char label[MENTAL_SHADER_LABEL_LENGTH];
+    if (computePath) {
+        snprintf(label, sizeof(label), "%s%s%s", computePath, pDesc->defines ? " " : "",
+                 pDesc->defines ? pDesc->defines : "");
+    } else {
+        snprintf(label, sizeof(label), "%s + %s%s%s",
+                 pDesc->paths[MENTAL_SHADER_STAGE_VERTEX], pDesc->paths[MENTAL_SHADER_STAGE_FRAGMENT],
+                 pDesc->defines ? " " : "", pDesc->defines ? pDesc->defines : "");
+    }
+
+    bool registered = g_shaders.entryCount < MENTAL_SHADER_MAX_PROGRAMS;
+    if (!fromBinary && (!async || !registered)) {
+        // Синхронный запрос или программу негде ждать — дожидаемся драйвера сразу
+        result = mental_shader_finish(program, stageShaders, label);
+        if (result != MENTAL_OK) {
+            mentalGLDeleteProgram(program);
+            return result;
+        }
+        g_shaders.compileCount++;
+        mental_shader_save_binary(key, program);
+        mental_shader_bind_blocks(program);
+    }
+
+    if (registered) {
+        MentalShaderEntry* pEntry = &g_shaders.entries[g_shaders.entryCount++];
+        memset(pEntry, 0, sizeof(*pEntry));
+        pEntry->program = program;
+        pEntry->key = key;
+        pEntry->refCount = 1;
+        memcpy(pEntry->label, label, sizeof(label));
+        if (!fromBinary && async) {
+            pEntry->status = MENTAL_SHADER_STATUS_PENDING;
+            memcpy(pEntry->stageShaders, stageShaders, sizeof(stageShaders));
+            g_shaders.asyncCount++;
+            MENTAL_DEBUG("Shader program %u queued: %s", program, label);
+        } else {
+            pEntry->status = MENTAL_SHADER_STATUS_READY;
+            MENTAL_DEBUG("Shader program %u %s: %s", program, fromBinary ? "loaded from cache" : "compiled", label);
+        }
+    } else {
+        // Реестр заполнен — программа живет отдельно и удаляется при первом release
+        MENTAL_DEBUG("Shader registry is full, program %u is not shared", program);
+    }
+
+    *pProgram = program;
+    return MENTAL_OK;
+}
+
+MentalResult mentalShaderAcquire(const MentalShaderDesc* pDesc, uint32_t* pProgram)
+{
+    return mental_shader_acquire(pDesc, pProgram, false);
+}
+
+MentalResult mentalShaderAcquireAsync(const MentalShaderDesc* pDesc, uint32_t* pProgram)
+{
+    return mental_shader_acquire(pDesc, pProgram, true);
+}
+
+MentalResult mentalShaderPrefetch(const MentalShaderDesc* pDesc)
+{
+    uint32_t program = 0;
+    MentalResult result = mentalShaderAcquireAsync(pDesc, &program);
+    if (result != MENTAL_OK) {
+        return result;
+    }
+    MentalShaderEntry* pEntry = mental_shader_find(program);
+    if (!pEntry || pEntry->prefetched) {
+        // Уже заказана или вне реестра — лишняя ссылка не нужна
+        mentalShaderRelease(program);
+        return MENTAL_OK;
+    }
+    pEntry->prefetched = true;
+    return MENTAL_OK;
+}
+
+void mentalShaderEndPrefetch(void)
+{
+    // Release может переставить записи, поэтому проход начинается заново
+    for (uint32_t i = 0; i < g_shaders.entryCount; i++) {
+        MentalShaderEntry* pEntry = &g_shaders.entries[i];
+        if (pEntry->prefetched) {
+            pEntry->prefetched = false;
+            mentalShaderRelease(pEntry->program);
+            i = (uint32_t)-1;
+        }
+    }
+}
+
+uint32_t mentalShaderPoll(void)
+{
+    uint32_t pending = 0;
+    bool finishedBlocking = false;
+    for (uint32_t i = 0; i < g_shaders.entryCount; i++) {
+        MentalShaderEntry* pEntry = &g_shaders.entries[i];
+        if (pEntry->status != MENTAL_SHADER_STATUS_PENDING) {
+            continue;
+        }
+        if (mental_shader_is_complete(pEntry->program)) {
+            mental_shader_complete_entry(pEntry);
+        } else if (!g_shaders.parallelCompile && !finishedBlocking) {
+            // Без расширения опрашивать нечем: завершаем по одной программе за кадр
+            mental_shader_complete_entry(pEntry);
+            finishedBlocking = true;
+        } else {
+            pending++;
+        }
+    }
+    return pending;
+}
+
+bool mentalShaderIsReady(uint32_t program)
+{
+    MentalShaderEntry* pEntry = mental_shader_find(program);
+    if (!pEntry) {
+        return program != 0;
+    }
+    if (pEntry->status == MENTAL_SHADER_STATUS_PENDING && mental_shader_is_complete(program)) {
+        mental_shader_complete_entry(pEntry);
+    }
+    return pEntry->status == MENTAL_SHADER_STATUS_READY;
+}
+
+static const char* g_placeholderVertex =
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "uniform mat4 model;\n"
+    "layout(std140) uniform FrameData {\n"
+    "    mat4 view;\n"
+    "    mat4 projection;\n"
+    "    mat4 viewProjection;\n"
+    "};\n"
+    "void main() { gl_Position = viewProjection * model * vec4(aPos, 1.0); }\n";
+
+static const char* g_placeholderFragment =
+    "#version 330 core\n"
+    "out vec4 FragColor;\n"
+    "void main() { FragColor = vec4(0.45, 0.45, 0.5, 1.0); }\n";
+
+// Простая программа на время компиляции: только позиция и ровный серый цвет
+static uint32_t mental_shader_placeholder(void)
+{
+    if (g_shaders.placeholder != 0) {
+        return g_shaders.placeholder;
+    }
+
+    uint32_t stageShaders[MENTAL_SHADER_STAGE_COUNT] = {0};
+    stageShaders[MENTAL_SHADER_STAGE_VERTEX] =
+        mental_shader_submit_stage(GL_VERTEX_SHADER, g_placeholderVertex, NULL, "placeholder vertex");
+    stageShaders[MENTAL_SHADER_STAGE_FRAGMENT] =
+        mental_shader_submit_stage(GL_FRAGMENT_SHADER, g_placeholderFragment, NULL, "placeholder fragment");
+    GLuint program = glCreateProgram();
+    for (int stage = 0; stage < MENTAL_SHADER_STAGE_COUNT; stage++) {
+        if (stageShaders[stage]) {
+            glAttachShader(program, stageShaders[stage]);
+        }
+    }
+    glLinkProgram(program);
+    if (mental_shader_finish(program, stageShaders, "placeholder") != MENTAL_OK) {
+        mentalGLDeleteProgram(program);
+        return 0;
+    }
+    mental_shader_bind_blocks(program);
+    g_shaders.placeholder = program;
+    return program;
+}
+
+uint32_t mentalShaderUse(uint32_t program)
+{
+    MentalShaderEntry* pEntry = g_shaders.pLastUsed;
+    if (!pEntry || pEntry >= g_shaders.entries + g_shaders.entryCount || pEntry->program != program) {
+        pEntry = mental_shader_find(program);
+        g_shaders.pLastUsed = pEntry;
+    }
+
+    if (pEntry && pEntry->status == MENTAL_SHADER_STATUS_PENDING && mental_shader_is_complete(program)) {
+        mental_shader_complete_entry(pEntry);
+    }
+    if (pEntry && pEntry->status != MENTAL_SHADER_STATUS_READY) {
+        program = mental_shader_placeholder();
+        g_shaders.placeholderUseCount++;
+    }
+
+    mentalGLUseProgram(program);
+    return program;
+}
+
+void mentalShaderRelease(uint32_t program)
+{
+    if (program == 0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < g_shaders.entryCount; i++) {
+        MentalShaderEntry* pEntry = &g_shaders.entries[i];
+        if (pEntry->program != program) {
+            continue;
+        }
+        if (--pEntry->refCount == 0) {
+            for (int stage = 0; stage < MENTAL_SHADER_STAGE_COUNT; stage++) {
+                if (pEntry->stageShaders[stage]) {
+                    glDeleteShader(pEntry->stageShaders[stage]);
+                }
+            }
+            mentalUniformsForget(pEntry->program);
+            mentalGLDeleteProgram(pEntry->program);
+            g_shaders.entries[i] = g_shaders.entries[--g_shaders.entryCount];
+            g_shaders.pLastUsed = NULL;
+        }
+        return;
+    }
+
+    mentalUniformsForget(program);
+    mentalGLDeleteProgram(program);
+}
+
+uint32_t mentalShaderVariant(MentalShaderVariants* pVariants, uint32_t features)
+{
+    if (!pVariants) {
+        return 0;
+    }
+    if (pVariants->lastIndex < pVariants->count && pVariants->masks[pVariants->lastIndex] == features) {
+        return pVariants->programs[pVariants->lastIndex];
+    }
+    for (uint32_t i = 0; i < pVariants->count; i++) {
+        if (pVariants->masks[i] == features) {
+            pVariants->lastIndex = i;
+            return pVariants->programs[i];
+        }
+    }
+    if (pVariants->count >= MENTAL_SHADER_MAX_VARIANTS) {
+        MENTAL_DEBUG("Shader variant set is full, features 0x%x are not compiled", features);
+        return 0;
+    }
+
+    // Маска в строку defines в порядке битов, чтобы ключ реестра был стабильным
+    char defines[MENTAL_SHADER_DEFINES_LENGTH];
+    size_t offset = 0;
+    defines[0] = '\0';
+    for (uint32_t bit = 0; bit < pVariants->featureCount; bit++) {
+        if ((features & (1u << bit)) && offset < sizeof(defines)) {
+            offset += (size_t)snprintf(defines + offset, sizeof(defines) - offset, "%s;", pVariants->featureNames[bit]);
+        }
+    }
+
+    MentalShaderDesc desc = {0};
+    for (int stage = 0; stage < MENTAL_SHADER_STAGE_COUNT; stage++) {
+        desc.paths[stage] = pVariants->paths[stage];
+    }
+    desc.defines = defines;
+
+    uint32_t program = 0;
+    if (mentalShaderAcquireAsync(&desc, &program) != MENTAL_OK) {
+        MENTAL_DEBUG("Failed to compile shader variant: %s", defines);
+        return 0;
+    }
+    pVariants->masks[pVariants->count] = features;
+    pVariants->programs[pVariants->count] = program;
+    pVariants->lastIndex = pVariants->count++;
+    return program;
+}
+
+void mentalShaderReleaseVariants(MentalShaderVariants* pVariants)
+{
+    if (!pVariants) {
+        return;
+    }
+    for (uint32_t i = 0; i < pVariants->count; i++) {
+        mentalShaderRelease(pVariants->programs[i]);
+    }
+    pVariants->count = 0;
+    pVariants->lastIndex = 0;
+}
+
+void mentalShaderGetStats(MentalShaderStats* pStats)
+{
+    if (!pStats) {
+        return;
+    }
+    pStats->programCount = g_shaders.entryCount;
+    pStats->compileCount = g_shaders.compileCount;
+    pStats->hitCount = g_shaders.hitCount;
+    pStats->binaryHitCount = g_shaders.binaryHitCount;
+    pStats->binaryRejectCount = g_shaders.binaryRejectCount;
+    pStats->pendingCount = 0;
+    for (uint32_t i = 0; i < g_shaders.entryCount; i++) {
+        if (g_shaders.entries[i].status == MENTAL_SHADER_STATUS_PENDING) {
+            pStats->pendingCount++;
+        }
+    }
+    pStats->asyncCount = g_shaders.asyncCount;
+    pStats->placeholderUseCount = g_shaders.placeholderUseCount;
+    pStats->parallelCompile = g_shaders.parallelCompile;
+}
+
+void mentalShaderShutdown(void)
+{
+    MENTAL_DEBUG("Shaders: %u programs compiled, %u loaded from binary cache (%u rejected), %u requests shared, %u still alive",
+                 g_shaders.compileCount, g_shaders.binaryHitCount, g_shaders.binaryRejectCount,
+                 g_shaders.hitCount, g_shaders.entryCount);
+    MENTAL_DEBUG("Shaders: %u queued asynchronously, %llu draws used the placeholder", g_shaders.asyncCount,
+                 (unsigned long long)g_shaders.placeholderUseCount);
+    for (uint32_t i = 0; i < g_shaders.entryCount; i++) {
+        MentalShaderEntry* pEntry = &g_shaders.entries[i];
+        for (int stage = 0; stage < MENTAL_SHADER_STAGE_COUNT; stage++) {
+            if (pEntry->stageShaders[stage]) {
+                glDeleteShader(pEntry->stageShaders[stage]);
+            }
+        }
+        mentalGLDeleteProgram(pEntry->program);
+    }
+    if (g_shaders.placeholder) {
+        mentalGLDeleteProgram(g_shaders.placeholder);
+    }
+    memset(&g_shaders, 0, sizeof(g_shaders));
+    // ID удаленных программ драйвер выдаст заново — таблицы больше недействительны
+    mentalUniformsShutdown();
+}
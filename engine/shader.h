@@ -0,0 +1,106 @@
+#ifndef mental_shader_h
+#define mental_shader_h
+
+#include "mental.h"
+
+// Реестр шейдерных программ. Ключ — пути стадий, содержимое файлов и набор
+// #define, поэтому компоненты с одинаковым материалом получают один и тот же
+// program ID и каждая программа компилируется ровно один раз. Ручки считают
+// ссылки: программа удаляется, когда ее отпустил последний владелец.
+// Слинкованные программы сохраняются на диск (glGetProgramBinary) отдельно
+// для каждого драйвера, и при следующем запуске компилятор GLSL не нужен.
+//
+// Асинхронный запрос только отправляет исходники драйверу и сразу возвращает
+// ID. С GL_KHR_parallel_shader_compile компиляция идет в потоках драйвера, а
+// mentalShaderPoll проверяет готовность через GL_COMPLETION_STATUS_KHR без
+// ожидания. Пока программа не готова, mentalShaderUse подставляет простую
+// заглушку (ровный серый цвет), так что первый кадр не ждет компилятора.
+
+#define MENTAL_SHADER_MAX_PROGRAMS      64
+#define MENTAL_SHADER_LABEL_LENGTH      128
+#define MENTAL_SHADER_CACHE_DIR         ".mental_cache"
+#define MENTAL_SHADER_CACHE_MAGIC       "MPRG"
+#define MENTAL_SHADER_CACHE_VERSION     1
+#define MENTAL_SHADER_MAX_VARIANTS      32
+#define MENTAL_SHADER_DEFINES_LENGTH    256
+
+typedef enum MentalShaderStage {
+    MENTAL_SHADER_STAGE_VERTEX = 0,
+    MENTAL_SHADER_STAGE_TESS_CONTROL,
+    MENTAL_SHADER_STAGE_TESS_EVALUATION,
+    MENTAL_SHADER_STAGE_GEOMETRY,
+    MENTAL_SHADER_STAGE_FRAGMENT,
+    MENTAL_SHADER_STAGE_COMPUTE,        // Только без остальных стадий; нужен OpenGL 4.3
+    MENTAL_SHADER_STAGE_COUNT
+} MentalShaderStage;
+
+typedef struct MentalShaderDesc {
+    const char  *paths[MENTAL_SHADER_STAGE_COUNT];  // NULL — стадии нет
+    const char  *defines;                           // "NAME;NAME=VALUE;..." или NULL
+} MentalShaderDesc;
+
+typedef enum MentalShaderStatus {
+    MENTAL_SHADER_STATUS_READY = 0,
+    MENTAL_SHADER_STATUS_PENDING,  // Отправлена драйверу, результат еще не проверен
+    MENTAL_SHADER_STATUS_FAILED
+} MentalShaderStatus;
+
+typedef struct MentalShaderEntry {
+    uint32_t            program;
+    uint64_t            key;            // Пути + содержимое + defines
+    uint32_t            refCount;
+    MentalShaderStatus  status;
+    uint32_t            stageShaders[MENTAL_SHADER_STAGE_COUNT];  // Живут до завершения линковки
+    bool                prefetched;     // Ссылка держится до mentalShaderEndPrefetch
+    char                label[MENTAL_SHADER_LABEL_LENGTH];
+} MentalShaderEntry;
+
+typedef struct MentalShaderStats {
+    uint32_t   programCount;   // Живых программ в реестре
+    uint32_t   compileCount;   // Сколько раз реально вызывался компилятор
+    uint32_t   hitCount;       // Сколько запросов обслужено из реестра
+    uint32_t   binaryHitCount; // Программ загружено из кэша на диске
+    uint32_t   binaryRejectCount; // Двоичных образов, отвергнутых драйвером
+    uint32_t   pendingCount;   // Программ, которые еще компилируются
+    uint32_t   asyncCount;     // Сколько программ отправлено без ожидания
+    uint64_t   placeholderUseCount; // Отрисовок, выполненных заглушкой
+    bool       parallelCompile;    // Драйвер компилирует в своих потоках
+} MentalShaderStats;
+
+// Набор вариантов одной программы: каждый бит маски включает свой #define.
+// Варианты компилируются при первом запросе (асинхронно) и хранятся в наборе,
+// повторный запрос того же набора флагов — поиск по маске без чтения файлов.
+typedef struct MentalShaderVariants {
+    const char* const*  paths;          // MENTAL_SHADER_STAGE_COUNT путей, NULL — стадии нет
+    const char* const*  featureNames;   // Имя #define для каждого бита маски
+    uint32_t            featureCount;
+    uint32_t            masks[MENTAL_SHADER_MAX_VARIANTS];
+    uint32_t            programs[MENTAL_SHADER_MAX_VARIANTS];
+    uint32_t            count;
+    uint32_t            lastIndex;      // Подряд обычно запрашивается один и тот же вариант
+} MentalShaderVariants;
+
+// Выдает программу для описания (компилирует только при первом запросе)
+MentalResult mentalShaderAcquire(const MentalShaderDesc* pDesc, uint32_t* pProgram);
+// То же без ожидания компилятора: программа готова, когда mentalShaderIsReady
+MentalResult mentalShaderAcquireAsync(const MentalShaderDesc* pDesc, uint32_t* pProgram);
+// Заранее заказывает программу, которая понадобится позже (при создании окна)
+MentalResult mentalShaderPrefetch(const MentalShaderDesc* pDesc);
+// Отпускает ссылки предзаказа: невостребованные программы удаляются
+void         mentalShaderEndPrefetch(void);
+// Завершает готовые программы; вызывается раз в кадр. Возвращает число ожидающих
+uint32_t     mentalShaderPoll(void);
+bool         mentalShaderIsReady(uint32_t program);
+// glUseProgram программы или заглушки; возвращает реально привязанный ID
+uint32_t     mentalShaderUse(uint32_t program);
+// Отпускает ручку; программы вне реестра удаляются сразу
+void         mentalShaderRelease(uint32_t program);
+void         mentalShaderGetStats(MentalShaderStats* pStats);
+// Программа варианта; набор владеет ссылкой, вызывающий ее не отпускает. 0 — ошибка
+uint32_t     mentalShaderVariant(MentalShaderVariants* pVariants, uint32_t features);
+// Отпускает все варианты набора
+void         mentalShaderReleaseVariants(MentalShaderVariants* pVariants);
+// Удаляет все оставшиеся программы (при закрытии окна)
+void         mentalShaderShutdown(void);
+
+#endif // mental_shader_h
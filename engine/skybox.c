@@ -1,7 +1,19 @@
 #include "component.h"
 #include "mental.h"
 #include "wm.h"
+#include "texture.h"
+#include "jobs.h"
+#include "hash.h"
+#include "hdr.h"
+#include "shader.h"
+#include "glstate.h"
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../stb_image.h"
 
 // Вершины для куба скайбокса (все грани направлены внутрь)
 static float skyboxVertices[] = {
@@ -60,13 +72,14 @@ MentalResult mentalCreateSkybox(MentalSkybox* pSkybox) {
     pSkybox->VBO = 0;
     pSkybox->cubemapTexture = 0;
     pSkybox->shaderProgram = 0;
+    pSkybox->sourceHash = 0;
     pSkybox->isInitialized = false;
 
     // Создание VAO и VBO
     glGenVertexArrays(1, &pSkybox->VAO);
     glGenBuffers(1, &pSkybox->VBO);
     
-    glBindVertexArray(pSkybox->VAO);
+    mentalGLBindVertexArray(pSkybox->VAO);
     glBindBuffer(GL_ARRAY_BUFFER, pSkybox->VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
     
@@ -78,106 +91,307 @@ MentalResult mentalCreateSkybox(MentalSkybox* pSkybox) {
     return MENTAL_OK;
 }
 
-// Функция для загрузки PPM файла
-unsigned char* loadPPM(const char* filename, int* width, int* height) {
-    FILE* file = fopen(filename, "rb");
-    if (!file) {
-        MENTAL_DEBUG("Failed to open PPM file: %s", filename);
-        return NULL;
+// Грань кубической карты в процессе загрузки
+typedef struct MentalSkyboxFace {
+    const char      *path;
+    int             width, height, channels;
+    bool            isHDR;
+    bool            isPacked;       // 4 байта на тексель в формате hdrFormat
+    MentalHDRFormat hdrFormat;
+    const void      *pixels;        // Данные для glTexImage2D
+    void            *decoded;       // Буфер stb_image (NULL для PPM)
+    uint32_t        *packed;        // HDR грань, упакованная при загрузке
+    void            *mapping;       // Отображение PPM/MHDR файла в память
+    size_t          mappingSize;
+    uint64_t        hash;           // Хеш размеров и пикселей грани
+} MentalSkyboxFace;
+
+// Чтение числа из заголовка PPM с пропуском пробелов и комментариев
+static bool mental_skybox_ppm_number(const unsigned char* data, size_t size, size_t* pOffset, int* pValue)
+{
+    size_t i = *pOffset;
+    while (i < size) {
+        if (data[i] == '#') {
+            while (i < size && data[i] != '\n') i++;
+        } else if (data[i] == ' ' || data[i] == '\t' || data[i] == '\r' || data[i] == '\n') {
+            i++;
+        } else {
+            break;
+        }
     }
-    
-    char magic[3];
-    int maxval;
-    
-    // Читаем заголовок PPM
-    if (fscanf(file, "%2s", magic) != 1 || strcmp(magic, "P6") != 0) {
-        MENTAL_DEBUG("Invalid PPM format in file: %s", filename);
-        fclose(file);
-        return NULL;
+    if (i >= size || data[i] < '0' || data[i] > '9') {
+        return false;
     }
-    
-    if (fscanf(file, "%d %d", width, height) != 2) {
-        MENTAL_DEBUG("Failed to read dimensions from PPM file: %s", filename);
-        fclose(file);
-        return NULL;
+
+    int value = 0;
+    while (i < size && data[i] >= '0' && data[i] <= '9') {
+        value = value * 10 + (data[i] - '0');
+        if (value > (1 << 24)) {
+            return false;
+        }
+        i++;
     }
-    
-    if (fscanf(file, "%d", &maxval) != 1) {
-        MENTAL_DEBUG("Failed to read maxval from PPM file: %s", filename);
-        fclose(file);
-        return NULL;
+    *pOffset = i;
+    *pValue = value;
+    return true;
+}
+
+// PPM (P6) и PGM (P5) отображаются в память, пиксели заливаются прямо из отображения
+static bool mental_skybox_map_ppm(MentalSkyboxFace* pFace)
+{
+    int fd = open(pFace->path, O_RDONLY);
+    if (fd < 0) {
+        MENTAL_DEBUG("Failed to open PPM file: %s", pFace->path);
+        return false;
     }
-    
-    // Пропускаем один символ новой строки
-    fgetc(file);
-    
-    // Выделяем память для данных
-    unsigned char* data = malloc(*width * *height * 3);
-    if (!data) {
-        MENTAL_DEBUG("Failed to allocate memory for PPM data");
-        fclose(file);
-        return NULL;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < 8) {
+        close(fd);
+        MENTAL_DEBUG("Invalid PPM file: %s", pFace->path);
+        return false;
     }
-    
-    // Читаем данные
-    if (fread(data, 1, *width * *height * 3, file) != (size_t)(*width * *height * 3)) {
-        MENTAL_DEBUG("Failed to read PPM data from file: %s", filename);
-        free(data);
-        fclose(file);
-        return NULL;
+
+    size_t size = (size_t)info.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        MENTAL_DEBUG("Failed to map PPM file: %s", pFace->path);
+        return false;
     }
-    
-    fclose(file);
-    return data;
+
+    const unsigned char* data = mapping;
+    size_t offset = 2;
+    int maxval = 0;
+    int channels = (data[0] == 'P' && data[1] == '6') ? 3 : (data[0] == 'P' && data[1] == '5') ? 1 : 0;
+    if (channels == 0 ||
+        !mental_skybox_ppm_number(data, size, &offset, &pFace->width) ||
+        !mental_skybox_ppm_number(data, size, &offset, &pFace->height) ||
+        !mental_skybox_ppm_number(data, size, &offset, &maxval) ||
+        maxval <= 0 || maxval > 255 || pFace->width <= 0 || pFace->height <= 0) {
+        MENTAL_DEBUG("Invalid PPM format in file: %s", pFace->path);
+        munmap(mapping, size);
+        return false;
+    }
+    offset++;   // Ровно один пробельный символ после maxval
+
+    size_t pixelBytes = (size_t)pFace->width * pFace->height * channels;
+    if (offset + pixelBytes > size) {
+        MENTAL_DEBUG("Truncated PPM data in file: %s", pFace->path);
+        munmap(mapping, size);
+        return false;
+    }
+
+    // Подсказываем ядру, что файл будет прочитан целиком
+    madvise(mapping, size, MADV_WILLNEED);
+
+    pFace->channels = channels;
+    pFace->mapping = mapping;
+    pFace->mappingSize = size;
+    pFace->pixels = data + offset;
+    return true;
 }
 
-// Функция для загрузки изображения в различных форматах
-unsigned char* loadImage(const char* filename, int* width, int* height, int* channels) {
-    // Проверяем расширение файла
-    const char* ext = strrchr(filename, '.');
-    if (!ext) {
-        MENTAL_DEBUG("No file extension found: %s", filename);
-        return NULL;
+// Запеченная заранее HDR грань (.mhdr, см. mentalBakeHDRImage) заливается прямо из отображения
+static bool mental_skybox_map_mhdr(MentalSkyboxFace* pFace)
+{
+    int fd = open(pFace->path, O_RDONLY);
+    if (fd < 0) {
+        MENTAL_DEBUG("Failed to open HDR file: %s", pFace->path);
+        return false;
     }
-    
-    if (strcmp(ext, ".ppm") == 0) {
-        // Загружаем PPM файл
-        unsigned char* data = loadPPM(filename, width, height);
-        if (data) {
-            *channels = 3; // PPM всегда RGB
-        }
-        return data;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(MentalHDRFileHeader)) {
+        close(fd);
+        MENTAL_DEBUG("Invalid HDR file: %s", pFace->path);
+        return false;
+    }
+
+    size_t size = (size_t)info.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        MENTAL_DEBUG("Failed to map HDR file: %s", pFace->path);
+        return false;
+    }
+
+    const MentalHDRFileHeader* pHeader = mapping;
+    size_t texels = (size_t)pHeader->width * pHeader->height;
+    if (memcmp(pHeader->magic, MENTAL_HDR_FILE_MAGIC, 4) != 0 || pHeader->version != MENTAL_HDR_FILE_VERSION ||
+        pHeader->format > MENTAL_HDR_FORMAT_RGB9E5 || pHeader->width == 0 || pHeader->height == 0 ||
+        sizeof(MentalHDRFileHeader) + texels * sizeof(uint32_t) > size) {
+        MENTAL_DEBUG("Invalid HDR format in file: %s", pFace->path);
+        munmap(mapping, size);
+        return false;
+    }
+
+    madvise(mapping, size, MADV_WILLNEED);
+
+    pFace->width = (int)pHeader->width;
+    pFace->height = (int)pHeader->height;
+    pFace->channels = 3;
+    pFace->isHDR = true;
+    pFace->isPacked = true;
+    pFace->hdrFormat = (MentalHDRFormat)pHeader->format;
+    pFace->mapping = mapping;
+    pFace->mappingSize = size;
+    pFace->pixels = (const unsigned char*)mapping + sizeof(MentalHDRFileHeader);
+    return true;
+}
+
+static void mental_skybox_hash_face(MentalSkyboxFace* pFace)
+{
+    if (!pFace->pixels) {
+        return;
+    }
+    int header[5] = { pFace->width, pFace->height, pFace->channels, pFace->isHDR, pFace->isPacked };
+    size_t texelBytes = pFace->isPacked ? sizeof(uint32_t) : pFace->channels * (pFace->isHDR ? sizeof(float) : 1);
+    size_t bytes = (size_t)pFace->width * pFace->height * texelBytes;
+    pFace->hash = mentalHashBytes(header, sizeof(header), MENTAL_HASH_SEED);
+    pFace->hash = mentalHashBytes(pFace->pixels, bytes, pFace->hash);
+}
+
+static void mental_skybox_decode_face(void* pArg, uint32_t index)
+{
+    MentalSkyboxFace* pFace = &((MentalSkyboxFace*)pArg)[index];
+    const char* ext = strrchr(pFace->path, '.');
+    if (ext && (strcmp(ext, ".ppm") == 0 || strcmp(ext, ".pgm") == 0)) {
+        mental_skybox_map_ppm(pFace);
+        mental_skybox_hash_face(pFace);
+        return;
+    }
+    if (ext && strcmp(ext, ".mhdr") == 0) {
+        mental_skybox_map_mhdr(pFace);
+        mental_skybox_hash_face(pFace);
+        return;
+    }
+
+    // PNG/JPG/TGA/BMP/HDR через stb_image
+    int channels = 0;
+    if (stbi_is_hdr(pFace->path)) {
+        pFace->decoded = stbi_loadf(pFace->path, &pFace->width, &pFace->height, &channels, 3);
+        pFace->channels = 3;
+        pFace->isHDR = true;
     } else {
-        // Для других форматов можно добавить поддержку stb_image или других библиотек
-        MENTAL_DEBUG("Unsupported image format: %s", ext);
-        return NULL;
+        if (!stbi_info(pFace->path, &pFace->width, &pFace->height, &channels)) {
+            MENTAL_DEBUG("Unsupported skybox image: %s (%s)", pFace->path, stbi_failure_reason());
+            return;
+        }
+        pFace->channels = channels == 4 || channels == 2 ? 4 : 3;
+        pFace->decoded = stbi_load(pFace->path, &pFace->width, &pFace->height, &channels, pFace->channels);
+    }
+
+    if (!pFace->decoded) {
+        MENTAL_DEBUG("Failed to decode skybox image: %s", pFace->path);
+        return;
+    }
+    pFace->pixels = pFace->decoded;
+    mental_skybox_hash_face(pFace);
+
+    // HDR грань сразу упаковывается в 4 байта на тексель вместо 12 (или 6 для RGB16F)
+    if (pFace->isHDR) {
+        size_t count = (size_t)pFace->width * pFace->height;
+        pFace->packed = malloc(count * sizeof(uint32_t));
+        if (pFace->packed) {
+            pFace->hdrFormat = mentalHDRGetCubemapFormat();
+            mentalEncodeHDR(pFace->hdrFormat, pFace->decoded, pFace->packed, count);
+            stbi_image_free(pFace->decoded);
+            pFace->decoded = NULL;
+            pFace->pixels = pFace->packed;
+            pFace->isPacked = true;
+        }
     }
 }
 
+static void mental_skybox_release_face(MentalSkyboxFace* pFace)
+{
+    if (pFace->mapping) {
+        munmap(pFace->mapping, pFace->mappingSize);
+    }
+    if (pFace->decoded) {
+        stbi_image_free(pFace->decoded);
+    }
+    free(pFace->packed);
+    pFace->mapping = NULL;
+    pFace->decoded = NULL;
+    pFace->packed = NULL;
+    pFace->pixels = NULL;
+}
+
 uint32_t mentalLoadCubemap(const char* faces[6]) {
+    return mentalLoadCubemapHashed(faces, NULL);
+}
+
+uint32_t mentalLoadCubemapHashed(const char* faces[6], uint64_t* pSourceHash) {
+    double startTime = glfwGetTime();
+
+    // Все шесть граней декодируются параллельно, на GPU заливаются из главного потока
+    MentalSkyboxFace loaded[6];
+    memset(loaded, 0, sizeof(loaded));
+    for (unsigned int i = 0; i < 6; i++) {
+        loaded[i].path = faces[i];
+    }
+    mentalJobsParallelFor(6, mental_skybox_decode_face, loaded);
+
     uint32_t textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-    int width, height, channels;
+    int width = 0, height = 0, channels = 3;
+    bool isHDR = false, isPacked = false;
+    unsigned int faceCount = 0;
+    uint64_t sourceHash = MENTAL_HASH_SEED;
     for (unsigned int i = 0; i < 6; i++) {
-        unsigned char *data = loadImage(faces[i], &width, &height, &channels);
-        if (data) {
-            GLenum format = (channels == 4) ? GL_RGBA : GL_RGB;
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
-                        0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-            free(data);
+        MentalSkyboxFace* pFace = &loaded[i];
+        if (pFace->pixels) {
+            GLenum format = pFace->channels == 4 ? GL_RGBA : pFace->channels == 1 ? GL_RED : GL_RGB;
+            if (pFace->isPacked) {
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, mentalHDRInternalFormat(pFace->hdrFormat),
+                             pFace->width, pFace->height, 0, GL_RGB, mentalHDRPixelType(pFace->hdrFormat), pFace->pixels);
+            } else {
+                GLenum internalFormat = pFace->isHDR ? GL_RGB16F : format;
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, internalFormat, pFace->width, pFace->height, 0,
+                             format, pFace->isHDR ? GL_FLOAT : GL_UNSIGNED_BYTE, pFace->pixels);
+            }
+            width = pFace->width;
+            height = pFace->height;
+            channels = pFace->channels;
+            isHDR = isHDR || pFace->isHDR;
+            isPacked = isPacked || pFace->isPacked;
+            sourceHash = mentalHashBytes(&pFace->hash, sizeof(pFace->hash), sourceHash);
+            faceCount++;
         } else {
             MENTAL_DEBUG("Cubemap texture failed to load at path: %s", faces[i]);
         }
+        mental_skybox_release_face(pFace);
     }
-    
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // Бесшовная выборка между гранями и мипмапы, чтобы в даль не было ряби
+    mentalGLEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, faceCount == 6 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    if (faceCount == 6) {
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    }
+    if (width > 0 && height > 0) {
+        // Упакованные HDR грани — 4 байта на тексель, остальные HDR — по два байта на канал (RGB16F)
+        int texelBytes = isPacked ? 4 : isHDR ? channels * 2 : channels;
+        mentalTextureRegister(textureID, GL_TEXTURE_CUBE_MAP, width, height, 6, texelBytes,
+                              (faceCount == 6 ? MENTAL_TEXTURE_FLAG_MIPMAPS : 0) | MENTAL_TEXTURE_FLAG_PINNED, NULL);
+    }
 
+    if (pSourceHash) {
+        *pSourceHash = faceCount == 6 ? sourceHash : 0;
+    }
+
+    MENTAL_DEBUG("Cubemap loaded: %u/6 faces, %dx%d%s in %.1f ms", faceCount, width, height,
+                 isPacked ? " packed HDR" : isHDR ? " HDR" : "", (glfwGetTime() - startTime) * 1000.0);
     return textureID;
 }
 
@@ -190,7 +404,7 @@ MentalResult mentalLoadSkyboxTextures(MentalSkybox* pSkybox, const char* right,
     }
 
     const char* faces[6] = {right, left, top, bottom, front, back};
-    pSkybox->cubemapTexture = mentalLoadCubemap(faces);
+    pSkybox->cubemapTexture = mentalLoadCubemapHashed(faces, &pSkybox->sourceHash);
     
     MENTAL_DEBUG("Skybox textures loaded successfully.");
     return MENTAL_OK;
@@ -202,99 +416,19 @@ MentalResult mentalAttachSkyboxShader(MentalSkybox* pSkybox, const char* vertex_
         return MENTAL_POINTER_IS_NULL;
     }
 
-    // Чтение и компиляция шейдеров
-    char* vertexCode = NULL;
-    char* fragmentCode = NULL;
-    
-    // Читаем вершинный шейдер
-    FILE* vShaderFile = fopen(vertex_path, "r");
-    if (!vShaderFile) {
-        MENTAL_DEBUG("Failed to open vertex shader file: %s", vertex_path);
-        return MENTAL_FILE_OPEN_FAILED;
-    }
-    
-    fseek(vShaderFile, 0, SEEK_END);
-    long vFileSize = ftell(vShaderFile);
-    fseek(vShaderFile, 0, SEEK_SET);
-    
-    vertexCode = malloc(vFileSize + 1);
-    if (!vertexCode) {
-        MENTAL_DEBUG("Failed to allocate memory for vertex shader");
-        fclose(vShaderFile);
-        return MENTAL_FAILED_TO_ALLOCATE_MEMORY;
-    }
-    
-    fread(vertexCode, 1, vFileSize, vShaderFile);
-    vertexCode[vFileSize] = '\0';
-    fclose(vShaderFile);
+    MentalShaderDesc desc = {0};
+    desc.paths[MENTAL_SHADER_STAGE_VERTEX] = vertex_path;
+    desc.paths[MENTAL_SHADER_STAGE_FRAGMENT] = fragment_path;
 
-    // Читаем фрагментный шейдер
-    FILE* fShaderFile = fopen(fragment_path, "r");
-    if (!fShaderFile) {
-        MENTAL_DEBUG("Failed to open fragment shader file: %s", fragment_path);
-        free(vertexCode);
-        return MENTAL_FILE_OPEN_FAILED;
+    uint32_t program = 0;
+    MentalResult result = mentalShaderAcquireAsync(&desc, &program);
+    if (result != MENTAL_OK) {
+        MENTAL_DEBUG("Failed to attach skybox shader.");
+        return result;
     }
-    
-    fseek(fShaderFile, 0, SEEK_END);
-    long fFileSize = ftell(fShaderFile);
-    fseek(fShaderFile, 0, SEEK_SET);
-    
-    fragmentCode = malloc(fFileSize + 1);
-    if (!fragmentCode) {
-        MENTAL_DEBUG("Failed to allocate memory for fragment shader");
-        free(vertexCode);
-        fclose(fShaderFile);
-        return MENTAL_FAILED_TO_ALLOCATE_MEMORY;
-    }
-    
-    fread(fragmentCode, 1, fFileSize, fShaderFile);
-    fragmentCode[fFileSize] = '\0';
-    fclose(fShaderFile);
-
-    // Компиляция шейдеров
-    uint32_t vertex, fragment;
-    int success;
-    char infoLog[512];
-
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vertexCode, NULL);
-    glCompileShader(vertex);
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-        MENTAL_DEBUG("Vertex shader compilation failed: %s", infoLog);
-        return MENTAL_SHADER_COMPILE_FAILED;
-    }
-
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fragmentCode, NULL);
-    glCompileShader(fragment);
-    glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-        MENTAL_DEBUG("Fragment shader compilation failed: %s", infoLog);
-        return MENTAL_SHADER_COMPILE_FAILED;
-    }
-
-    // Линковка программы
-    pSkybox->shaderProgram = glCreateProgram();
-    glAttachShader(pSkybox->shaderProgram, vertex);
-    glAttachShader(pSkybox->shaderProgram, fragment);
-    glLinkProgram(pSkybox->shaderProgram);
-    glGetProgramiv(pSkybox->shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(pSkybox->shaderProgram, 512, NULL, infoLog);
-        MENTAL_DEBUG("Shader program linking failed: %s", infoLog);
-        return MENTAL_SHADER_LINK_FAILED;
-    }
-
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-
-    // Освобождаем память
-    free(vertexCode);
-    free(fragmentCode);
+
+    mentalShaderRelease(pSkybox->shaderProgram);
+    pSkybox->shaderProgram = program;
 
     MENTAL_DEBUG("Skybox shader attached successfully.");
     return MENTAL_OK;
@@ -312,32 +446,19 @@ MentalResult mentalDrawSkybox(MentalSkybox* pSkybox, MentalWindowManager *pManag
     }
 
     // Сохраняем текущее состояние глубины
-    glDepthFunc(GL_LEQUAL);
-    
-    glUseProgram(pSkybox->shaderProgram);
-    
-    // Убираем трансляцию из view матрицы для скайбокса
-    mat4 view;
-    mental_camera_get_view_matrix(&pManager->camera, view);
-    view[3][0] = 0.0f;
-    view[3][1] = 0.0f;
-    view[3][2] = 0.0f;
-    
-    mat4 projection;
-    mental_camera_get_projection_matrix(&pManager->camera, projection, 
-                                       (float)pManager->pInfo->aSizes[0] / pManager->pInfo->aSizes[1]);
+    mentalGLDepthFunc(GL_LEQUAL);
     
-    glUniformMatrix4fv(glGetUniformLocation(pSkybox->shaderProgram, "view"), 1, GL_FALSE, (float*)view);
-    glUniformMatrix4fv(glGetUniformLocation(pSkybox->shaderProgram, "projection"), 1, GL_FALSE, (float*)projection);
+    // Матрицы берутся из блока FrameData, трансляцию вершинный шейдер отбрасывает сам
+    mentalShaderUse(pSkybox->shaderProgram);
     
-    glBindVertexArray(pSkybox->VAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, pSkybox->cubemapTexture);
+    mentalGLBindVertexArray(pSkybox->VAO);
+    mentalGLActiveTexture(GL_TEXTURE0);
+    mentalGLBindTexture(GL_TEXTURE_CUBE_MAP, pSkybox->cubemapTexture);
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+    mentalGLBindVertexArray(0);
     
     // Восстанавливаем настройки глубины
-    glDepthFunc(GL_LESS);
+    mentalGLDepthFunc(GL_LESS);
     
     return MENTAL_OK;
 }
@@ -349,7 +470,7 @@ MentalResult mentalDestroySkybox(MentalSkybox *pSkybox) {
     }
 
     if (pSkybox->VAO != 0) {
-        glDeleteVertexArrays(1, &pSkybox->VAO);
+        mentalGLDeleteVertexArrays(1, &pSkybox->VAO);
         pSkybox->VAO = 0;
     }
     
@@ -359,12 +480,11 @@ MentalResult mentalDestroySkybox(MentalSkybox *pSkybox) {
     }
     
     if (pSkybox->cubemapTexture != 0) {
-        glDeleteTextures(1, &pSkybox->cubemapTexture);
-        pSkybox->cubemapTexture = 0;
+        mentalTextureDelete(&pSkybox->cubemapTexture);
     }
     
     if (pSkybox->shaderProgram != 0) {
-        glDeleteProgram(pSkybox->shaderProgram);
+        mentalShaderRelease(pSkybox->shaderProgram);
         pSkybox->shaderProgram = 0;
     }
     
@@ -0,0 +1,320 @@
+#include "texture.h"
+#include "imageproc.h"
+#include "glstate.h"
+#include <string.h>
+
+#include "../stb_image.h"
+
+typedef struct MentalTextureManager {
+    MentalTextureEntry  entries[MENTAL_TEXTURE_MAX_ENTRIES];
+    uint32_t            entryCount;
+    uint64_t            budgetBytes;
+    uint64_t            totalBytes;
+    uint64_t            peakBytes;
+    uint64_t            frame;
+    uint32_t            touchedThisFrame;
+    uint32_t            evictionsThisFrame;
+    uint32_t            restoresThisFrame;
+    uint64_t            bytesFreedThisFrame;
+} MentalTextureManager;
+
+static MentalTextureManager g_textures = {
+    .budgetBytes = MENTAL_TEXTURE_DEFAULT_BUDGET,
+    .frame = 1,
+};
+
+static GLenum mental_texture_format(int channels)
+{
+    switch (channels) {
+        case 1:  return GL_RED;
+        case 2:  return GL_RG;
+        case 3:  return GL_RGB;
+        default: return GL_RGBA;
+    }
+}
+
+static inline int mental_texture_level_size(int size, uint32_t level)
+{
+    int result = size >> level;
+    return result > 0 ? result : 1;
+}
+
+static uint32_t mental_texture_max_level(const MentalTextureEntry* pEntry)
+{
+    uint32_t level = 0;
+    while (mental_texture_level_size(pEntry->width, level) > 1 || mental_texture_level_size(pEntry->height, level) > 1) {
+        level++;
+    }
+    return level;
+}
+
+// Объем текстуры, начиная с уровня firstLevel. Драйверы хранят GL_RGB8
+// с выравниванием до 4 байт на тексель, поэтому 3 канала считаются как 4
+static uint64_t mental_texture_bytes(const MentalTextureEntry* pEntry, uint32_t firstLevel)
+{
+    uint64_t bytes = 0;
+    uint64_t texelBytes = pEntry->channels == 3 ? 4 : (uint64_t)pEntry->channels;
+    uint32_t maxLevel = mental_texture_max_level(pEntry);
+    uint32_t lastLevel = (pEntry->flags & MENTAL_TEXTURE_FLAG_MIPMAPS) ? maxLevel : firstLevel;
+    for (uint32_t level = firstLevel; level <= lastLevel; level++) {
+        bytes += (uint64_t)mental_texture_level_size(pEntry->width, level) *
+                 mental_texture_level_size(pEntry->height, level) * pEntry->layers * texelBytes;
+    }
+    return bytes;
+}
+
+static MentalTextureEntry* mental_texture_find(uint32_t texture)
+{
+    for (uint32_t i = 0; i < g_textures.entryCount; i++) {
+        if (g_textures.entries[i].texture == texture) {
+            return &g_textures.entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void mental_texture_set_bytes(MentalTextureEntry* pEntry, uint64_t bytes)
+{
+    g_textures.totalBytes = g_textures.totalBytes - pEntry->bytes + bytes;
+    pEntry->bytes = bytes;
+    if (g_textures.totalBytes > g_textures.peakBytes) {
+        g_textures.peakBytes = g_textures.totalBytes;
+    }
+}
+
+// Вытеснять можно только 2D текстуры с мипмапами, которые умеем восстановить из файла
+static bool mental_texture_is_evictable(const MentalTextureEntry* pEntry)
+{
+    return !(pEntry->flags & MENTAL_TEXTURE_FLAG_PINNED) &&
+           (pEntry->flags & MENTAL_TEXTURE_FLAG_MIPMAPS) &&
+           pEntry->target == GL_TEXTURE_2D && pEntry->layers == 1 &&
+           pEntry->path[0] != '\0' &&
+           pEntry->residentLevel < mental_texture_max_level(pEntry);
+}
+
+MentalResult mentalTextureRegister(uint32_t texture, uint32_t target, int width, int height, int layers,
+                                   int channels, uint32_t flags, const char* path)
+{
+    if (texture == 0 || width <= 0 || height <= 0 || layers <= 0 || channels <= 0) {
+        return MENTAL_ERROR_INVALID_PARAMETER;
+    }
+
+    MentalTextureEntry* pEntry = mental_texture_find(texture);
+    if (pEntry) {
+        // Повторная регистрация (текстуру перезалили) — просто обновляем запись
+        mental_texture_set_bytes(pEntry, 0);
+    } else {
+        if (g_textures.entryCount >= MENTAL_TEXTURE_MAX_ENTRIES) {
+            MENTAL_DEBUG("Texture manager is full: %u textures", g_textures.entryCount);
+            return MENTAL_ERROR_OUT_OF_MEMORY;
+        }
+        pEntry = &g_textures.entries[g_textures.entryCount++];
+    }
+
+    memset(pEntry, 0, sizeof(MentalTextureEntry));
+    pEntry->texture = texture;
+    pEntry->target = target;
+    pEntry->width = width;
+    pEntry->height = height;
+    pEntry->layers = layers;
+    pEntry->channels = channels;
+    pEntry->flags = flags;
+    pEntry->lastUsed = g_textures.frame;
+    if (path) {
+        snprintf(pEntry->path, sizeof(pEntry->path), "%s", path);
+    }
+    pEntry->fullBytes = mental_texture_bytes(pEntry, 0);
+    mental_texture_set_bytes(pEntry, pEntry->fullBytes);
+    return MENTAL_OK;
+}
+
+MentalResult mentalTextureDelete(uint32_t* pTexture)
+{
+    if (!pTexture) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    if (*pTexture == 0) {
+        return MENTAL_OK;
+    }
+
+    MentalTextureEntry* pEntry = mental_texture_find(*pTexture);
+    if (pEntry) {
+        mental_texture_set_bytes(pEntry, 0);
+        *pEntry = g_textures.entries[--g_textures.entryCount];
+    }
+    mentalGLDeleteTextures(1, pTexture);
+    *pTexture = 0;
+    return MENTAL_OK;
+}
+
+void mentalTextureTouch(uint32_t texture)
+{
+    MentalTextureEntry* pEntry = mental_texture_find(texture);
+    if (!pEntry || pEntry->lastUsed == g_textures.frame) {
+        return;
+    }
+    pEntry->lastUsed = g_textures.frame;
+    g_textures.touchedThisFrame++;
+    if (pEntry->residentLevel > 0 && pEntry->path[0] != '\0') {
+        pEntry->wantsRestore = true;
+    }
+}
+
+void mentalTexturePin(uint32_t texture, bool pinned)
+{
+    MentalTextureEntry* pEntry = mental_texture_find(texture);
+    if (!pEntry) {
+        return;
+    }
+    if (pinned) {
+        pEntry->flags |= MENTAL_TEXTURE_FLAG_PINNED;
+    } else {
+        pEntry->flags &= ~MENTAL_TEXTURE_FLAG_PINNED;
+    }
+}
+
+void mentalTextureSetBudget(uint64_t budgetBytes)
+{
+    g_textures.budgetBytes = budgetBytes > 0 ? budgetBytes : MENTAL_TEXTURE_DEFAULT_BUDGET;
+    MENTAL_DEBUG("Texture budget set to %llu MB", (unsigned long long)(g_textures.budgetBytes >> 20));
+}
+
+void mentalTextureBeginFrame(void)
+{
+    g_textures.frame++;
+    g_textures.touchedThisFrame = 0;
+    g_textures.evictionsThisFrame = 0;
+    g_textures.restoresThisFrame = 0;
+    g_textures.bytesFreedThisFrame = 0;
+}
+
+// Отбрасываем верхний уровень: читаем уровень 1 и заливаем его как новый уровень 0
+static bool mental_texture_drop_level(MentalTextureEntry* pEntry)
+{
+    uint32_t level = pEntry->residentLevel;
+    int width = mental_texture_level_size(pEntry->width, level + 1);
+    int height = mental_texture_level_size(pEntry->height, level + 1);
+    GLenum format = mental_texture_format(pEntry->channels);
+
+    unsigned char* data = malloc((size_t)width * height * pEntry->channels);
+    if (!data) {
+        return false;
+    }
+
+    mentalGLBindTexture(GL_TEXTURE_2D, pEntry->texture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 1, format, GL_UNSIGNED_BYTE, data);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    mentalGLBindTexture(GL_TEXTURE_2D, 0);
+    free(data);
+
+    uint64_t before = pEntry->bytes;
+    pEntry->residentLevel++;
+    mental_texture_set_bytes(pEntry, mental_texture_bytes(pEntry, pEntry->residentLevel));
+    g_textures.bytesFreedThisFrame += before - pEntry->bytes;
+    g_textures.evictionsThisFrame++;
+    return true;
+}
+
+static bool mental_texture_restore(MentalTextureEntry* pEntry)
+{
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load((pEntry->flags & MENTAL_TEXTURE_FLAG_FLIP_Y) != 0);
+    unsigned char* data = mentalImageLoad(pEntry->path, &width, &height, &channels, pEntry->channels);
+    stbi_set_flip_vertically_on_load(false);
+    if (!data || width != pEntry->width || height != pEntry->height) {
+        MENTAL_DEBUG("Failed to restore texture %u from %s", pEntry->texture, pEntry->path);
+        if (data) {
+            stbi_image_free(data);
+        }
+        pEntry->path[0] = '\0';     // Источник изменился или пропал — больше не пытаемся
+        return false;
+    }
+
+    GLenum format = mental_texture_format(pEntry->channels);
+    mentalGLBindTexture(GL_TEXTURE_2D, pEntry->texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    mentalGLBindTexture(GL_TEXTURE_2D, 0);
+    stbi_image_free(data);
+
+    pEntry->residentLevel = 0;
+    mental_texture_set_bytes(pEntry, pEntry->fullBytes);
+    g_textures.restoresThisFrame++;
+    return true;
+}
+
+static MentalTextureEntry* mental_texture_find_victim(void)
+{
+    MentalTextureEntry* pVictim = NULL;
+    for (uint32_t i = 0; i < g_textures.entryCount; i++) {
+        MentalTextureEntry* pEntry = &g_textures.entries[i];
+        // Текстуры, привязанные в этом кадре, не трогаем
+        if (pEntry->lastUsed >= g_textures.frame || !mental_texture_is_evictable(pEntry)) {
+            continue;
+        }
+        if (!pVictim || pEntry->lastUsed < pVictim->lastUsed ||
+            (pEntry->lastUsed == pVictim->lastUsed && pEntry->bytes > pVictim->bytes)) {
+            pVictim = pEntry;
+        }
+    }
+    return pVictim;
+}
+
+void mentalTextureEndFrame(void)
+{
+    while (g_textures.totalBytes > g_textures.budgetBytes) {
+        MentalTextureEntry* pVictim = mental_texture_find_victim();
+        if (!pVictim || !mental_texture_drop_level(pVictim)) {
+            break;
+        }
+    }
+
+    // Восстанавливаем понадобившиеся текстуры, только если они помещаются в бюджет
+    for (uint32_t i = 0; i < g_textures.entryCount &&
+                         g_textures.restoresThisFrame < MENTAL_TEXTURE_RESTORES_PER_FRAME; i++) {
+        MentalTextureEntry* pEntry = &g_textures.entries[i];
+        if (!pEntry->wantsRestore) {
+            continue;
+        }
+        pEntry->wantsRestore = false;
+        if (pEntry->residentLevel == 0 || pEntry->path[0] == '\0') {
+            continue;
+        }
+        if (g_textures.totalBytes - pEntry->bytes + pEntry->fullBytes <= g_textures.budgetBytes) {
+            mental_texture_restore(pEntry);
+        }
+    }
+}
+
+void mentalTextureGetStats(MentalTextureStats* pStats)
+{
+    if (!pStats) {
+        return;
+    }
+
+    memset(pStats, 0, sizeof(MentalTextureStats));
+    pStats->textureCount = g_textures.entryCount;
+    pStats->totalBytes = g_textures.totalBytes;
+    pStats->peakBytes = g_textures.peakBytes;
+    pStats->budgetBytes = g_textures.budgetBytes;
+    pStats->touchedThisFrame = g_textures.touchedThisFrame;
+    pStats->evictionsThisFrame = g_textures.evictionsThisFrame;
+    pStats->restoresThisFrame = g_textures.restoresThisFrame;
+    pStats->bytesFreedThisFrame = g_textures.bytesFreedThisFrame;
+    for (uint32_t i = 0; i < g_textures.entryCount; i++) {
+        const MentalTextureEntry* pEntry = &g_textures.entries[i];
+        if (pEntry->residentLevel > 0) {
+            pStats->reducedCount++;
+            if (pEntry->residentLevel >= mental_texture_max_level(pEntry)) {
+                pStats->evictedCount++;
+            }
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef mental_texture_h
+#define mental_texture_h
+
+#include "mental.h"
+
+// Учет памяти текстур и бюджет VRAM.
+// Каждая созданная движком текстура регистрируется здесь вместе с размером
+// (включая мипмапы). Если суммарный объем превышает бюджет, в конце кадра
+// давно не использованные текстуры ужимаются до младших мип-уровней, вплоть
+// до 1x1 (средний цвет). Текстуры, загруженные из файла, восстанавливаются
+// в полном разрешении, когда снова понадобятся и бюджет это позволяет.
+
+#define MENTAL_TEXTURE_MAX_ENTRIES          512
+#define MENTAL_TEXTURE_DEFAULT_BUDGET       (256ull * 1024ull * 1024ull)
+#define MENTAL_TEXTURE_RESTORES_PER_FRAME   1
+
+// Флаги регистрации
+#define MENTAL_TEXTURE_FLAG_MIPMAPS         0x1     // У текстуры полная цепочка мипмапов
+#define MENTAL_TEXTURE_FLAG_PINNED          0x2     // Никогда не вытесняется
+#define MENTAL_TEXTURE_FLAG_FLIP_Y          0x4     // При перезагрузке переворачивать по вертикали
+
+typedef struct MentalTextureEntry {
+    uint32_t   texture;
+    uint32_t   target;         // GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, ...
+    int        width, height;  // Полный размер уровня 0
+    int        layers;         // Слои массива или грани кубической карты
+    int        channels;
+    uint32_t   flags;
+    uint32_t   residentLevel;  // Сколько уровней сейчас отброшено (0 — полное разрешение)
+    uint64_t   bytes;          // Текущий объем в VRAM
+    uint64_t   fullBytes;      // Объем в полном разрешении
+    uint64_t   lastUsed;       // Кадр последней привязки
+    bool       wantsRestore;
+    char       path[256];      // Источник для восстановления (пусто — не восстанавливается)
+} MentalTextureEntry;
+
+typedef struct MentalTextureStats {
+    uint32_t   textureCount;
+    uint32_t   evictedCount;       // Текстуры, ужатые до 1x1
+    uint32_t   reducedCount;       // Текстуры не в полном разрешении
+    uint64_t   totalBytes;
+    uint64_t   peakBytes;
+    uint64_t   budgetBytes;
+    // За последний кадр
+    uint32_t   touchedThisFrame;
+    uint32_t   evictionsThisFrame;
+    uint32_t   restoresThisFrame;
+    uint64_t   bytesFreedThisFrame;
+} MentalTextureStats;
+
+MentalResult mentalTextureRegister(uint32_t texture, uint32_t target, int width, int height, int layers,
+                                   int channels, uint32_t flags, const char* path);
+MentalResult mentalTextureDelete(uint32_t* pTexture);
+void         mentalTextureTouch(uint32_t texture);
+void         mentalTexturePin(uint32_t texture, bool pinned);
+void         mentalTextureSetBudget(uint64_t budgetBytes);
+
+void         mentalTextureBeginFrame(void);
+void         mentalTextureEndFrame(void);
+void         mentalTextureGetStats(MentalTextureStats* pStats);
+
+#endif // mental_texture_h
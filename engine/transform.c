@@ -0,0 +1,437 @@
+#include "transform.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+static MentalTransformStats s_transformStats;
+
+void mentalTransformInit(MentalTransform* pTransform)
+{
+    glm_vec3_zero(pTransform->position);
+    glm_quat_identity(pTransform->rotation);
+    pTransform->scale = 1.0f;
+    pTransform->pParent = NULL;
+    glm_mat4_identity(pTransform->local);
+    glm_mat4_identity(pTransform->world);
+    pTransform->version = 0;
+    pTransform->parentVersion = 0;
+    pTransform->dirty = true;
+}
+
+void mentalTransformSetPosition(MentalTransform* pTransform, float x, float y, float z)
+{
+    pTransform->position[0] = x;
+    pTransform->position[1] = y;
+    pTransform->position[2] = z;
+    pTransform->dirty = true;
+}
+
+void mentalTransformSetRotation(MentalTransform* pTransform, versor rotation)
+{
+    glm_quat_copy(rotation, pTransform->rotation);
+    pTransform->dirty = true;
+}
+
+void mentalTransformSetEuler(MentalTransform* pTransform, float angleX, float angleY, float angleZ)
+{
+    versor qx, qy, qz;
+    glm_quatv(qx, glm_rad(angleX), (vec3){1.0f, 0.0f, 0.0f});
+    glm_quatv(qy, glm_rad(angleY), (vec3){0.0f, 1.0f, 0.0f});
+    glm_quatv(qz, glm_rad(angleZ), (vec3){0.0f, 0.0f, 1.0f});
+    glm_quat_mul(qx, qy, pTransform->rotation);
+    glm_quat_mul(pTransform->rotation, qz, pTransform->rotation);
+    pTransform->dirty = true;
+}
+
+void mentalTransformSetScale(MentalTransform* pTransform, float scale)
+{
+    pTransform->scale = scale;
+    pTransform->dirty = true;
+}
+
+MentalResult mentalTransformSetParent(MentalTransform* pTransform, MentalTransform* pParent)
+{
+    if (!pTransform) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    for (MentalTransform* pAncestor = pParent; pAncestor; pAncestor = pAncestor->pParent) {
+        if (pAncestor == pTransform) {
+            MENTAL_DEBUG("Transform parent would create a cycle");
+            return MENTAL_ERROR;
+        }
+    }
+    pTransform->pParent = pParent;
+    pTransform->dirty = true;
+    return MENTAL_OK;
+}
+
+// T * R * S без промежуточных умножений: столбцы поворота масштабируются на месте
+static void mental_transform_compose_local(MentalTransform* pTransform)
+{
+    glm_quat_mat4(pTransform->rotation, pTransform->local);
+    glm_vec4_scale(pTransform->local[0], pTransform->scale, pTransform->local[0]);
+    glm_vec4_scale(pTransform->local[1], pTransform->scale, pTransform->local[1]);
+    glm_vec4_scale(pTransform->local[2], pTransform->scale, pTransform->local[2]);
+    pTransform->local[3][0] = pTransform->position[0];
+    pTransform->local[3][1] = pTransform->position[1];
+    pTransform->local[3][2] = pTransform->position[2];
+    pTransform->local[3][3] = 1.0f;
+    s_transformStats.localUpdates++;
+}
+
+vec4* mentalTransformWorld(MentalTransform* pTransform)
+{
+    MentalTransform* pParent = pTransform->pParent;
+    if (pParent) {
+        // Родитель сначала приводит в порядок свою цепочку; его версия растет, если он пересчитался
+        mentalTransformWorld(pParent);
+    }
+
+    bool parentChanged = pParent && pParent->version != pTransform->parentVersion;
+    if (!pTransform->dirty && !parentChanged) {
+        return pTransform->world;
+    }
+
+    if (pTransform->dirty) {
+        mental_transform_compose_local(pTransform);
+    }
+    if (pParent) {
+        glm_mat4_mul(pParent->world, pTransform->local, pTransform->world);
+        pTransform->parentVersion = pParent->version;
+    } else {
+        glm_mat4_copy(pTransform->local, pTransform->world);
+    }
+    pTransform->dirty = false;
+    pTransform->version++;
+    s_transformStats.worldUpdates++;
+    return pTransform->world;
+}
+
+void mentalTransformWorldPosition(MentalTransform* pTransform, vec3 position)
+{
+    vec4* world = mentalTransformWorld(pTransform);
+    glm_vec3_copy(world[3], position);
+}
+
+float mentalTransformWorldScale(MentalTransform* pTransform)
+{
+    vec4* world = mentalTransformWorld(pTransform);
+    return glm_vec3_norm(world[0]);
+}
+
+void mentalTransformGetStats(MentalTransformStats* pStats)
+{
+    *pStats = s_transformStats;
+}
+
+MentalResult mentalTransformSoAReserve(MentalTransformSoA* pSoA, uint32_t capacity)
+{
+    if (capacity <= pSoA->capacity) {
+        return MENTAL_OK;
+    }
+    for (int lane = 0; lane < MENTAL_TRANSFORM_LANE_COUNT; lane++) {
+        float* pLane = realloc(pSoA->lanes[lane], sizeof(float) * capacity);
+        if (!pLane) {
+            return MENTAL_ERROR_OUT_OF_MEMORY;
+        }
+        pSoA->lanes[lane] = pLane;
+    }
+    pSoA->capacity = capacity;
+    return MENTAL_OK;
+}
+
+void mentalTransformSoAFree(MentalTransformSoA* pSoA)
+{
+    for (int lane = 0; lane < MENTAL_TRANSFORM_LANE_COUNT; lane++) {
+        free(pSoA->lanes[lane]);
+    }
+    memset(pSoA, 0, sizeof(*pSoA));
+}
+
+void mentalTransformSoASetEuler(MentalTransformSoA* pSoA, uint32_t first, uint32_t count,
+                                const float* pAngleX, const float* pAngleY, const float* pAngleZ)
+{
+    float* qx = pSoA->lanes[MENTAL_TRANSFORM_LANE_ROTATION_X];
+    float* qy = pSoA->lanes[MENTAL_TRANSFORM_LANE_ROTATION_Y];
+    float* qz = pSoA->lanes[MENTAL_TRANSFORM_LANE_ROTATION_Z];
+    float* qw = pSoA->lanes[MENTAL_TRANSFORM_LANE_ROTATION_W];
+    const float halfRadians = glm_rad(0.5f);
+
+    // qx * qy * qz, раскрытое по компонентам
+    for (uint32_t i = 0; i < count; i++) {
+        float sx = sinf(pAngleX[i] * halfRadians), cx = cosf(pAngleX[i] * halfRadians);
+        float sy = sinf(pAngleY[i] * halfRadians), cy = cosf(pAngleY[i] * halfRadians);
+        float sz = sinf(pAngleZ[i] * halfRadians), cz = cosf(pAngleZ[i] * halfRadians);
+        float x = sx * cy, y = cx * sy, z = sx * sy, w = cx * cy;
+        qx[first + i] = x * cz + y * sz;
+        qy[first + i] = y * cz - x * sz;
+        qz[first + i] = w * sz + z * cz;
+        qw[first + i] = w * cz - z * sz;
+    }
+}
+
+static void mental_transform_compose_one(float* const* lanes, uint32_t i, float* pMatrix, float* pNormal)
+{
+    float x = lanes[MENTAL_TRANSFORM_LANE_ROTATION_X][i];
+    float y = lanes[MENTAL_TRANSFORM_LANE_ROTATION_Y][i];
+    float z = lanes[MENTAL_TRANSFORM_LANE_ROTATION_Z][i];
+    float w = lanes[MENTAL_TRANSFORM_LANE_ROTATION_W][i];
+    float s = lanes[MENTAL_TRANSFORM_LANE_SCALE][i];
+
+    float xx = x * (x + x), yy = y * (y + y), zz = z * (z + z);
+    float xy = x * (y + y), xz = x * (z + z), yz = y * (z + z);
+    float wx = w * (x + x), wy = w * (y + y), wz = w * (z + z);
+    float rotation[9] = {
+        1.0f - (yy + zz), xy + wz, xz - wy,
+        xy - wz, 1.0f - (xx + zz), yz + wx,
+        xz + wy, yz - wx, 1.0f - (xx + yy)
+    };
+
+    for (int column = 0; column < 3; column++) {
+        for (int row = 0; row < 3; row++) {
+            pMatrix[column * 4 + row] = rotation[column * 3 + row] * s;
+        }
+        pMatrix[column * 4 + 3] = 0.0f;
+    }
+    pMatrix[12] = lanes[MENTAL_TRANSFORM_LANE_POSITION_X][i];
+    pMatrix[13] = lanes[MENTAL_TRANSFORM_LANE_POSITION_Y][i];
+    pMatrix[14] = lanes[MENTAL_TRANSFORM_LANE_POSITION_Z][i];
+    pMatrix[15] = 1.0f;
+
+    if (pNormal) {
+        // Обратная транспонированная к R * s при равномерном масштабе — R / s
+        float inverseScale = 1.0f / s;
+        for (int column = 0; column < 3; column++) {
+            for (int row = 0; row < 3; row++) {
+                pNormal[column * 4 + row] = rotation[column * 3 + row] * inverseScale;
+            }
+            pNormal[column * 4 + 3] = 0.0f;
+        }
+    }
+}
+
+#if defined(__SSE2__)
+
+// Четыре объекта: a, b, c, d — одна строка столбца у каждого; после
+// транспонирования в регистре лежит столбец одного объекта
+static void mental_transform_store_column4(__m128 a, __m128 b, __m128 c, __m128 d, uint8_t* pBase, size_t stride,
+                                           size_t offset)
+{
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+    _mm_storeu_ps((float*)(pBase + offset), a);
+    _mm_storeu_ps((float*)(pBase + stride + offset), b);
+    _mm_storeu_ps((float*)(pBase + stride * 2 + offset), c);
+    _mm_storeu_ps((float*)(pBase + stride * 3 + offset), d);
+}
+
+#endif
+
+#if defined(__AVX__)
+
+// Восемь объектов: младшие и старшие половины регистров — две четверки SSE
+static void mental_transform_store_column8(__m256 a, __m256 b, __m256 c, __m256 d, uint8_t* pBase, size_t stride,
+                                           size_t offset)
+{
+    mental_transform_store_column4(_mm256_castps256_ps128(a), _mm256_castps256_ps128(b), _mm256_castps256_ps128(c),
+                                   _mm256_castps256_ps128(d), pBase, stride, offset);
+    mental_transform_store_column4(_mm256_extractf128_ps(a, 1), _mm256_extractf128_ps(b, 1),
+                                   _mm256_extractf128_ps(c, 1), _mm256_extractf128_ps(d, 1), pBase + stride * 4,
+                                   stride, offset);
+}
+
+static uint32_t mental_transform_compose_simd(float* const* lanes, uint32_t count, uint8_t* pMatrices,
+                                              size_t matrixStride, uint8_t* pNormals, size_t normalStride)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_ROTATION_X] + i);
+        __m256 y = _mm256_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_ROTATION_Y] + i);
+        __m256 z = _mm256_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_ROTATION_Z] + i);
+        __m256 w = _mm256_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_ROTATION_W] + i);
+        __m256 s = _mm256_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_SCALE] + i);
+        __m256 x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+        __m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+        __m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+        __m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+
+        __m256 r[9] = {
+            _mm256_sub_ps(one, _mm256_add_ps(yy, zz)), _mm256_add_ps(xy, wz), _mm256_sub_ps(xz, wy),
+            _mm256_sub_ps(xy, wz), _mm256_sub_ps(one, _mm256_add_ps(xx, zz)), _mm256_add_ps(yz, wx),
+            _mm256_add_ps(xz, wy), _mm256_sub_ps(yz, wx), _mm256_sub_ps(one, _mm256_add_ps(xx, yy))
+        };
+
+        uint8_t* pBase = pMatrices + (size_t)i * matrixStride;
+        for (int column = 0; column < 3; column++) {
+            mental_transform_store_column8(_mm256_mul_ps(r[column * 3], s), _mm256_mul_ps(r[column * 3 + 1], s),
+                                           _mm256_mul_ps(r[column * 3 + 2], s), zero, pBase, matrixStride,
+                                           column * sizeof(vec4));
+        }
+        mental_transform_store_column8(_mm256_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_POSITION_X] + i),
+                                       _mm256_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_POSITION_Y] + i),
+                                       _mm256_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_POSITION_Z] + i), one, pBase,
+                                       matrixStride, 3 * sizeof(vec4));
+
+        if (pNormals) {
+            __m256 inverseScale = _mm256_div_ps(one, s);
+            pBase = pNormals + (size_t)i * normalStride;
+            for (int column = 0; column < 3; column++) {
+                mental_transform_store_column8(_mm256_mul_ps(r[column * 3], inverseScale),
+                                               _mm256_mul_ps(r[column * 3 + 1], inverseScale),
+                                               _mm256_mul_ps(r[column * 3 + 2], inverseScale), zero, pBase,
+                                               normalStride, column * sizeof(vec4));
+            }
+        }
+    }
+    return i;
+}
+
+#elif defined(__SSE2__)
+
+static uint32_t mental_transform_compose_simd(float* const* lanes, uint32_t count, uint8_t* pMatrices,
+                                              size_t matrixStride, uint8_t* pNormals, size_t normalStride)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_ROTATION_X] + i);
+        __m128 y = _mm_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_ROTATION_Y] + i);
+        __m128 z = _mm_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_ROTATION_Z] + i);
+        __m128 w = _mm_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_ROTATION_W] + i);
+        __m128 s = _mm_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_SCALE] + i);
+        __m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+        __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+        __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+        __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+        __m128 r[9] = {
+            _mm_sub_ps(one, _mm_add_ps(yy, zz)), _mm_add_ps(xy, wz), _mm_sub_ps(xz, wy),
+            _mm_sub_ps(xy, wz), _mm_sub_ps(one, _mm_add_ps(xx, zz)), _mm_add_ps(yz, wx),
+            _mm_add_ps(xz, wy), _mm_sub_ps(yz, wx), _mm_sub_ps(one, _mm_add_ps(xx, yy))
+        };
+
+        uint8_t* pBase = pMatrices + (size_t)i * matrixStride;
+        for (int column = 0; column < 3; column++) {
+            mental_transform_store_column4(_mm_mul_ps(r[column * 3], s), _mm_mul_ps(r[column * 3 + 1], s),
+                                           _mm_mul_ps(r[column * 3 + 2], s), zero, pBase, matrixStride,
+                                           column * sizeof(vec4));
+        }
+        mental_transform_store_column4(_mm_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_POSITION_X] + i),
+                                       _mm_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_POSITION_Y] + i),
+                                       _mm_loadu_ps(lanes[MENTAL_TRANSFORM_LANE_POSITION_Z] + i), one, pBase,
+                                       matrixStride, 3 * sizeof(vec4));
+
+        if (pNormals) {
+            __m128 inverseScale = _mm_div_ps(one, s);
+            pBase = pNormals + (size_t)i * normalStride;
+            for (int column = 0; column < 3; column++) {
+                mental_transform_store_column4(_mm_mul_ps(r[column * 3], inverseScale),
+                                               _mm_mul_ps(r[column * 3 + 1], inverseScale),
+                                               _mm_mul_ps(r[column * 3 + 2], inverseScale), zero, pBase,
+                                               normalStride, column * sizeof(vec4));
+            }
+        }
+    }
+    return i;
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+// vst4q раскладывает четыре строки в четыре столбца подряд; дальше столбцы копируются с шагом
+static void mental_transform_store_column4(float32x4_t a, float32x4_t b, float32x4_t c, float32x4_t d,
+                                           uint8_t* pBase, size_t stride, size_t offset)
+{
+    float columns[4][4];
+    float32x4x4_t rows = { { a, b, c, d } };
+    vst4q_f32(&columns[0][0], rows);
+    for (int lane = 0; lane < 4; lane++) {
+        memcpy(pBase + stride * lane + offset, columns[lane], sizeof(columns[lane]));
+    }
+}
+
+static uint32_t mental_transform_compose_simd(float* const* lanes, uint32_t count, uint8_t* pMatrices,
+                                              size_t matrixStride, uint8_t* pNormals, size_t normalStride)
+{
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t x = vld1q_f32(lanes[MENTAL_TRANSFORM_LANE_ROTATION_X] + i);
+        float32x4_t y = vld1q_f32(lanes[MENTAL_TRANSFORM_LANE_ROTATION_Y] + i);
+        float32x4_t z = vld1q_f32(lanes[MENTAL_TRANSFORM_LANE_ROTATION_Z] + i);
+        float32x4_t w = vld1q_f32(lanes[MENTAL_TRANSFORM_LANE_ROTATION_W] + i);
+        float32x4_t s = vld1q_f32(lanes[MENTAL_TRANSFORM_LANE_SCALE] + i);
+        float32x4_t x2 = vaddq_f32(x, x), y2 = vaddq_f32(y, y), z2 = vaddq_f32(z, z);
+        float32x4_t xx = vmulq_f32(x, x2), yy = vmulq_f32(y, y2), zz = vmulq_f32(z, z2);
+        float32x4_t xy = vmulq_f32(x, y2), xz = vmulq_f32(x, z2), yz = vmulq_f32(y, z2);
+        float32x4_t wx = vmulq_f32(w, x2), wy = vmulq_f32(w, y2), wz = vmulq_f32(w, z2);
+
+        float32x4_t r[9] = {
+            vsubq_f32(one, vaddq_f32(yy, zz)), vaddq_f32(xy, wz), vsubq_f32(xz, wy),
+            vsubq_f32(xy, wz), vsubq_f32(one, vaddq_f32(xx, zz)), vaddq_f32(yz, wx),
+            vaddq_f32(xz, wy), vsubq_f32(yz, wx), vsubq_f32(one, vaddq_f32(xx, yy))
+        };
+
+        uint8_t* pBase = pMatrices + (size_t)i * matrixStride;
+        for (int column = 0; column < 3; column++) {
+            mental_transform_store_column4(vmulq_f32(r[column * 3], s), vmulq_f32(r[column * 3 + 1], s),
+                                           vmulq_f32(r[column * 3 + 2], s), zero, pBase, matrixStride,
+                                           column * sizeof(vec4));
+        }
+        mental_transform_store_column4(vld1q_f32(lanes[MENTAL_TRANSFORM_LANE_POSITION_X] + i),
+                                       vld1q_f32(lanes[MENTAL_TRANSFORM_LANE_POSITION_Y] + i),
+                                       vld1q_f32(lanes[MENTAL_TRANSFORM_LANE_POSITION_Z] + i), one, pBase,
+                                       matrixStride, 3 * sizeof(vec4));
+
+        if (pNormals) {
+            float32x4_t inverseScale = vdivq_f32(one, s);
+            pBase = pNormals + (size_t)i * normalStride;
+            for (int column = 0; column < 3; column++) {
+                mental_transform_store_column4(vmulq_f32(r[column * 3], inverseScale),
+                                               vmulq_f32(r[column * 3 + 1], inverseScale),
+                                               vmulq_f32(r[column * 3 + 2], inverseScale), zero, pBase,
+                                               normalStride, column * sizeof(vec4));
+            }
+        }
+    }
+    return i;
+}
+
+#else
+
+static uint32_t mental_transform_compose_simd(float* const* lanes, uint32_t count, uint8_t* pMatrices,
+                                              size_t matrixStride, uint8_t* pNormals, size_t normalStride)
+{
+    (void)lanes;
+    (void)count;
+    (void)pMatrices;
+    (void)matrixStride;
+    (void)pNormals;
+    (void)normalStride;
+    return 0;
+}
+
+#endif
+
+void mentalTransformBatchCompose(const MentalTransformSoA* pSoA, uint32_t count, void* pMatrices,
+                                 size_t matrixStride, void* pNormals, size_t normalStride)
+{
+    float* const* lanes = pSoA->lanes;
+    uint8_t* pMatrixBytes = pMatrices;
+    uint8_t* pNormalBytes = pNormals;
+    uint32_t i = mental_transform_compose_simd(lanes, count, pMatrixBytes, matrixStride, pNormalBytes, normalStride);
+    for (; i < count; i++) {
+        mental_transform_compose_one(lanes, i, (float*)(pMatrixBytes + (size_t)i * matrixStride),
+                                     pNormalBytes ? (float*)(pNormalBytes + (size_t)i * normalStride) : NULL);
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef mental_transform_h
+#define mental_transform_h
+
+#include "mental.h"
+#include <cglm/cglm.h>
+
+// Иерархия преобразований. Локальное преобразование хранится как положение,
+// кватернион и равномерный масштаб; матрицы local и world кэшируются и
+// пересчитываются только после изменения. Сеттеры лишь поднимают флаг dirty.
+// Изменение родителя доходит до потомков через номер версии: каждый пересчет
+// world увеличивает version, а потомок помнит, по какой версии родителя
+// считал свою матрицу. Неподвижный объект платит за кадр только сравнениями
+// версий вверх по цепочке, без умножения матриц.
+
+typedef struct MentalTransform MentalTransform;
+
+struct MentalTransform {
+    vec3                position;
+    versor              rotation;       // Кватернион x, y, z, w (как в cglm)
+    float               scale;          // Равномерный масштаб
+    MentalTransform*    pParent;        // NULL — корень; родитель должен жить дольше потомка
+
+    mat4                local;          // T * R * S
+    mat4                world;          // parent.world * local
+    uint32_t            version;        // Растет при каждом пересчете world
+    uint32_t            parentVersion;  // Версия родителя, по которой посчитан world
+    bool                dirty;          // Локальные TRS изменились
+};
+
+typedef struct MentalTransformStats {
+    uint64_t   localUpdates;       // Пересчетов local (изменились TRS)
+    uint64_t   worldUpdates;       // Пересчетов world (сам объект или родитель)
+} MentalTransformStats;
+
+// Для статической инициализации компонентов; поворот единичный
+#define MENTAL_TRANSFORM_INIT(x, y, z, s) \
+    { .position = {(x), (y), (z)}, .rotation = {0.0f, 0.0f, 0.0f, 1.0f}, .scale = (s), .dirty = true }
+
+void mentalTransformInit(MentalTransform* pTransform);
+void mentalTransformSetPosition(MentalTransform* pTransform, float x, float y, float z);
+void mentalTransformSetRotation(MentalTransform* pTransform, versor rotation);
+// Углы в градусах; порядок как у прежней матрицы модели: Rx * Ry * Rz
+void mentalTransformSetEuler(MentalTransform* pTransform, float angleX, float angleY, float angleZ);
+void mentalTransformSetScale(MentalTransform* pTransform, float scale);
+// Отказывает, если родитель — сам объект или его потомок
+MentalResult mentalTransformSetParent(MentalTransform* pTransform, MentalTransform* pParent);
+
+// Мировая матрица; пересчитывает цепочку родителей, только если что-то в ней изменилось
+vec4* mentalTransformWorld(MentalTransform* pTransform);
+// Мировое положение (столбец переноса) и масштаб по оси X мировой матрицы
+void  mentalTransformWorldPosition(MentalTransform* pTransform, vec3 position);
+float mentalTransformWorldScale(MentalTransform* pTransform);
+
+void mentalTransformGetStats(MentalTransformStats* pStats);
+
+// Пакетный путь для тысяч движущихся объектов без иерархии (например, экземпляров
+// модели). Положения, кватернионы и масштабы лежат в SoA, матрицы собираются
+// по 8 (AVX) или 4 (SSE / NEON) объекта за итерацию и пишутся с заданным шагом,
+// так что приемником может быть отображенный буфер экземпляров на GPU.
+
+typedef enum MentalTransformLane {
+    MENTAL_TRANSFORM_LANE_POSITION_X = 0,
+    MENTAL_TRANSFORM_LANE_POSITION_Y,
+    MENTAL_TRANSFORM_LANE_POSITION_Z,
+    MENTAL_TRANSFORM_LANE_ROTATION_X,
+    MENTAL_TRANSFORM_LANE_ROTATION_Y,
+    MENTAL_TRANSFORM_LANE_ROTATION_Z,
+    MENTAL_TRANSFORM_LANE_ROTATION_W,
+    MENTAL_TRANSFORM_LANE_SCALE,
+    MENTAL_TRANSFORM_LANE_COUNT
+} MentalTransformLane;
+
+typedef struct MentalTransformSoA {
+    float*      lanes[MENTAL_TRANSFORM_LANE_COUNT];
+    uint32_t    capacity;
+} MentalTransformSoA;
+
+MentalResult mentalTransformSoAReserve(MentalTransformSoA* pSoA, uint32_t capacity);
+void         mentalTransformSoAFree(MentalTransformSoA* pSoA);
+// Углы в градусах (по массиву на ось) переводятся в кватернионы, как mentalTransformSetEuler
+void         mentalTransformSoASetEuler(MentalTransformSoA* pSoA, uint32_t first, uint32_t count,
+                                        const float* pAngleX, const float* pAngleY, const float* pAngleZ);
+// Матрицы T * R * S (16 float по столбцам) с шагом matrixStride байт. Если pNormals
+// не NULL, туда же пишутся матрицы нормалей R / scale — три столбца vec4, как mat3
+// в std140. Кватернионы должны быть единичными, масштаб — ненулевым
+void         mentalTransformBatchCompose(const MentalTransformSoA* pSoA, uint32_t count, void* pMatrices,
+                                         size_t matrixStride, void* pNormals, size_t normalStride);
+
+#endif // mental_transform_h
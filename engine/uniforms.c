@@ -0,0 +1,244 @@
+#include "uniforms.h"
+#include <string.h>
+
+static struct {
+    MentalUniformTable  tables[MENTAL_UNIFORM_MAX_TABLES];
+    uint32_t            tableCount;
+    MentalUniformTable* pLast;      // Подряд обычно идут вызовы для одной программы
+    uint64_t            useClock;
+    uint32_t            buildCount;
+    uint64_t            uploadCount;
+    uint64_t            skipCount;
+} g_uniforms;
+
+// Имена в порядке MentalUniform; для массивов glGetActiveUniform добавляет "[0]"
+static const char* g_uniformNames[MENTAL_UNIFORM_COUNT] = {
+    [MENTAL_UNIFORM_MODEL]               = "model",
+    [MENTAL_UNIFORM_VIEW]                = "view",
+    [MENTAL_UNIFORM_PROJECTION]          = "projection",
+    [MENTAL_UNIFORM_SIZE]                = "size",
+    [MENTAL_UNIFORM_MATERIAL_ALBEDO]     = "material.albedo",
+    [MENTAL_UNIFORM_MATERIAL_METALLIC]   = "material.metallic",
+    [MENTAL_UNIFORM_MATERIAL_ROUGHNESS]  = "material.roughness",
+    [MENTAL_UNIFORM_MATERIAL_AO]         = "material.ao",
+    [MENTAL_UNIFORM_MATERIAL_AMBIENT]    = "material.ambient",
+    [MENTAL_UNIFORM_MATERIAL_DIFFUSE]    = "material.diffuse",
+    [MENTAL_UNIFORM_MATERIAL_SPECULAR]   = "material.specular",
+    [MENTAL_UNIFORM_MATERIAL_SHININESS]  = "material.shininess",
+    [MENTAL_UNIFORM_OBJECT_COLOR]        = "objectColor",
+    [MENTAL_UNIFORM_HAS_TEXTURE]         = "hasTexture",
+    [MENTAL_UNIFORM_TEXTURE1]            = "texture1",
+    [MENTAL_UNIFORM_HEIGHT_SCALE]        = "heightScale",
+    [MENTAL_UNIFORM_TESS_EDGE_PIXELS]    = "tessEdgePixels",
+    [MENTAL_UNIFORM_TESS_MAX_LEVEL]      = "tessMaxLevel",
+    [MENTAL_UNIFORM_ALBEDO_MAP]          = "albedoMap",
+    [MENTAL_UNIFORM_NORMAL_MAP]          = "normalMap",
+    [MENTAL_UNIFORM_METALLIC_MAP]        = "metallicMap",
+    [MENTAL_UNIFORM_ROUGHNESS_MAP]       = "roughnessMap",
+    [MENTAL_UNIFORM_AO_MAP]              = "aoMap",
+    [MENTAL_UNIFORM_HEIGHT_MAP]          = "heightMap",
+    [MENTAL_UNIFORM_ALBEDO_ARRAY]        = "albedoArray",
+    [MENTAL_UNIFORM_ALBEDO_LAYER]        = "albedoLayer",
+    [MENTAL_UNIFORM_ALBEDO_UV_SCALE]     = "albedoUVScale",
+    [MENTAL_UNIFORM_USE_IBL]             = "useIBL",
+    [MENTAL_UNIFORM_IRRADIANCE_MAP]      = "irradianceMap",
+    [MENTAL_UNIFORM_PREFILTER_MAP]       = "prefilterMap",
+    [MENTAL_UNIFORM_BRDF_LUT]            = "brdfLUT",
+    [MENTAL_UNIFORM_PREFILTER_MAX_LOD]   = "prefilterMaxLod",
+    [MENTAL_UNIFORM_ENVIRONMENT_MAP]     = "environmentMap",
+    [MENTAL_UNIFORM_SOURCE_LOD]          = "sourceLod",
+    [MENTAL_UNIFORM_SOURCE_RESOLUTION]   = "sourceResolution",
+    [MENTAL_UNIFORM_PREFILTER_ROUGHNESS] = "roughness",
+    [MENTAL_UNIFORM_USE_VIRTUAL_TEXTURE] = "useVirtualTexture",
+    [MENTAL_UNIFORM_VT_INDIRECTION]      = "vtIndirection",
+    [MENTAL_UNIFORM_VT_PHYSICAL]         = "vtPhysical",
+    [MENTAL_UNIFORM_VT_UV_TRANSFORM]     = "vtUVTransform",
+    [MENTAL_UNIFORM_VT_SIZE]             = "vtSize",
+    [MENTAL_UNIFORM_VT_TILE_SIZE]        = "vtTileSize",
+    [MENTAL_UNIFORM_VT_MIP_COUNT]        = "vtMipCount",
+    [MENTAL_UNIFORM_VT_BORDER]           = "vtBorder",
+    [MENTAL_UNIFORM_VT_PHYSICAL_SIZE]    = "vtPhysicalSize",
+    [MENTAL_UNIFORM_VT_FEEDBACK_BIAS]    = "vtFeedbackBias",
+};
+
+static void mental_uniforms_build(MentalUniformTable* pTable, uint32_t program)
+{
+    memset(pTable, 0, sizeof(*pTable));
+    pTable->program = program;
+    for (int slot = 0; slot < MENTAL_UNIFORM_COUNT; slot++) {
+        pTable->locations[slot] = -1;
+    }
+
+    GLint activeCount = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &activeCount);
+    int found = 0;
+    for (GLint i = 0; i < activeCount; i++) {
+        char name[128];
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, (GLuint)i, sizeof(name), &length, &size, &type, name);
+        char* bracket = strchr(name, '[');
+        if (bracket) {
+            *bracket = '\0';
+        }
+
+        for (int slot = 0; slot < MENTAL_UNIFORM_COUNT; slot++) {
+            if (strcmp(name, g_uniformNames[slot]) != 0) {
+                continue;
+            }
+            // Индекс активного юниформа не равен его location; члены блоков дают -1
+            pTable->locations[slot] = glGetUniformLocation(program, name);
+            if (pTable->locations[slot] != -1) {
+                found++;
+            }
+            break;
+        }
+    }
+
+    g_uniforms.buildCount++;
+    MENTAL_DEBUG("Uniform table for program %u: %d of %d active uniforms mapped", program, found, activeCount);
+}
+
+MentalUniformTable* mentalUniformsFor(uint32_t program)
+{
+    if (program == 0) {
+        return NULL;
+    }
+
+    MentalUniformTable* pTable = g_uniforms.pLast;
+    if (!pTable || pTable->program != program) {
+        pTable = NULL;
+        for (uint32_t i = 0; i < g_uniforms.tableCount; i++) {
+            if (g_uniforms.tables[i].program == program) {
+                pTable = &g_uniforms.tables[i];
+                break;
+            }
+        }
+    }
+
+    if (!pTable) {
+        if (g_uniforms.tableCount < MENTAL_UNIFORM_MAX_TABLES) {
+            pTable = &g_uniforms.tables[g_uniforms.tableCount++];
+        } else {
+            // Вытесняем давно не использованную таблицу: при повторном обращении
+            // она просто построится заново, а значения загрузятся еще раз
+            pTable = &g_uniforms.tables[0];
+            for (uint32_t i = 1; i < g_uniforms.tableCount; i++) {
+                if (g_uniforms.tables[i].lastUse < pTable->lastUse) {
+                    pTable = &g_uniforms.tables[i];
+                }
+            }
+        }
+        mental_uniforms_build(pTable, program);
+    }
+
+    pTable->lastUse = ++g_uniforms.useClock;
+    g_uniforms.pLast = pTable;
+    return pTable;
+}
+
+void mentalUniformsForget(uint32_t program)
+{
+    for (uint32_t i = 0; i < g_uniforms.tableCount; i++) {
+        if (g_uniforms.tables[i].program != program) {
+            continue;
+        }
+        g_uniforms.tables[i] = g_uniforms.tables[--g_uniforms.tableCount];
+        g_uniforms.pLast = NULL;
+        return;
+    }
+}
+
+void mentalUniformsGetStats(MentalUniformStats* pStats)
+{
+    if (!pStats) {
+        return;
+    }
+    pStats->tableCount = g_uniforms.tableCount;
+    pStats->buildCount = g_uniforms.buildCount;
+    pStats->uploadCount = g_uniforms.uploadCount;
+    pStats->skipCount = g_uniforms.skipCount;
+}
+
+void mentalUniformsShutdown(void)
+{
+    MENTAL_DEBUG("Uniforms: %u tables built, %llu uploads, %llu skipped as unchanged", g_uniforms.buildCount,
+                 (unsigned long long)g_uniforms.uploadCount, (unsigned long long)g_uniforms.skipCount);
+    memset(&g_uniforms, 0, sizeof(g_uniforms));
+}
+
+// Возвращает location, если значение нужно загрузить, иначе -1.
+// Сравнение побитовое: NaN и -0.0 тоже не приводят к лишней загрузке.
+static GLint mental_uniform_update(MentalUniformTable* pTable, MentalUniform slot, const void* value, size_t size)
+{
+    if (!pTable || (unsigned)slot >= MENTAL_UNIFORM_COUNT || pTable->locations[slot] == -1) {
+        return -1;
+    }
+    if (pTable->cached[slot] && memcmp(pTable->values[slot], value, size) == 0) {
+        g_uniforms.skipCount++;
+        return -1;
+    }
+    memcpy(pTable->values[slot], value, size);
+    pTable->cached[slot] = true;
+    g_uniforms.uploadCount++;
+    return pTable->locations[slot];
+}
+
+void mentalUniform1i(MentalUniformTable* pTable, MentalUniform slot, int value)
+{
+    GLint location = mental_uniform_update(pTable, slot, &value, sizeof(value));
+    if (location != -1) {
+        glUniform1i(location, value);
+    }
+}
+
+void mentalUniform1f(MentalUniformTable* pTable, MentalUniform slot, float value)
+{
+    GLint location = mental_uniform_update(pTable, slot, &value, sizeof(value));
+    if (location != -1) {
+        glUniform1f(location, value);
+    }
+}
+
+void mentalUniform2f(MentalUniformTable* pTable, MentalUniform slot, float x, float y)
+{
+    mentalUniform2fv(pTable, slot, (const float[2]){x, y});
+}
+
+void mentalUniform3f(MentalUniformTable* pTable, MentalUniform slot, float x, float y, float z)
+{
+    mentalUniform3fv(pTable, slot, (const float[3]){x, y, z});
+}
+
+void mentalUniform2fv(MentalUniformTable* pTable, MentalUniform slot, const float* value)
+{
+    GLint location = mental_uniform_update(pTable, slot, value, sizeof(float) * 2);
+    if (location != -1) {
+        glUniform2fv(location, 1, value);
+    }
+}
+
+void mentalUniform3fv(MentalUniformTable* pTable, MentalUniform slot, const float* value)
+{
+    GLint location = mental_uniform_update(pTable, slot, value, sizeof(float) * 3);
+    if (location != -1) {
+        glUniform3fv(location, 1, value);
+    }
+}
+
+void mentalUniform4fv(MentalUniformTable* pTable, MentalUniform slot, const float* value)
+{
+    GLint location = mental_uniform_update(pTable, slot, value, sizeof(float) * 4);
+    if (location != -1) {
+        glUniform4fv(location, 1, value);
+    }
+}
+
+void mentalUniformMatrix4fv(MentalUniformTable* pTable, MentalUniform slot, const float* value)
+{
+    GLint location = mental_uniform_update(pTable, slot, value, sizeof(float) * 16);
+    if (location != -1) {
+        glUniformMatrix4fv(location, 1, GL_FALSE, value);
+    }
+}
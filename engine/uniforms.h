@@ -0,0 +1,105 @@
+#ifndef mental_uniforms_h
+#define mental_uniforms_h
+
+#include "mental.h"
+
+// Таблицы расположений юниформов. При первом обращении к программе ее
+// активные юниформы перечисляются один раз (glGetActiveUniform) и
+// раскладываются по слотам перечисления ниже; отрисовка больше не вызывает
+// glGetUniformLocation. Заодно таблица помнит последние загруженные значения
+// и пропускает glUniform*, если значение не изменилось с прошлого кадра.
+//
+// Сеттеры пишут в текущую программу: перед ними должен стоять glUseProgram
+// той же программы, для которой получена таблица.
+
+#define MENTAL_UNIFORM_MAX_TABLES       64
+#define MENTAL_UNIFORM_MAX_FLOATS       16
+
+typedef enum MentalUniform {
+    // Преобразования; камера, свет и время кадра — в блоке FrameData (frame.h)
+    MENTAL_UNIFORM_MODEL = 0,
+    MENTAL_UNIFORM_VIEW,
+    MENTAL_UNIFORM_PROJECTION,
+    MENTAL_UNIFORM_SIZE,
+    // Материал
+    MENTAL_UNIFORM_MATERIAL_ALBEDO,
+    MENTAL_UNIFORM_MATERIAL_METALLIC,
+    MENTAL_UNIFORM_MATERIAL_ROUGHNESS,
+    MENTAL_UNIFORM_MATERIAL_AO,
+    MENTAL_UNIFORM_MATERIAL_AMBIENT,
+    MENTAL_UNIFORM_MATERIAL_DIFFUSE,
+    MENTAL_UNIFORM_MATERIAL_SPECULAR,
+    MENTAL_UNIFORM_MATERIAL_SHININESS,
+    MENTAL_UNIFORM_OBJECT_COLOR,
+    MENTAL_UNIFORM_HAS_TEXTURE,
+    MENTAL_UNIFORM_TEXTURE1,
+    MENTAL_UNIFORM_HEIGHT_SCALE,
+    MENTAL_UNIFORM_TESS_EDGE_PIXELS,
+    MENTAL_UNIFORM_TESS_MAX_LEVEL,
+    MENTAL_UNIFORM_ALBEDO_MAP,
+    MENTAL_UNIFORM_NORMAL_MAP,
+    MENTAL_UNIFORM_METALLIC_MAP,
+    MENTAL_UNIFORM_ROUGHNESS_MAP,
+    MENTAL_UNIFORM_AO_MAP,
+    MENTAL_UNIFORM_HEIGHT_MAP,
+    MENTAL_UNIFORM_ALBEDO_ARRAY,
+    MENTAL_UNIFORM_ALBEDO_LAYER,
+    MENTAL_UNIFORM_ALBEDO_UV_SCALE,
+    // IBL
+    MENTAL_UNIFORM_USE_IBL,
+    MENTAL_UNIFORM_IRRADIANCE_MAP,
+    MENTAL_UNIFORM_PREFILTER_MAP,
+    MENTAL_UNIFORM_BRDF_LUT,
+    MENTAL_UNIFORM_PREFILTER_MAX_LOD,
+    // Запекание IBL (ibl.c)
+    MENTAL_UNIFORM_ENVIRONMENT_MAP,
+    MENTAL_UNIFORM_SOURCE_LOD,
+    MENTAL_UNIFORM_SOURCE_RESOLUTION,
+    MENTAL_UNIFORM_PREFILTER_ROUGHNESS,
+    // Виртуальные текстуры
+    MENTAL_UNIFORM_USE_VIRTUAL_TEXTURE,
+    MENTAL_UNIFORM_VT_INDIRECTION,
+    MENTAL_UNIFORM_VT_PHYSICAL,
+    MENTAL_UNIFORM_VT_UV_TRANSFORM,
+    MENTAL_UNIFORM_VT_SIZE,
+    MENTAL_UNIFORM_VT_TILE_SIZE,
+    MENTAL_UNIFORM_VT_MIP_COUNT,
+    MENTAL_UNIFORM_VT_BORDER,
+    MENTAL_UNIFORM_VT_PHYSICAL_SIZE,
+    MENTAL_UNIFORM_VT_FEEDBACK_BIAS,
+    MENTAL_UNIFORM_COUNT
+} MentalUniform;
+
+typedef struct MentalUniformTable {
+    uint32_t   program;
+    int32_t    locations[MENTAL_UNIFORM_COUNT];    // -1 — юниформа в программе нет
+    bool       cached[MENTAL_UNIFORM_COUNT];       // Значение уже загружалось
+    float      values[MENTAL_UNIFORM_COUNT][MENTAL_UNIFORM_MAX_FLOATS];
+    uint64_t   lastUse;
+} MentalUniformTable;
+
+typedef struct MentalUniformStats {
+    uint32_t   tableCount;
+    uint32_t   buildCount;     // Сколько раз программа перечислялась
+    uint64_t   uploadCount;    // Реальных вызовов glUniform*
+    uint64_t   skipCount;      // Пропущенных: значение не изменилось
+} MentalUniformStats;
+
+// Таблица программы; строится при первом обращении. 0 дает NULL.
+MentalUniformTable* mentalUniformsFor(uint32_t program);
+// Забыть таблицу (программа удаляется, ее ID может быть выдан заново)
+void                mentalUniformsForget(uint32_t program);
+void                mentalUniformsGetStats(MentalUniformStats* pStats);
+void                mentalUniformsShutdown(void);
+
+// Сеттеры принимают NULL-таблицу и отсутствующие в программе слоты
+void mentalUniform1i(MentalUniformTable* pTable, MentalUniform slot, int value);
+void mentalUniform1f(MentalUniformTable* pTable, MentalUniform slot, float value);
+void mentalUniform2f(MentalUniformTable* pTable, MentalUniform slot, float x, float y);
+void mentalUniform3f(MentalUniformTable* pTable, MentalUniform slot, float x, float y, float z);
+void mentalUniform2fv(MentalUniformTable* pTable, MentalUniform slot, const float* value);
+void mentalUniform3fv(MentalUniformTable* pTable, MentalUniform slot, const float* value);
+void mentalUniform4fv(MentalUniformTable* pTable, MentalUniform slot, const float* value);
+void mentalUniformMatrix4fv(MentalUniformTable* pTable, MentalUniform slot, const float* value);
+
+#endif // mental_uniforms_h
@@ -0,0 +1,805 @@
+#include "vtex.h"
+#include "component.h"
+#include "wm.h"
+#include "jobs.h"
+#include "texture.h"
+#include "shader.h"
+#include "uniforms.h"
+#include "glstate.h"
+#include "hash.h"
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../stb_image.h"
+
+#define MENTAL_VT_PENDING_BIT   0x80000000u
+#define MENTAL_VT_PINNED        UINT64_MAX
+
+static inline uint32_t mental_vt_key(uint32_t mip, uint32_t x, uint32_t y)
+{
+    return (mip << 24) | (y << 12) | x;
+}
+
+static inline uint32_t mental_vt_tiles(const MentalVirtualTexture* pVT, uint32_t mip)
+{
+    uint32_t tiles = (pVT->header.size / pVT->header.tileSize) >> mip;
+    return tiles > 0 ? tiles : 1;
+}
+
+// ============================
+// Нарезка исходного изображения
+// ============================
+
+static void mental_vt_resample(const unsigned char* src, int srcW, int srcH, unsigned char* dst, uint32_t size)
+{
+    for (uint32_t y = 0; y < size; y++) {
+        float fy = ((float)y + 0.5f) * (float)srcH / (float)size - 0.5f;
+        int y0 = (int)floorf(fy);
+        float ty = fy - (float)y0;
+        int y1 = y0 + 1;
+        if (y0 < 0) y0 = 0;
+        if (y1 > srcH - 1) y1 = srcH - 1;
+        if (y0 > srcH - 1) y0 = srcH - 1;
+        for (uint32_t x = 0; x < size; x++) {
+            float fx = ((float)x + 0.5f) * (float)srcW / (float)size - 0.5f;
+            int x0 = (int)floorf(fx);
+            float tx = fx - (float)x0;
+            int x1 = x0 + 1;
+            if (x0 < 0) x0 = 0;
+            if (x1 > srcW - 1) x1 = srcW - 1;
+            if (x0 > srcW - 1) x0 = srcW - 1;
+            for (int c = 0; c < 4; c++) {
+                float a = src[(y0 * srcW + x0) * 4 + c];
+                float b = src[(y0 * srcW + x1) * 4 + c];
+                float d = src[(y1 * srcW + x0) * 4 + c];
+                float e = src[(y1 * srcW + x1) * 4 + c];
+                float top = a + (b - a) * tx;
+                float bottom = d + (e - d) * tx;
+                dst[((size_t)y * size + x) * 4 + c] = (unsigned char)(top + (bottom - top) * ty + 0.5f);
+            }
+        }
+    }
+}
+
+static void mental_vt_downscale(const unsigned char* src, uint32_t srcSize, unsigned char* dst)
+{
+    uint32_t dstSize = srcSize / 2;
+    for (uint32_t y = 0; y < dstSize; y++) {
+        for (uint32_t x = 0; x < dstSize; x++) {
+            for (int c = 0; c < 4; c++) {
+                uint32_t sum = src[((size_t)(2 * y) * srcSize + 2 * x) * 4 + c] +
+                               src[((size_t)(2 * y) * srcSize + 2 * x + 1) * 4 + c] +
+                               src[((size_t)(2 * y + 1) * srcSize + 2 * x) * 4 + c] +
+                               src[((size_t)(2 * y + 1) * srcSize + 2 * x + 1) * 4 + c];
+                dst[((size_t)y * dstSize + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+MentalResult mentalBakeVirtualTexture(const char* source_path, const char* page_file, uint32_t tileSize)
+{
+    if (!source_path || !page_file) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    if (tileSize == 0) {
+        tileSize = MENTAL_VT_DEFAULT_TILE_SIZE;
+    }
+
+    int width, height, channels;
+    unsigned char* src = stbi_load(source_path, &width, &height, &channels, 4);
+    if (!src) {
+        MENTAL_DEBUG("Failed to load virtual texture source: %s", source_path);
+        return MENTAL_ERROR_TEXTURE_LOAD_FAILED;
+    }
+
+    // Виртуальная текстура — квадрат со стороной-степенью двойки, кратной тайлу
+    uint32_t size = tileSize;
+    while (size < (uint32_t)width || size < (uint32_t)height) {
+        size <<= 1;
+    }
+    uint32_t mipCount = 1;
+    while ((size >> (mipCount - 1)) > tileSize && mipCount < MENTAL_VT_MAX_MIPS) {
+        mipCount++;
+    }
+    if ((size >> (mipCount - 1)) != tileSize) {
+        MENTAL_DEBUG("Virtual texture %s is too large: %ux%u", source_path, size, size);
+        stbi_image_free(src);
+        return MENTAL_ERROR_TEXTURE_UNSUPPORTED_FORMAT;
+    }
+
+    unsigned char* level = malloc((size_t)size * size * 4);
+    if (!level) {
+        stbi_image_free(src);
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+    if ((uint32_t)width == size && (uint32_t)height == size) {
+        memcpy(level, src, (size_t)size * size * 4);
+    } else {
+        mental_vt_resample(src, width, height, level, size);
+    }
+    stbi_image_free(src);
+
+    FILE* file = fopen(page_file, "wb");
+    if (!file) {
+        MENTAL_DEBUG("Failed to create page file: %s", page_file);
+        free(level);
+        return MENTAL_FILE_OPEN_FAILED;
+    }
+
+    MentalVTFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MENTAL_VT_MAGIC, 4);
+    header.version = MENTAL_VT_VERSION;
+    header.size = size;
+    header.tileSize = tileSize;
+    header.border = MENTAL_VT_BORDER;
+    header.mipCount = mipCount;
+    fwrite(&header, sizeof(header), 1, file);
+
+    uint32_t padded = tileSize + 2 * MENTAL_VT_BORDER;
+    unsigned char* tile = malloc((size_t)padded * padded * 4);
+    if (!tile) {
+        fclose(file);
+        free(level);
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+
+    uint32_t levelSize = size;
+    for (uint32_t mip = 0; mip < mipCount; mip++) {
+        header.mipOffsets[mip] = (uint64_t)ftell(file);
+        uint32_t tiles = levelSize / tileSize;
+        for (uint32_t ty = 0; ty < tiles; ty++) {
+            for (uint32_t tx = 0; tx < tiles; tx++) {
+                // Тайл с рамкой: соседние тексели берутся с прижатием к краю уровня
+                for (uint32_t py = 0; py < padded; py++) {
+                    int sy = (int)(ty * tileSize + py) - MENTAL_VT_BORDER;
+                    if (sy < 0) sy = 0;
+                    if (sy > (int)levelSize - 1) sy = (int)levelSize - 1;
+                    for (uint32_t px = 0; px < padded; px++) {
+                        int sx = (int)(tx * tileSize + px) - MENTAL_VT_BORDER;
+                        if (sx < 0) sx = 0;
+                        if (sx > (int)levelSize - 1) sx = (int)levelSize - 1;
+                        memcpy(&tile[((size_t)py * padded + px) * 4], &level[((size_t)sy * levelSize + sx) * 4], 4);
+                    }
+                }
+                fwrite(tile, 1, (size_t)padded * padded * 4, file);
+            }
+        }
+
+        if (mip + 1 < mipCount) {
+            mental_vt_downscale(level, levelSize, level);
+            levelSize /= 2;
+        }
+    }
+
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    fclose(file);
+    free(tile);
+    free(level);
+
+    MENTAL_DEBUG("Virtual texture baked: %s -> %s (%ux%u, %u mips, tile %u)",
+                 source_path, page_file, size, size, mipCount, tileSize);
+    return MENTAL_OK;
+}
+
+// Ключ кэша: содержимое исходного файла и все, что меняет нарезку
+static bool mental_vt_source_hash(const char* source_path, uint32_t tileSize, uint64_t* pHash)
+{
+    FILE* file = fopen(source_path, "rb");
+    if (!file) {
+        return false;
+    }
+    uint32_t params[3] = { MENTAL_VT_VERSION, tileSize, MENTAL_VT_BORDER };
+    uint64_t hash = mentalHashBytes(params, sizeof(params), MENTAL_HASH_SEED);
+    unsigned char buffer[64 * 1024];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        hash = mentalHashBytes(buffer, read, hash);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    *pHash = hash;
+    return ok;
+}
+
+MentalResult mentalVirtualTexturePageFile(const char* source_path, uint32_t tileSize, char* page_file, size_t size)
+{
+    if (!source_path || !page_file) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+    if (tileSize == 0) {
+        tileSize = MENTAL_VT_DEFAULT_TILE_SIZE;
+    }
+
+    uint64_t hash = 0;
+    if (!mental_vt_source_hash(source_path, tileSize, &hash)) {
+        MENTAL_DEBUG("Failed to read virtual texture source: %s", source_path);
+        return MENTAL_FILE_OPEN_FAILED;
+    }
+    snprintf(page_file, size, "%s/vt_%016llx.mvt", MENTAL_VT_CACHE_DIR, (unsigned long long)hash);
+    if (access(page_file, R_OK) == 0) {
+        return MENTAL_OK;
+    }
+
+    // Нарезка пишется во временный файл и переименовывается целиком: оборванная
+    // запись не оставит в кэше битый page file
+    char temp_file[512];
+    snprintf(temp_file, sizeof(temp_file), "%s.%d.tmp", page_file, (int)getpid());
+    mkdir(MENTAL_VT_CACHE_DIR, 0755);
+    MentalResult result = mentalBakeVirtualTexture(source_path, temp_file, tileSize);
+    if (result != MENTAL_OK) {
+        remove(temp_file);
+        return result;
+    }
+    if (rename(temp_file, page_file) != 0) {
+        MENTAL_DEBUG("Failed to move page file into the cache: %s", page_file);
+        remove(temp_file);
+        return MENTAL_FILE_OPEN_FAILED;
+    }
+    return MENTAL_OK;
+}
+
+// ============================
+// Фоновая подгрузка тайлов
+// ============================
+
+static void mental_vt_load_job(void* pArg)
+{
+    MentalVTLoad* pLoad = pArg;
+    MentalVirtualTexture* pVT = pLoad->pVT;
+
+    uint32_t mip = pLoad->key >> 24;
+    uint32_t y = (pLoad->key >> 12) & 0xFFF;
+    uint32_t x = pLoad->key & 0xFFF;
+    size_t tileBytes = (size_t)pVT->paddedTile * pVT->paddedTile * 4;
+    off_t offset = (off_t)(pVT->header.mipOffsets[mip] + ((uint64_t)y * mental_vt_tiles(pVT, mip) + x) * tileBytes);
+
+    pLoad->data = malloc(tileBytes);
+    pLoad->ok = pLoad->data && pread(pVT->fd, pLoad->data, tileBytes, offset) == (ssize_t)tileBytes;
+
+    pthread_mutex_lock(&pVT->mutex);
+    pVT->completed[pVT->completedCount++] = pLoad;
+    pthread_mutex_unlock(&pVT->mutex);
+}
+
+static void mental_vt_upload(MentalVirtualTexture* pVT, uint32_t slot, const unsigned char* data)
+{
+    uint32_t sx = slot % pVT->pagesPerSide;
+    uint32_t sy = slot / pVT->pagesPerSide;
+    mentalGLBindTexture(GL_TEXTURE_2D, pVT->physicalTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, sx * pVT->paddedTile, sy * pVT->paddedTile,
+                    pVT->paddedTile, pVT->paddedTile, GL_RGBA, GL_UNSIGNED_BYTE, data);
+}
+
+// Выбор слота: свободный или самый давно использованный, не нужный в этом кадре
+static int64_t mental_vt_find_slot(MentalVirtualTexture* pVT)
+{
+    int64_t best = -1;
+    uint64_t bestFrame = MENTAL_VT_PINNED;
+    for (uint32_t i = 0; i < pVT->slotCount; i++) {
+        MentalVTSlot* pSlot = &pVT->slots[i];
+        if (!pSlot->used) {
+            return i;
+        }
+        if (pSlot->lastUsed < pVT->frame && pSlot->lastUsed < bestFrame) {
+            bestFrame = pSlot->lastUsed;
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Страница уровня mip меняет записи своего уровня и всех более подробных, которые на нее ссылаются
+static inline void mental_vt_mark_dirty(MentalVirtualTexture* pVT, uint32_t mip)
+{
+    if ((int32_t)mip > pVT->indirectionDirtyMip) {
+        pVT->indirectionDirtyMip = (int32_t)mip;
+    }
+}
+
+static void mental_vt_make_resident(MentalVirtualTexture* pVT, uint32_t key, uint32_t slot, const unsigned char* data)
+{
+    MentalVTSlot* pSlot = &pVT->slots[slot];
+    if (pSlot->used) {
+        uint32_t oldMip = pSlot->key >> 24;
+        uint32_t oldY = (pSlot->key >> 12) & 0xFFF;
+        uint32_t oldX = pSlot->key & 0xFFF;
+        pVT->pageState[oldMip][oldY * mental_vt_tiles(pVT, oldMip) + oldX] = 0;
+        pVT->residentPages--;
+        mental_vt_mark_dirty(pVT, oldMip);
+    }
+
+    mental_vt_upload(pVT, slot, data);
+
+    uint32_t mip = key >> 24;
+    uint32_t y = (key >> 12) & 0xFFF;
+    uint32_t x = key & 0xFFF;
+    pVT->pageState[mip][y * mental_vt_tiles(pVT, mip) + x] = slot + 1;
+    pSlot->key = key;
+    pSlot->used = true;
+    pSlot->lastUsed = pVT->frame;
+    pVT->residentPages++;
+    mental_vt_mark_dirty(pVT, mip);
+}
+
+// Каждая страница без данных ссылается на ближайшего загруженного предка.
+// Пересобираются только измененный уровень и более подробные под ним: грубые
+// уровни от них не зависят
+static void mental_vt_rebuild_indirection(MentalVirtualTexture* pVT)
+{
+    mentalGLBindTexture(GL_TEXTURE_2D, pVT->indirectionTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (int mip = pVT->indirectionDirtyMip; mip >= 0; mip--) {
+        uint32_t tiles = mental_vt_tiles(pVT, mip);
+        for (uint32_t y = 0; y < tiles; y++) {
+            for (uint32_t x = 0; x < tiles; x++) {
+                uint32_t state = pVT->pageState[mip][y * tiles + x] & ~MENTAL_VT_PENDING_BIT;
+                uint32_t entry;
+                if (state != 0) {
+                    uint32_t slot = state - 1;
+                    entry = (slot % pVT->pagesPerSide) | ((slot / pVT->pagesPerSide) << 8) |
+                            ((uint32_t)mip << 16) | (0xFFu << 24);
+                } else {
+                    uint32_t parentTiles = mental_vt_tiles(pVT, mip + 1);
+                    entry = pVT->indirection[mip + 1][(y / 2) * parentTiles + (x / 2)];
+                }
+                pVT->indirection[mip][y * tiles + x] = entry;
+            }
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, mip, 0, 0, tiles, tiles, GL_RGBA, GL_UNSIGNED_BYTE, pVT->indirection[mip]);
+    }
+    pVT->indirectionDirtyMip = -1;
+}
+
+MentalResult mentalCreateVirtualTexture(MentalVirtualTexture* pVT, const char* page_file, uint32_t budgetBytes)
+{
+    if (!pVT || !page_file) {
+        MENTAL_DEBUG("Virtual texture or page file pointer is null.");
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    memset(pVT, 0, sizeof(MentalVirtualTexture));
+    pVT->indirectionDirtyMip = -1;
+    pVT->fd = open(page_file, O_RDONLY);
+    if (pVT->fd < 0) {
+        MENTAL_DEBUG("Failed to open page file: %s", page_file);
+        return MENTAL_FILE_OPEN_FAILED;
+    }
+
+    if (pread(pVT->fd, &pVT->header, sizeof(pVT->header), 0) != (ssize_t)sizeof(pVT->header) ||
+        memcmp(pVT->header.magic, MENTAL_VT_MAGIC, 4) != 0 || pVT->header.version != MENTAL_VT_VERSION ||
+        pVT->header.mipCount == 0 || pVT->header.mipCount > MENTAL_VT_MAX_MIPS) {
+        MENTAL_DEBUG("Invalid page file: %s", page_file);
+        close(pVT->fd);
+        return MENTAL_ERROR_TEXTURE_UNSUPPORTED_FORMAT;
+    }
+
+    pthread_mutex_init(&pVT->mutex, NULL);
+    pthread_cond_init(&pVT->idle, NULL);
+    pVT->paddedTile = pVT->header.tileSize + 2 * pVT->header.border;
+    pVT->uvTransform[0] = 1.0f;
+    pVT->uvTransform[1] = 1.0f;
+
+    // Размер физического кэша определяется бюджетом VRAM
+    if (budgetBytes == 0) {
+        budgetBytes = MENTAL_VT_DEFAULT_BUDGET;
+    }
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    uint32_t tileBytes = pVT->paddedTile * pVT->paddedTile * 4;
+    pVT->pagesPerSide = (uint32_t)sqrt((double)(budgetBytes / tileBytes));
+    if (maxSize > 0 && pVT->pagesPerSide * pVT->paddedTile > (uint32_t)maxSize) {
+        pVT->pagesPerSide = (uint32_t)maxSize / pVT->paddedTile;
+    }
+    if (pVT->pagesPerSide > 255) pVT->pagesPerSide = 255;
+    if (pVT->pagesPerSide < 2) pVT->pagesPerSide = 2;
+    pVT->slotCount = pVT->pagesPerSide * pVT->pagesPerSide;
+    pVT->slots = calloc(pVT->slotCount, sizeof(MentalVTSlot));
+
+    for (uint32_t mip = 0; mip < pVT->header.mipCount; mip++) {
+        uint32_t pages = mental_vt_tiles(pVT, mip) * mental_vt_tiles(pVT, mip);
+        pVT->pageState[mip] = calloc(pages, sizeof(uint32_t));
+        pVT->indirection[mip] = calloc(pages, sizeof(uint32_t));
+        pVT->requestFrame[mip] = calloc(pages, sizeof(uint64_t));
+        if (!pVT->pageState[mip] || !pVT->indirection[mip] || !pVT->requestFrame[mip]) {
+            mentalDestroyVirtualTexture(pVT);
+            return MENTAL_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    if (!pVT->slots) {
+        mentalDestroyVirtualTexture(pVT);
+        return MENTAL_ERROR_OUT_OF_MEMORY;
+    }
+
+    glGenTextures(1, &pVT->physicalTexture);
+    mentalGLBindTexture(GL_TEXTURE_2D, pVT->physicalTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, pVT->pagesPerSide * pVT->paddedTile, pVT->pagesPerSide * pVT->paddedTile,
+                 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    mentalTextureRegister(pVT->physicalTexture, GL_TEXTURE_2D, pVT->pagesPerSide * pVT->paddedTile,
+                          pVT->pagesPerSide * pVT->paddedTile, 1, 4, MENTAL_TEXTURE_FLAG_PINNED, NULL);
+
+    glGenTextures(1, &pVT->indirectionTexture);
+    mentalGLBindTexture(GL_TEXTURE_2D, pVT->indirectionTexture);
+    for (uint32_t mip = 0; mip < pVT->header.mipCount; mip++) {
+        uint32_t tiles = mental_vt_tiles(pVT, mip);
+        glTexImage2D(GL_TEXTURE_2D, mip, GL_RGBA8, tiles, tiles, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, pVT->header.mipCount - 1);
+    mentalTextureRegister(pVT->indirectionTexture, GL_TEXTURE_2D, mental_vt_tiles(pVT, 0), mental_vt_tiles(pVT, 0), 1, 4,
+                          MENTAL_TEXTURE_FLAG_MIPMAPS | MENTAL_TEXTURE_FLAG_PINNED, NULL);
+
+    // Самый грубый уровень (один тайл) загружаем сразу и закрепляем навсегда
+    MentalVTLoad root = { .pVT = pVT, .key = mental_vt_key(pVT->header.mipCount - 1, 0, 0) };
+    mental_vt_load_job(&root);
+    pVT->completedCount = 0;
+    if (!root.ok) {
+        free(root.data);
+        MENTAL_DEBUG("Failed to read root tile from page file: %s", page_file);
+        mentalDestroyVirtualTexture(pVT);
+        return MENTAL_FILE_OPEN_FAILED;
+    }
+    mental_vt_make_resident(pVT, root.key, 0, root.data);
+    pVT->slots[0].lastUsed = MENTAL_VT_PINNED;
+    free(root.data);
+    mental_vt_rebuild_indirection(pVT);
+    mentalGLBindTexture(GL_TEXTURE_2D, 0);
+
+    MENTAL_DEBUG("Virtual texture created: %s (%ux%u, %u mips, cache %ux%u pages, %u KB)",
+                 page_file, pVT->header.size, pVT->header.size, pVT->header.mipCount,
+                 pVT->pagesPerSide, pVT->pagesPerSide, (pVT->slotCount * tileBytes) / 1024);
+    return MENTAL_OK;
+}
+
+// ============================
+// Проход обратной связи
+// ============================
+
+static MentalResult mental_vt_create_feedback(MentalVirtualTexture* pVT, int width, int height)
+{
+    if (pVT->feedbackProgram == 0) {
+        MentalComponent program = {0};
+        if (mentalAttachShader(&program, "ground_vertex.glsl", "vt_feedback_fragment.glsl") != MENTAL_OK) {
+            MENTAL_DEBUG("Failed to compile virtual texture feedback shader.");
+            return MENTAL_SHADER_COMPILE_FAILED;
+        }
+        pVT->feedbackProgram = program.shaderProgram;
+    }
+
+    if (pVT->feedbackFBO != 0) {
+        mentalGLDeleteFramebuffers(1, &pVT->feedbackFBO);
+        mentalGLDeleteTextures(1, &pVT->feedbackTexture);
+        glDeleteRenderbuffers(1, &pVT->feedbackDepth);
+        glDeleteBuffers(2, pVT->feedbackPBO);
+    }
+
+    glGenTextures(1, &pVT->feedbackTexture);
+    mentalGLBindTexture(GL_TEXTURE_2D, pVT->feedbackTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenRenderbuffers(1, &pVT->feedbackDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, pVT->feedbackDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    glGenFramebuffers(1, &pVT->feedbackFBO);
+    mentalGLBindFramebuffer(GL_FRAMEBUFFER, pVT->feedbackFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pVT->feedbackTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, pVT->feedbackDepth);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    mentalGLBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        MENTAL_DEBUG("Virtual texture feedback framebuffer is incomplete: 0x%X", status);
+        return MENTAL_ERROR;
+    }
+
+    // Два PBO: читаем результат предыдущего кадра, не дожидаясь GPU
+    glGenBuffers(2, pVT->feedbackPBO);
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pVT->feedbackPBO[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+        pVT->feedbackPending[i] = false;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pVT->feedbackSize[0] = width;
+    pVT->feedbackSize[1] = height;
+    return MENTAL_OK;
+}
+
+static void mental_vt_set_uniforms(MentalVirtualTexture* pVT, MentalUniformTable* pUniforms)
+{
+    mentalUniform4fv(pUniforms, MENTAL_UNIFORM_VT_UV_TRANSFORM, pVT->uvTransform);
+    mentalUniform1f(pUniforms, MENTAL_UNIFORM_VT_SIZE, (float)pVT->header.size);
+    mentalUniform1f(pUniforms, MENTAL_UNIFORM_VT_TILE_SIZE, (float)pVT->header.tileSize);
+    mentalUniform1f(pUniforms, MENTAL_UNIFORM_VT_MIP_COUNT, (float)pVT->header.mipCount);
+}
+
+MentalResult mentalRenderVirtualTextureFeedback(MentalVirtualTexture* pVT, MentalComponent* pComponent, MentalWindowManager* pManager)
+{
+    if (!pVT || !pComponent || !pManager) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    int width = pManager->pInfo->aSizes[0] / MENTAL_VT_FEEDBACK_DIVISOR;
+    int height = pManager->pInfo->aSizes[1] / MENTAL_VT_FEEDBACK_DIVISOR;
+    if (width < 1) width = 1;
+    if (height < 1) height = 1;
+    if (width != pVT->feedbackSize[0] || height != pVT->feedbackSize[1]) {
+        MentalResult result = mental_vt_create_feedback(pVT, width, height);
+        if (result != MENTAL_OK) {
+            return result;
+        }
+    }
+
+    // Пока программа обратной связи компилируется, проход пропускается:
+    // заглушка не пишет номера страниц
+    if (!mentalShaderIsReady(pVT->feedbackProgram)) {
+        return MENTAL_OK;
+    }
+
+    mentalGLBindFramebuffer(GL_FRAMEBUFFER, pVT->feedbackFBO);
+    mentalGLViewport(0, 0, width, height);
+    // Альфа 1.0 (255) означает "запроса нет"
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    mentalGLUseProgram(pVT->feedbackProgram);
+    MentalUniformTable* pUniforms = mentalUniformsFor(pVT->feedbackProgram);
+
+    // Камера берется из блока FrameData: кадр уже обновлен до прохода feedback
+    mentalUniformMatrix4fv(pUniforms, MENTAL_UNIFORM_MODEL, (float*)mentalTransformWorld(&pComponent->transform));
+    mental_vt_set_uniforms(pVT, pUniforms);
+    mentalUniform1f(pUniforms, MENTAL_UNIFORM_VT_FEEDBACK_BIAS, log2f((float)MENTAL_VT_FEEDBACK_DIVISOR));
+
+    mentalGLBindVertexArray(pComponent->VAO);
+    glDrawElements(GL_TRIANGLES, pComponent->indexCount, GL_UNSIGNED_INT, 0);
+    mentalGLBindVertexArray(0);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pVT->feedbackPBO[pVT->feedbackIndex]);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    pVT->feedbackPending[pVT->feedbackIndex] = true;
+    pVT->feedbackIndex ^= 1;
+
+    mentalGLBindFramebuffer(GL_FRAMEBUFFER, 0);
+    mentalGLViewport(0, 0, pManager->pInfo->aSizes[0], pManager->pInfo->aSizes[1]);
+    return MENTAL_OK;
+}
+
+// ============================
+// Обработка запросов и загрузка
+// ============================
+
+typedef struct MentalVTRequest {
+    uint32_t key;
+} MentalVTRequest;
+
+// Сначала грубые уровни: они покрывают больше экрана и нужны как запасной вариант
+static int mental_vt_compare_requests(const void* a, const void* b)
+{
+    uint32_t mipA = ((const MentalVTRequest*)a)->key >> 24;
+    uint32_t mipB = ((const MentalVTRequest*)b)->key >> 24;
+    return (int)mipB - (int)mipA;
+}
+
+static void mental_vt_touch(MentalVirtualTexture* pVT, uint32_t mip, uint32_t x, uint32_t y)
+{
+    // Загруженные предки тоже считаются использованными — ими закрываются дыры
+    for (; mip < pVT->header.mipCount; mip++, x /= 2, y /= 2) {
+        uint32_t state = pVT->pageState[mip][y * mental_vt_tiles(pVT, mip) + x] & ~MENTAL_VT_PENDING_BIT;
+        if (state != 0 && pVT->slots[state - 1].lastUsed != MENTAL_VT_PINNED) {
+            pVT->slots[state - 1].lastUsed = pVT->frame;
+        }
+    }
+}
+
+static void mental_vt_process_feedback(MentalVirtualTexture* pVT)
+{
+    uint32_t readIndex = pVT->feedbackIndex;  // PBO, записанный кадр назад
+    if (!pVT->feedbackPending[readIndex]) {
+        return;
+    }
+
+    size_t pixelCount = (size_t)pVT->feedbackSize[0] * pVT->feedbackSize[1];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pVT->feedbackPBO[readIndex]);
+    const unsigned char* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixelCount * 4, GL_MAP_READ_BIT);
+    if (!pixels) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return;
+    }
+
+    MentalVTRequest requests[MENTAL_VT_MAX_LOADS_IN_FLIGHT * 4];
+    uint32_t requestCount = 0;
+
+    for (size_t i = 0; i < pixelCount; i++) {
+        const unsigned char* p = &pixels[i * 4];
+        uint32_t mip = p[3];
+        if (mip >= pVT->header.mipCount) {
+            continue;
+        }
+        uint32_t x = p[0] | ((uint32_t)(p[2] & 0x0F) << 8);
+        uint32_t y = p[1] | ((uint32_t)(p[2] >> 4) << 8);
+        uint32_t tiles = mental_vt_tiles(pVT, mip);
+        if (x >= tiles || y >= tiles) {
+            continue;
+        }
+
+        uint32_t index = y * tiles + x;
+        if (pVT->requestFrame[mip][index] == pVT->frame) {
+            continue;
+        }
+        pVT->requestFrame[mip][index] = pVT->frame;
+
+        mental_vt_touch(pVT, mip, x, y);
+        if (pVT->pageState[mip][index] == 0 && requestCount < sizeof(requests) / sizeof(requests[0])) {
+            requests[requestCount++].key = mental_vt_key(mip, x, y);
+        }
+    }
+
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    pVT->feedbackPending[readIndex] = false;
+
+    qsort(requests, requestCount, sizeof(MentalVTRequest), mental_vt_compare_requests);
+
+    for (uint32_t i = 0; i < requestCount; i++) {
+        pthread_mutex_lock(&pVT->mutex);
+        bool full = pVT->inFlight >= MENTAL_VT_MAX_LOADS_IN_FLIGHT;
+        if (!full) {
+            pVT->inFlight++;
+        }
+        pthread_mutex_unlock(&pVT->mutex);
+        if (full) {
+            break;
+        }
+
+        uint32_t key = requests[i].key;
+        uint32_t mip = key >> 24;
+        uint32_t y = (key >> 12) & 0xFFF;
+        uint32_t x = key & 0xFFF;
+        pVT->pageState[mip][y * mental_vt_tiles(pVT, mip) + x] = MENTAL_VT_PENDING_BIT;
+
+        MentalVTLoad* pLoad = calloc(1, sizeof(MentalVTLoad));
+        if (!pLoad) {
+            pVT->pageState[mip][y * mental_vt_tiles(pVT, mip) + x] = 0;
+            pthread_mutex_lock(&pVT->mutex);
+            pVT->inFlight--;
+            pthread_mutex_unlock(&pVT->mutex);
+            break;
+        }
+        pLoad->pVT = pVT;
+        pLoad->key = key;
+        mentalJobsSubmit(mental_vt_load_job, pLoad);
+    }
+}
+
+MentalResult mentalUpdateVirtualTexture(MentalVirtualTexture* pVT)
+{
+    if (!pVT) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    pVT->frame++;
+    mental_vt_process_feedback(pVT);
+
+    // Забираем готовые тайлы, не больше лимита загрузок за кадр
+    MentalVTLoad* ready[MENTAL_VT_UPLOADS_PER_FRAME];
+    uint32_t readyCount = 0;
+    pthread_mutex_lock(&pVT->mutex);
+    while (pVT->completedCount > 0 && readyCount < MENTAL_VT_UPLOADS_PER_FRAME) {
+        ready[readyCount++] = pVT->completed[--pVT->completedCount];
+    }
+    pthread_mutex_unlock(&pVT->mutex);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    pVT->uploadsLastFrame = 0;
+    for (uint32_t i = 0; i < readyCount; i++) {
+        MentalVTLoad* pLoad = ready[i];
+        uint32_t mip = pLoad->key >> 24;
+        uint32_t y = (pLoad->key >> 12) & 0xFFF;
+        uint32_t x = pLoad->key & 0xFFF;
+        uint32_t* pState = &pVT->pageState[mip][y * mental_vt_tiles(pVT, mip) + x];
+        *pState = 0;
+
+        int64_t slot = pLoad->ok ? mental_vt_find_slot(pVT) : -1;
+        if (slot >= 0) {
+            mental_vt_make_resident(pVT, pLoad->key, (uint32_t)slot, pLoad->data);
+            pVT->uploadsLastFrame++;
+        }
+
+        free(pLoad->data);
+        free(pLoad);
+        pthread_mutex_lock(&pVT->mutex);
+        pVT->inFlight--;
+        pthread_cond_broadcast(&pVT->idle);
+        pthread_mutex_unlock(&pVT->mutex);
+    }
+
+    if (pVT->indirectionDirtyMip >= 0) {
+        mental_vt_rebuild_indirection(pVT);
+        mentalGLBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    return MENTAL_OK;
+}
+
+MentalResult mentalBindVirtualTexture(MentalVirtualTexture* pVT, uint32_t program, int firstUnit)
+{
+    if (!pVT) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    mentalGLActiveTexture(GL_TEXTURE0 + firstUnit);
+    mentalGLBindTexture(GL_TEXTURE_2D, pVT->indirectionTexture);
+    mentalGLActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+    mentalGLBindTexture(GL_TEXTURE_2D, pVT->physicalTexture);
+    mentalGLActiveTexture(GL_TEXTURE0);
+
+    MentalUniformTable* pUniforms = mentalUniformsFor(program);
+    mentalUniform1i(pUniforms, MENTAL_UNIFORM_VT_INDIRECTION, firstUnit);
+    mentalUniform1i(pUniforms, MENTAL_UNIFORM_VT_PHYSICAL, firstUnit + 1);
+    mental_vt_set_uniforms(pVT, pUniforms);
+    mentalUniform1f(pUniforms, MENTAL_UNIFORM_VT_BORDER, (float)pVT->header.border);
+    mentalUniform1f(pUniforms, MENTAL_UNIFORM_VT_PHYSICAL_SIZE, (float)(pVT->pagesPerSide * pVT->paddedTile));
+    return MENTAL_OK;
+}
+
+MentalResult mentalDestroyVirtualTexture(MentalVirtualTexture* pVT)
+{
+    if (!pVT) {
+        return MENTAL_POINTER_IS_NULL;
+    }
+
+    // Дожидаемся фоновых чтений: они пишут в структуру и читают fd
+    pthread_mutex_lock(&pVT->mutex);
+    while (pVT->inFlight > 0) {
+        while (pVT->completedCount > 0) {
+            MentalVTLoad* pLoad = pVT->completed[--pVT->completedCount];
+            free(pLoad->data);
+            free(pLoad);
+            pVT->inFlight--;
+        }
+        if (pVT->inFlight > 0) {
+            pthread_cond_wait(&pVT->idle, &pVT->mutex);
+        }
+    }
+    pthread_mutex_unlock(&pVT->mutex);
+
+    mentalTextureDelete(&pVT->physicalTexture);
+    mentalTextureDelete(&pVT->indirectionTexture);
+    if (pVT->feedbackTexture) mentalGLDeleteTextures(1, &pVT->feedbackTexture);
+    if (pVT->feedbackDepth) glDeleteRenderbuffers(1, &pVT->feedbackDepth);
+    if (pVT->feedbackFBO) mentalGLDeleteFramebuffers(1, &pVT->feedbackFBO);
+    if (pVT->feedbackPBO[0]) glDeleteBuffers(2, pVT->feedbackPBO);
+    if (pVT->feedbackProgram) mentalShaderRelease(pVT->feedbackProgram);
+
+    for (uint32_t mip = 0; mip < MENTAL_VT_MAX_MIPS; mip++) {
+        free(pVT->pageState[mip]);
+        free(pVT->indirection[mip]);
+        free(pVT->requestFrame[mip]);
+    }
+    free(pVT->slots);
+    if (pVT->fd >= 0) {
+        close(pVT->fd);
+    }
+    pthread_mutex_destroy(&pVT->mutex);
+    pthread_cond_destroy(&pVT->idle);
+
+    memset(pVT, 0, sizeof(MentalVirtualTexture));
+    pVT->fd = -1;
+    MENTAL_DEBUG("Virtual texture destroyed.");
+    return MENTAL_OK;
+}
@@ -0,0 +1,99 @@
+#ifndef mental_vtex_h
+#define mental_vtex_h
+
+#include "mental.h"
+#include <pthread.h>
+
+// Виртуальное текстурирование для больших текстур местности.
+// Исходное изображение заранее нарезается на тайлы (page file *.mvt) со всеми
+// уровнями мипмапов. Во время работы в VRAM живет только физический кэш тайлов
+// фиксированного размера и таблица косвенной адресации (indirection).
+// Проход обратной связи (feedback) в низком разрешении определяет, какие тайлы
+// и на каком мип-уровне видны, а фоновые задачи подгружают их с диска.
+
+#define MENTAL_VT_MAGIC                 "MVT1"
+#define MENTAL_VT_VERSION               1
+#define MENTAL_VT_MAX_MIPS              13      // До 4096 тайлов по стороне
+#define MENTAL_VT_DEFAULT_TILE_SIZE     128
+#define MENTAL_VT_BORDER                4       // Рамка тайла для билинейной фильтрации
+#define MENTAL_VT_DEFAULT_BUDGET        (32u * 1024u * 1024u)
+#define MENTAL_VT_FEEDBACK_DIVISOR      8       // Feedback рисуется в 1/8 разрешения экрана
+#define MENTAL_VT_MAX_LOADS_IN_FLIGHT   32
+#define MENTAL_VT_UPLOADS_PER_FRAME     16
+#define MENTAL_VT_CACHE_DIR             ".mental_cache"
+
+typedef struct MentalComponent MentalComponent;
+typedef struct MentalWindowManager MentalWindowManager;
+
+// Заголовок page file (хранится в начале файла как есть)
+typedef struct MentalVTFileHeader {
+    char       magic[4];
+    uint32_t   version;
+    uint32_t   size;                            // Сторона виртуальной текстуры в текселях
+    uint32_t   tileSize;                        // Полезная сторона тайла без рамки
+    uint32_t   border;
+    uint32_t   mipCount;
+    uint64_t   mipOffsets[MENTAL_VT_MAX_MIPS];  // Смещение первого тайла каждого уровня
+} MentalVTFileHeader;
+
+typedef struct MentalVTSlot {
+    uint32_t   key;            // (mip << 24) | (y << 12) | x
+    uint64_t   lastUsed;       // Кадр последнего обращения (UINT64_MAX — закреплен)
+    bool       used;
+} MentalVTSlot;
+
+typedef struct MentalVTLoad {
+    struct MentalVirtualTexture *pVT;
+    uint32_t   key;
+    unsigned char *data;
+    bool       ok;
+} MentalVTLoad;
+
+typedef struct MentalVirtualTexture {
+    int                 fd;
+    MentalVTFileHeader  header;
+    uint32_t            paddedTile;
+    float               uvTransform[4];         // xz мира -> uv: scale.xy, offset.zw
+
+    // Физический кэш тайлов и таблица косвенной адресации
+    uint32_t            physicalTexture;
+    uint32_t            indirectionTexture;
+    uint32_t            pagesPerSide;
+    uint32_t            slotCount;
+    MentalVTSlot        *slots;
+    uint32_t            *pageState[MENTAL_VT_MAX_MIPS];   // slot + 1, бит 31 — загрузка в процессе
+    uint32_t            *indirection[MENTAL_VT_MAX_MIPS]; // RGBA8: slot.x, slot.y, mip, 255
+    uint64_t            *requestFrame[MENTAL_VT_MAX_MIPS];
+    int32_t             indirectionDirtyMip;    // Самый грубый измененный уровень; -1 — таблица актуальна
+
+    // Проход обратной связи
+    uint32_t            feedbackProgram;
+    uint32_t            feedbackFBO, feedbackTexture, feedbackDepth;
+    uint32_t            feedbackPBO[2];
+    bool                feedbackPending[2];
+    uint32_t            feedbackIndex;
+    int                 feedbackSize[2];
+
+    // Фоновая подгрузка
+    pthread_mutex_t     mutex;
+    pthread_cond_t      idle;
+    MentalVTLoad        *completed[MENTAL_VT_MAX_LOADS_IN_FLIGHT];
+    uint32_t            completedCount;
+    uint32_t            inFlight;
+
+    uint64_t            frame;
+    uint32_t            residentPages;
+    uint32_t            uploadsLastFrame;
+} MentalVirtualTexture;
+
+MentalResult mentalBakeVirtualTexture(const char* source_path, const char* page_file, uint32_t tileSize);
+// Page file для обычного изображения из кэша (MENTAL_VT_CACHE_DIR) по хэшу его
+// содержимого; при промахе изображение нарезается туда же. Каталог с исходником не меняется
+MentalResult mentalVirtualTexturePageFile(const char* source_path, uint32_t tileSize, char* page_file, size_t size);
+MentalResult mentalCreateVirtualTexture(MentalVirtualTexture* pVT, const char* page_file, uint32_t budgetBytes);
+MentalResult mentalRenderVirtualTextureFeedback(MentalVirtualTexture* pVT, MentalComponent* pComponent, MentalWindowManager* pManager);
+MentalResult mentalUpdateVirtualTexture(MentalVirtualTexture* pVT);
+MentalResult mentalBindVirtualTexture(MentalVirtualTexture* pVT, uint32_t program, int firstUnit);
+MentalResult mentalDestroyVirtualTexture(MentalVirtualTexture* pVT);
+
+#endif // mental_vtex_h
@@ -4,6 +4,31 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include "wm.h"
+#include "jobs.h"
+#include "vtex.h"
+#include "texture.h"
+#include "shader.h"
+#include "glstate.h"
+#include "geompool.h"
+#include "gpucull.h"
+#include "occlusion.h"
+
+static void mental_wm_prefetch_shaders(void)
+{
+    static const char* programs[][2] = {
+        { "skybox_vertex.glsl",         "skybox_fragment.glsl" },
+        { "ground_vertex.glsl",         "ground_fragment.glsl" },
+        { "vertex.glsl",                "fragment.glsl" },
+    };
+    for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); i++) {
+        MentalShaderDesc desc = {0};
+        desc.paths[MENTAL_SHADER_STAGE_VERTEX] = programs[i][0];
+        desc.paths[MENTAL_SHADER_STAGE_FRAGMENT] = programs[i][1];
+        if (mentalShaderPrefetch(&desc) != MENTAL_OK) {
+            MENTAL_DEBUG("Failed to queue shader %s + %s", programs[i][0], programs[i][1]);
+        }
+    }
+}
 
 MentalResult mentalCreateWM(MentalWindowManager* pManager) {
     if (!pManager) {
@@ -16,10 +41,14 @@ MentalResult mentalCreateWM(MentalWindowManager* pManager) {
         return MENTAL_GLFW_INIT_FAILED;
     }
 
+    // Уровень качества должен быть задан до загрузки любых текстур
+    mentalSetTextureQuality(pManager->pInfo->eTextureQuality);
+
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, pManager->pInfo->bHidden ? GLFW_FALSE : GLFW_TRUE);
     
 #ifdef    __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
@@ -55,16 +84,21 @@ MentalResult mentalCreateWM(MentalWindowManager* pManager) {
     glfwSetFramebufferSizeCallback(pManager->pNext, mental_framebuffer_size_callback);
     glfwSetInputMode(pManager->pNext, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-    // Configure OpenGL
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS); // Proper depth testing
-    glEnable(GL_MULTISAMPLE); // Включение сглаживания
-    glEnable(GL_POLYGON_SMOOTH);
-    glViewport(0, 0, pManager->pInfo->aSizes[0], pManager->pInfo->aSizes[1]);
+    // Configure OpenGL; теневая копия состояния начинается с чистого листа
+    mentalGLStateInvalidate();
+    mentalGLEnable(GL_DEPTH_TEST);
+    mentalGLDepthFunc(GL_LESS); // Proper depth testing
+    mentalGLEnable(GL_MULTISAMPLE); // Включение сглаживания
+    mentalGLEnable(GL_POLYGON_SMOOTH);
+    mentalGLViewport(0, 0, pManager->pInfo->aSizes[0], pManager->pInfo->aSizes[1]);
 
     // Initialize camera
     mental_camera_init(&pManager->camera, 0.0f, 0.0f, 3.0f);
 
+    // Все программы сцены уходят драйверу сразу: пока грузятся текстуры и
+    // считается IBL, они компилируются параллельно
+    mental_wm_prefetch_shaders();
+
     // Initialize skybox
     if (mentalCreateSkybox(&pManager->skybox) != MENTAL_OK) {
         MENTAL_DEBUG("Failed to create skybox.");
@@ -86,6 +120,35 @@ MentalResult mentalCreateWM(MentalWindowManager* pManager) {
         return MENTAL_ERROR;
     }
 
+    // Освещение по изображению из скайбокса (при наличии кэша — просто загрузка)
+    if (mentalCreateIBL(&pManager->ibl, &pManager->skybox) != MENTAL_OK) {
+        MENTAL_DEBUG("Image based lighting is unavailable, using ambient term only.");
+    }
+
+    // Общий UBO с камерой и светом; обновляется раз в кадр в mentalRunWM
+    if (mentalCreateFrameData(&pManager->frame) != MENTAL_OK) {
+        MENTAL_DEBUG("Failed to create frame data buffer.");
+        return MENTAL_ERROR;
+    }
+
+    // Очередь отрисовки: компоненты сортируются по состоянию и глубине
+    if (mentalCreateRenderQueue(&pManager->queue) != MENTAL_OK) {
+        MENTAL_DEBUG("Failed to create render queue.");
+        return MENTAL_ERROR;
+    }
+
+    // SH освещение — запасной вариант фонового освещения без IBL и оттенок неба для земли
+    if (mentalCreateSHLighting(&pManager->sh) != MENTAL_OK ||
+        mentalUpdateSHLighting(&pManager->sh, &pManager->skybox) != MENTAL_OK) {
+        MENTAL_DEBUG("Spherical harmonics lighting is unavailable.");
+    }
+
+    // Общий атлас текстур для материалов моделей
+    if (mentalCreateTextureAtlas(&pManager->atlas, MENTAL_ATLAS_DEFAULT_LAYERS) != MENTAL_OK) {
+        MENTAL_DEBUG("Failed to create texture atlas.");
+        return MENTAL_ERROR;
+    }
+
     return MENTAL_OK;
 }
 
@@ -123,7 +186,7 @@ void mental_framebuffer_size_callback(GLFWwindow* window, int width, int height)
         pManager->pInfo->aSizes[0] = width;
         pManager->pInfo->aSizes[1] = height;
     }
-    glViewport(0, 0, width, height);
+    mentalGLViewport(0, 0, width, height);
     MENTAL_DEBUG("Framebuffer resized to %dx%d", width, height);
 }
 
@@ -136,9 +199,7 @@ MentalResult mentalRunWM(MentalWindowManager *pManager) {
     // Create ground component
     MentalComponent ground = {
         .eType = MENTAL_COMPONENT_TYPE_GROUND,
-        .position = {0.0f, -1.0f, 0.0f},  // Земля ниже уровня камеры
-        .size = 1.0f,
-        .rotation = {0.0f, 0.0f, 0.0f},
+        .transform = MENTAL_TRANSFORM_INIT(0.0f, -1.0f, 0.0f, 1.0f),  // Земля ниже уровня камеры
         .VAO = 0,
         .VBO = 0,
         .EBO = 0,
@@ -155,14 +216,15 @@ MentalResult mentalRunWM(MentalWindowManager *pManager) {
         return MENTAL_ERROR;
     }
     MENTAL_DEBUG("Shader attached to ground successfully.");
+    if (mentalLoadGroundTexture(&ground, "rocky_terrain_02_diff_2k.jpg") != MENTAL_OK) {
+        MENTAL_DEBUG("Failed to load ground virtual texture, using procedural colors.");
+    }
     
     // Create clouds component
     /*
     MentalComponent clouds = {
         .eType = MENTAL_COMPONENT_TYPE_CLOUDS,
-        .position = {0.0f, 5.0f, 0.0f},  // Облака высоко над землей
-        .size = 1.0f,
-        .rotation = {0.0f, 0.0f, 0.0f},
+        .transform = MENTAL_TRANSFORM_INIT(0.0f, 5.0f, 0.0f, 1.0f),  // Облака высоко над землей
         .VAO = 0,
         .VBO = 0,
         .EBO = 0,
@@ -187,9 +249,7 @@ MentalResult mentalRunWM(MentalWindowManager *pManager) {
     // Create 3D model component for cube
     MentalComponent cube = {
         .eType = MENTAL_COMPONENT_TYPE_MODEL3D,
-        .position = {0.0f, 0.0f, -3.0f},  // Position in 3D space
-        .size = 0.5f,                     // Scale factor
-        .rotation = {0.0f, 0.0f, 0.0f},  // Rotation angles in degrees
+        .transform = MENTAL_TRANSFORM_INIT(0.0f, 0.0f, -3.0f, 0.5f),  // Position in 3D space
         .VAO = 0,
         .VBO = 0,
         .EBO = 0,
@@ -199,9 +259,7 @@ MentalResult mentalRunWM(MentalWindowManager *pManager) {
     // Create components
     MentalComponent rectangle = {
         .eType = MENTAL_COMPONENT_TYPE_RECTANGLE,
-        .position = {2.0f, 0.0f, 0.0f},  // Using 3D coordinates now
-        .size = 1.0f,                     // Scale factor
-        .rotation = {0.0f, 0.0f, 0.0f},  // Rotation angles in degrees
+        .transform = MENTAL_TRANSFORM_INIT(2.0f, 0.0f, 0.0f, 1.0f),  // Using 3D coordinates now
         .VAO = 0,
         .VBO = 0,
         .EBO = 0,
@@ -236,18 +294,8 @@ MentalResult mentalRunWM(MentalWindowManager *pManager) {
     }
     MENTAL_DEBUG("Rocky terrain textures loaded. PBR textures will be auto-detected if available.");
 
-    // Attach PBR shader to the 3D model
-    if (mentalAttachPBRShader(&cube) != MENTAL_OK) {
-        MENTAL_DEBUG("Failed to attach PBR shader to cube model.");
-        mentalDestroyComponent(&ground);
-        mentalDestroyModel3DComponent(&cube);
-        return MENTAL_ERROR;
-    }
-    MENTAL_DEBUG("PBR shader attached to cube model successfully.");
-    GLuint shaderProgram = cube.shaderProgram;
-    glUseProgram(shaderProgram);
-    glUniform1i(glGetUniformLocation(shaderProgram, "hasHeightMap"), 1); // Включить деформацию
-    glUniform1f(glGetUniformLocation(shaderProgram, "heightScale"), 0.2f); // Сила деформации
+    // Параметры уходят в материал и загружаются при отрисовке
+    mentalSetModelHeightScale(&cube, 0.2f); // Сила деформации
     // Set rocky terrain PBR material
     vec3 rockyAlbedo = {0.5f, 0.5f, 0.5f}; // Neutral color for rock (will be influenced by texture)
     float rockyMetallic = 0.05f;           // Минимальная металличность для камня
@@ -265,10 +313,18 @@ MentalResult mentalRunWM(MentalWindowManager *pManager) {
     mentalLoadModelAOMap(&cube, "rocky-rugged-terrain-bl/rocky-rugged-terrain_1_ao.png");
     mentalLoadModelHeightMap(&cube, "rocky-rugged-terrain-bl/rocky-rugged-terrain_1_height.png");
     MENTAL_DEBUG("Additional PBR maps loaded.");
-    glUniform1i(glGetUniformLocation(cube.shaderProgram, "hasHeightMap"), true);
-    glUniform1f(glGetUniformLocation(cube.shaderProgram, "heightScale"), 0.2f);
-    glPatchParameteri(GL_PATCH_VERTICES, 3);
-    glUniform1f(glGetUniformLocation(shaderProgram, "TessLevel"), 16.0f);
+    // Адаптивная тесселяция: плотность сетки следует за размером модели на экране
+    if (mentalSetModelTessellation(&cube, MENTAL_TESS_DEFAULT_EDGE_PIXELS) != MENTAL_OK) {
+        MENTAL_DEBUG("Cube model is drawn without tessellation.");
+    }
+    // Attach PBR shader after the maps: the program variant depends on which maps are present
+    if (mentalAttachPBRShader(&cube) != MENTAL_OK) {
+        MENTAL_DEBUG("Failed to attach PBR shader to cube model.");
+        mentalDestroyComponent(&ground);
+        mentalDestroyModel3DComponent(&cube);
+        return MENTAL_ERROR;
+    }
+    MENTAL_DEBUG("PBR shader attached to cube model successfully.");
     
     if (mentalCreateComponent(&rectangle) != MENTAL_OK) {
         MENTAL_DEBUG("Failed to create rectangle component.");
@@ -288,9 +344,7 @@ MentalResult mentalRunWM(MentalWindowManager *pManager) {
     
     MentalComponent triangle = {
         .eType = MENTAL_COMPONENT_TYPE_TRIANGLE,
-        .position = {1.5f, 0.0f, 0.0f},
-        .size = 1.0f,
-        .rotation = {0.0f, 0.0f, 0.0f},
+        .transform = MENTAL_TRANSFORM_INIT(1.5f, 0.0f, 0.0f, 1.0f),
         .VAO = 0,
         .VBO = 0,
         .EBO = 0,
@@ -314,6 +368,12 @@ MentalResult mentalRunWM(MentalWindowManager *pManager) {
     }
     MENTAL_DEBUG("Shader attached to triangle successfully.");
 
+    // Строим мипмапы для всех слоев, добавленных в атлас при загрузке
+    mentalAtlasFlush(&pManager->atlas);
+
+    // Невостребованные программы предзаказа больше не нужны
+    mentalShaderEndPrefetch();
+
     // Timing variables
     float deltaTime = 0.0f;
     float lastFrame = 0.0f;
@@ -325,6 +385,12 @@ MentalResult mentalRunWM(MentalWindowManager *pManager) {
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        mentalTextureBeginFrame();
+        mentalGLStateBeginFrame();
+        mentalGeometryPoolBeginFrame();
+        // Подхватываем программы, которые драйвер успел собрать
+        mentalShaderPoll();
+
         // Process input
         mental_process_keyboard(pManager, deltaTime);
 
@@ -334,61 +400,102 @@ MentalResult mentalRunWM(MentalWindowManager *pManager) {
         if (width != pManager->pInfo->aSizes[0] || height != pManager->pInfo->aSizes[1]) {
             pManager->pInfo->aSizes[0] = width;
             pManager->pInfo->aSizes[1] = height;
-            glViewport(0, 0, width, height);
+            mentalGLViewport(0, 0, width, height);
+        }
+
+        // Камера, свет и время кадра — один раз для всех программ
+        mentalUpdateFrameData(&pManager->frame, &pManager->camera, pManager->pInfo->aSizes[0],
+                              pManager->pInfo->aSizes[1], currentFrame);
+        mentalGpuCullBeginFrame(&pManager->frame);
+
+        // Рельеф растеризуется на CPU до отправки в очередь: все, что целиком за
+        // холмами, очередь отбросит после пирамиды видимости
+        mentalOcclusionBeginFrame(pManager->frame.block.viewProjection);
+        mentalOcclusionAddOccluder(&ground.occluder, mentalTransformWorld(&ground.transform));
+        mentalOcclusionRasterize();
+
+        // Feedback для виртуальной текстуры земли и подгрузка видимых тайлов
+        if (ground.pVirtualTexture) {
+            mentalRenderVirtualTextureFeedback(ground.pVirtualTexture, &ground, pManager);
+            mentalUpdateVirtualTexture(ground.pVirtualTexture);
         }
 
         // Clear screen
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Draw skybox first (background)
-        if (mentalDrawSkybox(&pManager->skybox, pManager) != MENTAL_OK) {
-            MENTAL_DEBUG("Failed to draw skybox.");
-        }
+        // Update components
+        //mentalSetRotation(&cube, currentFrame * 10.0f, currentFrame * 20.0f, 0.0f);  // Вращение куба
+        mentalSetRotation(&rectangle, 0.0f, currentFrame * 50.0f, 0.0f);
+        mentalSetRotation(&triangle, currentFrame * 30.0f, 0.0f, 0.0f);
+        //mentalSetRotation(&clouds, 0.0f, currentFrame * 5.0f, 0.0f); // Медленное вращение облаков
 
-        // Draw ground first (after skybox)
-        if (mentalDrawGroundComponent(&ground, pManager) != MENTAL_OK) {
-            MENTAL_DEBUG("Failed to draw ground component.");
-        }
-        
-        /*
-        // Анимируем и отрисовываем облака
-        clouds.rotation[1] = currentFrame * 5.0f; // Медленное вращение облаков
-        if (mentalDrawCloudComponent(&clouds, pManager) != MENTAL_OK) {
-            MENTAL_DEBUG("Failed to draw clouds component.");
-        }
-        */
-        
-        // Update and render components
-        //cube.rotation[1] = currentFrame * 20.0f;  // Вращение куба вокруг оси Y
-        //cube.rotation[0] = currentFrame * 10.0f;  // Вращение куба вокруг оси X
-        rectangle.rotation[1] = currentFrame * 50.0f;
-        triangle.rotation[0] = currentFrame * 30.0f;
-        
-        // Отрисовка 3D модели куба
-        if (mentalDrawModel3DComponent(&cube, pManager) != MENTAL_OK) {
-            MENTAL_DEBUG("Failed to draw cube model component.");
-        }
-        
-        if (mentalDrawComponent(&rectangle, pManager) != MENTAL_OK) {
-            MENTAL_DEBUG("Failed to draw rectangle component.");
-        }
-        if (mentalDrawComponent(&triangle, pManager) != MENTAL_OK) {
-            MENTAL_DEBUG("Failed to draw triangle component.");
+        // Порядок отрисовки задает очередь: непрозрачные спереди назад,
+        // скайбокс после них на дальней плоскости, прозрачные сзади вперед
+        mentalRenderQueueBegin(&pManager->queue);
+        mentalSubmitSkybox(&pManager->queue, &pManager->skybox);
+        mentalSubmitComponent(&pManager->queue, pManager, &ground);
+        //mentalSubmitComponent(&pManager->queue, pManager, &clouds);
+        mentalSubmitComponent(&pManager->queue, pManager, &cube);
+        mentalSubmitComponent(&pManager->queue, pManager, &rectangle);
+        mentalSubmitComponent(&pManager->queue, pManager, &triangle);
+        if (mentalRenderQueueFlush(&pManager->queue, pManager) != MENTAL_OK) {
+            MENTAL_DEBUG("Failed to draw %u of %u queued items.", pManager->queue.stats.failedDraws,
+                         pManager->queue.stats.itemCount);
         }
+        // Глубина этого кадра — пирамида для отсечения на GPU в следующем
+        mentalGpuCullBuildDepthPyramid(pManager->pInfo->aSizes[0], pManager->pInfo->aSizes[1]);
+
+        // Держим объем текстур в пределах бюджета
+        mentalTextureEndFrame();
 
         // Swap buffers and poll events
         glfwSwapBuffers(pManager->pNext);
         glfwPollEvents();
     }
 
+    MentalTextureStats textureStats;
+    mentalTextureGetStats(&textureStats);
+    MENTAL_DEBUG("Textures: %u registered, %llu KB resident, %llu KB peak, budget %llu KB, %u reduced, %u evicted",
+                 textureStats.textureCount, (unsigned long long)(textureStats.totalBytes >> 10),
+                 (unsigned long long)(textureStats.peakBytes >> 10), (unsigned long long)(textureStats.budgetBytes >> 10),
+                 textureStats.reducedCount, textureStats.evictedCount);
+    MENTAL_DEBUG("Render queue: %u items, %u program changes, %u radix passes in the last frame",
+                 pManager->queue.stats.itemCount, pManager->queue.stats.programChanges,
+                 pManager->queue.stats.sortPasses);
+    MENTAL_DEBUG("Frustum culling: %u visible, %u culled in the last frame, %llu culled in total",
+                 pManager->queue.stats.visibleCount, pManager->queue.stats.culledCount,
+                 (unsigned long long)pManager->queue.stats.totalCulled);
+    MENTAL_DEBUG("Occlusion culling: %u occluded in the last frame, %llu occluded in total",
+                 pManager->queue.stats.occludedCount, (unsigned long long)pManager->queue.stats.totalOccluded);
+    MENTAL_DEBUG("Indirect batches: %u batches for %u models in the last frame",
+                 pManager->queue.stats.indirectBatches, pManager->queue.stats.batchedCount);
+    MENTAL_DEBUG("Depth pre-pass: %s, %u items in the last frame", pManager->queue.depthPrepass ? "on" : "off",
+                 pManager->queue.stats.prepassCount);
+    MentalTransformStats transformStats;
+    mentalTransformGetStats(&transformStats);
+    MENTAL_DEBUG("Transforms: %llu local and %llu world matrix rebuilds",
+                 (unsigned long long)transformStats.localUpdates, (unsigned long long)transformStats.worldUpdates);
+
     // Cleanup
     mentalDestroyComponent(&ground);
     //mentalDestroyComponent(&clouds);
     mentalDestroyModel3DComponent(&cube);
     mentalDestroyComponent(&rectangle);
     mentalDestroyComponent(&triangle);
+    mentalDestroyIBL(&pManager->ibl);
+    mentalDestroySHLighting(&pManager->sh);
+    mentalDestroyFrameData(&pManager->frame);
+    mentalDestroyRenderQueue(&pManager->queue);
     mentalDestroySkybox(&pManager->skybox);
+    mentalDestroyTextureAtlas(&pManager->atlas);
+    mentalReleasePBRVariants();
+    mentalGeometryPoolShutdown();
+    mentalGpuCullShutdown();
+    mentalOcclusionShutdown();
+    mentalShaderShutdown();
+    mentalGLStateShutdown();
+    mentalJobsShutdown();
     
     MENTAL_DEBUG("Window closed successfully.");
     return MENTAL_OK;
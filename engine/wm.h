@@ -4,12 +4,19 @@
 #include "mental.h"
 #include "engine.h"
 #include "component.h"
+#include "ibl.h"
+#include "sh.h"
+#include "frame.h"
+#include "renderqueue.h"
+#include "imageproc.h"
 
 
 typedef struct MentalWindowManagerInfo {
     MentalStructureType                     eType;
     int                                     aSizes[2];
     char                                    *pTitle;
+    MentalTextureQuality                    eTextureQuality;    // Разрешение текстур при загрузке
+    bool                                    bHidden;            // Окно не показывается (замеры, фоновые задачи)
 } MentalWindowManagerInfo;
 
 typedef struct MentalWindowManager {
@@ -18,6 +25,11 @@ typedef struct MentalWindowManager {
     void                                    *pNext;
     MentalCamera                            camera;
     MentalSkybox                            skybox;
+    MentalTextureAtlas                      atlas;
+    MentalIBL                               ibl;
+    MentalSHLighting                        sh;
+    MentalFrameData                         frame;
+    MentalRenderQueue                       queue;
 } MentalWindowManager;
 
 MentalResult mentalCreateWM(MentalWindowManager *pManager);
@@ -4,8 +4,20 @@ out vec4 FragColor;
 in vec2 TexCoord;
 in vec3 WorldPos;
 
-uniform vec2 resolution;
-uniform float time;
+// Данные кадра (engine/frame.h), общий UBO для всех программ
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    float time;
+    vec3 lightPos;
+    float aspect;
+    vec3 lightColor;
+    float framePadding;
+    vec2 resolution;
+};
+
 uniform float size;
 
 // Улучшенный шум Перлина
@@ -0,0 +1,127 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+// Отсечение моделей пула геометрии (engine/gpucull.c): пирамида видимости кадра
+// и пирамида глубины прошлого кадра. Выжившие команды с COMPACT сжимаются
+// атомарным счетчиком, без него отброшенные получают instanceCount = 0.
+
+struct ObjectBounds {
+    vec4 sphere;        // Центр и радиус
+    vec4 extents;       // Полуразмеры AABB; w = 0 — границ нет, объект виден
+};
+
+// DrawElementsIndirectCommand
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int  baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Bounds {
+    ObjectBounds bounds[];
+};
+
+layout (std430, binding = 1) readonly buffer Commands {
+    DrawCommand commands[];
+};
+
+layout (std430, binding = 2) writeonly buffer Output {
+    DrawCommand visibleCommands[];
+};
+
+#ifdef COMPACT
+layout (binding = 0, offset = 0) uniform atomic_uint drawCount;
+#endif
+
+// engine/gpucull.h, MentalGpuCullBlock
+layout(std140) uniform CullData {
+    vec4 planes[6];
+    mat4 pyramidViewProjection;
+    vec2 pyramidSize;
+    uint pyramidLevels;
+    uint useOcclusion;
+};
+
+// MENTAL_GPU_CULL_PYRAMID_UNIT
+layout (binding = 11) uniform sampler2D depthPyramid;
+
+bool insideFrustum(vec3 center, vec3 extents, float radius)
+{
+    for (int i = 0; i < 6; i++) {
+        float distance = dot(planes[i].xyz, center) + planes[i].w;
+        if (distance < -radius || distance + dot(abs(planes[i].xyz), extents) < 0.0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// AABB проецируется матрицей прошлого кадра; уровень пирамиды выбирается так,
+// чтобы прямоугольник на экране занимал не больше 2x2 текселей
+bool occluded(vec3 center, vec3 extents)
+{
+    vec2 minUV = vec2(1.0);
+    vec2 maxUV = vec2(0.0);
+    float nearestDepth = 1.0;
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = center + extents * vec3((i & 1) != 0 ? 1.0 : -1.0,
+                                              (i & 2) != 0 ? 1.0 : -1.0,
+                                              (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = pyramidViewProjection * vec4(corner, 1.0);
+        // Объект пересекает ближнюю плоскость: на экране он огромен, считаем видимым
+        if (clip.w <= 0.0) {
+            return false;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 uv = ndc.xy * 0.5 + 0.5;
+        minUV = min(minUV, uv);
+        maxUV = max(maxUV, uv);
+        nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);
+    }
+    minUV = clamp(minUV, 0.0, 1.0);
+    maxUV = clamp(maxUV, 0.0, 1.0);
+
+    vec2 sizePixels = (maxUV - minUV) * pyramidSize;
+    float level = ceil(log2(max(max(sizePixels.x, sizePixels.y), 1.0)));
+    int lod = int(clamp(level, 0.0, float(pyramidLevels - 1u)));
+
+    // Индексы считаются в пикселях уровня 0 и сдвигаются на lod: размеры уровней
+    // округлены вниз, и при нечетном размере последний тексель уровня покрывает
+    // лишнюю строку или столбец (hiz_compute.glsl). uv * levelSize туда не попадает
+    ivec2 levelSize = textureSize(depthPyramid, lod);
+    ivec2 basePixels = ivec2(pyramidSize) - 1;
+    ivec2 a = min(clamp(ivec2(minUV * pyramidSize), ivec2(0), basePixels) >> lod, levelSize - 1);
+    ivec2 b = min(clamp(ivec2(maxUV * pyramidSize), ivec2(0), basePixels) >> lod, levelSize - 1);
+    float farthest = max(max(texelFetch(depthPyramid, a, lod).r, texelFetch(depthPyramid, ivec2(b.x, a.y), lod).r),
+                         max(texelFetch(depthPyramid, ivec2(a.x, b.y), lod).r, texelFetch(depthPyramid, b, lod).r));
+    return nearestDepth > farthest;
+}
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= uint(commands.length())) {
+        return;
+    }
+
+    ObjectBounds object = bounds[id];
+    bool visible = true;
+    if (object.extents.w != 0.0) {
+        visible = insideFrustum(object.sphere.xyz, object.extents.xyz, object.sphere.w);
+        if (visible && useOcclusion != 0u) {
+            visible = !occluded(object.sphere.xyz, object.extents.xyz);
+        }
+    }
+
+    DrawCommand command = commands[id];
+#ifdef COMPACT
+    if (visible) {
+        visibleCommands[atomicCounterIncrement(drawCount)] = command;
+    }
+#else
+    command.instanceCount = visible ? command.instanceCount : 0u;
+    visibleCommands[id] = command;
+#endif
+}
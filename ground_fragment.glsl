@@ -3,7 +3,73 @@ out vec4 FragColor;
 
 in vec3 WorldPos;
 
-uniform float time;
+// Данные кадра (engine/frame.h), общий UBO для всех программ
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    float time;
+    vec3 lightPos;
+    float aspect;
+    vec3 lightColor;
+    float framePadding;
+    vec2 resolution;
+};
+
+// Виртуальная текстура местности (если загружена)
+uniform bool useVirtualTexture;
+uniform sampler2D vtIndirection;    // RGBA8: slot.x, slot.y, mip загруженной страницы
+uniform sampler2D vtPhysical;       // Физический кэш тайлов
+uniform vec4 vtUVTransform;
+uniform float vtSize;
+uniform float vtTileSize;
+uniform float vtMipCount;
+uniform float vtBorder;
+uniform float vtPhysicalSize;
+
+// Фоновое освещение по сферическим гармоникам (engine/sh.h)
+layout(std140) uniform SHLighting {
+    vec4 shCoefficients[9];
+    vec4 shParams;              // x — включено, y — нормировка яркости
+};
+
+vec3 shIrradiance(vec3 n) {
+    vec3 result = shCoefficients[0].rgb * 0.282095;
+    result += shCoefficients[1].rgb * 0.488603 * n.y;
+    result += shCoefficients[2].rgb * 0.488603 * n.z;
+    result += shCoefficients[3].rgb * 0.488603 * n.x;
+    result += shCoefficients[4].rgb * 1.092548 * n.x * n.y;
+    result += shCoefficients[5].rgb * 1.092548 * n.y * n.z;
+    result += shCoefficients[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0);
+    result += shCoefficients[7].rgb * 1.092548 * n.x * n.z;
+    result += shCoefficients[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(result, vec3(0.0));
+}
+
+vec3 sampleVirtualTexture(vec2 uv) {
+    uv = clamp(uv, 0.0, 0.99999);
+
+    vec2 texel = uv * vtSize;
+    float footprint = max(length(dFdx(texel)), length(dFdy(texel)));
+    float lod = log2(max(footprint, 1e-6));
+    int mip = int(clamp(floor(lod), 0.0, vtMipCount - 1.0));
+
+    // Таблица косвенной адресации указывает на загруженную страницу
+    // нужного уровня или на ближайшего загруженного предка
+    ivec2 page = ivec2(uv * (vtSize / vtTileSize) / exp2(float(mip)));
+    vec4 entry = texelFetch(vtIndirection, page, mip) * 255.0;
+    vec2 slot = floor(entry.xy + 0.5);
+    float residentMip = floor(entry.z + 0.5);
+
+    vec2 local = fract(uv * (vtSize / vtTileSize) / exp2(residentMip));
+    float paddedTile = vtTileSize + 2.0 * vtBorder;
+    vec2 physical = (slot * paddedTile + vtBorder + local * vtTileSize) / vtPhysicalSize;
+
+    // Градиенты берем от непрерывных координат, чтобы не было швов на границах тайлов
+    vec2 scale = vtTileSize / exp2(residentMip) / vtPhysicalSize * (vtSize / vtTileSize);
+    return textureGrad(vtPhysical, physical, dFdx(uv) * scale, dFdy(uv) * scale).rgb;
+}
 
 // Улучшенная реализация шума Перлина
 float hash(vec2 p) {
@@ -101,6 +167,18 @@ void main()
     float shadow = 1.0 - height * 0.3;
     terrainColor *= shadow;
     
+    if (useVirtualTexture) {
+        vec3 albedo = sampleVirtualTexture(WorldPos.xz * vtUVTransform.xy + vtUVTransform.zw);
+        terrainColor = albedo * shadow;
+    }
+    
+    // Оттенок неба: нормаль по производным позиции, яркость нормирована
+    if (shParams.x > 0.5) {
+        vec3 N = normalize(cross(dFdx(WorldPos), dFdy(WorldPos)));
+        N *= sign(N.y);
+        terrainColor *= shIrradiance(N) * shParams.y;
+    }
+    
     // Ограничиваем цвет
     terrainColor = clamp(terrainColor, 0.0, 1.0);
     
@@ -2,9 +2,20 @@
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform float time;
+
+// Данные кадра (engine/frame.h), общий UBO для всех программ
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    float time;
+    vec3 lightPos;
+    float aspect;
+    vec3 lightColor;
+    float framePadding;
+    vec2 resolution;
+};
 
 out vec3 WorldPos;
 
@@ -13,5 +24,5 @@ void main()
     // Передаем мировую позицию в фрагментный шейдер
     WorldPos = aPos;
     
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
 }
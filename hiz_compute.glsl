@@ -0,0 +1,42 @@
+#version 430 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// Пирамида глубины для отсечения на GPU (engine/gpucull.c). Вариант FROM_DEPTH
+// переносит копию буфера глубины в уровень 0, без него каждый тексель
+// следующего уровня — максимум (самая дальняя глубина) своего участка 2x2.
+
+layout (binding = 1, r32f) uniform writeonly image2D dstLevel;
+
+#ifdef FROM_DEPTH
+// MENTAL_GPU_CULL_PYRAMID_UNIT
+layout (binding = 11) uniform sampler2D depthCopy;
+#else
+layout (binding = 0, r32f) uniform readonly image2D srcLevel;
+#endif
+
+void main()
+{
+    ivec2 dstSize = imageSize(dstLevel);
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(p, dstSize))) {
+        return;
+    }
+
+#ifdef FROM_DEPTH
+    float depth = texelFetch(depthCopy, p, 0).r;
+#else
+    // При нечетном размере последний тексель забирает и лишнюю строку или столбец
+    ivec2 srcSize = imageSize(srcLevel);
+    ivec2 first = p * 2;
+    ivec2 last = first + 1 + ivec2(equal(p, dstSize - 1)) * (srcSize & 1);
+    last = min(last, srcSize - 1);
+
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; y++) {
+        for (int x = first.x; x <= last.x; x++) {
+            depth = max(depth, imageLoad(srcLevel, ivec2(x, y)).r);
+        }
+    }
+#endif
+    imageStore(dstLevel, p, vec4(depth));
+}
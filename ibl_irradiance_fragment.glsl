@@ -0,0 +1,32 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 LocalPos;
+
+uniform samplerCube environmentMap;
+uniform float sourceLod;    // Мип-уровень окружения, чтобы не было шума от мелких деталей
+
+const float PI = 3.14159265359;
+
+void main()
+{
+    // Диффузная освещенность: свертка окружения с косинусом по полусфере
+    vec3 N = normalize(LocalPos);
+    vec3 up = abs(N.y) < 0.999 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 right = normalize(cross(up, N));
+    up = cross(N, right);
+
+    vec3 irradiance = vec3(0.0);
+    float sampleCount = 0.0;
+    const float sampleDelta = 0.025;
+    for (float phi = 0.0; phi < 2.0 * PI; phi += sampleDelta) {
+        for (float theta = 0.0; theta < 0.5 * PI; theta += sampleDelta) {
+            vec3 tangentSample = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+            vec3 sampleVec = tangentSample.x * right + tangentSample.y * up + tangentSample.z * N;
+            irradiance += textureLod(environmentMap, sampleVec, sourceLod).rgb * cos(theta) * sin(theta);
+            sampleCount += 1.0;
+        }
+    }
+
+    FragColor = vec4(PI * irradiance / sampleCount, 1.0);
+}
@@ -1,6 +1,7 @@
 #include "engine/mental.h"
 #include "engine/component.h"
 #include "engine/wm.h"
+#include "engine/glstate.h"
 #include <stdio.h>
 
 int main() {
@@ -84,10 +85,11 @@ int main() {
     mentalSetSize(modelComponent, 1.0f);
     
     // Настройка OpenGL для работы с 3D
-    glEnable(GL_DEPTH_TEST);
+    mentalGLEnable(GL_DEPTH_TEST);
     
     // Главный цикл
     float lastFrame = 0.0f;
+    float rotation = 0.0f;
     while (!glfwWindowShouldClose(wm.pNext)) {
         // Расчет времени кадра
         float currentFrame = glfwGetTime();
@@ -102,7 +104,8 @@ int main() {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
         // Вращение модели
-        modelComponent->rotation[1] += 30.0f * deltaTime; // Вращение вокруг оси Y (в градусах)
+        rotation += 30.0f * deltaTime; // Вращение вокруг оси Y (в градусах)
+        mentalSetRotation(modelComponent, 0.0f, rotation, 0.0f);
         
         // Отрисовка модели
         mentalDrawModel3DComponent(modelComponent, &wm);
@@ -1,6 +1,7 @@
 #include "engine/mental.h"
 #include "engine/component.h"
 #include "engine/wm.h"
+#include "engine/glstate.h"
 #include <cglm/cglm.h>
 #include <cglm/vec3.h>
 #include <stdio.h>
@@ -85,7 +86,7 @@ int main() {
     mentalSetSize(modelComponent, 1.0f);
     
     // Настройка OpenGL для работы с 3D
-    glEnable(GL_DEPTH_TEST);
+    mentalGLEnable(GL_DEPTH_TEST);
     
     // Главный цикл
     float lastFrame = 0.0f;
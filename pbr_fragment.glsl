@@ -7,6 +7,11 @@ in vec3 TangentLightPos;
 in vec3 TangentViewPos;
 in vec3 TangentFragPos;
 in vec3 OriginalNormal;
+in mat3 TangentToWorld;
+#ifdef INSTANCED
+flat in vec4 InstanceTint;
+flat in uint InstanceMaterial;
+#endif
 
 out vec4 FragColor;
 
@@ -24,32 +29,80 @@ const float GAMMA = 2.2;
 
 // Юниформы
 uniform Material material;
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-uniform vec3 lightColor;
-uniform bool usePBR;
-
-// Флаги текстур
-uniform bool hasAlbedoMap;
-uniform bool hasNormalMap;
-uniform bool hasMetallicMap;
-uniform bool hasRoughnessMap;
-uniform bool hasAOMap;
-uniform bool hasHeightMap;
+
+// Данные кадра (engine/frame.h), общий UBO для всех программ
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    float time;
+    vec3 lightPos;
+    float aspect;
+    vec3 lightColor;
+    float framePadding;
+    vec2 resolution;
+};
+
+// Варианты программы собираются через #define (engine/model3d.c), а не через
+// юниформы-флаги: в каждом варианте остается только нужный код
+//   HAS_ALBEDO_MAP, HAS_NORMAL_MAP, HAS_METALLIC_MAP, HAS_ROUGHNESS_MAP,
+//   HAS_AO_MAP, HAS_HEIGHT_MAP, USE_ALBEDO_ARRAY — наличие текстур
+//   DEBUG_UVS, DEBUG_NORMALS, DEBUG_TANGENTS, DEBUG_WIREFRAME — отладочные режимы
+//   INSTANCED — оттенок и слой материала приходят от экземпляра
 
 // Текстуры
+#ifdef HAS_ALBEDO_MAP
 uniform sampler2D albedoMap;
+#endif
+#ifdef HAS_NORMAL_MAP
 uniform sampler2D normalMap;
+#endif
+#ifdef HAS_METALLIC_MAP
 uniform sampler2D metallicMap;
+#endif
+#ifdef HAS_ROUGHNESS_MAP
 uniform sampler2D roughnessMap;
+#endif
+#ifdef HAS_AO_MAP
 uniform sampler2D aoMap;
+#endif
+#ifdef HAS_HEIGHT_MAP
 uniform sampler2D heightMap;
+#endif
+
+// Альбедо из атласа текстур (слой GL_TEXTURE_2D_ARRAY)
+#ifdef USE_ALBEDO_ARRAY
+uniform sampler2DArray albedoArray;
+uniform float albedoLayer;
+uniform vec2 albedoUVScale;
+#endif
+
+// Освещение по изображению (предрасчет из скайбокса)
+uniform bool useIBL;
+uniform samplerCube irradianceMap;
+uniform samplerCube prefilterMap;
+uniform sampler2D brdfLUT;
+uniform float prefilterMaxLod;
 
-// Отладочные режимы
-uniform bool debugUVs = false;
-uniform bool debugNormals = false;
-uniform bool debugWireframe = false;
-uniform bool debugTangents = false;
+// Фоновое освещение по сферическим гармоникам (engine/sh.h)
+layout(std140) uniform SHLighting {
+    vec4 shCoefficients[9];
+    vec4 shParams;              // x — включено, y — нормировка яркости
+};
+
+vec3 shIrradiance(vec3 n) {
+    vec3 result = shCoefficients[0].rgb * 0.282095;
+    result += shCoefficients[1].rgb * 0.488603 * n.y;
+    result += shCoefficients[2].rgb * 0.488603 * n.z;
+    result += shCoefficients[3].rgb * 0.488603 * n.x;
+    result += shCoefficients[4].rgb * 1.092548 * n.x * n.y;
+    result += shCoefficients[5].rgb * 1.092548 * n.y * n.z;
+    result += shCoefficients[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0);
+    result += shCoefficients[7].rgb * 1.092548 * n.x * n.z;
+    result += shCoefficients[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(result, vec3(0.0));
+}
 
 // Функции PBR
 float DistributionGGX(vec3 N, vec3 H, float roughness) {
@@ -77,9 +130,12 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0) {
     return F0 + (1.0 - F0) * pow(1.0 - cosTheta, 5.0);
 }
 
+vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness) {
+    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(1.0 - cosTheta, 5.0);
+}
+
+#ifdef HAS_HEIGHT_MAP
 vec2 parallaxMapping(vec2 texCoords, vec3 viewDir) {
-    if (!hasHeightMap) return texCoords;
-    
     const float minLayers = 8.0;
     const float maxLayers = 32.0;
     float numLayers = mix(maxLayers, minLayers, abs(dot(vec3(0.0, 0.0, 1.0), viewDir)));
@@ -105,53 +161,72 @@ vec2 parallaxMapping(vec2 texCoords, vec3 viewDir) {
     
     return mix(currentTexCoords, prevTexCoords, weight);
 }
+#endif
 
 void main()
 {
     // Отладочные режимы
-    if (debugUVs) {
-        FragColor = vec4(fract(TexCoord), 0.0, 1.0);
-        return;
-    }
-    
-    if (debugNormals) {
-        FragColor = vec4(normalize(OriginalNormal)*0.5+0.5, 1.0);
-        return;
-    }
-    
-    if (debugTangents) {
-        vec3 tangent = normalize(cross(OriginalNormal, vec3(0.0, 1.0, 0.0)));
-        FragColor = vec4(tangent*0.5+0.5, 1.0);
-        return;
-    }
+#if defined(DEBUG_UVS)
+    FragColor = vec4(fract(TexCoord), 0.0, 1.0);
+    return;
+#elif defined(DEBUG_NORMALS)
+    FragColor = vec4(normalize(OriginalNormal)*0.5+0.5, 1.0);
+    return;
+#elif defined(DEBUG_TANGENTS)
+    vec3 tangent = normalize(cross(OriginalNormal, vec3(0.0, 1.0, 0.0)));
+    FragColor = vec4(tangent*0.5+0.5, 1.0);
+    return;
+#endif
 
     // Основной PBR-рендеринг
-    vec2 finalTexCoord = hasHeightMap ? parallaxMapping(TexCoord, normalize(viewPos - FragPos)) : TexCoord;
-    finalTexCoord = fract(finalTexCoord); // Гарантируем [0,1] диапазон
+#ifdef HAS_HEIGHT_MAP
+    vec2 finalTexCoord = fract(parallaxMapping(TexCoord, normalize(viewPos - FragPos)));
+#else
+    vec2 finalTexCoord = fract(TexCoord); // Гарантируем [0,1] диапазон
+#endif
     
     // Получаем параметры материала
-    vec3 albedo = hasAlbedoMap ? pow(texture(albedoMap, finalTexCoord).rgb, vec3(GAMMA)) : material.albedo;
-    float metallic = hasMetallicMap ? texture(metallicMap, finalTexCoord).r : material.metallic;
-    float roughness = hasRoughnessMap ? texture(roughnessMap, finalTexCoord).r : material.roughness;
-    float ao = hasAOMap ? texture(aoMap, finalTexCoord).r : material.ao;
+#if defined(USE_ALBEDO_ARRAY) && defined(INSTANCED)
+    float layer = albedoLayer + float(InstanceMaterial);
+    vec3 albedo = pow(texture(albedoArray, vec3(finalTexCoord * albedoUVScale, layer)).rgb, vec3(GAMMA));
+#elif defined(USE_ALBEDO_ARRAY)
+    vec3 albedo = pow(texture(albedoArray, vec3(finalTexCoord * albedoUVScale, albedoLayer)).rgb, vec3(GAMMA));
+#elif defined(HAS_ALBEDO_MAP)
+    vec3 albedo = pow(texture(albedoMap, finalTexCoord).rgb, vec3(GAMMA));
+#else
+    vec3 albedo = material.albedo;
+#endif
+#ifdef INSTANCED
+    albedo *= InstanceTint.rgb;
+#endif
+#ifdef HAS_METALLIC_MAP
+    float metallic = texture(metallicMap, finalTexCoord).r;
+#else
+    float metallic = material.metallic;
+#endif
+#ifdef HAS_ROUGHNESS_MAP
+    float roughness = texture(roughnessMap, finalTexCoord).r;
+#else
+    float roughness = material.roughness;
+#endif
+#ifdef HAS_AO_MAP
+    float ao = texture(aoMap, finalTexCoord).r;
+#else
+    float ao = material.ao;
+#endif
     
     // Нормаль
-    vec3 N;
-    vec3 V;
-    vec3 L;
-    
-    if (hasNormalMap) {
-        N = texture(normalMap, finalTexCoord).rgb;
-        N = normalize(N * 2.0 - 1.0);
-        N = normalize(N);
-        
-        V = normalize(TangentViewPos - TangentFragPos);
-        L = normalize(TangentLightPos - TangentFragPos);
-    } else {
-        N = normalize(Normal);
-        V = normalize(viewPos - FragPos);
-        L = normalize(lightPos - FragPos);
-    }
+#ifdef HAS_NORMAL_MAP
+    vec3 N = normalize(texture(normalMap, finalTexCoord).rgb * 2.0 - 1.0);
+    vec3 V = normalize(TangentViewPos - TangentFragPos);
+    vec3 L = normalize(TangentLightPos - TangentFragPos);
+    vec3 worldN = normalize(TangentToWorld * N);
+#else
+    vec3 N = normalize(Normal);
+    vec3 V = normalize(viewPos - FragPos);
+    vec3 L = normalize(lightPos - FragPos);
+    vec3 worldN = N;
+#endif
     
     // PBR расчеты
     vec3 H = normalize(V + L);
@@ -173,6 +248,24 @@ void main()
     
     // Ambient освещение
     vec3 ambient = vec3(0.03) * albedo * ao;
+    if (useIBL) {
+        // IBL считается в мировом пространстве
+        vec3 worldV = normalize(viewPos - FragPos);
+        vec3 R = reflect(-worldV, worldN);
+        float NdotV = max(dot(worldN, worldV), 0.0);
+
+        vec3 F_ibl = fresnelSchlickRoughness(NdotV, F0, roughness);
+        vec3 kD_ibl = (vec3(1.0) - F_ibl) * (1.0 - metallic);
+        vec3 diffuseIBL = texture(irradianceMap, worldN).rgb * albedo;
+        vec3 prefiltered = textureLod(prefilterMap, R, roughness * prefilterMaxLod).rgb;
+        vec2 brdf = texture(brdfLUT, vec2(NdotV, roughness)).rg;
+        vec3 specularIBL = prefiltered * (F_ibl * brdf.x + brdf.y);
+        ambient = (kD_ibl * diffuseIBL + specularIBL) * ao;
+    } else if (shParams.x > 0.5) {
+        // Дешевый вариант: только диффузная часть из SH
+        vec3 kD_sh = (vec3(1.0) - fresnelSchlick(max(dot(N, V), 0.0), F0)) * (1.0 - metallic);
+        ambient = kD_sh * shIrradiance(worldN) * albedo * ao;
+    }
     vec3 color = ambient + Lo;
     
     // Тонирование и гамма-коррекция
@@ -182,10 +275,10 @@ void main()
     FragColor = vec4(color, 1.0);
     
     // Отладочная сетка
-    if (debugWireframe) {
-        float edgeX = smoothstep(0.99, 1.0, abs(dFdx(TexCoord.x)));
-        float edgeY = smoothstep(0.99, 1.0, abs(dFdy(TexCoord.y)));
-        float edge = min(edgeX + edgeY, 1.0);
-        FragColor = mix(FragColor, vec4(1.0,0.0,0.0,1.0), edge);
-    }
+#ifdef DEBUG_WIREFRAME
+    float edgeX = smoothstep(0.99, 1.0, abs(dFdx(TexCoord.x)));
+    float edgeY = smoothstep(0.99, 1.0, abs(dFdy(TexCoord.y)));
+    float edge = min(edgeX + edgeY, 1.0);
+    FragColor = mix(FragColor, vec4(1.0,0.0,0.0,1.0), edge);
+#endif
 }
\ No newline at end of file
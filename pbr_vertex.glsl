@@ -12,16 +12,42 @@ out vec3 TangentLightPos;
 out vec3 TangentViewPos;
 out vec3 TangentFragPos;
 out vec3 OriginalNormal; // Для отладки
+out mat3 TangentToWorld;  // Перевод нормали из карты нормалей в мировое пространство (для IBL)
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-uniform bool hasNormalMap;
-uniform bool hasHeightMap;
+
+// Предварительный проход глубины (DEPTH_ONLY) и основной проход с GL_EQUAL
+// должны получить одинаковую глубину из разных программ
+invariant gl_Position;
+
+// Инстансинг (engine/model3d.c, MentalModelInstance): матрица занимает слоты 4–7
+#ifdef INSTANCED
+layout (location = 4) in mat4 instanceModel;
+layout (location = 8) in vec4 instanceTint;
+layout (location = 9) in uvec2 instanceIndex;   // x — LOD, y — смещение слоя материала
+flat out vec4 InstanceTint;
+flat out uint InstanceMaterial;
+#endif
+
+// Данные кадра (engine/frame.h), общий UBO для всех программ
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    float time;
+    vec3 lightPos;
+    float aspect;
+    vec3 lightColor;
+    float framePadding;
+    vec2 resolution;
+};
+
+// Варианты программы: HAS_NORMAL_MAP, HAS_HEIGHT_MAP задаются через #define (engine/model3d.c)
+#ifdef HAS_HEIGHT_MAP
 uniform sampler2D heightMap;
 uniform float heightScale = 0.1;
+#endif
 
 void main()
 {
@@ -30,29 +56,48 @@ void main()
     
     // Смещение позиции с учетом карты высот
     vec3 displacedPos = aPos;
-    if (hasHeightMap) {
-        float heightValue = texture(heightMap, fixedTexCoord).r;
-        displacedPos += aNormal * (heightValue - 0.5) * heightScale * 0.1;
-    }
+#ifdef HAS_HEIGHT_MAP
+    float heightValue = texture(heightMap, fixedTexCoord).r;
+    displacedPos += aNormal * (heightValue - 0.5) * heightScale * 0.1;
+#endif
     
     // Позиция в мировых координатах
-    FragPos = vec3(model * vec4(displacedPos, 1.0));
+#ifdef INSTANCED
+    mat4 world = model * instanceModel;
+#else
+    mat4 world = model;
+#endif
+    // Глубина должна побитово совпасть с проходом DEPTH_ONLY: до этой строки код общий
+    gl_Position = viewProjection * world * vec4(displacedPos, 1.0);
+
+#ifndef DEPTH_ONLY
+#ifdef INSTANCED
+    InstanceTint = instanceTint;
+    InstanceMaterial = instanceIndex.y;
+    // Масштаб экземпляров равномерный: обратная матрица на каждую вершину не нужна
+    Normal = normalize(mat3(world) * aNormal);
+#else
     Normal = mat3(transpose(inverse(model))) * aNormal;
+#endif
+    FragPos = vec3(world * vec4(displacedPos, 1.0));
     OriginalNormal = Normal; // Сохраняем для отладки
     TexCoord = fixedTexCoord;
+    TangentToWorld = mat3(1.0);
 
     // Касательное пространство (только если есть карта нормалей)
-    if (hasNormalMap) {
-        vec3 T = normalize(vec3(model * vec4(aTangent, 0.0)));
-        vec3 N = normalize(vec3(model * vec4(aNormal, 0.0)));
+#ifdef HAS_NORMAL_MAP
+    {
+        vec3 T = normalize(vec3(world * vec4(aTangent, 0.0)));
+        vec3 N = normalize(vec3(world * vec4(aNormal, 0.0)));
         T = normalize(T - dot(T, N) * N); // Ортогонализация
         vec3 B = cross(N, T);
         
-        mat3 TBN = transpose(mat3(T, B, N));
+        TangentToWorld = mat3(T, B, N);
+        mat3 TBN = transpose(TangentToWorld);
         TangentLightPos = TBN * lightPos;
         TangentViewPos = TBN * viewPos;
         TangentFragPos = TBN * FragPos;
     }
-    
-    gl_Position = projection * view * model * vec4(displacedPos, 1.0);
+#endif
+#endif
 }
\ No newline at end of file
@@ -4,22 +4,108 @@ layout (vertices = 3) out;
 in vec3 Position[];
 in vec2 TexCoord[];
 in vec3 Normal[];
+in vec3 Tangent[];
 
 out vec3 tcPosition[];
 out vec2 tcTexCoord[];
 out vec3 tcNormal[];
+out vec3 tcTangent[];
 
-uniform float TessLevel;
+// Данные кадра (engine/frame.h), общий UBO для всех программ
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    float time;
+    vec3 lightPos;
+    float aspect;
+    vec3 lightColor;
+    float framePadding;
+    vec2 resolution;
+};
+
+uniform float tessEdgePixels = 8.0;     // Желаемая длина сегмента ребра на экране
+uniform float tessMaxLevel = 64.0;      // Не больше GL_MAX_TESS_GEN_LEVEL
+#ifdef HAS_HEIGHT_MAP
+uniform float heightScale = 0.1;
+#endif
+
+// Патч, все вершины которого смотрят от камеры сильнее этого порога, не рисуется.
+// Запас покрывает наклон нормалей после смещения по карте высот
+const float BACKFACE_THRESHOLD = -0.25;
+
+// Уровень разбиения ребра по его размеру на экране. Проецируется сфера,
+// описанная вокруг ребра: результат зависит только от концов ребра, поэтому
+// соседние патчи получают одинаковый уровень и трещин нет
+float edgeLevel(vec3 a, vec3 b, float displacement)
+{
+    vec3 center = 0.5 * (a + b);
+    float radius = 0.5 * distance(a, b) + displacement;
+    float w = max((viewProjection * vec4(center, 1.0)).w, 1e-3);
+    float pixels = radius * projection[1][1] / w * resolution.y;
+    return clamp(pixels / tessEdgePixels, 1.0, tessMaxLevel);
+}
+
+// Патч целиком за одной плоскостью пирамиды видимости (с учетом диапазона смещения)
+bool outsideFrustum(float displacement)
+{
+    vec4 clip[6];
+    for (int i = 0; i < 3; i++) {
+        vec3 offset = normalize(Normal[i]) * displacement;
+        clip[i * 2]     = viewProjection * vec4(Position[i] + offset, 1.0);
+        clip[i * 2 + 1] = viewProjection * vec4(Position[i] - offset, 1.0);
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        bool allBelow = true;
+        bool allAbove = true;
+        for (int i = 0; i < 6; i++) {
+            allBelow = allBelow && clip[i][axis] < -clip[i].w;
+            allAbove = allAbove && clip[i][axis] > clip[i].w;
+        }
+        if (allBelow || allAbove) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool facingAway()
+{
+    for (int i = 0; i < 3; i++) {
+        if (dot(normalize(Normal[i]), normalize(viewPos - Position[i])) > BACKFACE_THRESHOLD) {
+            return false;
+        }
+    }
+    return true;
+}
 
 void main() {
     tcPosition[gl_InvocationID] = Position[gl_InvocationID];
     tcTexCoord[gl_InvocationID] = TexCoord[gl_InvocationID];
     tcNormal[gl_InvocationID] = Normal[gl_InvocationID];
+    tcTangent[gl_InvocationID] = Tangent[gl_InvocationID];
     
     if (gl_InvocationID == 0) {
-        gl_TessLevelInner[0] = TessLevel;
-        gl_TessLevelOuter[0] = TessLevel;
-        gl_TessLevelOuter[1] = TessLevel;
-        gl_TessLevelOuter[2] = TessLevel;
+        float displacement = 0.0;
+#ifdef HAS_HEIGHT_MAP
+        displacement = 0.5 * abs(heightScale);
+#endif
+        if (outsideFrustum(displacement) || facingAway()) {
+            // Нулевой уровень отбрасывает патч до TES
+            gl_TessLevelOuter[0] = 0.0;
+            gl_TessLevelOuter[1] = 0.0;
+            gl_TessLevelOuter[2] = 0.0;
+            gl_TessLevelInner[0] = 0.0;
+        } else {
+            // Внешний уровень i относится к ребру напротив вершины i
+            float e0 = edgeLevel(Position[1], Position[2], displacement);
+            float e1 = edgeLevel(Position[2], Position[0], displacement);
+            float e2 = edgeLevel(Position[0], Position[1], displacement);
+            gl_TessLevelOuter[0] = e0;
+            gl_TessLevelOuter[1] = e1;
+            gl_TessLevelOuter[2] = e2;
+            gl_TessLevelInner[0] = max(e0, max(e1, e2));
+        }
     }
-}
\ No newline at end of file
+}
@@ -1,19 +1,42 @@
 #version 410 core
-layout (triangles, equal_spacing, ccw) in;
+layout (triangles, fractional_odd_spacing, ccw) in;
 
 in vec3 tcPosition[];
 in vec2 tcTexCoord[];
 in vec3 tcNormal[];
+in vec3 tcTangent[];
 
-out vec3 tePosition;
-out vec2 teTexCoord;
-out vec3 teNormal;
+// Те же выходы, что у pbr_vertex.glsl: фрагментный шейдер общий
+out vec2 TexCoord;
+out vec3 Normal;
+out vec3 FragPos;
+out vec3 TangentLightPos;
+out vec3 TangentViewPos;
+out vec3 TangentFragPos;
+out vec3 OriginalNormal;
+out mat3 TangentToWorld;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Глубина совпадает с вариантом DEPTH_ONLY (предварительный проход, затем GL_EQUAL)
+invariant gl_Position;
+
+// Данные кадра (engine/frame.h), общий UBO для всех программ
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    float time;
+    vec3 lightPos;
+    float aspect;
+    vec3 lightColor;
+    float framePadding;
+    vec2 resolution;
+};
+
+#ifdef HAS_HEIGHT_MAP
 uniform sampler2D heightMap;
-uniform float heightScale;
+uniform float heightScale = 0.1;
+#endif
 
 void main() {
     vec3 pos = gl_TessCoord.x * tcPosition[0] + 
@@ -28,13 +51,32 @@ void main() {
                          gl_TessCoord.y * tcNormal[1] + 
                          gl_TessCoord.z * tcNormal[2]);
     
-    // Применяем карту высот
-    float heightValue = texture(heightMap, texCoord).r;
+    // Применяем карту высот (в мировых координатах, диапазон учитывает TCS)
+#ifdef HAS_HEIGHT_MAP
+    float heightValue = texture(heightMap, fract(texCoord)).r;
     pos += normal * (heightValue - 0.5) * heightScale;
+#endif
     
-    tePosition = pos;
-    teTexCoord = texCoord;
-    teNormal = normal;
-    
-    gl_Position = projection * view * model * vec4(pos, 1.0);
-}
\ No newline at end of file
+    gl_Position = viewProjection * vec4(pos, 1.0);
+
+#ifndef DEPTH_ONLY
+    FragPos = pos;
+    Normal = normal;
+    OriginalNormal = normal;
+    TexCoord = fract(texCoord);
+    TangentToWorld = mat3(1.0);
+
+#ifdef HAS_NORMAL_MAP
+    vec3 tangent = gl_TessCoord.x * tcTangent[0] + 
+                   gl_TessCoord.y * tcTangent[1] + 
+                   gl_TessCoord.z * tcTangent[2];
+    vec3 T = normalize(tangent - dot(tangent, normal) * normal); // Ортогонализация
+    vec3 B = cross(normal, T);
+    TangentToWorld = mat3(T, B, normal);
+    mat3 TBN = transpose(TangentToWorld);
+    TangentLightPos = TBN * lightPos;
+    TangentViewPos = TBN * viewPos;
+    TangentFragPos = TBN * FragPos;
+#endif
+#endif
+}
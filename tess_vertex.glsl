@@ -2,18 +2,20 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
 layout (location = 2) in vec3 aNormal;
+layout (location = 3) in vec3 aTangent;
 
+// Патч строится в мировых координатах: TCS оценивает по ним размер ребер
+// на экране, TES смещает вершины и проецирует их
 out vec3 Position;
 out vec2 TexCoord;
 out vec3 Normal;
+out vec3 Tangent;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main() {
     Position = vec3(model * vec4(aPos, 1.0));
     TexCoord = aTexCoord;
     Normal = mat3(transpose(inverse(model))) * aNormal;
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    Tangent = mat3(model) * aTangent;
+}
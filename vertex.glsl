@@ -2,9 +2,20 @@
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform float time;  // Время для анимации облаков
+
+// Данные кадра (engine/frame.h), общий UBO для всех программ
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    float time;
+    vec3 lightPos;
+    float aspect;
+    vec3 lightColor;
+    float framePadding;
+    vec2 resolution;
+};
 
 out vec2 TexCoord;
 out vec3 WorldPos;
@@ -14,5 +25,5 @@ void main()
     WorldPos = vec3(model * vec4(aPos, 1.0));
     TexCoord = aPos.xy + 0.5;  // Нормализованные координаты текстуры
     
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,30 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 WorldPos;
+
+// Параметры виртуальной текстуры
+uniform vec4 vtUVTransform;     // scale.xy, offset.zw
+uniform float vtSize;           // Сторона виртуальной текстуры в текселях
+uniform float vtTileSize;       // Сторона тайла без рамки
+uniform float vtMipCount;
+uniform float vtFeedbackBias;   // log2 делителя разрешения feedback буфера
+
+void main()
+{
+    vec2 uv = clamp(WorldPos.xz * vtUVTransform.xy + vtUVTransform.zw, 0.0, 0.99999);
+
+    // Мип-уровень по производным в текселях виртуальной текстуры.
+    // Буфер меньше экрана, поэтому производные больше и уровень нужно сдвинуть
+    vec2 texel = uv * vtSize;
+    float footprint = max(length(dFdx(texel)), length(dFdy(texel)));
+    float lod = log2(max(footprint, 1e-6)) - vtFeedbackBias;
+    float mip = clamp(floor(lod), 0.0, vtMipCount - 1.0);
+
+    // Номер страницы на выбранном уровне: младшие 8 бит в r/g, старшие 4+4 в b
+    vec2 page = floor(uv * (vtSize / vtTileSize) / exp2(mip));
+    vec2 high = floor(page / 256.0);
+    vec2 low = page - high * 256.0;
+
+    FragColor = vec4(low, high.x + high.y * 16.0, mip) / 255.0;
+}